@@ -42,6 +42,7 @@ HEADERS += \
 	addressdialog.h \
 	../interfaces/igpslookup.h \
 	../interfaces/irouter.h \
+	../interfaces/idistancetable.h \
 	bookmarksdialog.h \
 	routedescriptiondialog.h \
 	descriptiongenerator.h \
@@ -101,7 +102,7 @@ macx {
     ICON = ../images/AppIcons.icns
 }
 
-LIBS += -L../bin/plugins_client -lmapnikrendererclient -lcontractionhierarchiesclient -lgpsgridclient -losmrendererclient -lunicodetournamenttrieclient -lqtilerendererclient
+LIBS += -L../bin/plugins_client -lmapnikrendererclient -lhublabelsclient -lcontractionhierarchiesclient -lgpsgridclient -losmrendererclient -lunicodetournamenttrieclient -lqtilerendererclient
 
 # Required by osmrendererclient
 QT += network
@@ -34,6 +34,7 @@ along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
 
 Q_IMPORT_PLUGIN( mapnikrendererclient );
 Q_IMPORT_PLUGIN( contractionhierarchiesclient );
+Q_IMPORT_PLUGIN( hublabelsclient );
 Q_IMPORT_PLUGIN( gpsgridclient );
 Q_IMPORT_PLUGIN( unicodetournamenttrieclient );
 Q_IMPORT_PLUGIN( osmrendererclient );
@@ -53,6 +53,8 @@ struct MapData::PrivateImplementation {
 	IGPSLookup* gpsLookup;
 	// stores a pointer to the current router plugin
 	IRouter* router;
+	// the distance table interface of the router plugin
+	IDistanceTable* distanceTable;
 
 	MapPackage information;
 
@@ -95,6 +97,7 @@ bool MapData::PrivateImplementation::testPlugin( QObject* plugin )
 	if ( IRouter *interface = qobject_cast< IRouter* >( plugin ) ) {
 		if ( interface->GetName() == routerName ) {
 			router = interface;
+			distanceTable = qobject_cast< IDistanceTable* >( plugin );
 			needed = true;
 		}
 	}
@@ -111,6 +114,7 @@ MapData::MapData() :
 	d->gpsLookup = NULL;
 	d->renderer = NULL;
 	d->router = NULL;
+	d->distanceTable = NULL;
 
 	QSettings settings( "MoNavClient" );
 	settings.beginGroup( "MapData" );
@@ -432,6 +436,7 @@ bool MapData::load( const Module& routingModule, const Module& renderingModule,
 		d->gpsLookup = NULL;
 		d->renderer = NULL;
 		d->router = NULL;
+		d->distanceTable = NULL;
 
 		foreach( QPluginLoader* pluginLoader, d->plugins )
 		{
@@ -471,6 +476,7 @@ bool MapData::unload()
 	d->gpsLookup = NULL;
 	d->renderer = NULL;
 	d->router = NULL;
+	d->distanceTable = NULL;
 
 	foreach( QPluginLoader* pluginLoader, d->plugins )
 	{
@@ -655,3 +661,8 @@ IRouter* MapData::router()
 	return d->router;
 }
 
+IDistanceTable* MapData::distanceTable()
+{
+	return d->distanceTable;
+}
+
@@ -24,6 +24,7 @@ along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
 #include "interfaces/igpslookup.h"
 #include "interfaces/irenderer.h"
 #include "interfaces/irouter.h"
+#include "interfaces/idistancetable.h"
 #include "utils/coordinates.h"
 #include <QObject>
 #include <QString>
@@ -115,6 +116,8 @@ public:
 	IGPSLookup* gpsLookup();
 	IRenderer* renderer();
 	IRouter* router();
+	// NULL if the router does not compute distance tables
+	IDistanceTable* distanceTable();
 
 signals:
 
@@ -419,20 +419,25 @@ void RoutingLogic::computeRoundtrip()
 	qDebug() << "GPS Mass Lookup:" << time.restart() << "ms";
 
 	// compute all pair shortest paths
-	QVector< int > distMatrix( num * num, 0 );
-	for ( int from = 0; from < num; from++ ) {
-		for ( int to = 0; to < num; to++ ) {
-			// skip source == target
-			if ( from == to )
-				continue;
-
-			double travelTime = 0;
-			// lookup distance only
-			bool found = router->GetRoute( &travelTime, NULL, NULL, gps[from], gps[to] );
-			if ( !found )
-				travelTime = std::numeric_limits< double >::max();
-
-			distMatrix[from * num + to] = travelTime;
+	// use a distance table if the router supports one
+	QVector< double > table;
+	IDistanceTable* distanceTable = MapData::instance()->distanceTable();
+	if ( distanceTable == NULL || !distanceTable->GetDistanceTable( NULL, &table, gps, gps ) ) {
+		table.fill( 0, num * num );
+		for ( int from = 0; from < num; from++ ) {
+			for ( int to = 0; to < num; to++ ) {
+				// skip source == target
+				if ( from == to )
+					continue;
+
+				double travelTime = 0;
+				// lookup distance only
+				bool found = router->GetRoute( &travelTime, NULL, NULL, gps[from], gps[to] );
+				if ( !found )
+					travelTime = std::numeric_limits< double >::max();
+
+				table[from * num + to] = travelTime;
+			}
 		}
 	}
 
@@ -454,7 +459,8 @@ void RoutingLogic::computeRoundtrip()
 		for ( int pos = 1; pos < num + 1; pos++ )
 		{
 			// calculate cost
-			double distance = distMatrix[permutation[pos - 1] * num + permutation[pos]];
+			// unreachable targets have the maximum travel time
+			double distance = table[permutation[pos - 1] * num + permutation[pos]];
 			if ( distance == std::numeric_limits< double >::max() )
 			{
 				impossible = true;
@@ -0,0 +1,59 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IALTERNATIVEROUTES_H
+#define IALTERNATIVEROUTES_H
+
+#include "irouter.h"
+#include <QVector>
+#include <QtPlugin>
+
+// router plugins can support this interface to compute alternatives to the shortest route
+class IAlternativeRoutes
+{
+
+public:
+
+	struct Route {
+		double seconds;
+		QVector< IRouter::Node > pathNodes;
+		QVector< IRouter::Edge > pathEdges;
+	};
+
+	// admissibility of an alternative route, all values are fractions of the shortest route's travel time
+	struct Limits {
+		// maximum additional travel time
+		double stretch;
+		// maximum travel time shared with the shortest route and the previously selected alternatives
+		double sharing;
+		// every subpath of at most this length around the deviation has to be a shortest path
+		double localOptimality;
+		Limits() : stretch( 0.25 ), sharing( 0.8 ), localOptimality( 0.25 ) {}
+	};
+
+	virtual ~IAlternativeRoutes() {}
+
+	// computes the shortest route followed by up to maxAlternatives admissible alternatives, best first
+	// passing NULL as context uses the router's internal context, which is not reentrant
+	virtual bool GetAlternativeRoutes( IRouter::QueryContext* context, QVector< Route >* result, const IGPSLookup::Result& source, const IGPSLookup::Result& target, int maxAlternatives, const Limits& limits ) = 0;
+};
+
+Q_DECLARE_INTERFACE( IAlternativeRoutes, "monav.IAlternativeRoutes/1.0" )
+
+#endif // IALTERNATIVEROUTES_H
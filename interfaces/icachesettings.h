@@ -0,0 +1,56 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ICACHESETTINGS_H
+#define ICACHESETTINGS_H
+
+#include <QtPlugin>
+
+// client plugins can support this interface to let the application choose
+// how their data is held in memory
+// settings take effect on the next call of LoadData
+class ICacheSettings
+{
+
+public:
+
+	enum CacheMode {
+		// reads the data into a bounded cache, suitable for small devices
+		BoundedCache = 0,
+		// maps the data files into memory, no private copies are made
+		// memory usage is only bounded by the operating system's page cache
+		MemoryMapped = 1
+	};
+
+	virtual ~ICacheSettings() {}
+
+	virtual void SetCacheMode( CacheMode mode ) = 0;
+	virtual CacheMode GetCacheMode() = 0;
+	// memory budget in bytes of the bounded cache, every query context gets its own cache
+	virtual void SetCacheSize( unsigned bytes ) = 0;
+	virtual unsigned GetCacheSize() = 0;
+	// remembers the most used blocks on UnloadData and SaveWarmCache,
+	// the next LoadData reads them in bulk before the first query
+	virtual void SetWarmCache( bool enabled ) = 0;
+	virtual bool SaveWarmCache() = 0;
+};
+
+Q_DECLARE_INTERFACE( ICacheSettings, "monav.ICacheSettings/1.2" )
+
+#endif // ICACHESETTINGS_H
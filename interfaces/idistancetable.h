@@ -0,0 +1,46 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IDISTANCETABLE_H
+#define IDISTANCETABLE_H
+
+#include "irouter.h"
+#include <QVector>
+#include <QtPlugin>
+
+// router plugins can support this interface to compute distance tables
+// more efficiently than with one query per pair
+class IDistanceTable
+{
+
+public:
+
+	virtual ~IDistanceTable() {}
+
+	// computes the shortest path distance from every source to every target
+	// distances is filled with sources.size() * targets.size() entries in row-major order,
+	// the distance from sources[i] to targets[j] is stored at i * targets.size() + j
+	// unreachable targets have distance std::numeric_limits< double >::max()
+	// passing NULL as context uses the router's internal context, which is not reentrant
+	virtual bool GetDistanceTable( IRouter::QueryContext* context, QVector< double >* distances, const QVector< IGPSLookup::Result >& sources, const QVector< IGPSLookup::Result >& targets ) = 0;
+};
+
+Q_DECLARE_INTERFACE( IDistanceTable, "monav.IDistanceTable/1.0" )
+
+#endif // IDISTANCETABLE_H
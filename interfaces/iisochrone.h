@@ -0,0 +1,59 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IISOCHRONE_H
+#define IISOCHRONE_H
+
+#include "irouter.h"
+#include "utils/coordinates.h"
+#include <QVector>
+#include <QtPlugin>
+
+// router plugins can support this interface to compute travel times
+// from one source to the whole road network
+class IIsochrone
+{
+
+public:
+
+	struct ReachedNode {
+		UnsignedCoordinate coordinate;
+		double seconds;
+	};
+
+	struct Isochrone {
+		double seconds;
+		// outlines of the area reachable within seconds
+		// outer boundaries and holes have opposite orientation
+		QVector< QVector< UnsignedCoordinate > > rings;
+	};
+
+	virtual ~IIsochrone() {}
+
+	// computes the travel time to every routing node reachable within maxSeconds
+	// passing NULL as context uses the router's internal context, which is not reentrant
+	virtual bool GetReachableNodes( IRouter::QueryContext* context, QVector< ReachedNode >* result, const IGPSLookup::Result& source, double maxSeconds ) = 0;
+	// computes one isochrone for every limit
+	// the reachable roads are rasterized into square cells with a side length of resolution meters
+	virtual bool GetIsochrones( IRouter::QueryContext* context, QVector< Isochrone >* result, const IGPSLookup::Result& source, const QVector< double >& limits, double resolution ) = 0;
+};
+
+Q_DECLARE_INTERFACE( IIsochrone, "monav.IIsochrone/1.0" )
+
+#endif // IISOCHRONE_H
@@ -0,0 +1,81 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IQUERYSTATISTICS_H
+#define IQUERYSTATISTICS_H
+
+#include "irouter.h"
+#include <QtPlugin>
+#include <algorithm>
+
+// router plugins can support this interface to report what a query cost
+// collecting is disabled by default and should not slow down queries in that case
+class IQueryStatistics
+{
+
+public:
+
+	struct QueryStatistics {
+		// nodes settled by the forward / backward search
+		unsigned settledForward;
+		unsigned settledBackward;
+		// settled nodes that were proven to be reached sub-optimally
+		unsigned stalled;
+		unsigned relaxedEdges;
+		// edge blocks accessed and how many of them were not found in the block cache
+		unsigned blocks;
+		unsigned blocksRead;
+		// edge blocks accessed in decoded form, they did not touch the block cache
+		unsigned decodedBlocks;
+		// path blocks accessed and how many of them were not found in the block cache
+		unsigned pathBlocks;
+		unsigned pathBlocksRead;
+		// deepest recursion of the shortcut unpacking, 0 if no shortcut was split up
+		unsigned unpackDepth;
+		QueryStatistics() : settledForward( 0 ), settledBackward( 0 ), stalled( 0 ), relaxedEdges( 0 ), blocks( 0 ), blocksRead( 0 ),
+				decodedBlocks( 0 ), pathBlocks( 0 ), pathBlocksRead( 0 ), unpackDepth( 0 ) {}
+
+		// sums up the counters, keeps the deepest recursion
+		void add( const QueryStatistics& other )
+		{
+			settledForward += other.settledForward;
+			settledBackward += other.settledBackward;
+			stalled += other.stalled;
+			relaxedEdges += other.relaxedEdges;
+			blocks += other.blocks;
+			blocksRead += other.blocksRead;
+			decodedBlocks += other.decodedBlocks;
+			pathBlocks += other.pathBlocks;
+			pathBlocksRead += other.pathBlocksRead;
+			unpackDepth = std::max( unpackDepth, other.unpackDepth );
+		}
+	};
+
+	virtual ~IQueryStatistics() {}
+
+	// enables or disables collecting statistics for all following queries
+	virtual void SetCollectStatistics( bool enabled ) = 0;
+	// statistics of the last route computed with the context
+	// passing NULL as context uses the router's internal context
+	virtual bool GetQueryStatistics( IRouter::QueryContext* context, QueryStatistics* statistics ) = 0;
+};
+
+Q_DECLARE_INTERFACE( IQueryStatistics, "monav.IQueryStatistics/1.0" )
+
+#endif // IQUERYSTATISTICS_H
@@ -57,6 +57,14 @@ public:
 		unsigned seconds;
 	};
 
+	// holds the state of a single query, e.g., priority queues and caches
+	// a context must not be used by more than one thread at once,
+	// but any number of threads can query the same router concurrently using one context each
+	class QueryContext {
+	public:
+		virtual ~QueryContext() {}
+	};
+
 	virtual ~IRouter() {}
 
 	virtual QString GetName() = 0;
@@ -69,6 +77,12 @@ public:
 	// leaving pathNodes and pathEdges to NULL is supported and should result in significantly better performance
 	// this allows for computing shortest path distance only in a short amount of time
 	virtual bool GetRoute( double* distance, QVector< Node>* pathNodes, QVector< Edge >* pathEdges, const IGPSLookup::Result& source, const IGPSLookup::Result& target ) = 0;
+	// creates a new query context for the loaded data, returns NULL on failure
+	// the caller takes ownership and has to delete the context before the data is unloaded
+	virtual QueryContext* CreateQueryContext() = 0;
+	// same as GetRoute, but stores all query state in the context
+	// passing NULL uses the router's internal context, which is not reentrant
+	virtual bool GetRoute( QueryContext* context, double* distance, QVector< Node>* pathNodes, QVector< Edge >* pathEdges, const IGPSLookup::Result& source, const IGPSLookup::Result& target ) = 0;
 	// translate a name ID into the corresponding string
 	virtual bool GetName( QString* result, unsigned name ) = 0;
 	// translate a list of name IDs into the corresponding strings
@@ -79,6 +93,6 @@ public:
 	virtual bool GetTypes( QVector< QString >* result, QVector< unsigned > types ) = 0;
 };
 
-Q_DECLARE_INTERFACE( IRouter, "monav.IRouter/1.1" )
+Q_DECLARE_INTERFACE( IRouter, "monav.IRouter/1.2" )
 
 #endif // IROUTER_H
@@ -0,0 +1,72 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ITRAFFICOVERLAY_H
+#define ITRAFFICOVERLAY_H
+
+#include <QVector>
+#include <QtPlugin>
+
+// router plugins can support this interface to replace edge travel times without preprocessing the data again
+// updates are serialized and may run while other threads query, a query uses the travel times published when it started
+class ITrafficOverlay
+{
+
+public:
+
+	struct EdgeWeight {
+		// index of the edge in the importer's routing edges
+		unsigned edge;
+		// new travel time of the whole edge
+		double seconds;
+		EdgeWeight() : edge( 0 ), seconds( 0 ) {}
+		EdgeWeight( unsigned e, double s ) : edge( e ), seconds( s ) {}
+	};
+
+	struct UpdateStatistics {
+		// edges whose travel time changed
+		unsigned edges;
+		// edges of the update that are not part of the routing graph
+		unsigned ignored;
+		// derived edges, e.g. shortcuts, whose travel time was recomputed
+		unsigned shortcuts;
+		// derived edges whose travel time changed
+		unsigned changedShortcuts;
+		// edges currently differing from the preprocessed travel times
+		unsigned overlaidEdges;
+		// size of the part of the routing graph searched in both directions because travel times decreased there
+		unsigned regionNodes;
+		// exact routes computed since the previous update and those among them that needed a search of the whole graph
+		unsigned routes;
+		unsigned fallbacks;
+		int milliseconds;
+		UpdateStatistics() : edges( 0 ), ignored( 0 ), shortcuts( 0 ), changedShortcuts( 0 ), overlaidEdges( 0 ), regionNodes( 0 ), routes( 0 ), fallbacks( 0 ), milliseconds( 0 ) {}
+	};
+
+	virtual ~ITrafficOverlay() {}
+
+	// replaces the travel times of the given edges, all other edges keep their current travel time
+	virtual bool UpdateEdgeWeights( const QVector< EdgeWeight >& weights, UpdateStatistics* statistics ) = 0;
+	// restores the preprocessed travel times
+	virtual void ClearEdgeWeights() = 0;
+};
+
+Q_DECLARE_INTERFACE( ITrafficOverlay, "monav.ITrafficOverlay/1.0" )
+
+#endif // ITRAFFICOVERLAY_H
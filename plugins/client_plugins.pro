@@ -1,6 +1,7 @@
 TEMPLATE = subdirs
-SUBDIRS = ch gg osmr mr utt qr
+SUBDIRS = ch hl gg osmr mr utt qr
 ch.file = contractionhierarchies/contractionhierarchiesclient.pro
+hl.file = hublabels/hublabelsclient.pro
 gg.file = gpsgrid/gpsgridclient.pro
 osmr.file = osmrenderer/osmrendererclient.pro
 mr.file = osmrenderer/mapnikrendererclient.pro
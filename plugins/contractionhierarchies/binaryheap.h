@@ -51,6 +51,50 @@ class ArrayStorage {
 		Key* positions;
 };
 
+// array storage that is reset in O(1) by incrementing a generation counter
+// entries from previous generations are treated as not inserted
+template< typename NodeID, typename Key >
+class GenerationStorage {
+	public:
+
+		GenerationStorage( size_t size ) :
+				entries( size ), generation( 1 )
+		{
+		}
+
+		Key &operator[]( NodeID node )
+		{
+			Entry& entry = entries[node];
+			if ( entry.generation != generation ) {
+				entry.generation = generation;
+				// same as a default constructed entry of MapStorage
+				entry.key = 0;
+			}
+			return entry.key;
+		}
+
+		void clear()
+		{
+			generation++;
+			// overflow => entries might be mistaken for current ones
+			if ( generation == 0 ) {
+				for ( size_t i = 0; i < entries.size(); i++ )
+					entries[i].generation = 0;
+				generation = 1;
+			}
+		}
+
+	private:
+		struct Entry {
+			unsigned generation;
+			Key key;
+			Entry() : generation( 0 ), key( 0 ) {}
+		};
+
+		std::vector< Entry > entries;
+		unsigned generation;
+};
+
 template< typename NodeID, typename Key >
 class MapStorage {
 	public:
@@ -22,12 +22,17 @@ along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QFile>
 #include <QHash>
+#include <algorithm>
+#include <cstring>
 #include <limits>
+#include <vector>
 #include <QtDebug>
 
 // Block must have member function / variables:
 // variable id => block id
 // function void load( const unsigned char* buffer )
+// not thread-safe: every block access updates the LRU list,
+// threads have to use their own cache
 template< class Block >
 class BlockCache{
 
@@ -38,6 +43,7 @@ public:
 		m_cache = NULL;
 		m_LRU = NULL;
 		m_blocks = NULL;
+		m_misses = 0;
 	}
 
 	bool load( const QString& filename, int cacheBlocks, unsigned blockSize )
@@ -57,6 +63,7 @@ public:
 		m_firstLoaded = -1;
 		m_lastLoaded = -1;
 		m_loadedCount = 0;
+		m_misses = 0;
 
 		return true;
 	}
@@ -86,10 +93,70 @@ public:
 		return m_blocks + cacheID;
 	}
 
+	// blocks read from the file since the cache was loaded
+	unsigned misses() const
+	{
+		return m_misses;
+	}
+
+	// ids of the cached blocks, most recently used first
+	void recent( std::vector< unsigned >* blocks ) const
+	{
+		blocks->clear();
+		for ( int cacheID = m_firstLoaded; cacheID != -1; cacheID = m_LRU[cacheID].nextLoaded )
+			blocks->push_back( m_blocks[cacheID].id );
+	}
+
+	// reads blocks into the free space of the cache, most important first
+	// the blocks are read in file order, runs of adjacent blocks with a single read
+	// prefetched blocks do not count as misses, the most important one becomes the most recently used
+	unsigned prefetch( const std::vector< unsigned >& blocks )
+	{
+		const unsigned fileBlocks = m_inputFile.size() / m_blockSize;
+		std::vector< unsigned > selected;
+		QHash< unsigned, int > importance;
+		for ( unsigned i = 0; i < blocks.size() && m_loadedCount + ( int ) selected.size() < m_cacheBlocks; i++ ) {
+			if ( blocks[i] >= fileBlocks || m_index.contains( blocks[i] ) || importance.contains( blocks[i] ) )
+				continue;
+			importance[blocks[i]] = i;
+			selected.push_back( blocks[i] );
+		}
+		std::sort( selected.begin(), selected.end() );
+
+		std::vector< std::pair< int, int > > inserted;
+		std::vector< unsigned char > buffer;
+		for ( unsigned first = 0, end = 0; first < selected.size(); first = end ) {
+			end = first + 1;
+			while ( end < selected.size() && selected[end] == selected[end - 1] + 1 && end - first < maxPrefetchRun )
+				end++;
+			buffer.assign( ( end - first ) * m_blockSize, 0 );
+			m_inputFile.seek( ( long long ) selected[first] * m_blockSize );
+			m_inputFile.read( ( char* ) &buffer[0], buffer.size() );
+			for ( unsigned i = first; i < end; i++ ) {
+				const int cacheID = m_loadedCount++;
+				unsigned char* data = m_cache + cacheID * m_blockSize;
+				memcpy( data, &buffer[( i - first ) * m_blockSize], m_blockSize );
+				m_blocks[cacheID].load( selected[i], data );
+				m_index[selected[i]] = cacheID;
+				inserted.push_back( std::make_pair( importance[selected[i]], cacheID ) );
+			}
+		}
+
+		// insert the least important block first => the most important one ends up in front
+		std::sort( inserted.begin(), inserted.end() );
+		for ( int i = ( int ) inserted.size() - 1; i >= 0; i-- )
+			insertFront( inserted[i].second );
+		return inserted.size();
+	}
+
 private:
 
+	// blocks read at once by prefetch
+	static const unsigned maxPrefetchRun = 64;
+
 	const Block* loadBlock( unsigned block )
 	{
+		m_misses++;
 		int freeBlock = m_loadedCount;
 		// cache is full => select least recently used block
 		if ( m_loadedCount == m_cacheBlocks ) {
@@ -98,14 +165,7 @@ private:
 			m_index.remove( m_blocks[freeBlock].id );
 			useBlock( freeBlock );
 		} else {
-			//insert into the front of the list
-			m_LRU[freeBlock].previousLoaded = -1;
-			m_LRU[freeBlock].nextLoaded = m_firstLoaded;
-			if ( m_firstLoaded != -1 )
-				m_LRU[m_firstLoaded].previousLoaded = freeBlock;
-			if ( m_lastLoaded == -1 )
-				m_lastLoaded = freeBlock;
-			m_firstLoaded = freeBlock;
+			insertFront( freeBlock );
 			m_loadedCount++;
 		}
 
@@ -118,6 +178,18 @@ private:
 		return m_blocks + freeBlock;
 	}
 
+	// inserts a block not in the list yet into the front of the list
+	void insertFront( int cacheID )
+	{
+		m_LRU[cacheID].previousLoaded = -1;
+		m_LRU[cacheID].nextLoaded = m_firstLoaded;
+		if ( m_firstLoaded != -1 )
+			m_LRU[m_firstLoaded].previousLoaded = cacheID;
+		if ( m_lastLoaded == -1 )
+			m_lastLoaded = cacheID;
+		m_firstLoaded = cacheID;
+	}
+
 	void useBlock( int cacheID )
 	{
 		assert( m_firstLoaded != -1 );
@@ -153,6 +225,7 @@ private:
 	int m_lastLoaded;
 	int m_loadedCount;
 	int m_cacheBlocks;
+	unsigned m_misses;
 	unsigned m_blockSize;
 	QFile m_inputFile;
 	QHash< unsigned, int > m_index;
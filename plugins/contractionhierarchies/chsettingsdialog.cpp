@@ -16,6 +16,7 @@ CHSettingsDialog::~CHSettingsDialog()
 bool CHSettingsDialog::readSettings( const ContractionHierarchies::Settings& settings )
 {
 	m_ui->blockSize->setValue( settings.blockSize );
+	m_ui->edgeBased->setChecked( settings.edgeBased );
 	return true;
 }
 
@@ -24,5 +25,6 @@ bool CHSettingsDialog::fillSettings( ContractionHierarchies::Settings* settings
 	if ( settings == NULL )
 		return false;
 	settings->blockSize = m_ui->blockSize->value();
+	settings->edgeBased = m_ui->edgeBased->isChecked();
 	return true;
 }
@@ -23,10 +23,14 @@ along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
 #include "interfaces/irouter.h"
 #include "utils/coordinates.h"
 #include "utils/bithelpers.h"
+#include "utils/bitunpack.h"
 #include "blockcache.h"
+#include "mappedblocks.h"
+#include "frequencycache.h"
 #include <QString>
 #include <QFile>
 #include <algorithm>
+#include <limits>
 #include <vector>
 
 class CompressedGraph {
@@ -86,6 +90,46 @@ protected:
 		}
 	};
 
+	// the edges of a block decoded into plain arrays, one array per field
+	// scanning the edges of a frequently used node does not need any bit operations
+	struct DecodedBlock {
+		enum Flags {
+			Forward = 1, Backward = 2, Shortcut = 4, Unpacked = 8, Reversed = 16, BranchingPossible = 32
+		};
+
+		unsigned id;
+		// nodeCount + 1 entries: index of a node's first edge and its position in the block
+		// the positions keep the edge IDs the same as in the compressed block
+		std::vector< unsigned > firstEdge;
+		std::vector< unsigned > firstPosition;
+		std::vector< NodeIterator > target;
+		std::vector< unsigned > distance;
+		std::vector< unsigned char > flags;
+		// unpacked edge => path, shortcut => middle, otherwise name ID
+		std::vector< unsigned > data;
+		std::vector< unsigned char > type;
+		// position of the next edge in the block
+		std::vector< unsigned > endPosition;
+
+		void clear()
+		{
+			firstEdge.clear();
+			firstPosition.clear();
+			target.clear();
+			distance.clear();
+			flags.clear();
+			data.clear();
+			type.clear();
+			endPosition.clear();
+		}
+
+		size_t bytes() const
+		{
+			return sizeof( DecodedBlock ) + ( firstEdge.size() + firstPosition.size() ) * sizeof( unsigned )
+					+ target.size() * ( sizeof( NodeIterator ) + 3 * sizeof( unsigned ) + 2 * sizeof( unsigned char ) );
+		}
+	};
+
 	struct PathBlock {
 
 		struct DataItem {
@@ -157,6 +201,31 @@ protected:
 
 	};
 
+	// compressed path format: the path items are split into groups of pathGroupSize items, groups do not span blocks
+	// block: first group ( 32 bits ), reference x / y ( 32 bits each ), number of groups ( 16 bits ), group offsets ( 16 bits each ) | groups
+	// group: number of items ( 8 bits ), node mask ( 16 bits ) | items
+	// node: x / y as zigzag varint deltas to the previous node of the group, the first node to the block's reference coordinate
+	// edge: ( name << 1 | branching ), type, length as varints, encoded seconds ( 8 bits )
+	enum PathFormat {
+		RawPaths = 0, CompressedPaths = 1
+	};
+
+	static const unsigned pathGroupSize = 16;
+	static const unsigned pathBlockHeaderSize = 14;
+
+	// the last decoded group of a cache, paths are read sequentially
+	struct PathGroup {
+		unsigned id;
+		unsigned size;
+		PathBlock::DataItem items[pathGroupSize];
+
+		PathGroup()
+		{
+			id = std::numeric_limits< unsigned >::max();
+			size = 0;
+		}
+	};
+
 public:
 
 	// TYPES
@@ -215,16 +284,28 @@ public:
 		NodeIterator middle() const { return m_data.middle; }
 		unsigned distance() const { return m_data.distance; }
 		IRouter::Edge description() const { return IRouter::Edge( m_data.description.nameID, m_data.description.branchingPossible, m_data.description.type, 1, ( m_data.distance + 5 ) / 10 ); }
+		// identifies the edge, stable as long as the graph is loaded
+		quint64 id() const { return ( ( quint64 ) m_blockID << 32 ) | m_position; }
 #ifdef NDEBUG
 	private:
 #endif
 
 		EdgeIterator( unsigned source, const Block& block, unsigned position, unsigned end ) :
-				m_block( &block ), m_source( source ), m_position( position ), m_end( end )
+				m_block( &block ), m_decoded( NULL ), m_blockID( block.id ), m_source( source ), m_position( position ), m_end( end )
+		{
+		}
+
+		EdgeIterator( unsigned source, const DecodedBlock& block ) :
+				m_block( NULL ), m_decoded( &block ), m_index( block.firstEdge[source] ), m_blockID( block.id ), m_source( source ),
+				m_position( block.firstPosition[source] ), m_end( block.firstPosition[source + 1] )
 		{
 		}
 
 		const Block* m_block;
+		// != NULL => the edges are read from the decoded arrays
+		const DecodedBlock* m_decoded;
+		unsigned m_index;
+		unsigned m_blockID;
 		NodeIterator m_target;
 		NodeIterator m_source;
 		unsigned m_position;
@@ -249,11 +330,81 @@ public:
 		} m_data;
 	};
 
+	// block caches used by a single thread
+	// the graph itself is read-only after loading, the caches are not:
+	// every thread querying the graph concurrently has to use its own cache
+	class Cache {
+
+		friend class CompressedGraph;
+
+	public:
+
+		// accesses since the cache was loaded, the counters wrap around
+		struct Counters {
+			unsigned blocks;
+			unsigned blocksRead;
+			unsigned decodedBlocks;
+			unsigned pathBlocks;
+			unsigned pathBlocksRead;
+		};
+
+		Cache()
+		{
+			m_loaded = false;
+			m_blocks = 0;
+			m_decodedBlocks = 0;
+			m_pathBlocks = 0;
+		}
+
+		Counters counters() const
+		{
+			Counters result;
+			result.blocks = m_blocks;
+			result.blocksRead = m_blockCache.misses();
+			result.decodedBlocks = m_decodedBlocks;
+			result.pathBlocks = m_pathBlocks;
+			result.pathBlocksRead = m_pathCache.misses();
+			return result;
+		}
+
+		~Cache()
+		{
+			unload();
+		}
+
+		void unload()
+		{
+			m_blockCache.unload();
+			m_pathCache.unload();
+			m_decodedCache.unload();
+			m_pathGroup = PathGroup();
+			m_loaded = false;
+		}
+
+	private:
+
+		BlockCache< Block > m_blockCache;
+		BlockCache< PathBlock > m_pathCache;
+		// second tier in front of the block cache, holds the most frequently used blocks decoded
+		FrequencyCache< DecodedBlock > m_decodedCache;
+		DecodedBlock m_decodeBuffer;
+		std::vector< unsigned > m_unpackBuffer;
+		PathGroup m_pathGroup;
+		unsigned m_blocks;
+		unsigned m_decodedBlocks;
+		unsigned m_pathBlocks;
+		bool m_loaded;
+	};
+
 	// FUNCTIONS
 
 	CompressedGraph()
 	{
 		m_loaded = false;
+		m_memoryMapped = false;
+		m_numberOfBlocks = 0;
+		m_decodedCacheSize = 0;
+		m_settings.pathFormat = RawPaths;
 	}
 
 	~CompressedGraph()
@@ -262,7 +413,9 @@ public:
 			unloadGraph();
 	}
 
-	bool loadGraph( QString filename, unsigned cacheSize )
+	// memoryMapped: map the graph files into memory instead of reading them into a bounded cache
+	// all block headers are loaded in advance and shared by all caches
+	bool loadGraph( QString filename, unsigned cacheSize, bool memoryMapped = false )
 	{
 		if ( m_loaded )
 			unloadGraph();
@@ -272,33 +425,212 @@ public:
 			return false;
 		}
 		m_settings.read( settingsFile );
-		if ( !m_blockCache.load( filename + "_edges", cacheSize / m_settings.blockSize / 2 + 1, m_settings.blockSize ) )
+		if ( m_settings.pathFormat == CompressedPaths && !readPathIndex( filename + "_paths_index" ) )
+			return false;
+		if ( QFile::exists( filename + "_core" ) && !readCore( filename + "_core" ) )
 			return false;
-		if ( !m_pathCache.load( filename + "_paths", cacheSize / m_settings.blockSize / 2 + 1, m_settings.blockSize ) )
+		QFile edgesFile( filename + "_edges" );
+		if ( !edgesFile.open( QIODevice::ReadOnly ) ) {
+			qCritical() << "failed to open file:" << edgesFile.fileName();
 			return false;
+		}
+		m_numberOfBlocks = edgesFile.size() / m_settings.blockSize;
+		edgesFile.close();
+		m_filename = filename;
+		m_cacheSize = cacheSize;
+		m_memoryMapped = memoryMapped;
+		if ( m_memoryMapped ) {
+			if ( !m_mappedBlocks.load( filename + "_edges", m_settings.blockSize ) )
+				return false;
+			if ( !m_mappedPathBlocks.load( filename + "_paths", m_settings.blockSize ) ) {
+				m_mappedBlocks.unload();
+				return false;
+			}
+		}
 		m_loaded = true;
 		return true;
 	}
 
 	void unloadGraph()
 	{
-		m_blockCache.unload();
-		m_pathCache.unload();
+		std::vector< unsigned >().swap( m_pathIndex );
+		std::vector< DecodedBlock >().swap( m_core );
+		m_mappedBlocks.unload();
+		m_mappedPathBlocks.unload();
+		m_loaded = false;
+	}
+
+	bool memoryMapped() const
+	{
+		return m_memoryMapped;
+	}
+
+	// memory budget of the decoded blocks of each cache, 0 disables decoding
+	// takes effect for caches loaded afterwards
+	void setDecodedCacheSize( size_t bytes )
+	{
+		m_decodedCacheSize = bytes;
+	}
+
+	// writes the edges of the blocks holding the most important nodes decoded into a separate file
+	// graphs loaded afterwards keep them in memory for all caches, queries never fetch these blocks
+	bool writeCore( QString filename, unsigned nodes )
+	{
+		assert( m_loaded );
+		QFile coreFile( filename );
+		if ( !coreFile.open( QIODevice::WriteOnly ) ) {
+			qCritical() << "failed to open file:" << coreFile.fileName();
+			return false;
+		}
+		Cache cache;
+		if ( !loadCache( &cache ) )
+			return false;
+		unsigned blocks = 0;
+		for ( unsigned coreNodes = 0; blocks < m_numberOfBlocks && coreNodes < nodes; blocks++ )
+			coreNodes += numberOfNodes( &cache, blocks );
+
+		unsigned header[2] = { coreFileVersion, blocks };
+		coreFile.write( ( const char* ) header, sizeof( header ) );
+		DecodedBlock decoded;
+		std::vector< unsigned > buffer;
+		for ( unsigned block = 0; block < blocks; block++ ) {
+			decodeBlock( *getBlock( &cache, block ), &buffer, &decoded );
+			unsigned counts[2] = { ( unsigned ) decoded.firstEdge.size() - 1, ( unsigned ) decoded.target.size() };
+			coreFile.write( ( const char* ) counts, sizeof( counts ) );
+			writeVector( &coreFile, decoded.firstEdge );
+			writeVector( &coreFile, decoded.firstPosition );
+			writeVector( &coreFile, decoded.target );
+			writeVector( &coreFile, decoded.distance );
+			writeVector( &coreFile, decoded.flags );
+			writeVector( &coreFile, decoded.data );
+			writeVector( &coreFile, decoded.type );
+			writeVector( &coreFile, decoded.endPosition );
+		}
+		qDebug() << "wrote core:" << blocks << "blocks," << coreFile.size() / 1024 << "KB";
+		return true;
+	}
+
+	// the blocks a cache relies on, most important first
+	// the edge blocks by access frequency, then the blocks of the block cache by recency
+	void hotBlocks( Cache* cache, std::vector< unsigned >* blocks, std::vector< unsigned >* pathBlocks )
+	{
+		assert( cache->m_loaded );
+		std::vector< unsigned > hottest;
+		std::vector< unsigned > recent;
+		cache->m_decodedCache.hottest( &hottest );
+		if ( !m_memoryMapped )
+			cache->m_blockCache.recent( &recent );
+		hottest.insert( hottest.end(), recent.begin(), recent.end() );
+		std::vector< bool > listed( m_numberOfBlocks, false );
+		blocks->clear();
+		for ( unsigned i = 0; i < hottest.size(); i++ ) {
+			if ( hottest[i] >= m_numberOfBlocks || listed[hottest[i]] )
+				continue;
+			listed[hottest[i]] = true;
+			blocks->push_back( hottest[i] );
+		}
+		pathBlocks->clear();
+		if ( !m_memoryMapped )
+			cache->m_pathCache.recent( pathBlocks );
+	}
+
+	// version, block size, number of blocks of the graph, number of edge blocks, number of path blocks | the block ids
+	bool writeHotBlocks( QString filename, Cache* cache )
+	{
+		std::vector< unsigned > blocks;
+		std::vector< unsigned > pathBlocks;
+		hotBlocks( cache, &blocks, &pathBlocks );
+		QFile hotFile( filename );
+		if ( !hotFile.open( QIODevice::WriteOnly ) ) {
+			qDebug() << "failed to open file:" << hotFile.fileName();
+			return false;
+		}
+		unsigned header[5] = { hotFileVersion, m_settings.blockSize, m_numberOfBlocks, ( unsigned ) blocks.size(), ( unsigned ) pathBlocks.size() };
+		hotFile.write( ( const char* ) header, sizeof( header ) );
+		writeVector( &hotFile, blocks );
+		writeVector( &hotFile, pathBlocks );
+		return true;
+	}
+
+	// fails if the file was written for a different graph
+	bool readHotBlocks( QString filename, std::vector< unsigned >* blocks, std::vector< unsigned >* pathBlocks )
+	{
+		QFile hotFile( filename );
+		if ( !hotFile.open( QIODevice::ReadOnly ) )
+			return false;
+		unsigned header[5];
+		if ( hotFile.read( ( char* ) header, sizeof( header ) ) != sizeof( header ) )
+			return false;
+		if ( header[0] != hotFileVersion || header[1] != m_settings.blockSize || header[2] != m_numberOfBlocks ) {
+			qDebug() << "hot blocks belong to a different graph:" << hotFile.fileName();
+			return false;
+		}
+		if ( !readVector( &hotFile, header[3], blocks ) || !readVector( &hotFile, header[4], pathBlocks ) ) {
+			blocks->clear();
+			pathBlocks->clear();
+			return false;
+		}
+		return true;
 	}
 
-	EdgeIterator edges( NodeIterator node )
+	// reads the blocks into the cache in file order, as many as fit
+	// in memory mapped mode the operating system is asked to read them in the background instead
+	unsigned prefetch( Cache* cache, const std::vector< unsigned >& blocks, const std::vector< unsigned >& pathBlocks )
+	{
+		if ( m_memoryMapped ) {
+			m_mappedBlocks.prefetch( blocks );
+			m_mappedPathBlocks.prefetch( pathBlocks );
+			return blocks.size() + pathBlocks.size();
+		}
+		assert( cache->m_loaded );
+		return cache->m_blockCache.prefetch( blocks ) + cache->m_pathCache.prefetch( pathBlocks );
+	}
+
+	// opens the graph files for a cache, each cache uses cacheSize bytes
+	// in memory mapped mode caches are not used and no memory is allocated
+	bool loadCache( Cache* cache )
+	{
+		assert( m_loaded );
+		cache->unload();
+		cache->m_decodedCache.load( m_numberOfBlocks, m_decodedCacheSize, decodedMinimumAccesses );
+		if ( m_memoryMapped ) {
+			cache->m_loaded = true;
+			return true;
+		}
+		if ( !cache->m_blockCache.load( m_filename + "_edges", m_cacheSize / m_settings.blockSize / 2 + 1, m_settings.blockSize ) )
+			return false;
+		if ( !cache->m_pathCache.load( m_filename + "_paths", m_cacheSize / m_settings.blockSize / 2 + 1, m_settings.blockSize ) )
+			return false;
+		cache->m_loaded = true;
+		return true;
+	}
+
+	EdgeIterator edges( Cache* cache, NodeIterator node )
 	{
 		unsigned blockID = nodeToBlock( node );
 		unsigned internal = nodeToInternal( node );
-		const Block* block = getBlock( blockID );
+		if ( blockID < m_core.size() ) {
+			cache->m_decodedBlocks++;
+			return EdgeIterator( internal, m_core[blockID] );
+		}
+		if ( cache->m_decodedCache.enabled() ) {
+			const DecodedBlock* decoded = cache->m_decodedCache.find( blockID );
+			if ( decoded == NULL && cache->m_decodedCache.admit( blockID ) )
+				decoded = decodeBlock( cache, blockID );
+			if ( decoded != NULL ) {
+				cache->m_decodedBlocks++;
+				return EdgeIterator( internal, *decoded );
+			}
+		}
+		const Block* block = getBlock( cache, blockID );
 		return unpackFirstEdges( *block, internal );
 	}
 
-	EdgeIterator findEdge( NodeIterator source, NodeIterator target, unsigned id )
+	EdgeIterator findEdge( Cache* cache, NodeIterator source, NodeIterator target, unsigned id )
 	{
 		if ( source < target )
 			std::swap( source, target );
-		EdgeIterator e = edges( source );
+		EdgeIterator e = edges( cache, source );
 		while ( e.hasEdgesLeft() ) {
 			unpackNextEdge( &e );
 			if ( e.target() != target )
@@ -318,6 +650,11 @@ public:
 
 	void unpackNextEdge( EdgeIterator* edge )
 	{
+		if ( edge->m_decoded != NULL ) {
+			unpackDecodedEdge( edge );
+			return;
+		}
+
 		const Block& block = *edge->m_block;
 		EdgeIterator::EdgeData& edgeData = edge->m_data;
 		const unsigned char* buffer = block.buffer + ( edge->m_position >> 3 );
@@ -381,11 +718,37 @@ public:
 		edge->m_position = ( buffer - block.buffer ) * 8 + offset;
 	}
 
-	IRouter::Node node( NodeIterator node )
+	void unpackDecodedEdge( EdgeIterator* edge )
+	{
+		const DecodedBlock& block = *edge->m_decoded;
+		EdgeIterator::EdgeData& edgeData = edge->m_data;
+		const unsigned index = edge->m_index++;
+		const unsigned flags = block.flags[index];
+
+		edge->m_target = block.target[index];
+		edgeData.distance = block.distance[index];
+		edgeData.forward = ( flags & DecodedBlock::Forward ) != 0;
+		edgeData.backward = ( flags & DecodedBlock::Backward ) != 0;
+		edgeData.shortcut = ( flags & DecodedBlock::Shortcut ) != 0;
+		edgeData.unpacked = ( flags & DecodedBlock::Unpacked ) != 0;
+		if ( edgeData.unpacked ) {
+			edgeData.reversed = ( flags & DecodedBlock::Reversed ) != 0;
+			edgeData.path = block.data[index];
+		} else if ( edgeData.shortcut ) {
+			edgeData.middle = block.data[index];
+		} else {
+			edgeData.description.nameID = block.data[index];
+			edgeData.description.branchingPossible = ( flags & DecodedBlock::BranchingPossible ) != 0;
+			edgeData.description.type = block.type[index];
+		}
+		edge->m_position = block.endPosition[index];
+	}
+
+	IRouter::Node node( Cache* cache, NodeIterator node )
 	{
 		unsigned blockID = nodeToBlock( node );
 		unsigned internal = nodeToInternal( node );
-		const Block* block = getBlock( blockID );
+		const Block* block = getBlock( cache, blockID );
 		IRouter::Node result;
 		unpackCoordinates( *block, internal, &result.coordinate );
 		return result;
@@ -396,24 +759,72 @@ public:
 		return m_settings.numberOfNodes;
 	}
 
+	// node IDs are not contiguous, but all IDs are smaller than this bound
+	unsigned numberOfNodeIDs() const
+	{
+		return m_numberOfBlocks << m_settings.internalBits;
+	}
+
+	unsigned numberOfBlocks() const
+	{
+		return m_numberOfBlocks;
+	}
+
+	// number of nodes stored in a block
+	unsigned numberOfNodes( Cache* cache, unsigned block )
+	{
+		return getBlock( cache, block )->settings.nodeCount;
+	}
+
+	// coordinates of all nodes of a block, indexed by internal ID
+	void blockCoordinates( Cache* cache, unsigned blockID, std::vector< UnsignedCoordinate >* result )
+	{
+		const Block* block = getBlock( cache, blockID );
+		const unsigned nodeCount = block->settings.nodeCount;
+		const unsigned stride = block->settings.xBits + block->settings.yBits;
+		std::vector< unsigned >& buffer = cache->m_unpackBuffer;
+		buffer.resize( nodeCount );
+		result->resize( nodeCount );
+		if ( nodeCount == 0 )
+			return;
+		unpack_bits( block->buffer, block->nodeCoordinates, block->settings.xBits, stride, nodeCount, &buffer[0] );
+		for ( unsigned node = 0; node < nodeCount; node++ )
+			( *result )[node].x = buffer[node] + block->settings.minX;
+		unpack_bits( block->buffer, block->nodeCoordinates + block->settings.xBits, block->settings.yBits, stride, nodeCount, &buffer[0] );
+		for ( unsigned node = 0; node < nodeCount; node++ )
+			( *result )[node].y = buffer[node] + block->settings.minY;
+	}
+
+	// ID of the internal-th node of a block
+	NodeIterator nodeID( unsigned block, unsigned internal )
+	{
+		return nodeFromDescriptor( block, internal );
+	}
+
+	// block containing the node
+	unsigned nodeBlock( NodeIterator node )
+	{
+		return nodeToBlock( node );
+	}
+
 	unsigned numberOfEdges() const
 	{
 		return m_settings.numberOfEdges;
 	}
 
 	template< class T, class S >
-	void path( const EdgeIterator& edge, T path, S edges, bool forward )
+	void path( Cache* cache, const EdgeIterator& edge, T path, S edges, bool forward )
 	{
 		assert( edge.unpacked() );
 		unsigned pathBegin = path->size();
 		unsigned edgesBegin = edges->size();
 		int increase = edge.m_data.reversed ? -1 : 1;
 
-		IRouter::Node targetNode = node( edge.target() );
+		IRouter::Node targetNode = node( cache, edge.target() );
 		unsigned pathID = edge.m_data.path;
 
 		if ( !forward ) {
-			PathBlock::DataItem data = unpackPath( pathID );
+			PathBlock::DataItem data = unpackPath( cache, pathID );
 			assert( data.isNode() );
 			path->push_back( data.toNode().coordinate );
 		}
@@ -421,7 +832,7 @@ public:
 		pathID += increase;
 
 		while( true ) {
-			PathBlock::DataItem data = unpackPath( pathID );
+			PathBlock::DataItem data = unpackPath( cache, pathID );
 			if ( data.isEdge() ) {
 				edges->push_back( data.toEdge() );
 				pathID += increase;
@@ -457,6 +868,8 @@ protected:
 		unsigned char nameBits;
 		unsigned numberOfNodes;
 		unsigned numberOfEdges;
+		// PathFormat, missing in old files
+		unsigned char pathFormat;
 
 		void read( QFile& in )
 		{
@@ -467,6 +880,8 @@ protected:
 			in.read( ( char* ) &nameBits, sizeof( nameBits ) );
 			in.read( ( char* ) &numberOfNodes, sizeof( numberOfNodes ) );
 			in.read( ( char* ) &numberOfEdges, sizeof( numberOfEdges ) );
+			if ( in.read( ( char* ) &pathFormat, sizeof( pathFormat ) ) != sizeof( pathFormat ) )
+				pathFormat = RawPaths;
 		}
 
 		void write( QFile& out )
@@ -478,6 +893,7 @@ protected:
 			out.write( ( const char* ) &nameBits, sizeof( nameBits ) );
 			out.write( ( const char* ) &numberOfNodes, sizeof( numberOfNodes ) );
 			out.write( ( const char* ) &numberOfEdges, sizeof( numberOfEdges ) );
+			out.write( ( const char* ) &pathFormat, sizeof( pathFormat ) );
 		}
 	};
 
@@ -488,16 +904,75 @@ protected:
 
 	// FUNCTIONS
 
-	PathBlock::DataItem unpackPath( unsigned position ) {
+	PathBlock::DataItem unpackPath( Cache* cache, unsigned position ) {
+		if ( m_settings.pathFormat == CompressedPaths ) {
+			PathGroup& group = cache->m_pathGroup;
+			if ( group.id != position / pathGroupSize ) {
+				group.id = position / pathGroupSize;
+				unsigned blockID = std::upper_bound( m_pathIndex.begin(), m_pathIndex.end(), group.id ) - m_pathIndex.begin() - 1;
+				decodePathGroup( *getPathBlock( cache, blockID ), group.id, &group );
+			}
+			assert( position % pathGroupSize < group.size );
+			return group.items[position % pathGroupSize];
+		}
+
 		unsigned blockID = position / ( m_settings.blockSize / 8 );
 		unsigned internal = ( position % ( m_settings.blockSize / 8 ) ) * 8;
-		const PathBlock* block = getPathBlock( blockID );
+		const PathBlock* block = getPathBlock( cache, blockID );
 		PathBlock::DataItem data;
 		data.a = *( ( unsigned* ) ( block->buffer + internal ) );
 		data.b = *( ( unsigned* ) ( block->buffer + internal + 4 ) );
 		return data;
 	}
 
+	static void decodePathGroup( const PathBlock& block, unsigned groupID, PathGroup* group )
+	{
+		const char* header = ( const char* ) block.buffer;
+		const unsigned firstGroup = readUnaligned< unsigned >( header );
+		unsigned x = readUnaligned< unsigned >( header + 4 );
+		unsigned y = readUnaligned< unsigned >( header + 8 );
+		assert( groupID >= firstGroup && groupID - firstGroup < readUnaligned< unsigned short >( header + 12 ) );
+		const unsigned short offset = readUnaligned< unsigned short >( header + pathBlockHeaderSize + 2 * ( groupID - firstGroup ) );
+
+		const unsigned char* buffer = block.buffer + offset;
+		group->size = *buffer++;
+		const unsigned nodeMask = readUnaligned< unsigned short >( ( const char* ) buffer );
+		buffer += 2;
+		for ( unsigned i = 0; i < group->size; i++ ) {
+			PathBlock::DataItem& item = group->items[i];
+			if ( ( nodeMask & ( 1u << i ) ) != 0 ) {
+				x += decode_zigzag( read_varint( &buffer ) );
+				y += decode_zigzag( read_varint( &buffer ) );
+				item.a = ( x << 1 ) | 1;
+				item.b = y;
+			} else {
+				item.a = read_varint( &buffer ) << 1;
+				const unsigned type = read_varint( &buffer );
+				const unsigned length = read_varint( &buffer );
+				item.b = ( type << 24 ) | ( length << 8 ) | *buffer++;
+			}
+		}
+	}
+
+	// first group of each path block
+	bool readPathIndex( QString filename )
+	{
+		QFile indexFile( filename );
+		if ( !indexFile.open( QIODevice::ReadOnly ) ) {
+			qCritical() << "failed to open file:" << indexFile.fileName();
+			return false;
+		}
+		m_pathIndex.resize( indexFile.size() / sizeof( unsigned ) );
+		if ( m_pathIndex.empty() )
+			return true;
+		const qint64 size = m_pathIndex.size() * sizeof( unsigned );
+		if ( indexFile.read( ( char* ) &m_pathIndex[0], size ) != size ) {
+			qCritical() << "failed to read file:" << indexFile.fileName();
+			return false;
+		}
+		return true;
+	}
+
 	void unpackCoordinates( const Block& block, unsigned node, UnsignedCoordinate* result )
 	{
 		unsigned position = block.nodeCoordinates + ( block.settings.xBits + block.settings.yBits ) * node;
@@ -517,14 +992,138 @@ protected:
 		return EdgeIterator( node, block, begin + block.edges, end + block.edges );
 	}
 
-	const Block* getBlock( unsigned block )
+	static const unsigned coreFileVersion = 1;
+
+	static const unsigned hotFileVersion = 1;
+
+	// a block has to be accessed this often before it is decoded
+	static const unsigned decodedMinimumAccesses = 16;
+
+	const DecodedBlock* decodeBlock( Cache* cache, unsigned blockID )
+	{
+		decodeBlock( *getBlock( cache, blockID ), &cache->m_unpackBuffer, &cache->m_decodeBuffer );
+		return cache->m_decodedCache.insert( blockID, cache->m_decodeBuffer );
+	}
+
+	void decodeBlock( const Block& block, std::vector< unsigned >* firstEdgeBuffer, DecodedBlock* result )
+	{
+		DecodedBlock& decoded = *result;
+		decoded.clear();
+		decoded.id = block.id;
+		const unsigned nodeCount = block.settings.nodeCount;
+		std::vector< unsigned >& firstEdges = *firstEdgeBuffer;
+		firstEdges.resize( nodeCount + 1 );
+		unpack_bits( block.buffer, block.firstEdges, block.settings.firstEdgeBits, block.settings.firstEdgeBits, nodeCount + 1, &firstEdges[0] );
+		for ( unsigned node = 0; node < nodeCount; node++ ) {
+			EdgeIterator edge( node, block, firstEdges[node] + block.edges, firstEdges[node + 1] + block.edges );
+			decoded.firstEdge.push_back( decoded.target.size() );
+			decoded.firstPosition.push_back( edge.m_position );
+			while ( edge.hasEdgesLeft() ) {
+				unpackNextEdge( &edge );
+				const EdgeIterator::EdgeData& edgeData = edge.m_data;
+				unsigned flags = 0;
+				flags |= edgeData.forward ? DecodedBlock::Forward : 0;
+				flags |= edgeData.backward ? DecodedBlock::Backward : 0;
+				flags |= edgeData.shortcut ? DecodedBlock::Shortcut : 0;
+				flags |= edgeData.unpacked ? DecodedBlock::Unpacked : 0;
+				unsigned data;
+				unsigned char type = 0;
+				if ( edgeData.unpacked ) {
+					flags |= edgeData.reversed ? DecodedBlock::Reversed : 0;
+					data = edgeData.path;
+				} else if ( edgeData.shortcut ) {
+					data = edgeData.middle;
+				} else {
+					flags |= edgeData.description.branchingPossible ? DecodedBlock::BranchingPossible : 0;
+					data = edgeData.description.nameID;
+					type = edgeData.description.type;
+				}
+				decoded.target.push_back( edge.target() );
+				decoded.distance.push_back( edgeData.distance );
+				decoded.flags.push_back( flags );
+				decoded.data.push_back( data );
+				decoded.type.push_back( type );
+				decoded.endPosition.push_back( edge.m_position );
+			}
+		}
+		decoded.firstEdge.push_back( decoded.target.size() );
+		decoded.firstPosition.push_back( firstEdges[nodeCount] + block.edges );
+	}
+
+	template< class T >
+	static void writeVector( QFile* file, const std::vector< T >& data )
+	{
+		if ( !data.empty() )
+			file->write( ( const char* ) &data[0], data.size() * sizeof( T ) );
+	}
+
+	template< class T >
+	static bool readVector( QFile* file, unsigned size, std::vector< T >* data )
+	{
+		data->resize( size );
+		if ( size == 0 )
+			return true;
+		const qint64 bytes = size * sizeof( T );
+		return file->read( ( char* ) &( *data )[0], bytes ) == bytes;
+	}
+
+	// version, number of blocks | per block: number of nodes, number of edges, DecodedBlock arrays
+	bool readCore( QString filename )
+	{
+		QFile coreFile( filename );
+		if ( !coreFile.open( QIODevice::ReadOnly ) ) {
+			qCritical() << "failed to open file:" << coreFile.fileName();
+			return false;
+		}
+		unsigned header[2];
+		if ( coreFile.read( ( char* ) header, sizeof( header ) ) != sizeof( header ) || header[0] != coreFileVersion ) {
+			qCritical() << "core file format not compatible:" << coreFile.fileName();
+			return false;
+		}
+		m_core.resize( header[1] );
+		size_t bytes = 0;
+		unsigned nodes = 0;
+		for ( unsigned block = 0; block < m_core.size(); block++ ) {
+			DecodedBlock& decoded = m_core[block];
+			unsigned counts[2];
+			bool ok = coreFile.read( ( char* ) counts, sizeof( counts ) ) == sizeof( counts );
+			ok = ok && readVector( &coreFile, counts[0] + 1, &decoded.firstEdge );
+			ok = ok && readVector( &coreFile, counts[0] + 1, &decoded.firstPosition );
+			ok = ok && readVector( &coreFile, counts[1], &decoded.target );
+			ok = ok && readVector( &coreFile, counts[1], &decoded.distance );
+			ok = ok && readVector( &coreFile, counts[1], &decoded.flags );
+			ok = ok && readVector( &coreFile, counts[1], &decoded.data );
+			ok = ok && readVector( &coreFile, counts[1], &decoded.type );
+			ok = ok && readVector( &coreFile, counts[1], &decoded.endPosition );
+			if ( !ok ) {
+				qCritical() << "core file corrupted:" << coreFile.fileName();
+				std::vector< DecodedBlock >().swap( m_core );
+				return false;
+			}
+			decoded.id = block;
+			bytes += decoded.bytes();
+			nodes += counts[0];
+		}
+		qDebug() << "loaded core:" << m_core.size() << "blocks," << nodes << "nodes," << bytes / 1024 << "KB";
+		return true;
+	}
+
+	const Block* getBlock( Cache* cache, unsigned block )
 	{
-		return m_blockCache.getBlock( block );
+		assert( cache->m_loaded );
+		cache->m_blocks++;
+		if ( m_memoryMapped )
+			return m_mappedBlocks.getBlock( block );
+		return cache->m_blockCache.getBlock( block );
 	}
 
-	const PathBlock* getPathBlock( unsigned block )
+	const PathBlock* getPathBlock( Cache* cache, unsigned block )
 	{
-		return m_pathCache.getBlock( block );
+		assert( cache->m_loaded );
+		cache->m_pathBlocks++;
+		if ( m_memoryMapped )
+			return m_mappedPathBlocks.getBlock( block );
+		return cache->m_pathCache.getBlock( block );
 	}
 
 	unsigned nodeToBlock( NodeIterator node )
@@ -593,8 +1192,16 @@ protected:
 	// VARIABLES
 
 	GlobalSettings m_settings;
-	BlockCache< Block > m_blockCache;
-	BlockCache< PathBlock > m_pathCache;
+	QString m_filename;
+	unsigned m_cacheSize;
+	unsigned m_numberOfBlocks;
+	bool m_memoryMapped;
+	MappedBlocks< Block > m_mappedBlocks;
+	MappedBlocks< PathBlock > m_mappedPathBlocks;
+	std::vector< unsigned > m_pathIndex;
+	// decoded blocks of the most important nodes, shared by all caches
+	std::vector< DecodedBlock > m_core;
+	size_t m_decodedCacheSize;
 	bool m_loaded;
 };
 
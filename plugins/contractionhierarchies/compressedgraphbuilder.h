@@ -33,11 +33,16 @@ public:
 
 	typedef IImporter::RoutingEdge OriginalEdge;
 
-	CompressedGraphBuilder( unsigned blockSize, std::vector< IRouter::Node >& inputNodes, std::vector< Edge >& inputEdges, std::vector< OriginalEdge >& originalEdges, std::vector< IRouter::Node >& edgePaths )
+	// unpackedNodes: the shortcuts of the unpackedNodes most important nodes store their unpacked path even if their middle node shares their block
+	CompressedGraphBuilder( unsigned blockSize, std::vector< IRouter::Node >& inputNodes, std::vector< Edge >& inputEdges, std::vector< OriginalEdge >& originalEdges, std::vector< IRouter::Node >& edgePaths, unsigned unpackedNodes = 0 )
 	{
 		m_settings.blockSize = blockSize;
+		m_unpackedNodes = unpackedNodes;
+		m_blockReserve = 0;
 		m_settings.numberOfNodes = inputNodes.size();
 		m_settings.numberOfEdges = inputEdges.size();
+		// the group offsets are 16 bit and the largest group has to fit into a block
+		m_settings.pathFormat = blockSize >= 512 && blockSize <= 65536 ? CompressedPaths : RawPaths;
 		m_nodes.swap( inputNodes );
 		m_edges.swap( inputEdges );
 		m_originalEdges.swap( originalEdges );
@@ -55,8 +60,76 @@ public:
 		return createGraph( filename, remap );
 	}
 
+	// leaves this percentage of every block free when computing the block layout, a single node may still fill a whole block
+	void setBlockReserve( unsigned percent )
+	{
+		m_blockReserve = m_settings.blockSize / 100 * std::min( percent, 100u );
+	}
+
+	// keeps the block layout of a previous run instead of computing one, the node IDs of the graph stay the same
+	// firstNodes: the first node of every block followed by the number of nodes, run fails if a block cannot hold its nodes
+	void setBlockLayout( const std::vector< unsigned >& firstNodes )
+	{
+		m_firstNodes = firstNodes;
+	}
+
+	// computes the block layout without writing the graph, for a layout shared with other edges of the same nodes
+	// the builder cannot run afterwards
+	bool computeBlockLayout()
+	{
+		return computeLayout();
+	}
+
+	// the block layout of the last run
+	void getBlockLayout( std::vector< unsigned >* firstNodes ) const
+	{
+		*firstNodes = m_firstNodes;
+	}
+
+	// stores the input of the builder, tools can rebuild the graph with other settings without contracting again
+	// version, number of nodes, edges, original edges and path nodes | the arrays
+	static bool writeInput( QString filename, const std::vector< IRouter::Node >& inputNodes, const std::vector< Edge >& inputEdges, const std::vector< OriginalEdge >& originalEdges, const std::vector< IRouter::Node >& edgePaths )
+	{
+		QFile inputFile( filename );
+		if ( !openQFile( &inputFile, QIODevice::WriteOnly ) )
+			return false;
+		unsigned header[5] = { inputFileVersion, ( unsigned ) inputNodes.size(), ( unsigned ) inputEdges.size(), ( unsigned ) originalEdges.size(), ( unsigned ) edgePaths.size() };
+		inputFile.write( ( const char* ) header, sizeof( header ) );
+		writeVector( &inputFile, inputNodes );
+		writeVector( &inputFile, inputEdges );
+		writeVector( &inputFile, originalEdges );
+		writeVector( &inputFile, edgePaths );
+		qDebug() << "wrote builder input:" << inputFile.size() / 1024 / 1024 << "MB";
+		return true;
+	}
+
+	static bool readInput( QString filename, std::vector< IRouter::Node >* inputNodes, std::vector< Edge >* inputEdges, std::vector< OriginalEdge >* originalEdges, std::vector< IRouter::Node >* edgePaths )
+	{
+		QFile inputFile( filename );
+		if ( !openQFile( &inputFile, QIODevice::ReadOnly ) )
+			return false;
+		unsigned header[5];
+		if ( inputFile.read( ( char* ) header, sizeof( header ) ) != sizeof( header ) || header[0] != inputFileVersion ) {
+			qCritical() << "builder input format not compatible:" << inputFile.fileName();
+			return false;
+		}
+		bool ok = readVector( &inputFile, header[1], inputNodes );
+		ok = ok && readVector( &inputFile, header[2], inputEdges );
+		ok = ok && readVector( &inputFile, header[3], originalEdges );
+		ok = ok && readVector( &inputFile, header[4], edgePaths );
+		if ( !ok ) {
+			qCritical() << "builder input corrupted:" << inputFile.fileName();
+			return false;
+		}
+		return true;
+	}
+
 private:
 
+	static const unsigned inputFileVersion = 1;
+	// amount of blocks encoded in parallel before they are written
+	static const unsigned blockBatchSize = 256;
+
 	// STRUCTS
 
 	struct BlockBuilder: public Block {
@@ -139,9 +212,8 @@ private:
 					<< "MB /" << ( graph.m_edges.size() - shortcuts - unpackedEdges ) * ( 32 + 32 + 32 ) / 8 / 1024 / 1024 << "MB";
 		}
 
-		void addBlock( const CompressedGraphBuilder& graph )
+		void addBlock( const CompressedGraphBuilder& graph, const BlockBuilder& block )
 		{
-			const BlockBuilder& block = graph.m_block;
 			adjacentBlocks += block.settings.adjacentBlockCount;
 			if ( block.settings.shortWeightBits == block.settings.longWeightBits )
 				noWeightSplit++;
@@ -194,190 +266,192 @@ private:
 	// FUNCTIONS
 
 	// Adds a new builder block starting at node
-	void initBlock( unsigned blockID, unsigned firstNode )
+	void initBlock( BlockBuilder* block, unsigned blockID, unsigned firstNode ) const
 	{
-		m_block.id = blockID;
+		block->id = blockID;
 		// Settings + 64Bit buffer
-		m_block.baseSize = sizeof( Block::Settings ) + 4;
-		m_block.maxX = 0;
-		m_block.maxY = 0;
-		m_block.firstNode = firstNode;
-
-		m_block.settings.blockBits = bits_needed( blockID - 1 );
-		m_block.settings.externalBits = 0;
-		m_block.settings.firstEdgeBits = 0;
-		m_block.settings.shortWeightBits = 0;
-		m_block.settings.longWeightBits = 0;
-		m_block.settings.xBits = 0;
-		m_block.settings.yBits = 0;
-		m_block.settings.minX = std::numeric_limits< unsigned >::max();
-		m_block.settings.minY = std::numeric_limits< unsigned >::max();
-		m_block.settings.adjacentBlockCount = 0;
-		m_block.settings.nodeCount = 0;
-
-		m_block.internalShortcutCount = 0;
-		m_block.shortcutCount = 0;
-		m_block.externalEdgeCount = 0;
-		m_block.internalEdgeTargetSize = 0;
-		m_block.edgeCount = 0;
-		m_block.singleDirectionCount = 0;
-		m_block.singleDirectionUnpackedCount = 0;
-		m_block.unpackedEdgeCount = 0;
-		m_block.weightDistribution.clear();
-		m_block.weightDistribution.resize( 33, 0 );
-		m_block.internalShortcutTargets.clear();
-		m_block.internalDirectedShortcutTargets.clear();
-		m_block.adjacentBlocks.clear();
+		block->baseSize = sizeof( Block::Settings ) + 4;
+		block->maxX = 0;
+		block->maxY = 0;
+		block->firstNode = firstNode;
+
+		block->settings.blockBits = bits_needed( blockID - 1 );
+		block->settings.externalBits = 0;
+		block->settings.firstEdgeBits = 0;
+		block->settings.shortWeightBits = 0;
+		block->settings.longWeightBits = 0;
+		block->settings.xBits = 0;
+		block->settings.yBits = 0;
+		block->settings.minX = std::numeric_limits< unsigned >::max();
+		block->settings.minY = std::numeric_limits< unsigned >::max();
+		block->settings.adjacentBlockCount = 0;
+		block->settings.nodeCount = 0;
+
+		block->internalShortcutCount = 0;
+		block->shortcutCount = 0;
+		block->externalEdgeCount = 0;
+		block->internalEdgeTargetSize = 0;
+		block->edgeCount = 0;
+		block->singleDirectionCount = 0;
+		block->singleDirectionUnpackedCount = 0;
+		block->unpackedEdgeCount = 0;
+		block->weightDistribution.clear();
+		block->weightDistribution.resize( 33, 0 );
+		block->internalShortcutTargets.clear();
+		block->internalDirectedShortcutTargets.clear();
+		block->adjacentBlocks.clear();
 	}
 
-	bool addNode ( unsigned node ) {
-		m_block.settings.nodeCount++;
+	// adds the next node to the block, fails if the block would exceed the block size minus the reserved bytes
+	// does not remap the node => only reads the shared data
+	bool addNode ( BlockBuilder* block, unsigned node, unsigned reserve = 0 ) const {
+		block->settings.nodeCount++;
 
-		m_block.settings.minX = std::min( m_nodes[node].coordinate.x, m_block.settings.minX );
-		m_block.settings.minY = std::min( m_nodes[node].coordinate.y, m_block.settings.minY );
-		m_block.maxX = std::max( m_nodes[node].coordinate.x, m_block.maxX );
-		m_block.maxY = std::max( m_nodes[node].coordinate.y, m_block.maxY );
+		block->settings.minX = std::min( m_nodes[node].coordinate.x, block->settings.minX );
+		block->settings.minY = std::min( m_nodes[node].coordinate.y, block->settings.minY );
+		block->maxX = std::max( m_nodes[node].coordinate.x, block->maxX );
+		block->maxY = std::max( m_nodes[node].coordinate.y, block->maxY );
 
-		m_block.settings.xBits = bits_needed( m_block.maxX - m_block.settings.minX );
-		m_block.settings.yBits = bits_needed( m_block.maxY - m_block.settings.minY );
+		block->settings.xBits = bits_needed( block->maxX - block->settings.minX );
+		block->settings.yBits = bits_needed( block->maxY - block->settings.minY );
 
-		unsigned internalTargetBits = bits_needed( node - m_block.firstNode ); // loops + previous nodes
+		unsigned internalTargetBits = bits_needed( node - block->firstNode ); // loops + previous nodes
 		for ( unsigned i = m_firstEdges[node]; i < m_firstEdges[node + 1]; i++ ) {
 			const Edge& edge = m_edges[i];
 
 			if ( !edge.data.forward || !edge.data.backward )
-				m_block.singleDirectionCount++;
+				block->singleDirectionCount++;
 
 			unsigned char weightBits = bits_needed( edge.data.distance );
-			m_block.weightDistribution[weightBits]++;
-			m_block.settings.longWeightBits = std::max( weightBits, m_block.settings.longWeightBits );
+			block->weightDistribution[weightBits]++;
+			block->settings.longWeightBits = std::max( weightBits, block->settings.longWeightBits );
 
-			if ( edge.target >= m_block.firstNode ) {
-				m_block.internalEdgeTargetSize += internalTargetBits; // we only need to address previous nodes due to DAG property
+			if ( edge.target >= block->firstNode ) {
+				block->internalEdgeTargetSize += internalTargetBits; // we only need to address previous nodes due to DAG property
 			} else {
-				m_block.externalEdgeCount++;
-				int block = m_nodeIDs[edge.target].block;
-				if ( !m_block.adjacentBlocks.contains( block ) ) {
-					m_block.adjacentBlocks.insert( block, m_block.adjacentBlocks.size() );
-					m_block.settings.externalBits = std::max( m_externalBits[block], m_block.settings.externalBits );
+				block->externalEdgeCount++;
+				int targetBlock = m_nodeIDs[edge.target].block;
+				if ( !block->adjacentBlocks.contains( targetBlock ) ) {
+					block->adjacentBlocks.insert( targetBlock, block->adjacentBlocks.size() );
+					block->settings.externalBits = std::max( m_externalBits[targetBlock], block->settings.externalBits );
 				}
 			}
 
-			if ( edge.data.shortcut ) {
-				m_block.shortcutCount++;
-				m_block.unpackedEdgeCount++;
-				m_block.internalShortcutTargets[edge.data.middle]++;
+			if ( edge.data.shortcut )
+				block->shortcutCount++;
+			if ( edge.data.shortcut && node >= m_unpackedNodes ) {
+				block->unpackedEdgeCount++;
+				block->internalShortcutTargets[edge.data.middle]++;
 				if ( !edge.data.forward || !edge.data.backward ) {
-					m_block.singleDirectionUnpackedCount++;
-					m_block.internalDirectedShortcutTargets[edge.data.middle]++;
+					block->singleDirectionUnpackedCount++;
+					block->internalDirectedShortcutTargets[edge.data.middle]++;
 				}
 			} else {
 				if ( mustUnpack( i ) ) {
-					m_block.unpackedEdgeCount++;
+					block->unpackedEdgeCount++;
 					if ( !edge.data.forward || !edge.data.backward )
-						m_block.singleDirectionUnpackedCount++;
+						block->singleDirectionUnpackedCount++;
 				}
 			}
 		}
 
-		m_block.edgeCount += m_firstEdges[node + 1] - m_firstEdges[node];
-		m_block.internalShortcutCount += m_block.internalShortcutTargets[node];
-		m_block.unpackedEdgeCount -= m_block.internalShortcutTargets[node];
-		m_block.singleDirectionUnpackedCount -= m_block.internalDirectedShortcutTargets[node];
-		m_block.settings.adjacentBlockCount = m_block.adjacentBlocks.size();
+		block->edgeCount += m_firstEdges[node + 1] - m_firstEdges[node];
+		block->internalShortcutCount += block->internalShortcutTargets[node];
+		block->unpackedEdgeCount -= block->internalShortcutTargets[node];
+		block->singleDirectionUnpackedCount -= block->internalDirectedShortcutTargets[node];
+		block->settings.adjacentBlockCount = block->adjacentBlocks.size();
 
 		int size = 0;
-		size += m_block.edgeCount * ( 1 + 1 + 1 ); // forward / backward + shortcut + target ( external vs internal ) flags
-		size += m_block.singleDirectionCount; // backward & forward takes up only 1 bit
-		size += m_block.externalEdgeCount * ( bits_needed( m_block.settings.adjacentBlockCount - 1 ) + m_block.settings.externalBits ); // external targets
-		size += m_block.internalEdgeTargetSize; // internal targets
-		size += m_block.edgeCount * ( 1 ); // unpacked flag
-		size += m_block.unpackedEdgeCount * ( m_settings.pathBits + 1 ); // unpacked + reversed flag
-		size -= m_block.singleDirectionUnpackedCount; // directed edges do not need a reverse flag
-		size += m_block.internalShortcutCount * bits_needed( node - m_block.firstNode ); // internal middle
+		size += block->edgeCount * ( 1 + 1 + 1 ); // forward / backward + shortcut + target ( external vs internal ) flags
+		size += block->singleDirectionCount; // backward & forward takes up only 1 bit
+		size += block->externalEdgeCount * ( bits_needed( block->settings.adjacentBlockCount - 1 ) + block->settings.externalBits ); // external targets
+		size += block->internalEdgeTargetSize; // internal targets
+		size += block->edgeCount * ( 1 ); // unpacked flag
+		size += block->unpackedEdgeCount * ( m_settings.pathBits + 1 ); // unpacked + reversed flag
+		size -= block->singleDirectionUnpackedCount; // directed edges do not need a reverse flag
+		size += block->internalShortcutCount * bits_needed( node - block->firstNode ); // internal middle
 		unsigned shortWeightsCount = 0;
 		unsigned minimumWeightSize = std::numeric_limits< unsigned >::max();
-		for ( int bits = 0; bits <= m_block.settings.longWeightBits; bits++ ) {
-			shortWeightsCount += m_block.weightDistribution[bits];
-			unsigned weightSize = shortWeightsCount * bits + ( m_block.edgeCount - shortWeightsCount ) * m_block.settings.longWeightBits;
-			if ( bits != m_block.settings.longWeightBits )
-				weightSize += m_block.edgeCount; // long vs short flag
+		for ( int bits = 0; bits <= block->settings.longWeightBits; bits++ ) {
+			shortWeightsCount += block->weightDistribution[bits];
+			unsigned weightSize = shortWeightsCount * bits + ( block->edgeCount - shortWeightsCount ) * block->settings.longWeightBits;
+			if ( bits != block->settings.longWeightBits )
+				weightSize += block->edgeCount; // long vs short flag
 			if ( weightSize < minimumWeightSize ) {
 				minimumWeightSize = weightSize;
-				m_block.settings.shortWeightBits = bits;
+				block->settings.shortWeightBits = bits;
 			}
 		}
 		size += minimumWeightSize;
-		size += ( m_block.edgeCount - m_block.internalShortcutCount - m_block.unpackedEdgeCount ) * ( m_settings.typeBits + m_settings.nameBits + 1 );
+		size += ( block->edgeCount - block->internalShortcutCount - block->unpackedEdgeCount ) * ( m_settings.typeBits + m_settings.nameBits + 1 );
 		// size == edge block size => compute firstEdgeBits
-		m_block.settings.firstEdgeBits = bits_needed( size );
-		size += m_block.settings.xBits * m_block.settings.nodeCount; // x coordinate
-		size += m_block.settings.yBits * m_block.settings.nodeCount; // y coordinate
-		size += m_block.settings.firstEdgeBits * ( m_block.settings.nodeCount + 1 ); // first edge entries
-		size += m_block.settings.blockBits * m_block.settings.adjacentBlockCount; // adjacent blocks entries
-
-		m_block.size = size;
-
-		if ( ( size + 7 ) / 8 + m_block.baseSize > m_settings.blockSize ) {
-			if ( m_block.settings.nodeCount == 1 ) {
+		block->settings.firstEdgeBits = bits_needed( size );
+		size += block->settings.xBits * block->settings.nodeCount; // x coordinate
+		size += block->settings.yBits * block->settings.nodeCount; // y coordinate
+		size += block->settings.firstEdgeBits * ( block->settings.nodeCount + 1 ); // first edge entries
+		size += block->settings.blockBits * block->settings.adjacentBlockCount; // adjacent blocks entries
+
+		block->size = size;
+
+		const unsigned bytes = ( size + 7 ) / 8 + block->baseSize;
+		if ( bytes > m_settings.blockSize - reserve ) {
+			if ( block->settings.nodeCount == 1 && bytes <= m_settings.blockSize )
+				return true;
+			if ( block->settings.nodeCount == 1 ) {
 				qCritical() << "ERROR: a node requires more space than a single block can suffice\n"
-						<< "block:" << m_block.id << "node:" << node << "size:" << size << "maxSize:" << m_settings.blockSize << "\n"
+						<< "block:" << block->id << "node:" << node << "size:" << size << "maxSize:" << m_settings.blockSize << "\n"
 						<< "try increasing the block size";
 				exit( -1 ); // TODO return gracefully!
 			}
 			return false;
 		}
 
-		//remap nodes
-		m_nodeIDs[node].block = m_block.id;
-		m_nodeIDs[node].node = node - m_block.firstNode;
-
 		return true;
 	}
 
-	void writeBlock( QFile& blockFile )
+	// encodes the block into the zeroed buffer, only reads the shared data => blocks can be encoded in parallel
+	void writeBlock( BlockBuilder* block, unsigned char* blockBuffer )
 	{
-		m_block.internalBits = bits_needed( m_block.settings.nodeCount - 1 );
+		block->internalBits = bits_needed( block->settings.nodeCount - 1 );
 
-		memset( m_blockBuffer, 0, m_settings.blockSize );
-		unsigned char* buffer = m_blockBuffer;
+		unsigned char* buffer = blockBuffer;
 		int offset = 0;
 
 		// write settings
-		write_unaligned_unsigned( &buffer, m_block.settings.blockBits, 8, &offset );
-		write_unaligned_unsigned( &buffer, m_block.settings.externalBits, 8, &offset );
-		write_unaligned_unsigned( &buffer, m_block.settings.firstEdgeBits, 8, &offset );
-		write_unaligned_unsigned( &buffer, m_block.settings.shortWeightBits, 8, &offset );
-		write_unaligned_unsigned( &buffer, m_block.settings.longWeightBits, 8, &offset );
-		write_unaligned_unsigned( &buffer, m_block.settings.xBits, 8, &offset );
-		write_unaligned_unsigned( &buffer, m_block.settings.yBits, 8, &offset );
-		write_unaligned_unsigned( &buffer, m_block.settings.minX, 32, &offset );
-		write_unaligned_unsigned( &buffer, m_block.settings.minY, 32, &offset );
-		write_unaligned_unsigned( &buffer, m_block.settings.nodeCount, 32, &offset );
-		write_unaligned_unsigned( &buffer, m_block.settings.adjacentBlockCount, 32, &offset );
+		write_unaligned_unsigned( &buffer, block->settings.blockBits, 8, &offset );
+		write_unaligned_unsigned( &buffer, block->settings.externalBits, 8, &offset );
+		write_unaligned_unsigned( &buffer, block->settings.firstEdgeBits, 8, &offset );
+		write_unaligned_unsigned( &buffer, block->settings.shortWeightBits, 8, &offset );
+		write_unaligned_unsigned( &buffer, block->settings.longWeightBits, 8, &offset );
+		write_unaligned_unsigned( &buffer, block->settings.xBits, 8, &offset );
+		write_unaligned_unsigned( &buffer, block->settings.yBits, 8, &offset );
+		write_unaligned_unsigned( &buffer, block->settings.minX, 32, &offset );
+		write_unaligned_unsigned( &buffer, block->settings.minY, 32, &offset );
+		write_unaligned_unsigned( &buffer, block->settings.nodeCount, 32, &offset );
+		write_unaligned_unsigned( &buffer, block->settings.adjacentBlockCount, 32, &offset );
 
 		unsigned char* beginBuffer = buffer;
 		int beginOffset = offset;
 
 		// write coordinates
-		for ( unsigned i = 0; i < m_block.settings.nodeCount; i++ ) {
-			unsigned node = i + m_block.firstNode;
-			write_unaligned_unsigned( &buffer, m_nodes[node].coordinate.x - m_block.settings.minX, m_block.settings.xBits, &offset );
-			write_unaligned_unsigned( &buffer, m_nodes[node].coordinate.y - m_block.settings.minY, m_block.settings.yBits, &offset );
+		for ( unsigned i = 0; i < block->settings.nodeCount; i++ ) {
+			unsigned node = i + block->firstNode;
+			write_unaligned_unsigned( &buffer, m_nodes[node].coordinate.x - block->settings.minX, block->settings.xBits, &offset );
+			write_unaligned_unsigned( &buffer, m_nodes[node].coordinate.y - block->settings.minY, block->settings.yBits, &offset );
 		}
 
 		// write adjacent blocks
-		std::vector< unsigned > adjacentBlocks( m_block.settings.adjacentBlockCount );
-		for ( QHash< unsigned, unsigned >::const_iterator i = m_block.adjacentBlocks.begin(), iend = m_block.adjacentBlocks.end(); i != iend; i++ )
+		std::vector< unsigned > adjacentBlocks( block->settings.adjacentBlockCount );
+		for ( QHash< unsigned, unsigned >::const_iterator i = block->adjacentBlocks.begin(), iend = block->adjacentBlocks.end(); i != iend; i++ )
 			adjacentBlocks[i.value()] = i.key();
-		for ( unsigned i = 0; i < m_block.settings.adjacentBlockCount; i++ )
-			write_unaligned_unsigned( &buffer, adjacentBlocks[i], m_block.settings.blockBits, &offset );
-		m_block.adjacentBlockBits = bits_needed( m_block.settings.adjacentBlockCount - 1 );
+		for ( unsigned i = 0; i < block->settings.adjacentBlockCount; i++ )
+			write_unaligned_unsigned( &buffer, adjacentBlocks[i], block->settings.blockBits, &offset );
+		block->adjacentBlockBits = bits_needed( block->settings.adjacentBlockCount - 1 );
 
 		// reserve space for first edge bits
 		unsigned char* firstEdgesBuffer = buffer;
 		int firstEdgesOffset = offset;
-		offset += m_block.settings.firstEdgeBits * ( m_block.settings.nodeCount + 1 );
+		offset += block->settings.firstEdgeBits * ( block->settings.nodeCount + 1 );
 		buffer += offset >> 3;
 		offset &= 7;
 
@@ -386,8 +460,8 @@ private:
 		firstEdges.push_back( 0 );
 		unsigned char* edgesBegin = buffer;
 		unsigned edgesBeginOffset = offset;
-		for ( unsigned i = 0; i < m_block.settings.nodeCount; i++ ) {
-			unsigned node = i + m_block.firstNode;
+		for ( unsigned i = 0; i < block->settings.nodeCount; i++ ) {
+			unsigned node = i + block->firstNode;
 			for ( unsigned edge = m_firstEdges[node]; edge < m_firstEdges[node + 1]; edge++ ) {
 				// forward + backward flags
 				bool directed = !m_edges[edge].data.forward || !m_edges[edge].data.backward;
@@ -402,24 +476,24 @@ private:
 				// target
 				if ( m_nodeIDs[node].block == m_nodeIDs[m_edges[edge].target].block ) {
 					write_unaligned_unsigned( &buffer, 1, 1, &offset );
-					write_unaligned_unsigned( &buffer, m_edges[edge].target - m_block.firstNode, bits_needed( i ), &offset );
+					write_unaligned_unsigned( &buffer, m_edges[edge].target - block->firstNode, bits_needed( i ), &offset );
 				} else {
 					write_unaligned_unsigned( &buffer, 0, 1, &offset );
 					unsigned targetBlock = m_nodeIDs[m_edges[edge].target].block;
-					write_unaligned_unsigned( &buffer, m_block.adjacentBlocks[targetBlock], m_block.adjacentBlockBits, &offset );
-					write_unaligned_unsigned( &buffer, m_nodeIDs[m_edges[edge].target].node, m_block.settings.externalBits, &offset );
+					write_unaligned_unsigned( &buffer, block->adjacentBlocks[targetBlock], block->adjacentBlockBits, &offset );
+					write_unaligned_unsigned( &buffer, m_nodeIDs[m_edges[edge].target].node, block->settings.externalBits, &offset );
 				}
 
 				// weight
-				bool longWeight = m_edges[edge].data.distance >= ( 1u << m_block.settings.shortWeightBits );
-				if ( m_block.settings.shortWeightBits != m_block.settings.longWeightBits )
+				bool longWeight = m_edges[edge].data.distance >= ( 1u << block->settings.shortWeightBits );
+				if ( block->settings.shortWeightBits != block->settings.longWeightBits )
 					write_unaligned_unsigned( &buffer, longWeight ? 1 : 0, 1, &offset );
-				write_unaligned_unsigned( &buffer, m_edges[edge].data.distance, longWeight ? m_block.settings.longWeightBits : m_block.settings.shortWeightBits, &offset );
+				write_unaligned_unsigned( &buffer, m_edges[edge].data.distance, longWeight ? block->settings.longWeightBits : block->settings.shortWeightBits, &offset );
 
 				// unpacked
 				bool unpacked = false;
 				if ( m_edges[edge].data.shortcut ) {
-					if ( m_edges[edge].data.middle - m_block.firstNode >= m_block.settings.nodeCount )
+					if ( node < m_unpackedNodes || m_edges[edge].data.middle - block->firstNode >= block->settings.nodeCount )
 						unpacked = true;
 				} else {
 					unpacked = mustUnpack( edge );
@@ -436,7 +510,7 @@ private:
 				write_unaligned_unsigned( &buffer, m_edges[edge].data.shortcut ? 1 : 0, 1, &offset );
 				if ( m_edges[edge].data.shortcut ) {
 					if ( !unpacked )
-						write_unaligned_unsigned( &buffer, m_edges[edge].data.middle - m_block.firstNode, m_block.internalBits, &offset );
+						write_unaligned_unsigned( &buffer, m_edges[edge].data.middle - block->firstNode, block->internalBits, &offset );
 				}
 
 				// edge description
@@ -451,43 +525,42 @@ private:
 		}
 
 		// write first edges in reserved space
-		for ( unsigned i = 0; i < m_block.settings.nodeCount + 1; i++ )
-			write_unaligned_unsigned( &firstEdgesBuffer, firstEdges[i], m_block.settings.firstEdgeBits, &firstEdgesOffset );
+		for ( unsigned i = 0; i < block->settings.nodeCount + 1; i++ )
+			write_unaligned_unsigned( &firstEdgesBuffer, firstEdges[i], block->settings.firstEdgeBits, &firstEdgesOffset );
 
 #ifndef NDEBUG
-		testBlock( firstEdges );
+		testBlock( *block, blockBuffer, firstEdges );
 #endif
 
-		assert( ( unsigned ) ( buffer - m_blockBuffer ) < m_settings.blockSize );
-		assert( ( unsigned ) ( ( buffer - beginBuffer ) * 8 + offset - beginOffset ) == m_block.size );
-		blockFile.write( ( const char* ) m_blockBuffer, m_settings.blockSize );
+		assert( ( unsigned ) ( buffer - blockBuffer ) < m_settings.blockSize );
+		assert( ( unsigned ) ( ( buffer - beginBuffer ) * 8 + offset - beginOffset ) == block->size );
 	}
 
 #ifndef NDEBUG
-	void testBlock( const std::vector< unsigned >& firstEdges )
+	void testBlock( const BlockBuilder& builder, const unsigned char* blockBuffer, const std::vector< unsigned >& firstEdges )
 	{
 		Block block;
-		block.load( m_block.id, m_blockBuffer );
+		block.load( builder.id, blockBuffer );
 
 		// check coordinates
-		for ( unsigned i = 0; i < m_block.settings.nodeCount; i++ ) {
+		for ( unsigned i = 0; i < builder.settings.nodeCount; i++ ) {
 			UnsignedCoordinate coordinate;
 			unpackCoordinates( block, i, &coordinate );
-			assert( coordinate.x == m_nodes[i + m_block.firstNode].coordinate.x );
-			assert( coordinate.y == m_nodes[i + m_block.firstNode].coordinate.y );
+			assert( coordinate.x == m_nodes[i + builder.firstNode].coordinate.x );
+			assert( coordinate.y == m_nodes[i + builder.firstNode].coordinate.y );
 		}
 
 		// check first edges
-		for ( unsigned i = 0; i < m_block.settings.nodeCount; i++ ) {
+		for ( unsigned i = 0; i < builder.settings.nodeCount; i++ ) {
 			EdgeIterator edge = unpackFirstEdges( block, i );
 			assert( edge.m_position == firstEdges[i] + block.edges );
 			assert( edge.m_end == firstEdges[i + 1] + block.edges );
 		}
 
 		// check edges
-		for ( unsigned i = 0; i < m_block.settings.nodeCount; i++ ) {
+		for ( unsigned i = 0; i < builder.settings.nodeCount; i++ ) {
 			EdgeIterator edge = unpackFirstEdges( block, i );
-			for ( unsigned e = m_firstEdges[i + m_block.firstNode]; e < m_firstEdges[i + m_block.firstNode + 1]; e++ ) {
+			for ( unsigned e = m_firstEdges[i + builder.firstNode]; e < m_firstEdges[i + builder.firstNode + 1]; e++ ) {
 				assert( edge.hasEdgesLeft() );
 				unpackNextEdge( &edge );
 				assert( nodeFromDescriptor( m_nodeIDs[m_edges[e].target] ) == edge.target() );
@@ -526,6 +599,33 @@ private:
 			m_firstEdges.push_back( m_edges.size() );
 	}
 
+	// assigns the nodes to the blocks of the given layout, fails if a block cannot hold its nodes
+	bool applyBlockLayout()
+	{
+		if ( m_firstNodes.front() != 0 || m_firstNodes.back() != m_nodes.size() ) {
+			qCritical() << "block layout does not match the graph:" << m_firstNodes.back() << "nodes instead of" << m_nodes.size();
+			return false;
+		}
+		BlockBuilder layoutBlock;
+		for ( unsigned block = 0; block + 1 < m_firstNodes.size(); block++ ) {
+			if ( m_firstNodes[block] >= m_firstNodes[block + 1] ) {
+				qCritical() << "block layout corrupted: block" << block << "is empty";
+				return false;
+			}
+			initBlock( &layoutBlock, block, m_firstNodes[block] );
+			for ( unsigned node = m_firstNodes[block]; node < m_firstNodes[block + 1]; node++ ) {
+				if ( !addNode( &layoutBlock, node ) ) {
+					qCritical() << "block" << block << "cannot hold its nodes anymore, the block layout does not fit the graph";
+					return false;
+				}
+				m_nodeIDs[node].block = block;
+				m_nodeIDs[node].node = node - m_firstNodes[block];
+			}
+			m_externalBits.push_back( bits_needed( m_firstNodes[block + 1] - 1 - m_firstNodes[block] ) );
+		}
+		return true;
+	}
+
 	// unpack all external shortcuts
 	void unpackAllNecessary( QFile* pathFile, bool pretend = false )
 	{
@@ -562,10 +662,8 @@ private:
 			}
 			numberOfUnpacked++;
 			if ( !pretend ) {
-				for ( unsigned i = 0; i < m_unpackBuffer.size(); i++ ) {
-					pathFile->write( ( const char* ) &m_unpackBuffer[i].a, sizeof( unsigned ) );
-					pathFile->write( ( const char* ) &m_unpackBuffer[i].b, sizeof( unsigned ) );
-				}
+				for ( unsigned i = 0; i < m_unpackBuffer.size(); i++ )
+					writePathItem( pathFile, m_unpackBuffer[i] );
 			}
 			m_unpackBufferOffset += m_unpackBuffer.size();
 			m_unpackBuffer.clear();
@@ -576,6 +674,111 @@ private:
 			qDebug( "unpacked edges: %lf %%", 100.0f * numberOfUnpacked / numberOfUnpackable );
 	}
 
+	void writePathItem( QFile* pathFile, const PathBlock::DataItem& item )
+	{
+		if ( m_settings.pathFormat == RawPaths ) {
+			pathFile->write( ( const char* ) &item.a, sizeof( unsigned ) );
+			pathFile->write( ( const char* ) &item.b, sizeof( unsigned ) );
+			return;
+		}
+		m_pathGroupItems.push_back( item );
+		if ( m_pathGroupItems.size() == pathGroupSize )
+			writePathGroup( pathFile );
+	}
+
+	// see CompressedGraph::PathFormat
+	static void encodePathGroup( const std::vector< PathBlock::DataItem >& items, unsigned x, unsigned y, std::vector< unsigned char >* buffer )
+	{
+		buffer->clear();
+		buffer->push_back( items.size() );
+		unsigned nodeMask = 0;
+		for ( unsigned i = 0; i < items.size(); i++ ) {
+			if ( items[i].isNode() )
+				nodeMask |= 1u << i;
+		}
+		buffer->push_back( nodeMask & 255 );
+		buffer->push_back( nodeMask >> 8 );
+		for ( unsigned i = 0; i < items.size(); i++ ) {
+			const PathBlock::DataItem& item = items[i];
+			if ( item.isNode() ) {
+				const unsigned nodeX = item.a >> 1;
+				write_varint( buffer, encode_zigzag( ( int ) ( nodeX - x ) ) );
+				write_varint( buffer, encode_zigzag( ( int ) ( item.b - y ) ) );
+				x = nodeX;
+				y = item.b;
+			} else {
+				write_varint( buffer, item.a >> 1 );
+				write_varint( buffer, item.b >> 24 );
+				write_varint( buffer, ( item.b >> 8 ) & 65535 );
+				buffer->push_back( item.b & 255 );
+			}
+		}
+	}
+
+	void writePathGroup( QFile* pathFile )
+	{
+		if ( m_pathGroupItems.empty() )
+			return;
+		std::vector< unsigned char > encoded;
+		encodePathGroup( m_pathGroupItems, m_pathReferenceX, m_pathReferenceY, &encoded );
+		if ( pathBlockHeaderSize + 2 * ( m_pathGroupOffsets.size() + 1 ) + m_pathBlockData.size() + encoded.size() > m_settings.blockSize )
+			writePathBlock( pathFile );
+		if ( m_pathGroupOffsets.empty() ) {
+			// a new block is referenced to its first node
+			for ( unsigned i = 0; i < m_pathGroupItems.size(); i++ ) {
+				if ( !m_pathGroupItems[i].isNode() )
+					continue;
+				m_pathReferenceX = m_pathGroupItems[i].a >> 1;
+				m_pathReferenceY = m_pathGroupItems[i].b;
+				break;
+			}
+			encodePathGroup( m_pathGroupItems, m_pathReferenceX, m_pathReferenceY, &encoded );
+		}
+		assert( pathBlockHeaderSize + 2 * ( m_pathGroupOffsets.size() + 1 ) + m_pathBlockData.size() + encoded.size() <= m_settings.blockSize );
+		m_pathGroupOffsets.push_back( m_pathBlockData.size() );
+		m_pathBlockData.insert( m_pathBlockData.end(), encoded.begin(), encoded.end() );
+		m_pathGroups++;
+		m_pathGroupItems.clear();
+	}
+
+	void writePathBlock( QFile* pathFile )
+	{
+		if ( m_pathGroupOffsets.empty() )
+			return;
+		const unsigned firstGroup = m_pathGroups - m_pathGroupOffsets.size();
+		const unsigned short groupCount = m_pathGroupOffsets.size();
+		const unsigned dataOffset = pathBlockHeaderSize + 2 * groupCount;
+		memset( m_blockBuffer, 0, m_settings.blockSize );
+		memcpy( m_blockBuffer, &firstGroup, sizeof( firstGroup ) );
+		memcpy( m_blockBuffer + 4, &m_pathReferenceX, sizeof( m_pathReferenceX ) );
+		memcpy( m_blockBuffer + 8, &m_pathReferenceY, sizeof( m_pathReferenceY ) );
+		memcpy( m_blockBuffer + 12, &groupCount, sizeof( groupCount ) );
+		for ( unsigned group = 0; group < groupCount; group++ ) {
+			const unsigned short offset = dataOffset + m_pathGroupOffsets[group];
+			memcpy( m_blockBuffer + pathBlockHeaderSize + 2 * group, &offset, sizeof( offset ) );
+		}
+		memcpy( m_blockBuffer + dataOffset, &m_pathBlockData[0], m_pathBlockData.size() );
+		pathFile->write( ( const char* ) m_blockBuffer, m_settings.blockSize );
+		m_pathIndex.push_back( firstGroup );
+		m_pathGroupOffsets.clear();
+		m_pathBlockData.clear();
+	}
+
+	// flushes the last group and block, writes the first group of every block
+	bool finishPaths( QFile* pathFile, QString filename )
+	{
+		if ( m_settings.pathFormat == RawPaths )
+			return true;
+		writePathGroup( pathFile );
+		writePathBlock( pathFile );
+		QFile indexFile( filename + "_paths_index" );
+		if ( !openQFile( &indexFile, QIODevice::WriteOnly ) )
+			return false;
+		if ( !m_pathIndex.empty() )
+			indexFile.write( ( const char* ) &m_pathIndex[0], m_pathIndex.size() * sizeof( unsigned ) );
+		return true;
+	}
+
 	// unpacks a shortcut and updates the pointers for all shortcuts encountered
 	void unpackPath( unsigned source, unsigned target, bool forward, unsigned edgeID = std::numeric_limits< unsigned >::max() ) {
 		unsigned shortestEdgeID = edgeID;
@@ -656,12 +859,12 @@ private:
 		}
 	}
 
-	bool mustUnpack( unsigned edgeID )
+	bool mustUnpack( unsigned edgeID ) const
 	{
 		const Edge& edge = m_edges[edgeID];
 		//do not unpack internal shortcuts
 		if ( edge.data.shortcut )
-			return m_nodeIDs[edge.source].block != m_nodeIDs[edge.data.middle].block;
+			return edge.source < m_unpackedNodes || m_nodeIDs[edge.source].block != m_nodeIDs[edge.data.middle].block;
 		const IImporter::RoutingEdge& originalEdge = m_originalEdges[edge.data.id];
 		return originalEdge.pathLength != 0;
 	}
@@ -676,12 +879,10 @@ private:
 		return originalEdge.pathLength != 0;
 	}
 
-	bool createGraph( QString filename, std::vector< unsigned >* remap )
+	// assigns the nodes to blocks, the block contents depend on the edges and the path index size
+	bool computeLayout()
 	{
-		assert( m_nodes.size() == remap->size() );
-		qDebug() << "creating compressed graph with" << m_nodes.size() <<  "nodes and" << m_edges.size() << "edges";
 		Timer time;
-
 		buildIndex();
 		m_nodeIDs.resize( m_nodes.size() );
 		qDebug() << "build node index:" << time.restart() << "ms";
@@ -700,20 +901,45 @@ private:
 		m_settings.nameBits = bits_needed( maxName );
 
 		// compute mapping nodes -> blocks
+		// sequential: a block starts where the previous one is full
 		unsigned blocks = 0;
-		initBlock( 0, 0 );
-		for ( unsigned node = 0; node < m_nodes.size(); node++ ) {
-			if ( !addNode( node ) ) {
-				m_externalBits.push_back( bits_needed( node - 1 - m_block.firstNode ) ); // never negative <= at least one node
-				initBlock( ++blocks, node );
-				addNode( node ); // cannot fail -> exit( -1 ) in addNode otherwise
+		BlockBuilder layoutBlock;
+		if ( !m_firstNodes.empty() ) {
+			if ( !applyBlockLayout() )
+				return false;
+			blocks = m_firstNodes.size() - 1;
+		} else {
+			initBlock( &layoutBlock, 0, 0 );
+			m_firstNodes.push_back( 0 );
+			for ( unsigned node = 0; node < m_nodes.size(); node++ ) {
+				if ( !addNode( &layoutBlock, node, m_blockReserve ) ) {
+					m_externalBits.push_back( bits_needed( node - 1 - layoutBlock.firstNode ) ); // never negative <= at least one node
+					initBlock( &layoutBlock, ++blocks, node );
+					m_firstNodes.push_back( node );
+					addNode( &layoutBlock, node, m_blockReserve ); // cannot fail -> exit( -1 ) in addNode otherwise
+				}
+				//remap nodes
+				m_nodeIDs[node].block = layoutBlock.id;
+				m_nodeIDs[node].node = node - layoutBlock.firstNode;
 			}
+			assert( blocks == m_externalBits.size() );
+			// account for the last block
+			blocks++;
+			m_externalBits.push_back( bits_needed( m_nodes.size() - 1 - layoutBlock.firstNode ) );
+			m_firstNodes.push_back( m_nodes.size() );
 		}
-		assert( blocks == m_externalBits.size() );
-		// account for the last block
-		blocks++;
-		m_externalBits.push_back( bits_needed( m_nodes.size() - 1 - m_block.firstNode ) );
 		qDebug() << "computed block layout:" << time.restart() << "ms";
+		return true;
+	}
+
+	bool createGraph( QString filename, std::vector< unsigned >* remap )
+	{
+		assert( m_nodes.size() == remap->size() );
+		qDebug() << "creating compressed graph with" << m_nodes.size() <<  "nodes and" << m_edges.size() << "edges";
+		if ( !computeLayout() )
+			return false;
+		const unsigned blocks = m_firstNodes.size() - 1;
+		Timer time;
 
 		m_settings.internalBits = 0;
 		for ( unsigned block = 0; block < blocks; block++ )
@@ -723,19 +949,36 @@ private:
 		QFile pathFile( filename + "_paths" );
 		if ( !openQFile( &pathFile, QIODevice::WriteOnly ) )
 			return false;
+		m_pathGroups = 0;
+		m_pathReferenceX = m_pathReferenceY = 0;
 		unpackAllNecessary( &pathFile );
+		if ( !finishPaths( &pathFile, filename ) )
+			return false;
 		qDebug() << "unpacked shortcuts:" << time.restart() << "ms";
 
 		// recompute block settings and write
 		QFile blockFile( filename + "_edges" );
 		if ( !openQFile( &blockFile, QIODevice::WriteOnly ) )
 			return false;
-		for ( unsigned block = 0, node = 0; block < blocks; block++ ) {
-			initBlock( block, node );
-			while ( node < m_nodes.size() && m_nodeIDs[node].block == block )
-				addNode( node++ );  // should never fail
-			writeBlock( blockFile );
-			m_statistics.addBlock( *this );
+		// blocks are encoded in parallel batches and written in order
+		// => the file does not depend on the amount of threads
+		const unsigned batchSize = std::min( blocks, ( unsigned ) blockBatchSize );
+		std::vector< BlockBuilder > batchBlocks( batchSize );
+		std::vector< unsigned char > batchBuffer( ( size_t ) batchSize * m_settings.blockSize );
+		for ( unsigned batchBegin = 0; batchBegin < blocks; batchBegin += batchSize ) {
+			const int batchEnd = std::min( batchBegin + batchSize, blocks );
+			std::fill( batchBuffer.begin(), batchBuffer.end(), 0 );
+#pragma omp parallel for schedule( dynamic )
+			for ( int block = batchBegin; block < batchEnd; block++ ) {
+				BlockBuilder* builder = &batchBlocks[block - batchBegin];
+				initBlock( builder, block, m_firstNodes[block] );
+				for ( unsigned node = m_firstNodes[block]; node < m_firstNodes[block + 1]; node++ )
+					addNode( builder, node ); // should never fail
+				writeBlock( builder, &batchBuffer[( size_t ) ( block - batchBegin ) * m_settings.blockSize] );
+			}
+			blockFile.write( ( const char* ) &batchBuffer[0], ( qint64 ) ( batchEnd - batchBegin ) * m_settings.blockSize );
+			for ( int block = batchBegin; block < batchEnd; block++ )
+				m_statistics.addBlock( *this, batchBlocks[block - batchBegin] );
 		}
 		qDebug() << "wrote blocks" << time.restart() << "ms";
 
@@ -750,7 +993,9 @@ private:
 		qDebug( "\tinternal bits: %d", m_settings.internalBits );
 		qDebug( "\tpath bits: %d", m_settings.pathBits );
 		qDebug( "\tblocks: %d", blocks );
-		qDebug( "\tpath blocks: %d", m_unpackBufferOffset / ( m_settings.blockSize / 8 ) );
+		qDebug( "\tpath format: %s", m_settings.pathFormat == CompressedPaths ? "compressed" : "raw" );
+		qDebug( "\tpath blocks: %lld", pathFile.size() / m_settings.blockSize );
+		qDebug( "\tpath data: %lld bytes, %lld bytes as raw items", pathFile.size(), ( qint64 ) m_unpackBufferOffset * 8 );
 		qDebug( "\tblock space: %lld Mb" , blockFile.size() / 1024 / 1024 );
 		qDebug( "\tpath block space: %lld Mb" , pathFile.size() / 1024 / 1024 );
 		qDebug( "\tmax internal ID: %u", nodeFromDescriptor( m_nodeIDs.back() ) );
@@ -771,9 +1016,21 @@ private:
 	std::vector< OriginalEdge > m_originalEdges;
 	std::vector< IRouter::Node > m_edgePaths;
 	std::vector< unsigned char > m_externalBits;
+	// first node of every block followed by the number of nodes
+	std::vector< unsigned > m_firstNodes;
+	// bytes left free in every block by the computed layout
+	unsigned m_blockReserve;
 	std::vector< PathBlock::DataItem > m_unpackBuffer;
 	unsigned m_unpackBufferOffset;
-	BlockBuilder m_block;
+	unsigned m_unpackedNodes;
+	// compressed path writer
+	std::vector< PathBlock::DataItem > m_pathGroupItems;
+	std::vector< unsigned char > m_pathBlockData;
+	std::vector< unsigned > m_pathGroupOffsets;
+	std::vector< unsigned > m_pathIndex;
+	unsigned m_pathGroups;
+	unsigned m_pathReferenceX;
+	unsigned m_pathReferenceY;
 	unsigned char* m_blockBuffer;
 
 	Statistics m_statistics;
@@ -24,6 +24,7 @@ along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
 #include <queue>
 #include <stack>
 #include "contractor.h"
+#include "utils/coordinates.h"
 
 class ContractionCleanup {
 	private:
@@ -84,8 +85,27 @@ class ContractionCleanup {
 
 		typedef BinaryHeap< NodeID, NodeID, int, _HeapData > _Heap;
 
+		struct _ThreadData {
+			_Heap heapForward;
+			_Heap heapBackward;
+			std::vector< _Witness > witnessData;
+			_ThreadData( NodeID nodes ): heapForward( nodes ), heapBackward( nodes ) {
+			}
+		};
+
 	public:
 
+		// decides which nodes share a block of the compressed graph
+		// every order is topological, the most important node gets the smallest ID
+		enum NodeOrder {
+			// buckets of similar depth, depth first topological order inside
+			DepthOrder = 0,
+			// buckets of similar depth, Hilbert curve order inside
+			SpatialOrder = 1,
+			// post order of depth first searches in the upward graph, keeps search spaces together
+			DFSOrder = 2
+		};
+
 		struct Edge {
 			NodeID source;
 			NodeID target;
@@ -124,26 +144,37 @@ class ContractionCleanup {
 		};
 
 
-		ContractionCleanup( int numNodes, const std::vector< Edge >& edges, const std::vector< Edge >& loops, const std::vector< Contractor::Witness >& witnessList ) {
-			_graph = edges;
-			_loops = loops;
-			_witnessList = witnessList;
+		// coordinates are only used by the spatial order
+		// takes over the edges, loops and witnesses, the vectors are left empty
+		ContractionCleanup( int numNodes, std::vector< Edge >* edges, std::vector< Edge >* loops, std::vector< Contractor::Witness >* witnessList, NodeOrder nodeOrder, const std::vector< UnsignedCoordinate >& coordinates ) {
+			_graph.swap( *edges );
+			_loops.swap( *loops );
+			_witnessList.swap( *witnessList );
 			_numNodes = numNodes;
-			_heapForward = new _Heap( numNodes );
-			_heapBackward = new _Heap( numNodes );
+			_nodeOrder = nodeOrder;
+			if ( nodeOrder == SpatialOrder )
+				_coordinates = coordinates;
+			for ( int threadNum = 0, maxThreads = omp_get_max_threads(); threadNum < maxThreads; ++threadNum )
+				_threadData.push_back( new _ThreadData( numNodes ) );
 		}
 
 		~ContractionCleanup() {
-
+			for ( unsigned threadNum = 0; threadNum < _threadData.size(); threadNum++ )
+				delete _threadData[threadNum];
 		}
 
 		void Run() {
 
 			double time = _Timestamp();
+			qDebug( "using %d threads", ( int ) _threadData.size() );
 
+			double timeLast = _Timestamp();
 			RemoveUselessShortcuts();
+			qDebug( "Useless Shortcuts Time: %lf s", _Timestamp() - timeLast );
 
+			timeLast = _Timestamp();
 			ReorderNodes();
+			qDebug( "Reordering Time: %lf s", _Timestamp() - timeLast );
 
 			//DistributeWitnessData();
 
@@ -158,7 +189,9 @@ class ContractionCleanup {
 			for ( NodeID node = 0; node < _numNodes; ++node )
 				map->push_back( _remap[node].mappedID );
 
+			edges->reserve( edges->size() + _graph.size() + _loops.size() );
 			convertEdges( edges, _graph );
+			std::vector< Edge >().swap( _graph );
 			convertEdges( edges, _loops );
 
 			std::sort( edges->begin(), edges->end() );
@@ -239,11 +272,13 @@ class ContractionCleanup {
 			}
 		}
 
+		// a shortcut direction is useless if the hierarchy has a strictly shorter path
+		// removing such edges does not change any distance => the searches can all run on the same graph
 		void RemoveUselessShortcuts() {
 
 			qDebug( "Scanning for useless shortcuts" );
 			BuildOutgoingGraph();
-			int numUseless = 0;
+			// shortcuts dominated by a parallel edge, the first of two equal edges survives
 			for ( unsigned i = 0; i < ( unsigned ) _graph.size(); i++ ) {
 
 				for ( unsigned edge = _firstEdge[_graph[i].source]; edge < _firstEdge[_graph[i].source + 1]; ++edge ) {
@@ -260,39 +295,39 @@ class ContractionCleanup {
 					_graph[edge].data.forward &= !_graph[i].data.forward;
 					_graph[edge].data.backward &= !_graph[i].data.backward;
 				}
+			}
 
-				if ( !_graph[i].data.forward && !_graph[i].data.backward )
-					continue;
+			//only remove shortcuts
+			std::vector< unsigned > shortcuts;
+			for ( unsigned i = 0; i < ( unsigned ) _graph.size(); i++ ) {
+				if ( _graph[i].data.shortcut && ( _graph[i].data.forward || _graph[i].data.backward ) )
+					shortcuts.push_back( i );
+			}
 
-				//only remove shortcuts
-				if ( !_graph[i].data.shortcut )
-					continue;
+			std::vector< char > uselessForward( shortcuts.size(), false );
+			std::vector< char > uselessBackward( shortcuts.size(), false );
+			#pragma omp parallel
+			{
+				_ThreadData* const data = _threadData[omp_get_thread_num()];
+				#pragma omp for schedule ( guided )
+				for ( int position = 0; position < ( int ) shortcuts.size(); ++position ) {
+					const Edge& edge = _graph[shortcuts[position]];
+					if ( edge.data.forward )
+						uselessForward[position] = _ComputeDistance( data, edge.source, edge.target ) < edge.data.distance;
+					if ( edge.data.backward )
+						uselessBackward[position] = _ComputeDistance( data, edge.target, edge.source ) < edge.data.distance;
+				}
+			}
 
-				if ( _graph[i].data.forward ) {
-					int result = _ComputeDistance( _graph[i].source, _graph[i].target );
-
-					if ( result < _graph[i].data.distance ) {
-						numUseless++;
-						_graph[i].data.forward = false;
-						//Contractor::Witness temp;
-						//temp.source = _graph[i].source;
-						//temp.target = _graph[i].target;
-						//temp.middle = _graph[i].data.middle;
-						//_witnessList.push_back( temp );
-					}
+			int numUseless = 0;
+			for ( unsigned position = 0; position < shortcuts.size(); position++ ) {
+				if ( uselessForward[position] ) {
+					numUseless++;
+					_graph[shortcuts[position]].data.forward = false;
 				}
-				if ( _graph[i].data.backward ) {
-					int result = _ComputeDistance( _graph[i].target, _graph[i].source );
-
-					if ( result < _graph[i].data.distance ) {
-						numUseless++;
-						_graph[i].data.backward = false;
-						//Contractor::Witness temp;
-						//temp.source = _graph[i].target;
-						//temp.target = _graph[i].source;
-						//temp.middle = _graph[i].data.middle;
-						//_witnessList.push_back( temp );
-					}
+				if ( uselessBackward[position] ) {
+					numUseless++;
+					_graph[shortcuts[position]].data.backward = false;
 				}
 			}
 			qDebug( "Found %d useless shortcut directions", numUseless );
@@ -316,119 +351,204 @@ class ContractionCleanup {
 				_remap[node].id = node;
 			}
 
+			switch ( _nodeOrder ) {
+			default:
+			case DepthOrder:
+				ComputeNodeDepth();
+				BuildIncomingGraph();
+				ComputeDepthFirstOrder();
+				SortIntoDepthBuckets();
+				break;
+			case SpatialOrder:
+				ComputeNodeDepth();
+				BuildIncomingGraph();
+				ComputeSpatialOrder();
+				SortIntoDepthBuckets();
+				break;
+			case DFSOrder:
+				ComputeUpwardPostOrder();
+				BuildIncomingGraph();
+				break;
+			}
+
+			SortTopologically();
+			std::sort( _remap.begin(), _remap.end(), _Node::CompareByID );
+		}
+
+		// requires the outgoing graph
+		void ComputeNodeDepth() {
 			qDebug( "Compute Node Depth" );
-			{
-				std::queue< NodeID > q;
-				std::vector< unsigned > inDegree( _numNodes, 0 );
-				for ( int i = 0; i < ( int ) _graph.size(); i++ ) {
-					inDegree[_graph[i].target]++;
-				}
-				for ( NodeID i = 0; i < _numNodes; i++ ) {
-					if ( inDegree[i] == 0 )
-						q.push( i );
+			std::queue< NodeID > q;
+			std::vector< unsigned > inDegree( _numNodes, 0 );
+			for ( int i = 0; i < ( int ) _graph.size(); i++ ) {
+				inDegree[_graph[i].target]++;
+			}
+			for ( NodeID i = 0; i < _numNodes; i++ ) {
+				if ( inDegree[i] == 0 )
+					q.push( i );
+			}
+			assert( !q.empty() );
+			NodeID lastNode = q.back();
+			int depth = 0;
+			while ( !q.empty() ) {
+				NodeID node = q.front();
+				q.pop();
+				_remap[node].depth = depth;
+				for ( unsigned i = _firstEdge[node], e = _firstEdge[node + 1]; i < e; i++ ) {
+					const NodeID target = _graph[i].target;
+					assert( inDegree[target] != 0 );
+					inDegree[target]--;
+					if ( inDegree[target] == 0 )
+						q.push( target );
 				}
-				assert( !q.empty() );
-				NodeID lastNode = q.back();
-				int depth = 0;
-				while ( !q.empty() ) {
-					NodeID node = q.front();
-					q.pop();
-					_remap[node].depth = depth;
-					for ( unsigned i = _firstEdge[node], e = _firstEdge[node + 1]; i < e; i++ ) {
-						const NodeID target = _graph[i].target;
-						assert( inDegree[target] != 0 );
-						inDegree[target]--;
-						if ( inDegree[target] == 0 )
-							q.push( target );
-					}
-					if ( node == lastNode ) {
-						if ( !q.empty() )
-							lastNode = q.back();
-						depth++;
-					}
+				if ( node == lastNode ) {
+					if ( !q.empty() )
+						lastNode = q.back();
+					depth++;
 				}
 			}
+		}
 
-
-			BuildIncomingGraph();
+		// requires the incoming graph
+		void ComputeDepthFirstOrder() {
 			qDebug( "Sort Nodes Topologically Depths First" );
-			{
-				std::stack< unsigned > s;
-				std::vector< unsigned > outDegree( _numNodes, 0 );
-				for ( int i = 0; i < ( int ) _graph.size(); i++ ) {
-					outDegree[_graph[i].source]++;
-				}
-				for ( NodeID i = 0; i < _numNodes; i++ ) {
-					if ( outDegree[i] == 0 )
-						s.push( i );
+			std::stack< unsigned > s;
+			std::vector< unsigned > outDegree( _numNodes, 0 );
+			for ( int i = 0; i < ( int ) _graph.size(); i++ ) {
+				outDegree[_graph[i].source]++;
+			}
+			for ( NodeID i = 0; i < _numNodes; i++ ) {
+				if ( outDegree[i] == 0 )
+					s.push( i );
+			}
+			NodeID newID = 0;
+			while ( !s.empty() ) {
+				unsigned n = s.top();
+				s.pop();
+				_remap[n].mappedID = newID++;
+				for ( unsigned i = _firstEdge[n], e = _firstEdge[n + 1]; i < e; i++ ) {
+					const NodeID target = _graph[i].source;
+					assert( outDegree[target] != 0 );
+					outDegree[target]--;
+					if ( outDegree[target] == 0 )
+						s.push( target );
 				}
-				NodeID newID = 0;
+			}
+			assert( newID == _numNodes );
+		}
+
+		void ComputeSpatialOrder() {
+			qDebug( "Sort Nodes along a Hilbert Curve" );
+			assert( _coordinates.size() == _numNodes );
+			std::vector< std::pair< quint64, NodeID > > curve( _numNodes );
+			for ( NodeID i = 0; i < _numNodes; i++ )
+				curve[i] = std::make_pair( _HilbertIndex( _coordinates[i].x, _coordinates[i].y ), i );
+			std::sort( curve.begin(), curve.end() );
+			for ( NodeID i = 0; i < _numNodes; i++ )
+				_remap[curve[i].second].mappedID = i;
+			std::vector< UnsignedCoordinate >().swap( _coordinates );
+		}
+
+		// requires the outgoing graph
+		// the post order is topological: a node finishes after all nodes above it
+		void ComputeUpwardPostOrder() {
+			qDebug( "Sort Nodes by Depth First Searches in the Upward Graph" );
+			std::vector< bool > visited( _numNodes, false );
+			// node, next edge
+			std::stack< std::pair< NodeID, unsigned > > s;
+			NodeID postOrder = 0;
+			for ( NodeID root = 0; root < _numNodes; root++ ) {
+				if ( visited[root] )
+					continue;
+				visited[root] = true;
+				s.push( std::make_pair( root, _firstEdge[root] ) );
 				while ( !s.empty() ) {
-					unsigned n = s.top();
-					s.pop();
-					_remap[n].mappedID = newID++;
-					for ( unsigned i = _firstEdge[n], e = _firstEdge[n + 1]; i < e; i++ ) {
-						const NodeID target = _graph[i].source;
-						assert( outDegree[target] != 0 );
-						outDegree[target]--;
-						if ( outDegree[target] == 0 )
-							s.push( target );
+					const NodeID node = s.top().first;
+					unsigned& edge = s.top().second;
+					if ( edge == _firstEdge[node + 1] ) {
+						// the topological sort prefers large keys => the first finished node becomes the top
+						_remap[node].mappedID = _numNodes - 1 - postOrder++;
+						s.pop();
+						continue;
 					}
+					const NodeID target = _graph[edge++].target;
+					if ( visited[target] )
+						continue;
+					visited[target] = true;
+					s.push( std::make_pair( target, _firstEdge[target] ) );
 				}
-				assert( newID == _numNodes );
 			}
+			assert( postOrder == _numNodes );
+		}
 
+		// replaces the keys by the position in buckets of similar depth, ordered by the old key inside
+		void SortIntoDepthBuckets() {
 			qDebug( "Sort Nodes into buckets according to hierarchy depths" );
-			{
-				//sort by level
-				sort( _remap.begin(), _remap.end(), _Node::CompareByDepth );
-
-				//sort buckets by original id
-				for ( NodeID i = 0; _numNodes - i > 16; ) {
-					NodeID bucketSize = ( _numNodes - i ) * 15 / 16;
-					NodeID position = i + bucketSize;
-					while ( position + 1 < _numNodes && _remap[position].depth == _remap[position + 1].depth )
-						++position;
-					sort( _remap.begin() + i, _remap.begin() + position, _Node::CompareByRemappedID );
-					i = position;
-				}
+			//sort by level
+			sort( _remap.begin(), _remap.end(), _Node::CompareByDepth );
+
+			//sort buckets by original id
+			for ( NodeID i = 0; _numNodes - i > 16; ) {
+				NodeID bucketSize = ( _numNodes - i ) * 15 / 16;
+				NodeID position = i + bucketSize;
+				while ( position + 1 < _numNodes && _remap[position].depth == _remap[position + 1].depth )
+					++position;
+				sort( _remap.begin() + i, _remap.begin() + position, _Node::CompareByRemappedID );
+				i = position;
+			}
 
-				//sort by original id
-				for ( NodeID i = 0; i < _numNodes; i++ ) {
-					_remap[i].mappedID = i;
-				}
-				sort( _remap.begin(), _remap.end(), _Node::CompareByID );
+			//sort by original id
+			for ( NodeID i = 0; i < _numNodes; i++ ) {
+				_remap[i].mappedID = i;
 			}
+			sort( _remap.begin(), _remap.end(), _Node::CompareByID );
+		}
 
-			//topological sorting
+		// assigns the final IDs, prefers nodes with large keys
+		// requires the incoming graph
+		void SortTopologically() {
 			qDebug( "Sort Nodes Topologically by computed order" );
-			{
-				std::priority_queue< _Node, std::vector< _Node >, _Comp > q;
-				std::vector< unsigned > outDegree( _numNodes, 0 );
-				for ( int i = 0; i < ( int ) _graph.size(); i++ ) {
-					outDegree[_graph[i].source]++;
-				}
-				for ( NodeID i = 0; i < _numNodes; i++ ) {
-					if ( outDegree[i] == 0 )
-						q.push( _remap[i] );
+			std::priority_queue< _Node, std::vector< _Node >, _Comp > q;
+			std::vector< unsigned > outDegree( _numNodes, 0 );
+			for ( int i = 0; i < ( int ) _graph.size(); i++ ) {
+				outDegree[_graph[i].source]++;
+			}
+			for ( NodeID i = 0; i < _numNodes; i++ ) {
+				if ( outDegree[i] == 0 )
+					q.push( _remap[i] );
+			}
+			NodeID newID = 0;
+			while ( !q.empty() ) {
+				_Node n = q.top();
+				q.pop();
+				_remap[n.id].mappedID = newID++;
+				for ( int i = _firstEdge[n.id], e = _firstEdge[n.id + 1]; i < e; i++ ) {
+					const NodeID target = _graph[i].source;
+					assert( outDegree[target] != 0 );
+					outDegree[target]--;
+					if ( outDegree[target] == 0 )
+						q.push( _remap[target] );
 				}
-				NodeID newID = 0;
-				while ( !q.empty() ) {
-					_Node n = q.top();
-					q.pop();
-					_remap[n.id].mappedID = newID++;
-					for ( int i = _firstEdge[n.id], e = _firstEdge[n.id + 1]; i < e; i++ ) {
-						const NodeID target = _graph[i].source;
-						assert( outDegree[target] != 0 );
-						outDegree[target]--;
-						if ( outDegree[target] == 0 )
-							q.push( _remap[target] );
+			}
+			assert( newID == _numNodes );
+		}
+
+		// position on a Hilbert curve through the whole coordinate space
+		static quint64 _HilbertIndex( unsigned x, unsigned y ) {
+			quint64 index = 0;
+			for ( unsigned s = 1u << 31; s > 0; s >>= 1 ) {
+				const unsigned rx = ( x & s ) != 0 ? 1 : 0;
+				const unsigned ry = ( y & s ) != 0 ? 1 : 0;
+				index += ( quint64 ) s * s * ( ( 3 * rx ) ^ ry );
+				if ( ry == 0 ) {
+					if ( rx == 1 ) {
+						x = ~x;
+						y = ~y;
 					}
+					std::swap( x, y );
 				}
-				assert( newID == _numNodes );
 			}
-
-			std::sort( _remap.begin(), _remap.end(), _Node::CompareByID );
+			return index;
 		}
 
 		void RemoveDuplicatedWitnesses() {
@@ -445,75 +565,40 @@ class ContractionCleanup {
 			qDebug( "Distributing witness data" );
 			BuildOutgoingGraph();
 			int numDeletedWitness = 0;
-			for ( unsigned i = _witnessList.size() - 1, e = _witnessList.size(); i < e; i-- ) {
-
-				//save some memory by removing duplicate data during the processing.
-				if ( i == e / 4 || i == e / 2 || i == e / 4 * 3 ) {
-					RemoveDuplicatedWitnesses();
-				}
-
-				//witness obsolet?
-				bool foundForwardEdge = false, foundBackwardEdge = false;
-				int weight = 0;
-				for ( int j = _firstEdge[_witnessList[i].middle], e = _firstEdge[_witnessList[i].middle + 1]; j < e; j++ ) {
-					if ( _graph[j].target == _witnessList[i].source && _graph[j].data.backward ) {
-						foundBackwardEdge = true;
-						weight += _graph[j].data.distance;
-					}
-					if ( _graph[j].target == _witnessList[i].target && _graph[j].data.forward ) {
-						foundForwardEdge = true;
-						weight += _graph[j].data.distance;
+			//save some memory by removing duplicate data during the processing.
+			//the witnesses are processed in quarters, the entries are sorted afterwards => the order of the threads does not matter
+			for ( int quarter = 0, e = _witnessList.size(); quarter < 4; quarter++ ) {
+				const int begin = e / 4 * quarter;
+				const int end = quarter == 3 ? e : e / 4 * ( quarter + 1 );
+				#pragma omp parallel
+				{
+					_ThreadData* const data = _threadData[omp_get_thread_num()];
+					int deleted = 0;
+					#pragma omp for schedule ( guided ) nowait
+					for ( int i = begin; i < end; i++ ) {
+						if ( !_DistributeWitness( data, _witnessList[i] ) )
+							deleted++;
 					}
+					#pragma omp atomic
+					numDeletedWitness += deleted;
 				}
-				if ( !foundForwardEdge || !foundBackwardEdge ) {
-					numDeletedWitness++;
-					continue;
+				for ( unsigned threadNum = 0; threadNum < _threadData.size(); threadNum++ ) {
+					std::vector< _Witness >& witnessData = _threadData[threadNum]->witnessData;
+					_distributedWitnessData.insert( _distributedWitnessData.end(), witnessData.begin(), witnessData.end() );
+					std::vector< _Witness >().swap( witnessData );
 				}
-
-				std::vector< NodeID > path;
-				int result = _ComputeDistance( _witnessList[i].source, _witnessList[i].target, &path );
-
-				for ( int j = 0; j < ( int ) path.size() - 1; j++ ) {
-					int actDepth = _remap[path[j]].depth;
-					int nextDepth = _remap[path[j + 1]].depth;
-					assert( actDepth != nextDepth );
-					_Witness temp;
-					temp.affectedNode = _witnessList[i].middle;
-					temp.safe = weight - result;
-					assert( temp.safe > 0 );
-					if ( nextDepth > actDepth ) {
-						for ( unsigned edge = _firstEdge[path[j]], e = _firstEdge[path[j] + 1]; edge < e; edge++ ) {
-							if ( _graph[edge].target == path[j + 1] && _graph[edge].data.forward ) {
-								temp.edge = edge;
-								break;
-							}
-							assert( edge != e - 1 );
-						}
-					} else {
-						for ( unsigned edge = _firstEdge[path[j + 1]], e = _firstEdge[path[j + 1] + 1]; edge < e; edge++ ) {
-							if ( _graph[edge].target == path[j] && _graph[edge].data.backward ) {
-								temp.edge = edge;
-								break;
-							}
-							assert( edge != e - 1 );
-						}
-					}
-					_distributedWitnessData.push_back( temp );
-				}
-
-				path.clear();
+				RemoveDuplicatedWitnesses();
 			}
+			qDebug( "Deleted %d obsolete witnesses", numDeletedWitness );
 			std::vector< Contractor::Witness >().swap( _witnessList );
 
-			RemoveDuplicatedWitnesses();
-
 			qDebug( "%d Edge _Witness Entries, %lf per Edge", ( int ) _witnessList.size(), _witnessList.size() * 1.0f / _graph.size() );
 
 			_witnessIndex.resize( _graph.size() + 1 );
 			_witnessIndex[0] = 0;
 			double safeFactor = 0;
 			for ( int i = 0, position = 0; i < ( int ) _graph.size(); i++ ) {
-				while ( _distributedWitnessData[position].edge == i && position < ( int ) _distributedWitnessData.size() ) {
+				while ( position < ( int ) _distributedWitnessData.size() && _distributedWitnessData[position].edge == i ) {
 					safeFactor += _distributedWitnessData[position].safe;
 					position++;
 				}
@@ -523,6 +608,57 @@ class ContractionCleanup {
 
 		}
 
+		// stores the edges of the witness path whose removal would invalidate the witness, false if the witness is obsolete
+		bool _DistributeWitness( _ThreadData* data, const Contractor::Witness& witness ) {
+			//witness obsolet?
+			bool foundForwardEdge = false, foundBackwardEdge = false;
+			int weight = 0;
+			for ( int j = _firstEdge[witness.middle], e = _firstEdge[witness.middle + 1]; j < e; j++ ) {
+				if ( _graph[j].target == witness.source && _graph[j].data.backward ) {
+					foundBackwardEdge = true;
+					weight += _graph[j].data.distance;
+				}
+				if ( _graph[j].target == witness.target && _graph[j].data.forward ) {
+					foundForwardEdge = true;
+					weight += _graph[j].data.distance;
+				}
+			}
+			if ( !foundForwardEdge || !foundBackwardEdge )
+				return false;
+
+			std::vector< NodeID > path;
+			int result = _ComputeDistance( data, witness.source, witness.target, &path );
+
+			for ( int j = 0; j < ( int ) path.size() - 1; j++ ) {
+				int actDepth = _remap[path[j]].depth;
+				int nextDepth = _remap[path[j + 1]].depth;
+				assert( actDepth != nextDepth );
+				_Witness temp;
+				temp.affectedNode = witness.middle;
+				temp.safe = weight - result;
+				assert( temp.safe > 0 );
+				if ( nextDepth > actDepth ) {
+					for ( unsigned edge = _firstEdge[path[j]], e = _firstEdge[path[j] + 1]; edge < e; edge++ ) {
+						if ( _graph[edge].target == path[j + 1] && _graph[edge].data.forward ) {
+							temp.edge = edge;
+							break;
+						}
+						assert( edge != e - 1 );
+					}
+				} else {
+					for ( unsigned edge = _firstEdge[path[j + 1]], e = _firstEdge[path[j + 1] + 1]; edge < e; edge++ ) {
+						if ( _graph[edge].target == path[j] && _graph[edge].data.backward ) {
+							temp.edge = edge;
+							break;
+						}
+						assert( edge != e - 1 );
+					}
+				}
+				data->witnessData.push_back( temp );
+			}
+			return true;
+		}
+
 		template< class EdgeAllowed > void _ComputeStep( _Heap* heapForward, _Heap* heapBackward, const EdgeAllowed& edgeAllowed, NodeID* middle, int* targetDistance ) {
 
 			const NodeID node = heapForward->DeleteMin();
@@ -561,7 +697,9 @@ class ContractionCleanup {
 			}
 		}
 
-		int _ComputeDistance( NodeID source, NodeID target, std::vector< NodeID >* path = NULL ) {
+		int _ComputeDistance( _ThreadData* data, NodeID source, NodeID target, std::vector< NodeID >* path = NULL ) {
+			_Heap* const _heapForward = &data->heapForward;
+			_Heap* const _heapBackward = &data->heapBackward;
 			_heapForward->Clear();
 			_heapBackward->Clear();
 			//insert source into heap
@@ -653,6 +791,8 @@ class ContractionCleanup {
 		}
 
 		NodeID _numNodes;
+		NodeOrder _nodeOrder;
+		std::vector< UnsignedCoordinate > _coordinates;
 		std::vector< Edge > _graph;
 		std::vector< Edge > _loops;
 		std::vector< unsigned > _firstEdge;
@@ -660,8 +800,7 @@ class ContractionCleanup {
 		std::vector< Contractor::Witness > _witnessList;
 		std::vector< _Witness > _distributedWitnessData;
 		std::vector< unsigned > _witnessIndex;
-		_Heap* _heapForward;
-		_Heap* _heapBackward;
+		std::vector< _ThreadData* > _threadData;
 };
 
 #endif // CONTRACTIONCLEANUP_H_INCLUDED
@@ -18,9 +18,12 @@ along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "contractionhierarchies.h"
+#include "compressedgraph.h"
 #include "compressedgraphbuilder.h"
 #include "contractor.h"
 #include "contractioncleanup.h"
+#include "customizer.h"
+#include "turntablebuilder.h"
 #include "utils/qthelpers.h"
 #ifndef NOGUI
 #include "chsettingsdialog.h"
@@ -30,6 +33,20 @@ along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
 
 ContractionHierarchies::ContractionHierarchies()
 {
+	m_settings.edgeBased = false;
+	m_settings.customize = false;
+	m_settings.nodeOrder = ContractionCleanup::DepthOrder;
+	m_settings.coreNodes = 0;
+	m_settings.unpackedNodes = 0;
+	m_settings.keepContraction = false;
+	m_settings.keepOrder = false;
+	m_settings.keepEdgeMap = false;
+	m_settings.customizable = false;
+	m_settings.spillThreshold = 0;
+	m_settings.checkpointInterval = 0;
+	m_settings.resume = false;
+	m_settings.witnessHops = 0;
+	m_settings.lazyUpdates = false;
 }
 
 ContractionHierarchies::~ContractionHierarchies()
@@ -46,6 +63,18 @@ bool ContractionHierarchies:: LoadSettings( QSettings* settings )
 	settings->beginGroup( "ContractionHierarchies" );
 	bool ok = false;
 	m_settings.blockSize = settings->value( "blockSize", 12 ).toInt( &ok );
+	m_settings.edgeBased = settings->value( "edgeBased", false ).toBool();
+	m_settings.nodeOrder = settings->value( "nodeOrder", ( int ) ContractionCleanup::DepthOrder ).toInt();
+	m_settings.coreNodes = settings->value( "coreNodes", 0 ).toInt();
+	m_settings.unpackedNodes = settings->value( "unpackedNodes", 0 ).toInt();
+	m_settings.keepContraction = settings->value( "keepContraction", false ).toBool();
+	m_settings.keepOrder = settings->value( "keepOrder", false ).toBool();
+	m_settings.keepEdgeMap = settings->value( "keepEdgeMap", false ).toBool();
+	m_settings.customizable = settings->value( "customizable", false ).toBool();
+	m_settings.spillThreshold = settings->value( "spillThreshold", 0 ).toInt();
+	m_settings.checkpointInterval = settings->value( "checkpointInterval", 0 ).toInt();
+	m_settings.witnessHops = settings->value( "witnessHops", 0 ).toInt();
+	m_settings.lazyUpdates = settings->value( "lazyUpdates", false ).toBool();
 	settings->endGroup();
 	return ok;
 }
@@ -54,13 +83,35 @@ bool ContractionHierarchies::SaveSettings( QSettings* settings )
 {
 	settings->beginGroup( "ContractionHierarchies" );
 	settings->setValue( "blockSize", m_settings.blockSize );
+	settings->setValue( "edgeBased", m_settings.edgeBased );
+	settings->setValue( "nodeOrder", m_settings.nodeOrder );
+	settings->setValue( "coreNodes", m_settings.coreNodes );
+	settings->setValue( "unpackedNodes", m_settings.unpackedNodes );
+	settings->setValue( "keepContraction", m_settings.keepContraction );
+	settings->setValue( "keepOrder", m_settings.keepOrder );
+	settings->setValue( "keepEdgeMap", m_settings.keepEdgeMap );
+	settings->setValue( "customizable", m_settings.customizable );
+	settings->setValue( "spillThreshold", m_settings.spillThreshold );
+	settings->setValue( "checkpointInterval", m_settings.checkpointInterval );
+	settings->setValue( "witnessHops", m_settings.witnessHops );
+	settings->setValue( "lazyUpdates", m_settings.lazyUpdates );
 	settings->endGroup();
 	return true;
 }
 
 int ContractionHierarchies::GetFileFormatVersion()
 {
-	return 1;
+	// the edge based graph cannot be used without its turn table
+	// 3 / 4: compressed path blocks, used unless the blocks are too small or too large
+	const bool compressedPaths = m_settings.blockSize >= 9 && m_settings.blockSize <= 16;
+	if ( m_settings.edgeBased )
+		return compressedPaths ? 4 : 2;
+	return compressedPaths ? 3 : 1;
+}
+
+bool ContractionHierarchies::IsEdgeBased()
+{
+	return m_settings.edgeBased;
 }
 
 ContractionHierarchies::Type ContractionHierarchies::GetType()
@@ -68,47 +119,371 @@ ContractionHierarchies::Type ContractionHierarchies::GetType()
 	return Router;
 }
 
-bool ContractionHierarchies::Preprocess( IImporter* importer, QString dir )
+// identifies the graph a node order belongs to, FNV-1a hash of the node coordinates
+class NodeChecksum {
+public:
+	NodeChecksum() : m_hash( 2166136261u ) {}
+
+	void add( const UnsignedCoordinate& coordinate )
+	{
+		add( coordinate.x );
+		add( coordinate.y );
+	}
+
+	unsigned value() const
+	{
+		return m_hash;
+	}
+
+private:
+	void add( unsigned data )
+	{
+		for ( int byte = 0; byte < 4; byte++ ) {
+			m_hash = ( m_hash ^ ( data & 255 ) ) * 16777619u;
+			data >>= 8;
+		}
+	}
+
+	unsigned m_hash;
+};
+
+// the node order of the last contraction
+// version, number of nodes, checksum, number of rounds | order | nodes per round
+static const unsigned orderFileVersion = 1;
+
+static bool readOrder( QString filename, unsigned numNodes, unsigned checksum, std::vector< NodeID >* order, std::vector< unsigned >* rounds )
 {
-	QString filename = fileInDirectory( dir, "Contraction Hierarchies" );
+	QFile orderFile( filename );
+	if ( !QFile::exists( filename ) ) {
+		qCritical() << "cannot customize, no node order found:" << filename;
+		return false;
+	}
+	if ( !openQFile( &orderFile, QIODevice::ReadOnly ) )
+		return false;
 
-	std::vector< IImporter::RoutingNode > inputNodes;
-	std::vector< IImporter::RoutingEdge > inputEdges;
+	unsigned header[4];
+	if ( orderFile.read( ( char* ) header, sizeof( header ) ) != sizeof( header ) || header[0] != orderFileVersion ) {
+		qCritical() << "node order file format not compatible:" << filename;
+		return false;
+	}
+	if ( header[1] != numNodes || header[2] != checksum ) {
+		qCritical() << "node order belongs to a different graph, the routing nodes changed";
+		return false;
+	}
 
-	if ( !importer->GetRoutingNodes( &inputNodes ) )
+	// every node is contracted in some round, check the size before reading anything
+	const qint64 orderSize = ( qint64 ) numNodes * sizeof( NodeID );
+	const qint64 roundsSize = ( qint64 ) header[3] * sizeof( unsigned );
+	if ( numNodes == 0 || header[3] == 0 || orderFile.size() != ( qint64 ) sizeof( header ) + orderSize + roundsSize ) {
+		qCritical() << "node order file corrupted:" << filename;
 		return false;
-	if ( !importer->GetRoutingEdges( &inputEdges ) )
+	}
+
+	order->resize( numNodes );
+	rounds->resize( header[3] );
+	if ( orderFile.read( ( char* ) &( *order )[0], orderSize ) != orderSize || orderFile.read( ( char* ) &( *rounds )[0], roundsSize ) != roundsSize ) {
+		qCritical() << "node order file corrupted:" << filename;
+		return false;
+	}
+	return true;
+}
+
+static bool writeOrder( QString filename, unsigned checksum, const std::vector< NodeID >& order, const std::vector< unsigned >& rounds )
+{
+	QFile orderFile( filename );
+	if ( !openQFile( &orderFile, QIODevice::WriteOnly ) )
 		return false;
 
-	unsigned numEdges = inputEdges.size();
-	unsigned numNodes = inputNodes.size();
+	unsigned header[4] = { orderFileVersion, ( unsigned ) order.size(), checksum, ( unsigned ) rounds.size() };
+	orderFile.write( ( const char* ) header, sizeof( header ) );
+	orderFile.write( ( const char* ) &order[0], order.size() * sizeof( NodeID ) );
+	orderFile.write( ( const char* ) &rounds[0], rounds.size() * sizeof( unsigned ) );
+	return true;
+}
+
+// contracts the graph, frees the input edges
+// customizing reuses the node order stored by a previous run with keepOrder, skips the node ordering but still searches witnesses,
+// falls back to a full contraction if the order does not match the graph
+// keepOrder stores the node order in filename_order, removes the one of a previous run otherwise
+// a spill threshold > 0 spills the contracted levels to filename_spill and compacts the contraction graph once it allocates more bytes
+// a checkpoint interval > 0 saves the state to filename_checkpoint every interval seconds, resume continues from it
+// witnessHops > 0 limits the witness searches of the sparse phases, lazy updates defer the priority updates until a node is selected
+// reports time and shortcuts of the resulting hierarchy to compare the contraction settings
+static bool contract( unsigned numNodes, std::vector< IImporter::RoutingEdge >* inputEdges, std::vector< CompressedGraph::Edge >* edges, std::vector< NodeID >* map, QString filename, unsigned checksum, bool customize, bool keepOrder,
+							  int nodeOrder, const std::vector< UnsignedCoordinate >& coordinates, quint64 spillThreshold, double checkpointInterval, bool resume, unsigned witnessHops, bool lazyUpdates )
+{
+	Timer time;
+	QString orderFilename = filename + "_order";
+	Contractor* contractor = new Contractor( numNodes, *inputEdges );
+	std::vector< IImporter::RoutingEdge >().swap( *inputEdges );
+	contractor->SetWitnessSearch( witnessHops, lazyUpdates );
+	// customizing is fast, it does not write checkpoints
+	if ( resume && customize ) {
+		qWarning( "resume ignored: customizing does not use checkpoints, contracting with the stored node order" );
+		resume = false;
+	} else if ( resume && checkpointInterval <= 0 ) {
+		qWarning( "resume ignored: it requires a checkpoint interval, contracting from scratch" );
+		resume = false;
+	}
+	if ( spillThreshold != 0 || checkpointInterval > 0 ) {
+		if ( spillThreshold == 0 )
+			spillThreshold = std::numeric_limits< quint64 >::max();
+		if ( !contractor->SetSpillFile( filename + "_spill", spillThreshold, resume ) ) {
+			delete contractor;
+			return false;
+		}
+	}
+	if ( checkpointInterval > 0 )
+		contractor->SetCheckpoint( filename + "_checkpoint", checkpointInterval, checksum, resume );
+
+	std::vector< NodeID > order;
+	std::vector< unsigned > rounds;
+	if ( customize && readOrder( orderFilename, numNodes, checksum, &order, &rounds ) && contractor->RunWithOrder( order, rounds ) ) {
+		qDebug() << "customized the node order of" << orderFilename;
+	} else {
+		if ( customize )
+			qWarning() << "customization failed, contracting from scratch";
+		contractor->Run();
+	}
 
-	Contractor* contractor = new Contractor( numNodes, inputEdges );
-	std::vector< IImporter::RoutingEdge >().swap( inputEdges );
-	contractor->Run();
+	QFile::remove( orderFilename );
+	if ( keepOrder ) {
+		contractor->GetOrder( &order, &rounds );
+		if ( !writeOrder( orderFilename, checksum, order, rounds ) ) {
+			delete contractor;
+			return false;
+		}
+	}
+	std::vector< NodeID >().swap( order );
+	std::vector< unsigned >().swap( rounds );
 
 	std::vector< Contractor::Witness > witnessList;
 	contractor->GetWitnessList( witnessList );
 
 	std::vector< ContractionCleanup::Edge > contractedEdges;
 	std::vector< ContractionCleanup::Edge > contractedLoops;
-	contractor->GetEdges( &contractedEdges );
+	if ( !contractor->GetEdges( &contractedEdges ) ) {
+		delete contractor;
+		return false;
+	}
 	contractor->GetLoops( &contractedLoops );
 	delete contractor;
 
-	ContractionCleanup* cleanup = new ContractionCleanup( inputNodes.size(), contractedEdges, contractedLoops, witnessList );
-	std::vector< ContractionCleanup::Edge >().swap( contractedEdges );
-	std::vector< ContractionCleanup::Edge >().swap( contractedLoops );
-	std::vector< Contractor::Witness >().swap( witnessList );
+	ContractionCleanup* cleanup = new ContractionCleanup( numNodes, &contractedEdges, &contractedLoops, &witnessList, ( ContractionCleanup::NodeOrder ) nodeOrder, coordinates );
 	cleanup->Run();
 
+	cleanup->GetData( edges, map );
+	delete cleanup;
+
+	unsigned shortcuts = 0;
+	for ( unsigned i = 0; i < edges->size(); i++ ) {
+		if ( ( *edges )[i].data.shortcut )
+			shortcuts++;
+	}
+	qDebug( "contraction: hop limit %d, %s updates: %lf s, %d edges, %d shortcuts", witnessHops, lazyUpdates ? "lazy" : "eager", time.elapsed() / 1000.0, ( int ) edges->size(), shortcuts );
+	return true;
+}
+
+// writes the names file, computes the mapping from name ID to file offset
+static bool writeNames( IImporter* importer, QString filename, std::vector< unsigned >* nameMap )
+{
+	std::vector< QString > inputNames;
+	if ( !importer->GetRoutingWayNames( &inputNames ) )
+		return false;
+
+	QFile nameFile( filename + "_names" );
+	if ( !openQFile( &nameFile, QIODevice::WriteOnly ) )
+		return false;
+
+	nameMap->resize( inputNames.size() );
+	for ( unsigned name = 0; name < inputNames.size(); name++ ) {
+		( *nameMap )[name] = nameFile.pos();
+		QByteArray buffer = inputNames[name].toUtf8();
+		buffer.push_back( ( char ) 0 );
+		nameFile.write( buffer );
+	}
+
+	nameFile.close();
+	nameFile.open( QIODevice::ReadOnly );
+	const char* test = ( const char* ) nameFile.map( 0, nameFile.size() );
+	for ( unsigned name = 0; name < inputNames.size(); name++ ) {
+		QString testName = QString::fromUtf8( test + ( *nameMap )[name] );
+		assert( testName == inputNames[name] );
+	}
+
+	return true;
+}
+
+static bool writeTypes( IImporter* importer, QString filename )
+{
+	std::vector< QString > inputTypes;
+	if ( !importer->GetRoutingWayTypes( &inputTypes ) )
+		return false;
+
+	QFile typeFile( filename + "_types" );
+	if ( !openQFile( &typeFile, QIODevice::WriteOnly ) )
+		return false;
+
+	QStringList typeList;
+	for ( unsigned type = 0; type < inputTypes.size(); type++ )
+		typeList.push_back( inputTypes[type] );
+
+	typeFile.write( typeList.join( ";" ).toUtf8() );
+	return true;
+}
+
+// locates the importer's edges in the contracted graph, used by the traffic overlay and only stored with keepEdgeMap
+// version, number of edges | source, target, ID among the parallel edges
+// edges missing from the graph have an invalid ID
+static const unsigned edgeMapFileVersion = 1;
+
+static bool writeEdgeMap( QString filename, const std::vector< IImporter::RoutingEdge >& inputEdges, const std::vector< NodeID >& map, const std::vector< unsigned >& edgeIDs )
+{
+	QFile edgeMapFile( filename );
+	if ( !openQFile( &edgeMapFile, QIODevice::WriteOnly ) )
+		return false;
+
+	unsigned header[2] = { edgeMapFileVersion, ( unsigned ) inputEdges.size() };
+	edgeMapFile.write( ( const char* ) header, sizeof( header ) );
+	for ( unsigned edge = 0; edge < inputEdges.size(); edge++ ) {
+		unsigned location[3] = { map[inputEdges[edge].source], map[inputEdges[edge].target], edgeIDs[edge] };
+		edgeMapFile.write( ( const char* ) location, sizeof( location ) );
+	}
+	return true;
+}
+
+// stores the blocks of the most important nodes decoded, the client keeps them in memory
+// removes the core of a previous run, the client would use it with the new graph otherwise
+static bool writeCore( QString filename, int coreNodes )
+{
+	QFile::remove( filename + "_core" );
+	if ( coreNodes <= 0 )
+		return true;
+	CompressedGraph graph;
+	if ( !graph.loadGraph( filename, 0, true ) )
+		return false;
+	return graph.writeCore( filename + "_core", coreNodes );
+}
+
+// stores the input of the compressed graph builder
+// removes the one of a previous run otherwise, it would not match the new graph
+static bool writeContraction( QString filename, bool keep, const std::vector< IRouter::Node >& nodes, const std::vector< CompressedGraph::Edge >& edges, const std::vector< IImporter::RoutingEdge >& originalEdges, const std::vector< IRouter::Node >& pathNodes )
+{
+	QFile::remove( filename + "_contraction" );
+	if ( !keep )
+		return true;
+	return CompressedGraphBuilder::writeInput( filename + "_contraction", nodes, edges, originalEdges, pathNodes );
+}
+
+// percentage of every block the customizable graph leaves free for later customizations
+static const unsigned customizableBlockReserve = 25;
+
+// travel time in 1/10 seconds, as used by the contractor
+static unsigned edgeDistance( double seconds )
+{
+	return std::max( seconds * 10.0 + 0.5, 1.0 );
+}
+
+// builds the customizable hierarchy instead of contracting, frees the input edges
+// the node order only depends on the road graph, the shortcuts on the node order, their weights are customized for the input edges
+// edges longer than a day are left out like the contractor does
+static bool buildCustomizable( unsigned numNodes, std::vector< IImporter::RoutingEdge >* inputEdges, std::vector< CompressedGraph::Edge >* edges, std::vector< NodeID >* map, Customizer* customizer )
+{
+	Timer time;
+	Customizer::ComputeOrder( numNodes, *inputEdges, map );
+
+	for ( unsigned i = 0; i < inputEdges->size(); i++ ) {
+		const IImporter::RoutingEdge& inputEdge = ( *inputEdges )[i];
+		const unsigned distance = edgeDistance( inputEdge.distance );
+		if ( distance > 24 * 60 * 60 * 10 )
+			continue;
+		const NodeID source = ( *map )[inputEdge.source];
+		const NodeID target = ( *map )[inputEdge.target];
+		CompressedGraph::Edge edge;
+		edge.source = std::max( source, target );
+		edge.target = std::min( source, target );
+		edge.data.distance = distance;
+		edge.data.shortcut = false;
+		edge.data.forward = source >= target || inputEdge.bidirectional;
+		edge.data.backward = source <= target || inputEdge.bidirectional;
+		edge.data.unpacked = false;
+		edge.data.reversed = false;
+		edge.data.id = i;
+		edge.data.path = 0;
+		edges->push_back( edge );
+	}
+	std::vector< IImporter::RoutingEdge >().swap( *inputEdges );
+	std::sort( edges->begin(), edges->end() );
+
+	customizer->BuildTopology( numNodes, *edges );
+	if ( !customizer->Run( edges ) )
+		return false;
+	qDebug( "customizable hierarchy: %lf s, %d edges", time.elapsed() / 1000.0, ( int ) edges->size() );
+	return true;
+}
+
+// lays out the blocks for all shortcuts of the topology, the shortcuts later travel times need take the place of the ones left out now
+// leaves some space free in every block, a shortcut might also be faster than the original edges only with other travel times
+static bool computeCustomizableLayout( unsigned blockSize, const std::vector< IRouter::Node >& nodes, const std::vector< CompressedGraph::Edge >& edges, const std::vector< IImporter::RoutingEdge >& originalEdges,
+									   const std::vector< IRouter::Node >& pathNodes, unsigned unpackedNodes, Customizer* customizer, std::vector< unsigned >* firstNodes )
+{
+	std::vector< IRouter::Node > layoutNodes( nodes );
+	std::vector< CompressedGraph::Edge > layoutEdges( edges );
+	std::vector< IImporter::RoutingEdge > layoutOriginalEdges( originalEdges );
+	std::vector< IRouter::Node > layoutPathNodes( pathNodes );
+	if ( !customizer->Run( &layoutEdges, true ) )
+		return false;
+	CompressedGraphBuilder* builder = new CompressedGraphBuilder( 1u << blockSize, layoutNodes, layoutEdges, layoutOriginalEdges, layoutPathNodes, unpackedNodes );
+	builder->setBlockReserve( customizableBlockReserve );
+	bool ok = builder->computeBlockLayout();
+	builder->getBlockLayout( firstNodes );
+	delete builder;
+	return ok;
+}
+
+bool ContractionHierarchies::Preprocess( IImporter* importer, QString dir )
+{
+	QString filename = fileInDirectory( dir, "Contraction Hierarchies" );
+
+	if ( m_settings.edgeBased )
+		return preprocessEdgeBased( importer, filename );
+
+	std::vector< IImporter::RoutingNode > inputNodes;
+	std::vector< IImporter::RoutingEdge > inputEdges;
+
+	if ( !importer->GetRoutingNodes( &inputNodes ) )
+		return false;
+	if ( !importer->GetRoutingEdges( &inputEdges ) )
+		return false;
+
+	unsigned numEdges = inputEdges.size();
+	unsigned numNodes = inputNodes.size();
+
+	NodeChecksum checksum;
+	std::vector< UnsignedCoordinate > nodeCoordinates;
+	for ( std::vector< IImporter::RoutingNode >::const_iterator i = inputNodes.begin(), iend = inputNodes.end(); i != iend; i++ ) {
+		checksum.add( i->coordinate );
+		if ( m_settings.nodeOrder == ContractionCleanup::SpatialOrder )
+			nodeCoordinates.push_back( i->coordinate );
+	}
+
 	std::vector< CompressedGraph::Edge > edges;
 	std::vector< NodeID > map;
-	cleanup->GetData( &edges, &map );
-	delete cleanup;
+	Customizer customizer;
+	QFile::remove( filename + "_topology" );
+	if ( m_settings.customizable ) {
+		if ( !buildCustomizable( numNodes, &inputEdges, &edges, &map, &customizer ) )
+			return false;
+	} else if ( !contract( numNodes, &inputEdges, &edges, &map, filename, checksum.value(), m_settings.customize, m_settings.keepOrder, m_settings.nodeOrder, nodeCoordinates,
+							  ( quint64 ) std::max( m_settings.spillThreshold, 0 ) * 1024 * 1024, std::max( m_settings.checkpointInterval, 0 ) * 60.0, m_settings.resume,
+							  ( unsigned ) std::max( m_settings.witnessHops, 0 ), m_settings.lazyUpdates ) ) {
+		return false;
+	}
+	std::vector< UnsignedCoordinate >().swap( nodeCoordinates );
 
+	// edges missing from the contracted graph keep the invalid ID
+	std::vector< unsigned > edgeIDs( numEdges, std::numeric_limits< unsigned >::max() );
 	{
-		std::vector< unsigned > edgeIDs( numEdges );
 		for ( unsigned edge = 0; edge < edges.size(); edge++ ) {
 			if ( edges[edge].data.shortcut )
 				continue;
@@ -128,7 +503,12 @@ bool ContractionHierarchies::Preprocess( IImporter* importer, QString dir )
 			}
 			edgeIDs[edges[edge].data.id] = id;
 		}
-		importer->SetEdgeIDMap( edgeIDs );
+		std::vector< unsigned > importerEdgeIDs( edgeIDs );
+		for ( unsigned edge = 0; edge < numEdges; edge++ ) {
+			if ( importerEdgeIDs[edge] == std::numeric_limits< unsigned >::max() )
+				importerEdgeIDs[edge] = 0;
+		}
+		importer->SetEdgeIDMap( importerEdgeIDs );
 	}
 
 	std::vector< IRouter::Node > nodes( numNodes );
@@ -150,61 +530,298 @@ bool ContractionHierarchies::Preprocess( IImporter* importer, QString dir )
 		return false;
 
 	{
-		std::vector< QString > inputNames;
-		if ( !importer->GetRoutingWayNames( &inputNames ) )
+		std::vector< unsigned > nameMap;
+		if ( !writeNames( importer, filename, &nameMap ) )
 			return false;
+		for ( unsigned edge = 0; edge < numEdges; edge++ )
+			inputEdges[edge].nameID = nameMap[inputEdges[edge].nameID];
+	}
+
+	if ( !writeTypes( importer, filename ) )
+		return false;
+
+	for ( std::vector< IImporter::RoutingEdge >::iterator i = inputEdges.begin(), iend = inputEdges.end(); i != iend; i++ ) {
+		i->source = map[i->source];
+		i->target = map[i->target];
+	}
+
+	// ch-customize starts from the contraction result
+	if ( !writeContraction( filename, m_settings.keepContraction || m_settings.customizable, nodes, edges, inputEdges, pathNodes ) )
+		return false;
+
+	// the customized shortcuts of a node have to fit the block it got now, the node IDs would change otherwise
+	std::vector< unsigned > blockLayout;
+	if ( m_settings.customizable && !computeCustomizableLayout( m_settings.blockSize, nodes, edges, inputEdges, pathNodes, std::max( m_settings.unpackedNodes, 0 ), &customizer, &blockLayout ) )
+		return false;
 
-		QFile nameFile( filename + "_names" );
-		if ( !openQFile( &nameFile, QIODevice::WriteOnly ) )
+	CompressedGraphBuilder* builder = new CompressedGraphBuilder( 1u << m_settings.blockSize, nodes, edges, inputEdges, pathNodes, std::max( m_settings.unpackedNodes, 0 ) );
+	if ( m_settings.customizable )
+		builder->setBlockLayout( blockLayout );
+	if ( !builder->run( filename, &map ) )
+		return false;
+	if ( m_settings.customizable ) {
+		Customizer::BuildSettings buildSettings;
+		buildSettings.blockSize = m_settings.blockSize;
+		buildSettings.unpackedNodes = std::max( m_settings.unpackedNodes, 0 );
+		buildSettings.coreNodes = std::max( m_settings.coreNodes, 0 );
+		buildSettings.firstNodes.swap( blockLayout );
+		customizer.SetBuildSettings( buildSettings );
+		if ( !customizer.Write( filename + "_topology" ) )
 			return false;
+	}
+	delete builder;
 
-		std::vector< unsigned > nameMap( inputNames.size() );
-		for ( unsigned name = 0; name < inputNames.size(); name++ ) {
-			nameMap[name] = nameFile.pos();
-			QByteArray buffer = inputNames[name].toUtf8();
-			buffer.push_back( ( char ) 0 );
-			nameFile.write( buffer );
-		}
+	if ( !writeCore( filename, m_settings.coreNodes ) )
+		return false;
 
-		nameFile.close();
-		nameFile.open( QIODevice::ReadOnly );
-		const char* test = ( const char* ) nameFile.map( 0, nameFile.size() );
-		for ( unsigned name = 0; name < inputNames.size(); name++ ) {
-			QString testName = QString::fromUtf8( test + nameMap[name] );
-			assert( testName == inputNames[name] );
-		}
+	// a stale edge map would locate the importer's edges in the wrong graph
+	QFile::remove( filename + "_edgemap" );
+	if ( m_settings.keepEdgeMap ) {
+		if ( !importer->GetRoutingEdges( &inputEdges ) )
+			return false;
+		if ( !writeEdgeMap( filename + "_edgemap", inputEdges, map, edgeIDs ) )
+			return false;
+	}
 
-		for ( unsigned edge = 0; edge < numEdges; edge++ )
-			inputEdges[edge].nameID = nameMap[inputEdges[edge].nameID];
+	importer->SetIDMap( map );
+
+	return true;
+}
+
+// the nodes of the contracted graph are directed road edges: a forward copy for every road edge
+// and a backward copy for every bidirectional one, located at the road edge's head.
+// the edges are the allowed turns, weighted by the penalty plus the travel time of the road edge turned into.
+// the turn tables are needed to compute the start and end of a route and are stored in a separate file
+bool ContractionHierarchies::preprocessEdgeBased( IImporter* importer, QString filename )
+{
+	std::vector< IImporter::RoutingNode > inputNodes;
+	std::vector< IImporter::RoutingEdge > inputEdges;
+	std::vector< char > inDegree;
+	std::vector< char > outDegree;
+	std::vector< double > penalties;
+
+	if ( !importer->GetRoutingNodes( &inputNodes ) )
+		return false;
+	if ( !importer->GetRoutingEdges( &inputEdges ) )
+		return false;
+	if ( !importer->GetRoutingPenalties( &inDegree, &outDegree, &penalties ) ) {
+		qCritical() << "edge based contraction requires turning penalties";
+		return false;
 	}
+	// the topology only covers the graph of road edges
+	QFile::remove( filename + "_topology" );
+	if ( m_settings.customizable )
+		qWarning( "customizable ignored: only supported by the node based graph" );
 
-	{
-		std::vector< QString > inputTypes;
-		if ( !importer->GetRoutingWayTypes( &inputTypes ) )
+	unsigned numEdges = inputEdges.size();
+	unsigned numNodes = inputNodes.size();
+	if ( inDegree.size() != numNodes || outDegree.size() != numNodes ) {
+		qCritical() << "turning penalties do not match the routing nodes";
+		return false;
+	}
+
+	std::vector< unsigned > firstTable( numNodes + 1, 0 );
+	std::vector< unsigned > firstIn( numNodes + 1, 0 );
+	std::vector< unsigned > firstOut( numNodes + 1, 0 );
+	for ( unsigned node = 0; node < numNodes; node++ ) {
+		firstTable[node + 1] = firstTable[node] + inDegree[node] * outDegree[node];
+		firstIn[node + 1] = firstIn[node] + inDegree[node];
+		firstOut[node + 1] = firstOut[node] + outDegree[node];
+	}
+	if ( firstTable[numNodes] != penalties.size() ) {
+		qCritical() << "turning penalties do not match the routing nodes";
+		return false;
+	}
+
+	// create the directed copies of the road edges
+	std::vector< NodeID > forwardNode( numEdges );
+	std::vector< NodeID > backwardNode( numEdges, 0 );
+	std::vector< UnsignedCoordinate > nodeCoordinates;
+	for ( unsigned edge = 0; edge < numEdges; edge++ ) {
+		const IImporter::RoutingEdge& road = inputEdges[edge];
+		forwardNode[edge] = nodeCoordinates.size();
+		nodeCoordinates.push_back( inputNodes[road.target].coordinate );
+		if ( road.bidirectional ) {
+			backwardNode[edge] = nodeCoordinates.size();
+			nodeCoordinates.push_back( inputNodes[road.source].coordinate );
+		}
+	}
+	qDebug() << "edge based graph:" << nodeCoordinates.size() << "directed road edges";
+
+	// assign the directed copies to the slots of the turn tables
+	TurnTable::Slot unused;
+	unused.roadEdge = numEdges;
+	unused.forward = false;
+	std::vector< TurnTable::Slot > inSlots( firstIn[numNodes], unused );
+	std::vector< TurnTable::Slot > outSlots( firstOut[numNodes], unused );
+	for ( unsigned edge = 0; edge < numEdges; edge++ ) {
+		const IImporter::RoutingEdge& road = inputEdges[edge];
+		if ( road.edgeIDAtSource >= outDegree[road.source] || road.edgeIDAtTarget >= inDegree[road.target] ) {
+			qCritical() << "edge not contained in the turn tables:" << road.source << road.target;
 			return false;
+		}
+		TurnTable::Slot slot;
+		slot.roadEdge = edge;
+		slot.forward = true;
+		outSlots[firstOut[road.source] + road.edgeIDAtSource] = slot;
+		inSlots[firstIn[road.target] + road.edgeIDAtTarget] = slot;
+		if ( road.bidirectional ) {
+			if ( road.edgeIDAtTarget >= outDegree[road.target] || road.edgeIDAtSource >= inDegree[road.source] ) {
+				qCritical() << "edge not contained in the turn tables:" << road.source << road.target;
+				return false;
+			}
+			slot.forward = false;
+			outSlots[firstOut[road.target] + road.edgeIDAtTarget] = slot;
+			inSlots[firstIn[road.source] + road.edgeIDAtSource] = slot;
+		}
+	}
 
-		QFile typeFile( filename + "_types" );
-		if ( !openQFile( &typeFile, QIODevice::WriteOnly ) )
+	// the paths of backward copies are traversed in reverse
+	std::vector< IRouter::Node > pathNodes;
+	std::vector< unsigned > reversedPath( numEdges, 0 );
+	{
+		std::vector< IImporter::RoutingNode > edgePaths;
+		if ( !importer->GetRoutingEdgePaths( &edgePaths ) )
 			return false;
+		pathNodes.resize( edgePaths.size() );
+		for ( unsigned i = 0; i < edgePaths.size(); i++ )
+			pathNodes[i].coordinate = edgePaths[i].coordinate;
+		for ( unsigned edge = 0; edge < numEdges; edge++ ) {
+			const IImporter::RoutingEdge& road = inputEdges[edge];
+			if ( !road.bidirectional || road.pathLength == 0 )
+				continue;
+			reversedPath[edge] = pathNodes.size();
+			for ( unsigned i = road.pathID + road.pathLength; i > road.pathID; i-- )
+				pathNodes.push_back( pathNodes[i - 1] );
+		}
+	}
 
-		QStringList typeList;
-		for ( unsigned type = 0; type < inputTypes.size(); type++ )
-			typeList.push_back( inputTypes[type] );
+	std::vector< unsigned > nameMap;
+	if ( !writeNames( importer, filename, &nameMap ) )
+		return false;
+	if ( !writeTypes( importer, filename ) )
+		return false;
+
+	// every allowed turn becomes an edge
+	std::vector< IImporter::RoutingEdge > turns;
+	for ( unsigned node = 0; node < numNodes; node++ ) {
+		for ( unsigned in = firstIn[node]; in < firstIn[node + 1]; in++ ) {
+			const TurnTable::Slot& from = inSlots[in];
+			if ( from.roadEdge == numEdges )
+				continue;
+			for ( unsigned out = firstOut[node]; out < firstOut[node + 1]; out++ ) {
+				const TurnTable::Slot& to = outSlots[out];
+				if ( to.roadEdge == numEdges )
+					continue;
+				const double penalty = penalties[firstTable[node] + ( in - firstIn[node] ) * outDegree[node] + out - firstOut[node]];
+				if ( penalty < 0 )
+					continue;
+				const IImporter::RoutingEdge& road = inputEdges[to.roadEdge];
+				IImporter::RoutingEdge turn = road;
+				turn.source = from.forward ? forwardNode[from.roadEdge] : backwardNode[from.roadEdge];
+				turn.target = to.forward ? forwardNode[to.roadEdge] : backwardNode[to.roadEdge];
+				turn.bidirectional = false;
+				turn.nameID = nameMap[road.nameID];
+				if ( !to.forward && road.pathLength != 0 )
+					turn.pathID = reversedPath[to.roadEdge];
+				// same rounding as the turn table => query distances are exact
+				turn.distance = ( edgeDistance( road.distance ) + ( int ) ( penalty * 10 + 0.5 ) ) / 10.0;
+				turns.push_back( turn );
+			}
+		}
+	}
+	qDebug() << "edge based graph:" << turns.size() << "turns";
 
-		typeFile.write( typeList.join( ";" ).toUtf8() );
+	std::vector< CompressedGraph::Edge > edges;
+	std::vector< NodeID > map;
+	{
+		NodeChecksum checksum;
+		for ( unsigned node = 0; node < nodeCoordinates.size(); node++ )
+			checksum.add( nodeCoordinates[node] );
+		std::vector< IImporter::RoutingEdge > contractorInput( turns );
+		if ( !contract( nodeCoordinates.size(), &contractorInput, &edges, &map, filename, checksum.value(), m_settings.customize, m_settings.keepOrder, m_settings.nodeOrder, nodeCoordinates,
+						( quint64 ) std::max( m_settings.spillThreshold, 0 ) * 1024 * 1024, std::max( m_settings.checkpointInterval, 0 ) * 60.0, m_settings.resume,
+						( unsigned ) std::max( m_settings.witnessHops, 0 ), m_settings.lazyUpdates ) )
+			return false;
 	}
 
-	for ( std::vector< IImporter::RoutingEdge >::iterator i = inputEdges.begin(), iend = inputEdges.end(); i != iend; i++ ) {
+	std::vector< IRouter::Node > nodes( nodeCoordinates.size() );
+	for ( unsigned node = 0; node < nodeCoordinates.size(); node++ )
+		nodes[map[node]].coordinate = nodeCoordinates[node];
+	std::vector< UnsignedCoordinate >().swap( nodeCoordinates );
+
+	for ( std::vector< IImporter::RoutingEdge >::iterator i = turns.begin(), iend = turns.end(); i != iend; i++ ) {
 		i->source = map[i->source];
 		i->target = map[i->target];
 	}
 
-	CompressedGraphBuilder* builder = new CompressedGraphBuilder( 1u << m_settings.blockSize, nodes, edges, inputEdges, pathNodes );
+	if ( !writeContraction( filename, m_settings.keepContraction, nodes, edges, turns, pathNodes ) )
+		return false;
+
+	CompressedGraphBuilder* builder = new CompressedGraphBuilder( 1u << m_settings.blockSize, nodes, edges, turns, pathNodes, std::max( m_settings.unpackedNodes, 0 ) );
 	if ( !builder->run( filename, &map ) )
 		return false;
 	delete builder;
 
-	importer->SetIDMap( map );
+	if ( !writeCore( filename, m_settings.coreNodes ) )
+		return false;
+	// the traffic overlay needs a node based graph
+	QFile::remove( filename + "_edgemap" );
+
+	// the gps lookup works on the original nodes and distinguishes parallel road edges
+	{
+		std::vector< NodeID > idMap( numNodes );
+		for ( unsigned node = 0; node < numNodes; node++ )
+			idMap[node] = node;
+		importer->SetIDMap( idMap );
+	}
+
+	std::vector< unsigned > edgeIDs( numEdges, 0 );
+	{
+		std::vector< std::pair< std::pair< NodeID, NodeID >, unsigned > > sorted( numEdges );
+		for ( unsigned edge = 0; edge < numEdges; edge++ )
+			sorted[edge] = std::make_pair( std::make_pair( inputEdges[edge].source, inputEdges[edge].target ), edge );
+		std::sort( sorted.begin(), sorted.end() );
+		for ( unsigned i = 1; i < numEdges; i++ ) {
+			if ( sorted[i].first == sorted[i - 1].first )
+				edgeIDs[sorted[i].second] = edgeIDs[sorted[i - 1].second] + 1;
+		}
+		importer->SetEdgeIDMap( edgeIDs );
+	}
+
+	std::vector< TurnTable::RoadEdge > roadEdges( numEdges );
+	std::vector< UnsignedCoordinate > roadCoordinates;
+	{
+		std::vector< IImporter::RoutingNode > edgePaths;
+		if ( !importer->GetRoutingEdgePaths( &edgePaths ) )
+			return false;
+		for ( unsigned edge = 0; edge < numEdges; edge++ ) {
+			const IImporter::RoutingEdge& road = inputEdges[edge];
+			TurnTable::RoadEdge& result = roadEdges[edge];
+			result.source = road.source;
+			result.target = road.target;
+			result.edgeID = edgeIDs[edge];
+			result.edgeIDAtSource = road.edgeIDAtSource;
+			result.edgeIDAtTarget = road.edgeIDAtTarget;
+			result.bidirectional = road.bidirectional;
+			result.branchingPossible = road.branchingPossible;
+			result.forwardNode = map[forwardNode[edge]];
+			result.backwardNode = road.bidirectional ? map[backwardNode[edge]] : 0;
+			result.distance = edgeDistance( road.distance );
+			result.name = nameMap[road.nameID];
+			result.type = road.type;
+			result.path = roadCoordinates.size();
+			result.pathLength = road.pathLength + 2;
+			roadCoordinates.push_back( inputNodes[road.source].coordinate );
+			for ( unsigned i = road.pathID; i < road.pathID + road.pathLength; i++ )
+				roadCoordinates.push_back( edgePaths[i].coordinate );
+			roadCoordinates.push_back( inputNodes[road.target].coordinate );
+		}
+	}
+
+	TurnTableBuilder turnTableBuilder( inDegree, outDegree, penalties, inSlots, roadEdges, roadCoordinates );
+	if ( !turnTableBuilder.run( filename + "_turns" ) )
+		return false;
 
 	return true;
 }
@@ -243,6 +860,20 @@ QString ContractionHierarchies::GetModuleName()
 bool ContractionHierarchies::GetSettingsList( QVector< Setting >* settings )
 {
 	settings->push_back( Setting( "", "block-size", "sets block size of compressed graph to 2^x", "integer > 7" ) );
+	settings->push_back( Setting( "", "edge-based", "honours turn restrictions and turning penalties, requires more memory", "" ) );
+	settings->push_back( Setting( "", "customize", "contracts with the node order stored by keep-order, skips the node ordering but still searches witnesses, ch-customize is faster for modules preprocessed with customizable", "" ) );
+	settings->push_back( Setting( "", "node-order", "decides which nodes share a block: depth levels, spatial order within levels or dfs of the search spaces", "depth|spatial|dfs" ) );
+	settings->push_back( Setting( "", "core-nodes", "keeps the blocks of the x most important nodes decoded in memory, 0 disables the core", "integer >= 0" ) );
+	settings->push_back( Setting( "", "unpack-nodes", "stores the unpacked paths of all shortcuts of the x most important nodes, speeds up the route geometry", "integer >= 0" ) );
+	settings->push_back( Setting( "", "keep-contraction", "stores the contraction result, lets ch-tune rebuild the graph with other block sizes", "" ) );
+	settings->push_back( Setting( "", "spill-threshold", "spills contracted levels to disk and compacts the contraction graph once it exceeds x MB, 0 keeps everything in memory", "integer >= 0" ) );
+	settings->push_back( Setting( "", "checkpoint-interval", "saves the contraction state every x minutes, 0 disables checkpoints", "integer >= 0" ) );
+	settings->push_back( Setting( "", "resume", "continues an interrupted contraction from its last checkpoint", "" ) );
+	settings->push_back( Setting( "", "witness-hops", "limits the witness searches to x edges while the graph is sparse, faster but adds shortcuts, 0 disables the limit", "integer >= 0" ) );
+	settings->push_back( Setting( "", "lazy-updates", "recomputes node priorities only when a node is selected for contraction", "" ) );
+	settings->push_back( Setting( "", "keep-order", "stores the node order next to the module, lets later runs customize it", "" ) );
+	settings->push_back( Setting( "", "keep-edge-map", "stores the location of every routing edge in the graph, required by traffic updates", "" ) );
+	settings->push_back( Setting( "", "customizable", "orders the nodes by the road graph only instead of contracting, lets ch-customize apply new travel times in seconds, queries get slower", "" ) );
 	return true;
 }
 
@@ -253,6 +884,55 @@ bool ContractionHierarchies::SetSetting( int id, QVariant data )
 	case 0:
 		m_settings.blockSize = data.toInt( &ok );
 		break;
+	case 1:
+		m_settings.edgeBased = true;
+		break;
+	case 2:
+		m_settings.customize = true;
+		break;
+	case 3:
+		if ( data.toString() == "depth" )
+			m_settings.nodeOrder = ContractionCleanup::DepthOrder;
+		else if ( data.toString() == "spatial" )
+			m_settings.nodeOrder = ContractionCleanup::SpatialOrder;
+		else if ( data.toString() == "dfs" )
+			m_settings.nodeOrder = ContractionCleanup::DFSOrder;
+		else
+			ok = false;
+		break;
+	case 4:
+		m_settings.coreNodes = data.toInt( &ok );
+		break;
+	case 5:
+		m_settings.unpackedNodes = data.toInt( &ok );
+		break;
+	case 6:
+		m_settings.keepContraction = true;
+		break;
+	case 7:
+		m_settings.spillThreshold = data.toInt( &ok );
+		break;
+	case 8:
+		m_settings.checkpointInterval = data.toInt( &ok );
+		break;
+	case 9:
+		m_settings.resume = true;
+		break;
+	case 10:
+		m_settings.witnessHops = data.toInt( &ok );
+		break;
+	case 11:
+		m_settings.lazyUpdates = true;
+		break;
+	case 12:
+		m_settings.keepOrder = true;
+		break;
+	case 13:
+		m_settings.keepEdgeMap = true;
+		break;
+	case 14:
+		m_settings.customizable = true;
+		break;
 	default:
 		return false;
 	}
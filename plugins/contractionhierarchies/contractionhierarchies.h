@@ -45,6 +45,37 @@ public:
 	struct Settings
 	{
 		int blockSize;
+		// contract the graph of directed road edges and turns, honours turning penalties and restrictions
+		bool edgeBased;
+		// contract with the node order stored by a previous run with keepOrder, skips the node ordering but still runs the witness searches
+		// the routing nodes have to be the same, e.g., only the speed profile changed
+		bool customize;
+		// ContractionCleanup::NodeOrder, decides which nodes share a block
+		int nodeOrder;
+		// the blocks holding this many of the most important nodes are stored uncompressed and pinned in memory by the client
+		int coreNodes;
+		// the shortcuts of this many of the most important nodes store their fully unpacked path
+		int unpackedNodes;
+		// stores the contraction result next to the graph, ch-tune rebuilds the graph from it with other block sizes
+		bool keepContraction;
+		// in MB, > 0 spills the contracted levels to disk and compacts the contraction graph once it allocates more, 0 disables spilling
+		// does not bound the memory of the cleanup and the graph builder, which hold all edges
+		int spillThreshold;
+		// in minutes, saves the contraction state periodically, 0 disables checkpoints
+		int checkpointInterval;
+		// continues from the last checkpoint, not stored with the settings
+		bool resume;
+		// limits the witness searches of the contraction to this many edges while the remaining graph is sparse, 0 disables the limit
+		int witnessHops;
+		// recomputes the priority of a node when it is selected instead of after each contracted neighbour
+		bool lazyUpdates;
+		// stores the node order next to the module for later customizations
+		bool keepOrder;
+		// stores the location of the importer's edges in the graph, needed by the traffic overlay of the client
+		bool keepEdgeMap;
+		// builds a hierarchy whose node order and shortcuts do not depend on the travel times instead of contracting, ignores the contraction settings
+		// stores its topology and the contraction result, ch-customize rewrites the module with new travel times, queries search more shortcuts
+		bool customizable;
 	};
 
 	ContractionHierarchies();
@@ -70,7 +101,13 @@ public:
 	virtual bool GetSettingsList( QVector< Setting >* settings );
 	virtual bool SetSetting( int id, QVariant data );
 
+	// contracts the graph of directed road edges and turns
+	bool IsEdgeBased();
+
 protected:
+
+	bool preprocessEdgeBased( IImporter* importer, QString filename );
+
 	Settings m_settings;
 };
 
@@ -23,8 +23,13 @@ HEADERS += contractionhierarchies.h \
 	 ../../utils/coordinates.h \
 	 ../../utils/config.h \
 	 compressedgraph.h \
+	 frequencycache.h \
 	 compressedgraphbuilder.h \
+	 customizer.h \
+	 turntable.h \
+	 turntablebuilder.h \
 	 ../../utils/bithelpers.h \
+	 ../../utils/bitunpack.h \
 	 ../../utils/qthelpers.h \
 	 ../../interfaces/irouter.h
 SOURCES += contractionhierarchies.cpp
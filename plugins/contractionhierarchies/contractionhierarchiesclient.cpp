@@ -19,16 +19,26 @@ along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "contractionhierarchiesclient.h"
 #include "utils/qthelpers.h"
+#include "utils/gridoutline.h"
 #include <QtDebug>
-#include <stack>
+#include <QTime>
+#include <vector>
+#include <algorithm>
+#include <iterator>
 #ifndef NOGUI
 	#include <QMessageBox>
 #endif
 
 ContractionHierarchiesClient::ContractionHierarchiesClient()
 {
-	m_heapForward = NULL;
-	m_heapBackward = NULL;
+	m_context = NULL;
+	m_updateContext = NULL;
+	m_cacheMode = BoundedCache;
+	m_cacheSize = 1024 * 1024 * 6;
+	m_warmCache = false;
+	m_overlayVersion = 0;
+	m_overlay = QSharedPointer< const Overlay >( new Overlay() );
+	m_collectStatistics = false;
 }
 
 ContractionHierarchiesClient::~ContractionHierarchiesClient()
@@ -56,21 +66,36 @@ void ContractionHierarchiesClient::ShowSettings()
 
 bool ContractionHierarchiesClient::UnloadData()
 {
-	if ( m_heapForward != NULL )
-		delete m_heapForward;
-	m_heapForward = NULL;
-	if ( m_heapBackward != NULL )
-		delete m_heapBackward;
-	m_heapBackward = NULL;
+	if ( m_warmCache && m_context != NULL )
+		SaveWarmCache();
+	if ( m_context != NULL )
+		delete m_context;
+	m_context = NULL;
+	delete m_updateContext;
+	m_updateContext = NULL;
+	m_warmCacheFile.clear();
+	std::vector< unsigned >().swap( m_hotBlocks );
+	std::vector< unsigned >().swap( m_hotPathBlocks );
 	m_types.clear();
 	m_graph.unloadGraph();
+	m_turnTable.unload();
+	Overlay* overlay = new Overlay();
+	overlay->version = ++m_overlayVersion;
+	publishOverlay( QSharedPointer< const Overlay >( overlay ) );
+	std::vector< EdgeLocation >().swap( m_edgeMap );
+	std::vector< unsigned >().swap( m_lowerFirst );
+	std::vector< NodeIterator >().swap( m_lowerNodes );
+	std::vector< unsigned >().swap( m_shortcutFirst );
+	std::vector< NodeIterator >().swap( m_shortcutNodes );
 
 	return true;
 }
 
 bool ContractionHierarchiesClient::IsCompatible( int fileFormatVersion )
 {
-	if ( fileFormatVersion == 1 )
+	// 2: edge based graph with turn table
+	// 3 / 4: 1 / 2 with compressed path blocks
+	if ( fileFormatVersion >= 1 && fileFormatVersion <= 4 )
 		return true;
 	return false;
 }
@@ -80,8 +105,18 @@ bool ContractionHierarchiesClient::LoadData()
 	QString filename = fileInDirectory( m_directory,"Contraction Hierarchies" );
 	UnloadData();
 
-	if ( !m_graph.loadGraph( filename, 1024 * 1024 * 4 ) )
+	// a third of the budget holds decoded blocks, the rest the raw edge and path blocks
+	m_graph.setDecodedCacheSize( m_cacheSize / 3 );
+	if ( !m_graph.loadGraph( filename, m_cacheSize - m_cacheSize / 3, m_cacheMode == MemoryMapped ) )
 		return false;
+	if ( QFile::exists( filename + "_turns" ) && !m_turnTable.load( filename + "_turns" ) )
+		return false;
+
+	if ( m_warmCache ) {
+		m_warmCacheFile = filename + "_warm";
+		if ( QFile::exists( m_warmCacheFile ) && m_graph.readHotBlocks( m_warmCacheFile, &m_hotBlocks, &m_hotPathBlocks ) && m_cacheMode == MemoryMapped )
+			m_graph.prefetch( NULL, m_hotBlocks, m_hotPathBlocks );
+	}
 
 	m_namesFile.setFileName( filename + "_names" );
 	if ( !openQFile( &m_namesFile, QIODevice::ReadOnly ) )
@@ -91,8 +126,9 @@ bool ContractionHierarchiesClient::LoadData()
 		return false;
 	m_namesFile.close();
 
-	m_heapForward = new Heap( m_graph.numberOfNodes() );
-	m_heapBackward = new Heap( m_graph.numberOfNodes() );
+	m_context = createContext();
+	if ( m_context == NULL )
+		return false;
 
 	QFile typeFile( filename + "_types" );
 	if ( !openQFile( &typeFile, QIODevice::ReadOnly ) )
@@ -105,20 +141,64 @@ bool ContractionHierarchiesClient::LoadData()
 	return true;
 }
 
+ContractionHierarchiesClient::Context* ContractionHierarchiesClient::createContext()
+{
+	Context* context = new Context( m_graph.numberOfNodeIDs() );
+	context->overlay = currentOverlay();
+	if ( !m_graph.loadCache( &context->cache ) ) {
+		delete context;
+		return NULL;
+	}
+	if ( m_cacheMode == BoundedCache && ( !m_hotBlocks.empty() || !m_hotPathBlocks.empty() ) ) {
+		QTime time;
+		time.start();
+		unsigned blocks = m_graph.prefetch( &context->cache, m_hotBlocks, m_hotPathBlocks );
+		qDebug() << "Contraction Hierarchies: prefetched" << blocks << "blocks:" << time.elapsed() << "ms";
+	}
+	return context;
+}
+
+IRouter::QueryContext* ContractionHierarchiesClient::CreateQueryContext()
+{
+	if ( m_context == NULL )
+		return NULL;
+	return createContext();
+}
+
 bool ContractionHierarchiesClient::GetRoute( double* distance, QVector< Node>* pathNodes, QVector< Edge >* pathEdges, const IGPSLookup::Result& source, const IGPSLookup::Result& target )
+{
+	return GetRoute( NULL, distance, pathNodes, pathEdges, source, target );
+}
+
+bool ContractionHierarchiesClient::GetRoute( QueryContext* queryContext, double* distance, QVector< Node>* pathNodes, QVector< Edge >* pathEdges, const IGPSLookup::Result& source, const IGPSLookup::Result& target )
 {
 	assert( distance != NULL );
-	m_heapForward->Clear();
-	m_heapBackward->Clear();
+	Context* context = queryContext != NULL ? static_cast< Context* >( queryContext ) : m_context;
+	assert( context != NULL );
+	startStatistics( context );
+	context->overlay = currentOverlay();
+	context->heapForward.Clear();
+	context->heapBackward.Clear();
+
+	if ( m_turnTable.loaded() ) {
+		*distance = computeEdgeBasedRoute( context, source, target, pathNodes, pathEdges );
+		if ( *distance == std::numeric_limits< double >::max() )
+			return false;
+		*distance /= 10;
+		return true;
+	}
 
-	*distance = computeRoute( source, target, pathNodes, pathEdges );
+	if ( context->overlay->weights.isEmpty() )
+		*distance = computeRoute( context, source, target, pathNodes, pathEdges );
+	else
+		*distance = computeOverlaidRoute( context, source, target, pathNodes, pathEdges );
 	if ( *distance == std::numeric_limits< int >::max() )
 		return false;
 
 	// is it shorter to drive along the edge?
 	if ( target.source == source.source && target.target == source.target && source.edgeID == target.edgeID ) {
-		EdgeIterator targetEdge = m_graph.findEdge( target.source, target.target, target.edgeID );
-		double onEdgeDistance = fabs( target.percentage - source.percentage ) * targetEdge.distance();
+		EdgeIterator targetEdge = m_graph.findEdge( &context->cache, target.source, target.target, target.edgeID );
+		double onEdgeDistance = fabs( target.percentage - source.percentage ) * positionWeight( context, targetEdge, target );
 		if ( onEdgeDistance < *distance ) {
 			if ( ( targetEdge.forward() && targetEdge.backward() ) || source.percentage < target.percentage ) {
 				if ( pathNodes != NULL && pathEdges != NULL )
@@ -127,9 +207,10 @@ bool ContractionHierarchiesClient::GetRoute( double* distance, QVector< Node>* p
 					pathEdges->clear();
 					pathNodes->push_back( source.nearestPoint );
 
-					QVector< Node > tempNodes;
+					QVector< Node >& tempNodes = context->tempNodes;
+					tempNodes.clear();
 					if ( targetEdge.unpacked() )
-						m_graph.path( targetEdge, &tempNodes, pathEdges, target.target == targetEdge.target() );
+						m_graph.path( &context->cache, targetEdge, &tempNodes, pathEdges, target.target == targetEdge.target() );
 					else
 						pathEdges->push_back( targetEdge.description() );
 
@@ -183,14 +264,55 @@ bool ContractionHierarchiesClient::GetTypes( QVector< QString >* result, QVector
 	return true;
 }
 
+void ContractionHierarchiesClient::SetCacheMode( CacheMode mode )
+{
+	m_cacheMode = mode;
+}
+
+ICacheSettings::CacheMode ContractionHierarchiesClient::GetCacheMode()
+{
+	return m_cacheMode;
+}
+
+void ContractionHierarchiesClient::SetCacheSize( unsigned bytes )
+{
+	m_cacheSize = bytes;
+}
+
+unsigned ContractionHierarchiesClient::GetCacheSize()
+{
+	return m_cacheSize;
+}
+
+void ContractionHierarchiesClient::SetWarmCache( bool enabled )
+{
+	m_warmCache = enabled;
+}
+
+bool ContractionHierarchiesClient::SaveWarmCache()
+{
+	if ( m_context == NULL || m_warmCacheFile.isEmpty() )
+		return false;
+	return m_graph.writeHotBlocks( m_warmCacheFile, &m_context->cache );
+}
+
 template< class EdgeAllowed, class StallEdgeAllowed >
-void ContractionHierarchiesClient::computeStep( Heap* heapForward, Heap* heapBackward, const EdgeAllowed& edgeAllowed, const StallEdgeAllowed& stallEdgeAllowed, NodeIterator* middle, int* targetDistance ) {
+void ContractionHierarchiesClient::computeStep( Context* context, Heap* heapForward, Heap* heapBackward, const EdgeAllowed& edgeAllowed, const StallEdgeAllowed& stallEdgeAllowed, NodeIterator* middle, int* targetDistance ) {
 
 	const NodeIterator node = heapForward->DeleteMin();
 	const int distance = heapForward->GetKey( node );
 
-	if ( heapForward->GetData( node ).stalled )
+	if ( heapForward->GetData( node ).stalled ) {
+		if ( context->collectStatistics )
+			context->statistics.stalled++;
 		return;
+	}
+	if ( context->collectStatistics ) {
+		if ( edgeAllowed.travelsForward() )
+			context->statistics.settledForward++;
+		else
+			context->statistics.settledBackward++;
+	}
 
 	if ( heapBackward->WasInserted( node ) && !heapBackward->GetData( node ).stalled ) {
 		const int newDistance = heapBackward->GetKey( node ) + distance;
@@ -204,31 +326,34 @@ void ContractionHierarchiesClient::computeStep( Heap* heapForward, Heap* heapBac
 		heapForward->DeleteAll();
 		return;
 	}
-	for ( EdgeIterator edge = m_graph.edges( node ); edge.hasEdgesLeft(); ) {
+	std::queue< NodeIterator >& stallQueue = context->stallQueue;
+	const Overlay* overlaid = this->overlaid( context, node );
+	for ( EdgeIterator edge = m_graph.edges( &context->cache, node ); edge.hasEdgesLeft(); ) {
 		m_graph.unpackNextEdge( &edge );
 		const NodeIterator to = edge.target();
-		const int edgeWeight = edge.distance();
+		const int edgeWeight = weight( edge, overlaid, edgeAllowed.travelsForward() );
 		assert( edgeWeight > 0 );
 		const int toDistance = distance + edgeWeight;
 
 		if ( stallEdgeAllowed( edge.forward(), edge.backward() ) && heapForward->WasInserted( to ) ) {
-			const int shorterDistance = heapForward->GetKey( to ) + edgeWeight;
+			const int shorterDistance = heapForward->GetKey( to ) + ( int ) weight( edge, overlaid, stallEdgeAllowed.travelsForward() );
 			if ( shorterDistance < distance ) {
 				//perform a bfs starting at node
 				//only insert nodes when a sub-optimal path can be proven
 				//insert node into the stall queue
 				heapForward->GetKey( node ) = shorterDistance;
 				heapForward->GetData( node ).stalled = true;
-				m_stallQueue.push( node );
+				stallQueue.push( node );
 
-				while ( !m_stallQueue.empty() ) {
+				while ( !stallQueue.empty() ) {
 					//get node from the queue
-					const NodeIterator stallNode = m_stallQueue.front();
-					m_stallQueue.pop();
+					const NodeIterator stallNode = stallQueue.front();
+					stallQueue.pop();
 					const int stallDistance = heapForward->GetKey( stallNode );
+					const Overlay* stallOverlaid = this->overlaid( context, stallNode );
 
 					//iterate over outgoing edges
-					for ( EdgeIterator stallEdge = m_graph.edges( stallNode ); stallEdge.hasEdgesLeft(); ) {
+					for ( EdgeIterator stallEdge = m_graph.edges( &context->cache, stallNode ); stallEdge.hasEdgesLeft(); ) {
 						m_graph.unpackNextEdge( &stallEdge );
 						//is edge outgoing/reached/stalled?
 						if ( !edgeAllowed( stallEdge.forward(), stallEdge.backward() ) )
@@ -239,7 +364,7 @@ void ContractionHierarchiesClient::computeStep( Heap* heapForward, Heap* heapBac
 						if ( heapForward->GetData( stallTo ).stalled == true )
 							continue;
 
-						const int stallToDistance = stallDistance + stallEdge.distance();
+						const int stallToDistance = stallDistance + weight( stallEdge, stallOverlaid, edgeAllowed.travelsForward() );
 						//sub-optimal path found -> insert stallTo
 						if ( stallToDistance < heapForward->GetKey( stallTo ) ) {
 							if ( heapForward->WasRemoved( stallTo ) )
@@ -247,7 +372,7 @@ void ContractionHierarchiesClient::computeStep( Heap* heapForward, Heap* heapBac
 							else
 								heapForward->DecreaseKey( stallTo, stallToDistance );
 
-							m_stallQueue.push( stallTo );
+							stallQueue.push( stallTo );
 							heapForward->GetData( stallTo ).stalled = true;
 						}
 					}
@@ -257,6 +382,8 @@ void ContractionHierarchiesClient::computeStep( Heap* heapForward, Heap* heapBac
 		}
 
 		if ( edgeAllowed( edge.forward(), edge.backward() ) ) {
+			if ( context->collectStatistics )
+				context->statistics.relaxedEdges++;
 			//New Node discovered -> Add to Heap + Node Info Storage
 			if ( !heapForward->WasInserted( to ) )
 				heapForward->Insert( to, toDistance, node );
@@ -272,34 +399,571 @@ void ContractionHierarchiesClient::computeStep( Heap* heapForward, Heap* heapBac
 	}
 }
 
-int ContractionHierarchiesClient::computeRoute( const IGPSLookup::Result& source, const IGPSLookup::Result& target, QVector< Node>* pathNodes, QVector< Edge >* pathEdges ) {
-	EdgeIterator sourceEdge = m_graph.findEdge( source.source, source.target, source.edgeID );
-	unsigned sourceWeight = sourceEdge.distance();
-	EdgeIterator targetEdge = m_graph.findEdge( target.source, target.target, target.edgeID );
-	unsigned targetWeight = targetEdge.distance();
+// settles the next node of a search that explores the whole upward graph
+// returns false if the node's distance is not exact ( stall-on-demand )
+template< class EdgeAllowed, class StallEdgeAllowed >
+bool ContractionHierarchiesClient::computeSearchStep( Context* context, Heap* heap, const EdgeAllowed& edgeAllowed, const StallEdgeAllowed& stallEdgeAllowed, NodeIterator* node )
+{
+	*node = heap->DeleteMin();
+	const int distance = heap->GetKey( *node );
+	const Overlay* overlaid = this->overlaid( context, *node );
+
+	// a higher node offers a shorter path => node can be skipped
+	for ( EdgeIterator edge = m_graph.edges( &context->cache, *node ); edge.hasEdgesLeft(); ) {
+		m_graph.unpackNextEdge( &edge );
+		if ( !stallEdgeAllowed( edge.forward(), edge.backward() ) )
+			continue;
+		const NodeIterator to = edge.target();
+		if ( heap->WasInserted( to ) && heap->GetKey( to ) + ( int ) weight( edge, overlaid, stallEdgeAllowed.travelsForward() ) < distance )
+			return false;
+	}
+
+	for ( EdgeIterator edge = m_graph.edges( &context->cache, *node ); edge.hasEdgesLeft(); ) {
+		m_graph.unpackNextEdge( &edge );
+		if ( !edgeAllowed( edge.forward(), edge.backward() ) )
+			continue;
+		const NodeIterator to = edge.target();
+		const int toDistance = distance + weight( edge, overlaid, edgeAllowed.travelsForward() );
+
+		if ( !heap->WasInserted( to ) ) {
+			heap->Insert( to, toDistance, *node );
+		} else if ( toDistance < heap->GetKey( to ) ) {
+			heap->GetData( to ).parent = *node;
+			heap->DecreaseKey( to, toDistance );
+		}
+	}
+	return true;
+}
+
+bool ContractionHierarchiesClient::GetDistanceTable( QueryContext* queryContext, QVector< double >* distances, const QVector< IGPSLookup::Result >& sources, const QVector< IGPSLookup::Result >& targets )
+{
+	assert( distances != NULL );
+	Context* context = queryContext != NULL ? static_cast< Context* >( queryContext ) : m_context;
+	assert( context != NULL );
+	context->overlay = currentOverlay();
+	Heap* heapForward = &context->heapForward;
+	Heap* heapBackward = &context->heapBackward;
+	std::vector< BucketEntry >& buckets = context->buckets;
+	AllowForwardEdge forward;
+	AllowBackwardEdge backward;
+
+	distances->clear();
+	if ( sources.empty() || targets.empty() )
+		return true;
+
+	// backward search from every target => store distances in the settled nodes' buckets
+	buckets.clear();
+	for ( int target = 0; target < targets.size(); target++ ) {
+		heapBackward->Clear();
+		if ( m_turnTable.loaded() ) {
+			TurnTable::RoadEdge road;
+			if ( findRoadEdge( &road, targets[target] ) )
+				insertEdgeBasedTarget( context, heapBackward, road, targets[target].percentage );
+		} else {
+			insertTarget( context, heapBackward, targets[target] );
+		}
+		while ( heapBackward->Size() > 0 ) {
+			NodeIterator node;
+			if ( computeSearchStep( context, heapBackward, backward, forward, &node ) )
+				buckets.push_back( BucketEntry( node, target, heapBackward->GetKey( node ) ) );
+		}
+	}
+	std::sort( buckets.begin(), buckets.end() );
+
+	// forward search from every source => scan the buckets of the settled nodes
+	std::vector< int > table( sources.size() * targets.size(), std::numeric_limits< int >::max() );
+	for ( int source = 0; source < sources.size(); source++ ) {
+		int* row = &table[0] + source * targets.size();
+		heapForward->Clear();
+		if ( m_turnTable.loaded() ) {
+			TurnTable::RoadEdge road;
+			if ( findRoadEdge( &road, sources[source] ) )
+				insertEdgeBasedSource( heapForward, road, sources[source].percentage );
+		} else {
+			insertSource( context, heapForward, sources[source] );
+		}
+		while ( heapForward->Size() > 0 ) {
+			NodeIterator node;
+			if ( !computeSearchStep( context, heapForward, forward, backward, &node ) )
+				continue;
+			const int distance = heapForward->GetKey( node );
+			std::vector< BucketEntry >::const_iterator entry = std::lower_bound( buckets.begin(), buckets.end(), BucketEntry( node, 0, 0 ) );
+			for ( std::vector< BucketEntry >::const_iterator end = buckets.end(); entry != end && entry->node == node; ++entry ) {
+				if ( distance + entry->distance < row[entry->target] )
+					row[entry->target] = distance + entry->distance;
+			}
+		}
+	}
+
+	distances->resize( sources.size() * targets.size() );
+	for ( int source = 0; source < sources.size(); source++ ) {
+		for ( int target = 0; target < targets.size(); target++ ) {
+			double distance = table[source * targets.size() + target];
+			// is it shorter to drive along the edge?
+			// GetRoute only considers this if the endpoints are connected in the node based graph
+			if ( distance != std::numeric_limits< int >::max() || m_turnTable.loaded() )
+				distance = std::min( distance, onEdgeDistance( context, sources[source], targets[target] ) );
+			if ( distance == std::numeric_limits< int >::max() )
+				( *distances )[source * targets.size() + target] = std::numeric_limits< double >::max();
+			else
+				( *distances )[source * targets.size() + target] = distance / 10;
+		}
+	}
+
+	return true;
+}
+
+// PHAST: an upward search from the source followed by a sweep over all nodes that relaxes the downward edges.
+// ContractionCleanup::ReorderNodes numbers the nodes topologically, higher nodes first,
+// and the node IDs preserve this order => the sweep is a single linear pass over the blocks
+bool ContractionHierarchiesClient::computeOneToAll( Context* context, const IGPSLookup::Result& source )
+{
+	Heap* heap = &context->heapForward;
+	CompressedGraph::Cache* cache = &context->cache;
+	std::vector< int >& distances = context->sweepDistances;
+	AllowForwardEdge forward;
+	AllowBackwardEdge backward;
+
+	heap->Clear();
+	if ( m_turnTable.loaded() ) {
+		TurnTable::RoadEdge road;
+		if ( !findRoadEdge( &road, source ) )
+			return false;
+		insertEdgeBasedSource( heap, road, source.percentage );
+	} else {
+		insertSource( context, heap, source );
+	}
+
+	distances.assign( m_graph.numberOfNodeIDs(), std::numeric_limits< int >::max() );
+	// stalled nodes are not relaxed, but their distances are still valid upper bounds
+	while ( heap->Size() > 0 ) {
+		NodeIterator node;
+		computeSearchStep( context, heap, forward, backward, &node );
+		distances[node] = heap->GetKey( node );
+	}
+
+	for ( unsigned block = 0, blocks = m_graph.numberOfBlocks(); block < blocks; block++ ) {
+		for ( unsigned internal = 0, nodes = m_graph.numberOfNodes( cache, block ); internal < nodes; internal++ ) {
+			const NodeIterator node = m_graph.nodeID( block, internal );
+			int distance = distances[node];
+			const Overlay* overlaid = this->overlaid( context, node );
+			for ( EdgeIterator edge = m_graph.edges( cache, node ); edge.hasEdgesLeft(); ) {
+				m_graph.unpackNextEdge( &edge );
+				if ( !edge.backward() )
+					continue;
+				const int parentDistance = distances[edge.target()];
+				if ( parentDistance == std::numeric_limits< int >::max() )
+					continue;
+				distance = std::min( distance, parentDistance + ( int ) weight( edge, overlaid, false ) );
+			}
+			distances[node] = distance;
+		}
+	}
+
+	return true;
+}
+
+bool ContractionHierarchiesClient::GetReachableNodes( QueryContext* queryContext, QVector< ReachedNode >* result, const IGPSLookup::Result& source, double maxSeconds )
+{
+	assert( result != NULL );
+	Context* context = queryContext != NULL ? static_cast< Context* >( queryContext ) : m_context;
+	assert( context != NULL );
+	context->overlay = currentOverlay();
+	CompressedGraph::Cache* cache = &context->cache;
+
+	result->clear();
+	if ( !computeOneToAll( context, source ) )
+		return false;
+
+	const std::vector< int >& distances = context->sweepDistances;
+	const double maxDistance = maxSeconds * 10;
+	std::vector< UnsignedCoordinate >& coordinates = context->blockCoordinates;
+	for ( unsigned block = 0, blocks = m_graph.numberOfBlocks(); block < blocks; block++ ) {
+		m_graph.blockCoordinates( cache, block, &coordinates );
+		for ( unsigned internal = 0, nodes = coordinates.size(); internal < nodes; internal++ ) {
+			const NodeIterator node = m_graph.nodeID( block, internal );
+			if ( distances[node] > maxDistance )
+				continue;
+			ReachedNode reached;
+			reached.coordinate = coordinates[internal];
+			reached.seconds = distances[node] / 10.0;
+			result->push_back( reached );
+		}
+	}
+
+	return true;
+}
+
+// rasterizes the reachable parts of all edges and traces the outlines
+// shortcuts are skipped, their geometry is covered by the edges they consist of
+bool ContractionHierarchiesClient::GetIsochrones( QueryContext* queryContext, QVector< Isochrone >* result, const IGPSLookup::Result& source, const QVector< double >& limits, double resolution )
+{
+	assert( result != NULL );
+	Context* context = queryContext != NULL ? static_cast< Context* >( queryContext ) : m_context;
+	assert( context != NULL );
+	context->overlay = currentOverlay();
+	CompressedGraph::Cache* cache = &context->cache;
+
+	result->clear();
+	if ( limits.empty() )
+		return true;
+	if ( !computeOneToAll( context, source ) )
+		return false;
+
+	// meters -> coordinate units at the source's latitude
+	const unsigned probe = 1u << 16;
+	UnsignedCoordinate probeCoordinate( source.nearestPoint.x + probe, source.nearestPoint.y );
+	double metersPerUnit = source.nearestPoint.ToGPSCoordinate().ApproximateDistance( probeCoordinate.ToGPSCoordinate() ) / probe;
+	unsigned cellSize = std::max( 1.0, resolution / metersPerUnit );
+
+	std::vector< GridOutline > outlines( limits.size(), GridOutline( cellSize ) );
+	for ( int limit = 0; limit < limits.size(); limit++ )
+		outlines[limit].addPoint( source.nearestPoint );
+
+	const std::vector< int >& distances = context->sweepDistances;
+	const double maxDistance = *std::max_element( limits.begin(), limits.end() ) * 10;
+	std::vector< UnsignedCoordinate >& coordinates = context->blockCoordinates;
+	for ( unsigned block = 0, blocks = m_graph.numberOfBlocks(); block < blocks; block++ ) {
+		m_graph.blockCoordinates( cache, block, &coordinates );
+		for ( unsigned internal = 0, nodes = coordinates.size(); internal < nodes; internal++ ) {
+			const NodeIterator node = m_graph.nodeID( block, internal );
+			const UnsignedCoordinate coordinate = coordinates[internal];
+			const int distance = distances[node];
+			const Overlay* overlaid = this->overlaid( context, node );
+			if ( distance <= maxDistance ) {
+				for ( int limit = 0; limit < limits.size(); limit++ ) {
+					if ( distance <= limits[limit] * 10 )
+						outlines[limit].addPoint( coordinate );
+				}
+			}
+
+			for ( EdgeIterator edge = m_graph.edges( cache, node ); edge.hasEdgesLeft(); ) {
+				m_graph.unpackNextEdge( &edge );
+				if ( edge.shortcut() )
+					continue;
+				const int targetDistance = distances[edge.target()];
+				if ( distance > maxDistance && targetDistance > maxDistance )
+					continue;
+				const UnsignedCoordinate targetCoordinate = m_graph.node( cache, edge.target() ).coordinate;
+				for ( int limit = 0; limit < limits.size(); limit++ ) {
+					const double limitDistance = limits[limit] * 10;
+					if ( edge.forward() && distance <= limitDistance ) {
+						double fraction = std::min( 1.0, ( limitDistance - distance ) / weight( edge, overlaid, true ) );
+						outlines[limit].addSegment( coordinate, UnsignedCoordinate( coordinate.x + ( ( double ) targetCoordinate.x - coordinate.x ) * fraction, coordinate.y + ( ( double ) targetCoordinate.y - coordinate.y ) * fraction ) );
+					}
+					if ( edge.backward() && targetDistance <= limitDistance ) {
+						double fraction = std::min( 1.0, ( limitDistance - targetDistance ) / weight( edge, overlaid, false ) );
+						outlines[limit].addSegment( targetCoordinate, UnsignedCoordinate( targetCoordinate.x + ( ( double ) coordinate.x - targetCoordinate.x ) * fraction, targetCoordinate.y + ( ( double ) coordinate.y - targetCoordinate.y ) * fraction ) );
+					}
+				}
+			}
+		}
+	}
+
+	result->resize( limits.size() );
+	for ( int limit = 0; limit < limits.size(); limit++ ) {
+		( *result )[limit].seconds = limits[limit];
+		outlines[limit].outlines( &( *result )[limit].rings );
+	}
+
+	return true;
+}
+
+// upper bound of via node candidates whose paths are unpacked and scored
+static const unsigned maxViaCandidates = 64;
+
+// via node method: both upward search spaces are explored completely by a single bidirectional search,
+// every node settled by both searches describes a path source -> via -> target
+// the candidates are filtered by stretch and sharing and the best ones have to pass a T-test for local optimality
+bool ContractionHierarchiesClient::GetAlternativeRoutes( QueryContext* queryContext, QVector< Route >* result, const IGPSLookup::Result& source, const IGPSLookup::Result& target, int maxAlternatives, const Limits& limits )
+{
+	assert( result != NULL );
+	Context* context = queryContext != NULL ? static_cast< Context* >( queryContext ) : m_context;
+	assert( context != NULL );
+	startStatistics( context );
+	context->overlay = currentOverlay();
+	Heap* heapForward = &context->heapForward;
+	Heap* heapBackward = &context->heapBackward;
+	heapForward->Clear();
+	heapBackward->Clear();
+	result->clear();
+
+	EdgeIterator sourceEdge;
+	EdgeIterator targetEdge;
+	TurnTable::RoadEdge sourceRoad;
+	TurnTable::RoadEdge targetRoad;
+	if ( m_turnTable.loaded() ) {
+		if ( !findRoadEdge( &sourceRoad, source ) || !findRoadEdge( &targetRoad, target ) )
+			return false;
+		insertEdgeBasedSource( heapForward, sourceRoad, source.percentage );
+		insertEdgeBasedTarget( context, heapBackward, targetRoad, target.percentage );
+	} else {
+		sourceEdge = insertSource( context, heapForward, source );
+		targetEdge = insertTarget( context, heapBackward, target );
+	}
+
+	AllowForwardEdge forward;
+	AllowBackwardEdge backward;
+	std::vector< NodeIterator >& settled = context->settled;
+	settled.clear();
+	NodeIterator node;
+	while ( heapForward->Size() > 0 ) {
+		if ( computeSearchStep( context, heapForward, forward, backward, &node ) )
+			settled.push_back( node );
+		else
+			heapForward->GetData( node ).stalled = true;
+	}
+	while ( heapBackward->Size() > 0 ) {
+		if ( !computeSearchStep( context, heapBackward, backward, forward, &node ) )
+			heapBackward->GetData( node ).stalled = true;
+	}
+
+	std::vector< ViaCandidate >& candidates = context->candidates;
+	candidates.clear();
+	for ( std::vector< NodeIterator >::const_iterator i = settled.begin(), e = settled.end(); i != e; ++i ) {
+		if ( !heapBackward->WasInserted( *i ) || heapBackward->GetData( *i ).stalled )
+			continue;
+		candidates.push_back( ViaCandidate( *i, heapForward->GetKey( *i ) + heapBackward->GetKey( *i ) ) );
+	}
+	std::sort( candidates.begin(), candidates.end() );
+	const int optimalDistance = candidates.empty() ? std::numeric_limits< int >::max() : candidates.front().distance;
+
+	// driving along the edge cannot be combined with via nodes, the plain query handles it
+	if ( onEdgeDistance( context, source, target ) < optimalDistance ) {
+		Route route;
+		if ( !GetRoute( context, &route.seconds, &route.pathNodes, &route.pathEdges, source, target ) )
+			return false;
+		result->push_back( route );
+		return true;
+	}
+	if ( candidates.empty() )
+		return false;
+
+	// bounded stretch
+	const int maxDistance = optimalDistance * ( 1 + limits.stretch );
+	const int maxShared = optimalDistance * limits.sharing;
+	unsigned numberOfCandidates = 1;
+	while ( numberOfCandidates < candidates.size() && candidates[numberOfCandidates].distance <= maxDistance )
+		numberOfCandidates++;
+	candidates.erase( candidates.begin() + numberOfCandidates, candidates.end() );
+
+	std::vector< PathEdge >& chain = context->viaChain;
+	std::vector< PathEdge >& path = context->viaPath;
+	std::vector< quint64 >& optimalChain = context->optimalChain;
+	std::vector< quint64 >& selectedEdges = context->selectedEdges;
+	optimalChain.clear();
+	selectedEdges.clear();
+	unsigned viaIndex = viaChain( context, candidates.front().node, &chain );
+	for ( std::vector< PathEdge >::const_iterator i = chain.begin(), e = chain.end(); i != e; ++i )
+		optimalChain.push_back( i->key() );
+	std::sort( optimalChain.begin(), optimalChain.end() );
+	unpackViaChain( context, chain, viaIndex, &path );
+	for ( std::vector< PathEdge >::const_iterator i = path.begin(), e = path.end(); i != e; ++i )
+		selectedEdges.push_back( i->key() );
+	std::sort( selectedEdges.begin(), selectedEdges.end() );
+
+	// limited sharing with the shortest route
+	// sharing search tree edges is a lower bound and avoids unpacking most candidates along the shortest route
+	std::vector< ViaCandidate > scored;
+	for ( unsigned i = 1; i < candidates.size() && scored.size() < maxViaCandidates; i++ ) {
+		viaIndex = viaChain( context, candidates[i].node, &chain );
+		if ( sharedDistance( chain, optimalChain ) > maxShared )
+			continue;
+		unpackViaChain( context, chain, viaIndex, &path );
+		const int shared = sharedDistance( path, selectedEdges );
+		if ( shared > maxShared )
+			continue;
+		candidates[i].score = 2 * candidates[i].distance + shared;
+		scored.push_back( candidates[i] );
+	}
+
+	std::vector< NodeIterator > selected;
+	selected.push_back( candidates.front().node );
+	for ( unsigned i = 0; i < scored.size() && ( int ) selected.size() <= maxAlternatives; i++ ) {
+		unsigned best = i;
+		for ( unsigned j = i + 1; j < scored.size(); j++ ) {
+			if ( scored[j].score < scored[best].score )
+				best = j;
+		}
+		std::swap( scored[i], scored[best] );
+
+		// limited sharing with the previously selected alternatives
+		viaIndex = viaChain( context, scored[i].node, &chain );
+		viaIndex = unpackViaChain( context, chain, viaIndex, &path );
+		if ( sharedDistance( path, selectedEdges ) > maxShared )
+			continue;
+		if ( !isLocallyOptimal( context, path, viaIndex, optimalDistance * limits.localOptimality ) )
+			continue;
+
+		selected.push_back( scored[i].node );
+		for ( std::vector< PathEdge >::const_iterator edge = path.begin(), e = path.end(); edge != e; ++edge )
+			selectedEdges.push_back( edge->key() );
+		std::sort( selectedEdges.begin(), selectedEdges.end() );
+	}
+
+	for ( unsigned i = 0; i < selected.size(); i++ ) {
+		Route route;
+		route.seconds = ( heapForward->GetKey( selected[i] ) + heapBackward->GetKey( selected[i] ) ) / 10.0;
+		if ( m_turnTable.loaded() )
+			buildEdgeBasedRoute( context, selected[i], source, target, sourceRoad, targetRoad, &route.pathNodes, &route.pathEdges );
+		else
+			buildRoute( context, selected[i], source, target, sourceEdge, targetEdge, &route.pathNodes, &route.pathEdges );
+		result->push_back( route );
+	}
+	return true;
+}
+
+// collects the search tree edges of the path through via in the direction of travel
+// returns the index of the first edge of the backward search tree
+unsigned ContractionHierarchiesClient::viaChain( Context* context, NodeIterator via, std::vector< PathEdge >* chain )
+{
+	Heap* heapForward = &context->heapForward;
+	Heap* heapBackward = &context->heapBackward;
+	chain->clear();
+
+	for ( NodeIterator node = via; heapForward->GetData( node ).parent != node; ) {
+		const NodeIterator parent = heapForward->GetData( node ).parent;
+		chain->push_back( PathEdge( parent, node, heapForward->GetKey( node ) - heapForward->GetKey( parent ) ) );
+		node = parent;
+	}
+	std::reverse( chain->begin(), chain->end() );
+
+	const unsigned viaIndex = chain->size();
+	for ( NodeIterator node = via; heapBackward->GetData( node ).parent != node; ) {
+		const NodeIterator parent = heapBackward->GetData( node ).parent;
+		chain->push_back( PathEdge( node, parent, heapBackward->GetKey( node ) - heapBackward->GetKey( parent ) ) );
+		node = parent;
+	}
+	return viaIndex;
+}
+
+// unpacks the search tree edges into original edges
+// returns the index of the first original edge after the via node
+unsigned ContractionHierarchiesClient::unpackViaChain( Context* context, const std::vector< PathEdge >& chain, unsigned viaIndex, std::vector< PathEdge >* path )
+{
+	path->clear();
+	for ( unsigned i = 0; i < viaIndex; i++ )
+		unpackEdge( context, chain[i].source, chain[i].target, true, path );
+	const unsigned pathViaIndex = path->size();
+	// backward search tree edges are stored at their lower node, the one nearer to the target
+	for ( unsigned i = viaIndex; i < chain.size(); i++ )
+		unpackEdge( context, chain[i].target, chain[i].source, false, path );
+	return pathViaIndex;
+}
+
+// travel time along the path's edges that are contained in the sorted edge set
+int ContractionHierarchiesClient::sharedDistance( const std::vector< PathEdge >& path, const std::vector< quint64 >& edges )
+{
+	int shared = 0;
+	for ( std::vector< PathEdge >::const_iterator i = path.begin(), e = path.end(); i != e; ++i ) {
+		if ( std::binary_search( edges.begin(), edges.end(), i->key() ) )
+			shared += i->distance;
+	}
+	return shared;
+}
+
+// T-test: the subpath covering radius before and after the via node has to be a shortest path
+bool ContractionHierarchiesClient::isLocallyOptimal( Context* context, const std::vector< PathEdge >& path, unsigned viaIndex, int radius )
+{
+	unsigned first = viaIndex;
+	int distance = 0;
+	while ( first > 0 && distance < radius )
+		distance += path[--first].distance;
+	unsigned last = viaIndex;
+	int after = 0;
+	while ( last < path.size() && after < radius )
+		after += path[last++].distance;
+	distance += after;
+
+	if ( first == last )
+		return true;
+	return computeDistance( context, path[first].source, path[last - 1].target ) >= distance;
+}
+
+// node to node query that leaves the context's main heaps untouched
+int ContractionHierarchiesClient::computeDistance( Context* context, NodeIterator source, NodeIterator target )
+{
+	if ( context->localForward == NULL ) {
+		context->localForward = new Heap( context->numberOfNodeIDs );
+		context->localBackward = new Heap( context->numberOfNodeIDs );
+	}
+	Heap* heapForward = context->localForward;
+	Heap* heapBackward = context->localBackward;
+	heapForward->Clear();
+	heapBackward->Clear();
+	heapForward->Insert( source, 0, source );
+	heapBackward->Insert( target, 0, target );
+
+	int targetDistance = std::numeric_limits< int >::max();
+	NodeIterator middle = ( NodeIterator ) 0;
+	AllowForwardEdge forward;
+	AllowBackwardEdge backward;
+
+	while ( heapForward->Size() + heapBackward->Size() > 0 ) {
+
+		if ( heapForward->Size() > 0 )
+			computeStep( context, heapForward, heapBackward, forward, backward, &middle, &targetDistance );
+
+		if ( heapBackward->Size() > 0 )
+			computeStep( context, heapBackward, heapForward, backward, forward, &middle, &targetDistance );
+
+	}
+
+	return targetDistance;
+}
+
+// travel time of the original edge a position lies on
+unsigned ContractionHierarchiesClient::positionWeight( Context* context, const EdgeIterator& edge, const IGPSLookup::Result& position )
+{
+	// findEdge looks at the lower node
+	const Overlay* overlaid = this->overlaid( context, std::max( position.source, position.target ) );
+	if ( context->lowerBound )
+		return lowerWeight( edge, overlaid, true );
+	return weight( edge, overlaid, true );
+}
+
+ContractionHierarchiesClient::EdgeIterator ContractionHierarchiesClient::insertSource( Context* context, Heap* heap, const IGPSLookup::Result& source )
+{
+	EdgeIterator sourceEdge = m_graph.findEdge( &context->cache, source.source, source.target, source.edgeID );
+	unsigned sourceWeight = positionWeight( context, sourceEdge, source );
 
-	//insert source into heap
-	m_heapForward->Insert( source.target, sourceWeight - sourceWeight * source.percentage, source.target );
+	heap->Insert( source.target, sourceWeight - sourceWeight * source.percentage, source.target );
 	if ( sourceEdge.backward() && sourceEdge.forward() && source.target != source.source )
-		m_heapForward->Insert( source.source, sourceWeight * source.percentage, source.source );
+		heap->Insert( source.source, sourceWeight * source.percentage, source.source );
+	return sourceEdge;
+}
+
+ContractionHierarchiesClient::EdgeIterator ContractionHierarchiesClient::insertTarget( Context* context, Heap* heap, const IGPSLookup::Result& target )
+{
+	EdgeIterator targetEdge = m_graph.findEdge( &context->cache, target.source, target.target, target.edgeID );
+	unsigned targetWeight = positionWeight( context, targetEdge, target );
 
-	//insert target into heap
-	m_heapBackward->Insert( target.source, targetWeight * target.percentage, target.source );
+	heap->Insert( target.source, targetWeight * target.percentage, target.source );
 	if ( targetEdge.backward() && targetEdge.forward() && target.target != target.source )
-		m_heapBackward->Insert( target.target, targetWeight - targetWeight * target.percentage, target.target );
+		heap->Insert( target.target, targetWeight - targetWeight * target.percentage, target.target );
+	return targetEdge;
+}
+
+int ContractionHierarchiesClient::computeRoute( Context* context, const IGPSLookup::Result& source, const IGPSLookup::Result& target, QVector< Node>* pathNodes, QVector< Edge >* pathEdges ) {
+	Heap* heapForward = &context->heapForward;
+	Heap* heapBackward = &context->heapBackward;
+
+	//insert source and target into heap
+	EdgeIterator sourceEdge = insertSource( context, heapForward, source );
+	EdgeIterator targetEdge = insertTarget( context, heapBackward, target );
 
 	int targetDistance = std::numeric_limits< int >::max();
 	NodeIterator middle = ( NodeIterator ) 0;
 	AllowForwardEdge forward;
 	AllowBackwardEdge backward;
 
-	while ( m_heapForward->Size() + m_heapBackward->Size() > 0 ) {
+	while ( heapForward->Size() + heapBackward->Size() > 0 ) {
 
-		if ( m_heapForward->Size() > 0 )
-			computeStep( m_heapForward, m_heapBackward, forward, backward, &middle, &targetDistance );
+		if ( heapForward->Size() > 0 )
+			computeStep( context, heapForward, heapBackward, forward, backward, &middle, &targetDistance );
 
-		if ( m_heapBackward->Size() > 0 )
-			computeStep( m_heapBackward, m_heapForward, backward, forward, &middle, &targetDistance );
+		if ( heapBackward->Size() > 0 )
+			computeStep( context, heapBackward, heapForward, backward, forward, &middle, &targetDistance );
 
 	}
 
@@ -310,11 +974,207 @@ int ContractionHierarchiesClient::computeRoute( const IGPSLookup::Result& source
 	if ( pathNodes == NULL || pathEdges == NULL )
 		return targetDistance;
 
-	std::stack< NodeIterator > stack;
+	buildRoute( context, middle, source, target, sourceEdge, targetEdge, pathNodes, pathEdges );
+	return targetDistance;
+}
+
+// the re-weighted hierarchy lacks the shortcuts that became faster than their witnesses and those whose witnesses became slower.
+// its route is a shortest one if the lower bound search finds no faster route, see computeLowerBound.
+// otherwise a bidirectional Dijkstra search on the original edges looks for a faster route
+int ContractionHierarchiesClient::computeOverlaidRoute( Context* context, const IGPSLookup::Result& source, const IGPSLookup::Result& target, QVector< Node>* pathNodes, QVector< Edge >* pathEdges )
+{
+	Heap* heapForward = &context->heapForward;
+	Heap* heapBackward = &context->heapBackward;
+
+	const int pathNodesBegin = pathNodes != NULL ? pathNodes->size() : 0;
+	const int pathEdgesBegin = pathEdges != NULL ? pathEdges->size() : 0;
+	const int upperBound = computeRoute( context, source, target, pathNodes, pathEdges );
+	m_overlaidRoutes.ref();
+	// the lower bound never overestimates: the hierarchy's route is a shortest one, or neither search connects the points
+	if ( computeLowerBound( context, source, target, upperBound ) >= upperBound )
+		return upperBound;
+	m_fallbackRoutes.ref();
+
+	heapForward->Clear();
+	heapBackward->Clear();
+	EdgeIterator sourceEdge = insertSource( context, heapForward, source );
+	EdgeIterator targetEdge = insertTarget( context, heapBackward, target );
+
+	int targetDistance = upperBound;
+	NodeIterator middle = ( NodeIterator ) 0;
+	while ( heapForward->Size() > 0 && heapBackward->Size() > 0 ) {
+		if ( heapForward->GetKey( heapForward->Min() ) + heapBackward->GetKey( heapBackward->Min() ) >= targetDistance )
+			break;
+		if ( heapForward->Size() <= heapBackward->Size() )
+			computeOriginalStep( context, heapForward, heapBackward, true, &middle, &targetDistance );
+		else
+			computeOriginalStep( context, heapBackward, heapForward, false, &middle, &targetDistance );
+	}
+
+	// the hierarchy's route is a shortest one
+	if ( targetDistance == upperBound )
+		return upperBound;
+
+	if ( pathNodes == NULL || pathEdges == NULL )
+		return targetDistance;
+
+	pathNodes->resize( pathNodesBegin );
+	pathEdges->resize( pathEdgesBegin );
+	buildRoute( context, middle, source, target, sourceEdge, targetEdge, pathNodes, pathEdges );
+	return targetDistance;
+}
+
+// distance of a route faster than upperBound, upperBound if there is none. the search uses the smaller of the preprocessed and the overlay travel times.
+// between its decreased edges a route is bounded from below by an up-down route of the preprocessed hierarchy,
+// the parts above the decreased edges lie in their region. outside the region the search follows upward edges, within it all edges in both directions
+int ContractionHierarchiesClient::computeLowerBound( Context* context, const IGPSLookup::Result& source, const IGPSLookup::Result& target, int upperBound )
+{
+	Heap* heapForward = &context->heapForward;
+	Heap* heapBackward = &context->heapBackward;
+	heapForward->Clear();
+	heapBackward->Clear();
+	context->lowerBound = true;
+	insertSource( context, heapForward, source );
+	insertTarget( context, heapBackward, target );
+	context->lowerBound = false;
+
+	int targetDistance = upperBound;
+	while ( targetDistance == upperBound ) {
+		const bool forward = heapForward->Size() > 0 && heapForward->GetKey( heapForward->Min() ) < upperBound;
+		const bool backward = heapBackward->Size() > 0 && heapBackward->GetKey( heapBackward->Min() ) < upperBound;
+		if ( !forward && !backward )
+			break;
+		if ( forward && ( !backward || heapForward->Size() <= heapBackward->Size() ) )
+			computeBoundStep( context, heapForward, heapBackward, true, &targetDistance );
+		else
+			computeBoundStep( context, heapBackward, heapForward, false, &targetDistance );
+	}
+	return targetDistance;
+}
+
+// settles the next node of the lower bound search
+void ContractionHierarchiesClient::computeBoundStep( Context* context, Heap* heap, Heap* otherHeap, bool forward, int* targetDistance )
+{
+	CompressedGraph::Cache* cache = &context->cache;
+	const NodeIterator node = heap->DeleteMin();
+	const int distance = heap->GetKey( node );
+	if ( context->collectStatistics ) {
+		if ( forward )
+			context->statistics.settledForward++;
+		else
+			context->statistics.settledBackward++;
+	}
+
+	if ( otherHeap->WasInserted( node ) && distance + otherHeap->GetKey( node ) < *targetDistance )
+		*targetDistance = distance + otherHeap->GetKey( node );
+
+	// edges to higher nodes
+	NodeIterator middle;
+	const Overlay* overlaid = this->overlaid( context, node );
+	for ( EdgeIterator edge = m_graph.edges( cache, node ); edge.hasEdgesLeft(); ) {
+		m_graph.unpackNextEdge( &edge );
+		if ( !( forward ? edge.forward() : edge.backward() ) )
+			continue;
+		relaxEdge( heap, otherHeap, node, edge.target(), distance + lowerWeight( edge, overlaid, forward ), &middle, targetDistance );
+	}
+
+	const std::vector< bool >& region = context->overlay->region;
+	if ( region.empty() || !region[node] )
+		return;
+
+	// edges from lower nodes, original ones and shortcuts
+	for ( int index = 0; index < 2; index++ ) {
+		const std::vector< unsigned >& first = index == 0 ? m_lowerFirst : m_shortcutFirst;
+		const std::vector< NodeIterator >& lowerNodes = index == 0 ? m_lowerNodes : m_shortcutNodes;
+		for ( unsigned i = first[node], end = first[node + 1]; i < end; i++ ) {
+			const NodeIterator lower = lowerNodes[i];
+			const Overlay* lowerOverlaid = this->overlaid( context, lower );
+			for ( EdgeIterator edge = m_graph.edges( cache, lower ); edge.hasEdgesLeft(); ) {
+				m_graph.unpackNextEdge( &edge );
+				if ( edge.target() != node )
+					continue;
+				if ( !( forward ? edge.backward() : edge.forward() ) )
+					continue;
+				relaxEdge( heap, otherHeap, node, lower, distance + lowerWeight( edge, lowerOverlaid, !forward ), &middle, targetDistance );
+			}
+		}
+	}
+}
+
+// settles the next node of a Dijkstra search that follows the original edges up and down the hierarchy
+void ContractionHierarchiesClient::computeOriginalStep( Context* context, Heap* heap, Heap* otherHeap, bool forward, NodeIterator* middle, int* targetDistance )
+{
+	CompressedGraph::Cache* cache = &context->cache;
+	const NodeIterator node = heap->DeleteMin();
+	const int distance = heap->GetKey( node );
+	if ( context->collectStatistics ) {
+		if ( forward )
+			context->statistics.settledForward++;
+		else
+			context->statistics.settledBackward++;
+	}
+
+	if ( otherHeap->WasInserted( node ) && distance + otherHeap->GetKey( node ) < *targetDistance ) {
+		*middle = node;
+		*targetDistance = distance + otherHeap->GetKey( node );
+	}
+
+	// edges to higher nodes
+	const Overlay* overlaid = this->overlaid( context, node );
+	for ( EdgeIterator edge = m_graph.edges( cache, node ); edge.hasEdgesLeft(); ) {
+		m_graph.unpackNextEdge( &edge );
+		if ( edge.shortcut() )
+			continue;
+		if ( !( forward ? edge.forward() : edge.backward() ) )
+			continue;
+		relaxEdge( heap, otherHeap, node, edge.target(), distance + weight( edge, overlaid, forward ), middle, targetDistance );
+	}
+
+	// edges from lower nodes, traversed against their stored direction
+	for ( unsigned i = m_lowerFirst[node], end = m_lowerFirst[node + 1]; i < end; i++ ) {
+		const NodeIterator lower = m_lowerNodes[i];
+		const Overlay* lowerOverlaid = this->overlaid( context, lower );
+		for ( EdgeIterator edge = m_graph.edges( cache, lower ); edge.hasEdgesLeft(); ) {
+			m_graph.unpackNextEdge( &edge );
+			if ( edge.target() != node || edge.shortcut() )
+				continue;
+			if ( !( forward ? edge.backward() : edge.forward() ) )
+				continue;
+			relaxEdge( heap, otherHeap, node, lower, distance + weight( edge, lowerOverlaid, !forward ), middle, targetDistance );
+		}
+	}
+}
+
+void ContractionHierarchiesClient::relaxEdge( Heap* heap, Heap* otherHeap, NodeIterator node, NodeIterator to, int toDistance, NodeIterator* middle, int* targetDistance )
+{
+	if ( !heap->WasInserted( to ) ) {
+		heap->Insert( to, toDistance, node );
+	} else if ( toDistance < heap->GetKey( to ) ) {
+		heap->GetData( to ).parent = node;
+		heap->DecreaseKey( to, toDistance );
+	} else {
+		return;
+	}
+
+	if ( otherHeap->WasInserted( to ) && toDistance + otherHeap->GetKey( to ) < *targetDistance ) {
+		*middle = to;
+		*targetDistance = toDistance + otherHeap->GetKey( to );
+	}
+}
+
+// reconstructs the path through middle from the parent pointers of both search heaps
+void ContractionHierarchiesClient::buildRoute( Context* context, NodeIterator middle, const IGPSLookup::Result& source, const IGPSLookup::Result& target, const EdgeIterator& sourceEdge, const EdgeIterator& targetEdge, QVector< Node>* pathNodes, QVector< Edge >* pathEdges )
+{
+	Heap* heapForward = &context->heapForward;
+	Heap* heapBackward = &context->heapBackward;
+	CompressedGraph::Cache* cache = &context->cache;
+
+	std::vector< NodeIterator >& stack = context->pathStack;
+	stack.clear();
 	NodeIterator pathNode = middle;
 	while ( true ) {
-		NodeIterator parent = m_heapForward->GetData( pathNode ).parent;
-		stack.push( pathNode );
+		NodeIterator parent = heapForward->GetData( pathNode ).parent;
+		stack.push_back( pathNode );
 		if ( parent == pathNode )
 			break;
 		pathNode = parent;
@@ -326,31 +1186,31 @@ int ContractionHierarchiesClient::computeRoute( const IGPSLookup::Result& source
 		reverseSourceDescription = !reverseSourceDescription;
 	if ( sourceEdge.unpacked() ) {
 		bool unpackSourceForward = source.target != sourceEdge.target() ? reverseSourceDescription : !reverseSourceDescription;
-		m_graph.path( sourceEdge, pathNodes, pathEdges, unpackSourceForward );
+		m_graph.path( cache, sourceEdge, pathNodes, pathEdges, unpackSourceForward );
 		if ( reverseSourceDescription ) {
 			pathNodes->remove( 1, pathNodes->size() - 1 - source.previousWayCoordinates );
 		} else {
 			pathNodes->remove( 1, source.previousWayCoordinates - 1 );
 		}
 	} else {
-		pathNodes->push_back( m_graph.node( pathNode ) );
+		pathNodes->push_back( m_graph.node( cache, pathNode ) );
 		pathEdges->push_back( sourceEdge.description() );
 	}
 	pathEdges->front().length = pathNodes->size() - 1;
 	pathEdges->front().seconds *= reverseSourceDescription ? source.percentage : 1 - source.percentage;
 
 	while ( stack.size() > 1 ) {
-		const NodeIterator node = stack.top();
-		stack.pop();
-		unpackEdge( node, stack.top(), true, pathNodes, pathEdges );
+		const NodeIterator node = stack.back();
+		stack.pop_back();
+		unpackTraversal( context, node, stack.back(), pathNodes, pathEdges );
 	}
 
 	pathNode = middle;
 	while ( true ) {
-		NodeIterator parent = m_heapBackward->GetData( pathNode ).parent;
+		NodeIterator parent = heapBackward->GetData( pathNode ).parent;
 		if ( parent == pathNode )
 			break;
-		unpackEdge( parent, pathNode, false, pathNodes, pathEdges );
+		unpackTraversal( context, pathNode, parent, pathNodes, pathEdges );
 		pathNode = parent;
 	}
 
@@ -360,7 +1220,7 @@ int ContractionHierarchiesClient::computeRoute( const IGPSLookup::Result& source
 		reverseTargetDescription = !reverseTargetDescription;
 	if ( targetEdge.unpacked() ) {
 		bool unpackTargetForward = target.target != targetEdge.target() ? reverseTargetDescription : !reverseTargetDescription;
-		m_graph.path( targetEdge, pathNodes, pathEdges, unpackTargetForward );
+		m_graph.path( cache, targetEdge, pathNodes, pathEdges, unpackTargetForward );
 		if ( reverseTargetDescription ) {
 			pathNodes->resize( pathNodes->size() - target.previousWayCoordinates );
 		} else {
@@ -372,15 +1232,221 @@ int ContractionHierarchiesClient::computeRoute( const IGPSLookup::Result& source
 	pathNodes->push_back( target.nearestPoint );
 	pathEdges->back().length = pathNodes->size() - begin;
 	pathEdges->back().seconds *= reverseTargetDescription ? 1 - target.percentage : target.percentage;
+}
+
+// travel time when driving along the edge from the source to the target position
+// std::numeric_limits< double >::max() if they do not share an edge or the edge's direction forbids it
+double ContractionHierarchiesClient::onEdgeDistance( Context* context, const IGPSLookup::Result& source, const IGPSLookup::Result& target )
+{
+	if ( target.source != source.source || target.target != source.target || source.edgeID != target.edgeID )
+		return std::numeric_limits< double >::max();
+
+	unsigned weight;
+	bool bidirectional;
+	if ( m_turnTable.loaded() ) {
+		TurnTable::RoadEdge road;
+		if ( !findRoadEdge( &road, target ) )
+			return std::numeric_limits< double >::max();
+		weight = road.distance;
+		bidirectional = road.bidirectional;
+	} else {
+		EdgeIterator targetEdge = m_graph.findEdge( &context->cache, target.source, target.target, target.edgeID );
+		weight = positionWeight( context, targetEdge, target );
+		bidirectional = targetEdge.forward() && targetEdge.backward();
+	}
+
+	if ( !bidirectional && source.percentage >= target.percentage )
+		return std::numeric_limits< double >::max();
+	return fabs( target.percentage - source.percentage ) * weight;
+}
+
+bool ContractionHierarchiesClient::findRoadEdge( TurnTable::RoadEdge* result, const IGPSLookup::Result& position )
+{
+	unsigned id = m_turnTable.findRoadEdge( position.source, position.target, position.edgeID );
+	if ( id == m_turnTable.numberOfRoadEdges() ) {
+		qCritical() << "road edge not found:" << position.source << position.target << position.edgeID;
+		return false;
+	}
+	m_turnTable.roadEdge( result, id );
+	return true;
+}
+
+void ContractionHierarchiesClient::insertEdgeBasedSource( Heap* heap, const TurnTable::RoadEdge& source, double percentage )
+{
+	heap->Insert( source.forwardNode, source.distance - source.distance * percentage, source.forwardNode );
+	if ( source.bidirectional )
+		heap->Insert( source.backwardNode, source.distance * percentage, source.backwardNode );
+}
+
+// the target edge cannot be entered without turning into it => start at its predecessors
+void ContractionHierarchiesClient::insertEdgeBasedTarget( Context* context, Heap* heap, const TurnTable::RoadEdge& target, double percentage )
+{
+	std::vector< TurnTable::Turn >& turns = context->turns;
+	for ( int direction = 0; direction < 2; direction++ ) {
+		const bool forward = direction == 0;
+		if ( !forward && !target.bidirectional )
+			break;
+		const int partial = forward ? target.distance * percentage : target.distance - target.distance * percentage;
+		m_turnTable.predecessors( &turns, target, forward );
+		for ( std::vector< TurnTable::Turn >::const_iterator turn = turns.begin(), end = turns.end(); turn != end; ++turn ) {
+			const int distance = turn->penalty + partial;
+			if ( !heap->WasInserted( turn->node ) )
+				heap->Insert( turn->node, distance, turn->node );
+			else if ( distance < heap->GetKey( turn->node ) )
+				heap->DecreaseKey( turn->node, distance );
+		}
+	}
+}
+
+double ContractionHierarchiesClient::computeEdgeBasedRoute( Context* context, const IGPSLookup::Result& source, const IGPSLookup::Result& target, QVector< Node>* pathNodes, QVector< Edge >* pathEdges )
+{
+	Heap* heapForward = &context->heapForward;
+	Heap* heapBackward = &context->heapBackward;
+
+	TurnTable::RoadEdge sourceRoad;
+	TurnTable::RoadEdge targetRoad;
+	if ( !findRoadEdge( &sourceRoad, source ) || !findRoadEdge( &targetRoad, target ) )
+		return std::numeric_limits< double >::max();
+
+	insertEdgeBasedSource( heapForward, sourceRoad, source.percentage );
+	insertEdgeBasedTarget( context, heapBackward, targetRoad, target.percentage );
+
+	int targetDistance = std::numeric_limits< int >::max();
+	NodeIterator middle = ( NodeIterator ) 0;
+	AllowForwardEdge forward;
+	AllowBackwardEdge backward;
+
+	while ( heapForward->Size() + heapBackward->Size() > 0 ) {
+
+		if ( heapForward->Size() > 0 )
+			computeStep( context, heapForward, heapBackward, forward, backward, &middle, &targetDistance );
+
+		if ( heapBackward->Size() > 0 )
+			computeStep( context, heapBackward, heapForward, backward, forward, &middle, &targetDistance );
+
+	}
 
+	// is it shorter to drive along the edge?
+	const double onEdge = onEdgeDistance( context, source, target );
+	if ( onEdge < targetDistance ) {
+		if ( pathNodes != NULL && pathEdges != NULL ) {
+			pathNodes->push_back( source.nearestPoint );
+			pathEdges->push_back( roadDescription( targetRoad ) );
+			if ( source.percentage <= target.percentage )
+				appendRoadPath( pathNodes, targetRoad, source.previousWayCoordinates, target.previousWayCoordinates );
+			else
+				appendRoadPath( pathNodes, targetRoad, source.previousWayCoordinates - 1, target.previousWayCoordinates - 1 );
+			pathNodes->push_back( target.nearestPoint );
+			pathEdges->back().length = pathNodes->size() - 1;
+			pathEdges->back().seconds *= fabs( target.percentage - source.percentage );
+		}
+		return onEdge;
+	}
+
+	if ( targetDistance == std::numeric_limits< int >::max() )
+		return std::numeric_limits< double >::max();
+
+	// abort early if the path description is not requested
+	if ( pathNodes == NULL || pathEdges == NULL )
+		return targetDistance;
+
+	buildEdgeBasedRoute( context, middle, source, target, sourceRoad, targetRoad, pathNodes, pathEdges );
 	return targetDistance;
 }
 
-bool ContractionHierarchiesClient::unpackEdge( const NodeIterator source, const NodeIterator target, bool forward, QVector< Node >* pathNodes, QVector< Edge >* pathEdges ) {
-	EdgeIterator shortestEdge;
+// reconstructs the path through middle from the parent pointers of both search heaps
+void ContractionHierarchiesClient::buildEdgeBasedRoute( Context* context, NodeIterator middle, const IGPSLookup::Result& source, const IGPSLookup::Result& target, const TurnTable::RoadEdge& sourceRoad, const TurnTable::RoadEdge& targetRoad, QVector< Node>* pathNodes, QVector< Edge >* pathEdges )
+{
+	Heap* heapForward = &context->heapForward;
+	Heap* heapBackward = &context->heapBackward;
+
+	std::vector< NodeIterator >& stack = context->pathStack;
+	stack.clear();
+	NodeIterator pathNode = middle;
+	while ( true ) {
+		NodeIterator parent = heapForward->GetData( pathNode ).parent;
+		stack.push_back( pathNode );
+		if ( parent == pathNode )
+			break;
+		pathNode = parent;
+	}
+
+	// the partial source edge, its directed copy is the root of the forward search
+	const bool sourceForward = pathNode == sourceRoad.forwardNode;
+	pathNodes->push_back( source.nearestPoint );
+	pathEdges->push_back( roadDescription( sourceRoad ) );
+	if ( sourceForward )
+		appendRoadPath( pathNodes, sourceRoad, source.previousWayCoordinates, sourceRoad.pathLength );
+	else
+		appendRoadPath( pathNodes, sourceRoad, source.previousWayCoordinates - 1, -1 );
+	pathEdges->back().length = pathNodes->size() - 1;
+	pathEdges->back().seconds *= sourceForward ? 1 - source.percentage : source.percentage;
+
+	while ( stack.size() > 1 ) {
+		const NodeIterator node = stack.back();
+		stack.pop_back();
+		unpackEdge( context, node, stack.back(), true, pathNodes, pathEdges );
+	}
+
+	pathNode = middle;
+	while ( true ) {
+		NodeIterator parent = heapBackward->GetData( pathNode ).parent;
+		if ( parent == pathNode )
+			break;
+		unpackEdge( context, parent, pathNode, false, pathNodes, pathEdges );
+		pathNode = parent;
+	}
+
+	// the root of the backward search is a predecessor of the target edge's directed copies
+	// the shortest turn decides which one was used
+	bool targetForward = true;
+	int bestDistance = std::numeric_limits< int >::max();
+	std::vector< TurnTable::Turn >& turns = context->turns;
+	for ( int direction = 0; direction < 2; direction++ ) {
+		const bool forwardCopy = direction == 0;
+		if ( !forwardCopy && !targetRoad.bidirectional )
+			break;
+		const int partial = forwardCopy ? targetRoad.distance * target.percentage : targetRoad.distance - targetRoad.distance * target.percentage;
+		m_turnTable.predecessors( &turns, targetRoad, forwardCopy );
+		for ( std::vector< TurnTable::Turn >::const_iterator turn = turns.begin(), end = turns.end(); turn != end; ++turn ) {
+			if ( turn->node == pathNode && turn->penalty + partial < bestDistance ) {
+				bestDistance = turn->penalty + partial;
+				targetForward = forwardCopy;
+			}
+		}
+	}
+
+	int begin = pathNodes->size();
+	pathEdges->push_back( roadDescription( targetRoad ) );
+	if ( targetForward )
+		appendRoadPath( pathNodes, targetRoad, 1, target.previousWayCoordinates );
+	else
+		appendRoadPath( pathNodes, targetRoad, targetRoad.pathLength - 2, target.previousWayCoordinates - 1 );
+	pathNodes->push_back( target.nearestPoint );
+	pathEdges->back().length = pathNodes->size() - begin;
+	pathEdges->back().seconds *= targetForward ? target.percentage : 1 - target.percentage;
+}
+
+// appends the road's coordinates from begin towards end, excluding end
+void ContractionHierarchiesClient::appendRoadPath( QVector< Node >* pathNodes, const TurnTable::RoadEdge& road, int begin, int end )
+{
+	const int step = begin < end ? 1 : -1;
+	for ( int i = begin; i != end; i += step )
+		pathNodes->push_back( m_turnTable.coordinate( road.path + i ) );
+}
+
+IRouter::Edge ContractionHierarchiesClient::roadDescription( const TurnTable::RoadEdge& road )
+{
+	return Edge( road.name, road.branchingPossible, road.type, road.pathLength - 1, road.distance / 10.0 + 0.5 );
+}
 
+// the shortest edge stored at source that leads to target in the direction of travel
+ContractionHierarchiesClient::EdgeIterator ContractionHierarchiesClient::shortestEdge( Context* context, const NodeIterator source, const NodeIterator target, bool forward )
+{
+	EdgeIterator shortestEdge;
 	unsigned distance = std::numeric_limits< unsigned >::max();
-	for ( EdgeIterator edge = m_graph.edges( source ); edge.hasEdgesLeft(); ) {
+	const Overlay* overlaid = this->overlaid( context, source );
+	for ( EdgeIterator edge = m_graph.edges( &context->cache, source ); edge.hasEdgesLeft(); ) {
 		m_graph.unpackNextEdge( &edge );
 		if ( edge.target() != target )
 			continue;
@@ -388,37 +1454,426 @@ bool ContractionHierarchiesClient::unpackEdge( const NodeIterator source, const
 			continue;
 		if ( !forward && !edge.backward() )
 			continue;
-		if ( edge.distance() > distance )
+		const unsigned edgeWeight = weight( edge, overlaid, forward );
+		if ( edgeWeight > distance )
 			continue;
-		distance = edge.distance();
+		distance = edgeWeight;
 		shortestEdge = edge;
 	}
+	return shortestEdge;
+}
+
+// travel time of the shortest edge stored at source that leads to target in the direction of travel
+// overlay: use the travel times of the traffic overlay instead of the preprocessed ones
+unsigned ContractionHierarchiesClient::shortestWeight( Context* context, const NodeIterator source, const NodeIterator target, bool forward, const Overlay* overlay )
+{
+	unsigned distance = std::numeric_limits< unsigned >::max();
+	const Overlay* overlaid = overlay != NULL && overlay->nodes[source] ? overlay : NULL;
+	for ( EdgeIterator edge = m_graph.edges( &context->cache, source ); edge.hasEdgesLeft(); ) {
+		m_graph.unpackNextEdge( &edge );
+		if ( edge.target() != target )
+			continue;
+		if ( forward && !edge.forward() )
+			continue;
+		if ( !forward && !edge.backward() )
+			continue;
+		distance = std::min( distance, weight( edge, overlaid, forward ) );
+	}
+	return distance;
+}
+
+// appends the path from one node to an adjacent one, the edge is stored at the lower node
+void ContractionHierarchiesClient::unpackTraversal( Context* context, const NodeIterator from, const NodeIterator to, QVector< Node >* pathNodes, QVector< Edge >* pathEdges )
+{
+	if ( from > to )
+		unpackEdge( context, from, to, true, pathNodes, pathEdges );
+	else
+		unpackEdge( context, to, from, false, pathNodes, pathEdges );
+}
+
+bool ContractionHierarchiesClient::unpackEdge( Context* context, const NodeIterator source, const NodeIterator target, bool forward, QVector< Node >* pathNodes, QVector< Edge >* pathEdges, unsigned depth ) {
+	CompressedGraph::Cache* cache = &context->cache;
+	EdgeIterator shortestEdge = this->shortestEdge( context, source, target, forward );
 
 	if ( shortestEdge.unpacked() ) {
-		m_graph.path( shortestEdge, pathNodes, pathEdges, forward );
+		m_graph.path( cache, shortestEdge, pathNodes, pathEdges, forward );
 		return true;
 	}
 
 	if ( !shortestEdge.shortcut() ) {
 		pathEdges->push_back( shortestEdge.description() );
+		pathEdges->back().seconds = ( weight( shortestEdge, overlaid( context, source ), forward ) + 5 ) / 10;
 		if ( forward )
-			pathNodes->push_back( m_graph.node( target ).coordinate );
+			pathNodes->push_back( m_graph.node( cache, target ).coordinate );
 		else
-			pathNodes->push_back( m_graph.node( source ).coordinate );
+			pathNodes->push_back( m_graph.node( cache, source ).coordinate );
 		return true;
 	}
 
+	// shortcuts without a stored path are unpacked once and then copied from the memo
+	const quint64 key = ( shortestEdge.id() << 1 ) | ( forward ? 1 : 0 );
+	if ( context->unpackedShortcuts.empty() )
+		context->unpackedShortcuts.resize( unpackedShortcutSlots );
+	UnpackedShortcut* memo = &context->unpackedShortcuts[qHash( key ) % unpackedShortcutSlots];
+	if ( memo->edge == key && memo->version == context->overlay->version ) {
+		*pathNodes += memo->nodes;
+		*pathEdges += memo->edges;
+		return true;
+	}
+	const int nodesBegin = pathNodes->size();
+	const int edgesBegin = pathEdges->size();
+
 	const NodeIterator middle = shortestEdge.middle();
+	if ( context->collectStatistics )
+		context->statistics.unpackDepth = std::max( context->statistics.unpackDepth, depth + 1 );
 
 	if ( forward ) {
-		unpackEdge( middle, source, false, pathNodes, pathEdges );
-		unpackEdge( middle, target, true, pathNodes, pathEdges );
-		return true;
+		unpackEdge( context, middle, source, false, pathNodes, pathEdges, depth + 1 );
+		unpackEdge( context, middle, target, true, pathNodes, pathEdges, depth + 1 );
 	} else {
-		unpackEdge( middle, target, false, pathNodes, pathEdges );
-		unpackEdge( middle, source, true, pathNodes, pathEdges );
-		return true;
+		unpackEdge( context, middle, target, false, pathNodes, pathEdges, depth + 1 );
+		unpackEdge( context, middle, source, true, pathNodes, pathEdges, depth + 1 );
+	}
+
+	if ( pathEdges->size() - edgesBegin <= unpackedShortcutEdges ) {
+		memo->edge = key;
+		memo->version = context->overlay->version;
+		memo->nodes = pathNodes->mid( nodesBegin );
+		memo->edges = pathEdges->mid( edgesBegin );
+	}
+	return true;
+}
+
+// appends the original edges of an edge in the direction of travel
+// shortcuts stored with their unpacked path are not split up
+void ContractionHierarchiesClient::unpackEdge( Context* context, const NodeIterator source, const NodeIterator target, bool forward, std::vector< PathEdge >* path )
+{
+	EdgeIterator shortestEdge = this->shortestEdge( context, source, target, forward );
+
+	if ( shortestEdge.unpacked() || !shortestEdge.shortcut() ) {
+		const int distance = weight( shortestEdge, overlaid( context, source ), forward );
+		if ( forward )
+			path->push_back( PathEdge( source, target, distance ) );
+		else
+			path->push_back( PathEdge( target, source, distance ) );
+		return;
+	}
+
+	const NodeIterator middle = shortestEdge.middle();
+
+	if ( forward ) {
+		unpackEdge( context, middle, source, false, path );
+		unpackEdge( context, middle, target, true, path );
+	} else {
+		unpackEdge( context, middle, target, false, path );
+		unpackEdge( context, middle, source, true, path );
+	}
+}
+
+// the importer edge locations, written by the preprocessor
+bool ContractionHierarchiesClient::loadEdgeMap()
+{
+	QString filename = fileInDirectory( m_directory, "Contraction Hierarchies" ) + "_edgemap";
+	if ( !QFile::exists( filename ) ) {
+		qCritical() << "traffic overlay not available, preprocess the routing module with keep-edge-map:" << filename;
+		return false;
+	}
+	QFile edgeMapFile( filename );
+	if ( !openQFile( &edgeMapFile, QIODevice::ReadOnly ) )
+		return false;
+
+	unsigned header[2];
+	if ( edgeMapFile.read( ( char* ) header, sizeof( header ) ) != sizeof( header ) || header[0] != 1 ) {
+		qCritical() << "edge map file format not compatible:" << filename;
+		return false;
+	}
+	m_edgeMap.resize( header[1] );
+	const qint64 size = m_edgeMap.size() * sizeof( EdgeLocation );
+	if ( size != 0 && edgeMapFile.read( ( char* ) &m_edgeMap[0], size ) != size ) {
+		qCritical() << "edge map file corrupted:" << filename;
+		std::vector< EdgeLocation >().swap( m_edgeMap );
+		return false;
+	}
+	return true;
+}
+
+// builds the index of a sorted list of ( node, lower node ) pairs
+static void buildIndex( const std::vector< std::pair< unsigned, unsigned > >& edges, unsigned numberOfNodeIDs, std::vector< unsigned >* first, std::vector< unsigned >* lowerNodes )
+{
+	first->assign( numberOfNodeIDs + 1, 0 );
+	lowerNodes->resize( edges.size() );
+	for ( unsigned i = 0; i < edges.size(); i++ ) {
+		( *first )[edges[i].first + 1]++;
+		( *lowerNodes )[i] = edges[i].second;
+	}
+	for ( unsigned node = 0; node < numberOfNodeIDs; node++ )
+		( *first )[node + 1] += ( *first )[node];
+}
+
+void ContractionHierarchiesClient::buildLowerIndex( Context* context )
+{
+	CompressedGraph::Cache* cache = &context->cache;
+	std::vector< std::pair< NodeIterator, NodeIterator > > edges;
+	std::vector< std::pair< NodeIterator, NodeIterator > > shortcuts;
+	for ( unsigned block = 0, blocks = m_graph.numberOfBlocks(); block < blocks; block++ ) {
+		for ( unsigned internal = 0, nodes = m_graph.numberOfNodes( cache, block ); internal < nodes; internal++ ) {
+			const NodeIterator node = m_graph.nodeID( block, internal );
+			for ( EdgeIterator edge = m_graph.edges( cache, node ); edge.hasEdgesLeft(); ) {
+				m_graph.unpackNextEdge( &edge );
+				if ( edge.target() == node )
+					continue;
+				if ( edge.shortcut() )
+					shortcuts.push_back( std::make_pair( edge.target(), node ) );
+				else
+					edges.push_back( std::make_pair( edge.target(), node ) );
+			}
+		}
 	}
+	std::sort( edges.begin(), edges.end() );
+	edges.erase( std::unique( edges.begin(), edges.end() ), edges.end() );
+	std::sort( shortcuts.begin(), shortcuts.end() );
+	shortcuts.erase( std::unique( shortcuts.begin(), shortcuts.end() ), shortcuts.end() );
+	// the lower bound search visits a node's edges once
+	std::vector< std::pair< NodeIterator, NodeIterator > > shortcutsOnly;
+	std::set_difference( shortcuts.begin(), shortcuts.end(), edges.begin(), edges.end(), std::back_inserter( shortcutsOnly ) );
+
+	buildIndex( edges, m_graph.numberOfNodeIDs(), &m_lowerFirst, &m_lowerNodes );
+	buildIndex( shortcutsOnly, m_graph.numberOfNodeIDs(), &m_shortcutFirst, &m_shortcutNodes );
+}
+
+// marks the region searched in both directions by the lower bound search and returns its size, see computeLowerBound
+unsigned ContractionHierarchiesClient::buildRegion( Context* context, Overlay* overlay )
+{
+	std::vector< bool >().swap( overlay->region );
+	if ( overlay->decreasedEdges.isEmpty() )
+		return 0;
+
+	overlay->region.resize( m_graph.numberOfNodeIDs(), false );
+	std::vector< NodeIterator > queue;
+	for ( QHash< quint64, NodeIterator >::const_iterator i = overlay->decreasedEdges.constBegin(); i != overlay->decreasedEdges.constEnd(); ++i ) {
+		if ( overlay->region[*i] )
+			continue;
+		overlay->region[*i] = true;
+		queue.push_back( *i );
+	}
+	for ( unsigned i = 0; i < queue.size(); i++ ) {
+		for ( EdgeIterator edge = m_graph.edges( &context->cache, queue[i] ); edge.hasEdgesLeft(); ) {
+			m_graph.unpackNextEdge( &edge );
+			if ( overlay->region[edge.target()] )
+				continue;
+			overlay->region[edge.target()] = true;
+			queue.push_back( edge.target() );
+		}
+	}
+	return queue.size();
+}
+
+// returns true if the travel times changed
+bool ContractionHierarchiesClient::setOverlayWeight( Overlay* overlay, NodeIterator node, const EdgeIterator& edge, unsigned forward, unsigned backward )
+{
+	const quint64 id = edge.id();
+	QHash< quint64, OverlayWeight >::const_iterator i = overlay->weights.constFind( id );
+	const OverlayWeight old = i != overlay->weights.constEnd() ? *i : OverlayWeight( edge.distance(), edge.distance() );
+	if ( ( !edge.forward() || forward == old.forward ) && ( !edge.backward() || backward == old.backward ) )
+		return false;
+
+	if ( ( !edge.forward() || forward == edge.distance() ) && ( !edge.backward() || backward == edge.distance() ) ) {
+		overlay->weights.remove( id );
+	} else {
+		overlay->weights.insert( id, OverlayWeight( forward, backward ) );
+		overlay->nodes[node] = true;
+	}
+	return true;
+}
+
+// recomputes the shortcuts bridging middle, they are stored at its higher neighbours.
+// shortcuts with an unpacked path do not know their middle, it is identified by the preprocessed travel times
+void ContractionHierarchiesClient::reweightShortcuts( Context* context, Overlay* overlay, NodeIterator middle, std::priority_queue< NodeIterator >* changed, QSet< NodeIterator >* queued, UpdateStatistics* statistics )
+{
+	CompressedGraph::Cache* cache = &context->cache;
+	std::vector< NodeIterator >& neighbours = context->pathStack;
+	neighbours.clear();
+	for ( EdgeIterator edge = m_graph.edges( cache, middle ); edge.hasEdgesLeft(); ) {
+		m_graph.unpackNextEdge( &edge );
+		neighbours.push_back( edge.target() );
+	}
+	std::sort( neighbours.begin(), neighbours.end() );
+	neighbours.erase( std::unique( neighbours.begin(), neighbours.end() ), neighbours.end() );
+
+	for ( unsigned i = 0; i < neighbours.size(); i++ ) {
+		const NodeIterator source = neighbours[i];
+		for ( EdgeIterator edge = m_graph.edges( cache, source ); edge.hasEdgesLeft(); ) {
+			m_graph.unpackNextEdge( &edge );
+			if ( !edge.shortcut() )
+				continue;
+			if ( !edge.unpacked() && edge.middle() != middle )
+				continue;
+			const NodeIterator target = edge.target();
+			if ( !std::binary_search( neighbours.begin(), neighbours.end(), target ) )
+				continue;
+
+			unsigned weights[2] = { edge.distance(), edge.distance() };
+			bool valid = true;
+			for ( int direction = 0; direction < 2; direction++ ) {
+				const bool forward = direction == 0;
+				if ( !( forward ? edge.forward() : edge.backward() ) )
+					continue;
+				const NodeIterator first = forward ? source : target;
+				const NodeIterator second = forward ? target : source;
+				if ( edge.unpacked() ) {
+					const unsigned preprocessed = shortestWeight( context, middle, first, false, NULL );
+					if ( preprocessed == std::numeric_limits< unsigned >::max() || preprocessed + shortestWeight( context, middle, second, true, NULL ) != edge.distance() ) {
+						valid = false;
+						break;
+					}
+				}
+				const unsigned toMiddle = shortestWeight( context, middle, first, false, overlay );
+				const unsigned fromMiddle = shortestWeight( context, middle, second, true, overlay );
+				if ( toMiddle == std::numeric_limits< unsigned >::max() || fromMiddle == std::numeric_limits< unsigned >::max() ) {
+					valid = false;
+					break;
+				}
+				weights[direction] = toMiddle + fromMiddle;
+			}
+			if ( !valid )
+				continue;
+
+			statistics->shortcuts++;
+			if ( !setOverlayWeight( overlay, source, edge, weights[0], weights[1] ) )
+				continue;
+			statistics->changedShortcuts++;
+			if ( !queued->contains( source ) ) {
+				queued->insert( source );
+				changed->push( source );
+			}
+		}
+	}
+}
+
+// only the shortcuts containing updated edges are recomputed.
+// lower nodes have higher IDs => processing the changed nodes by decreasing ID updates every shortcut after its parts
+// the update modifies a copy of the current overlay, queries continue with the current one until it is published
+bool ContractionHierarchiesClient::UpdateEdgeWeights( const QVector< EdgeWeight >& weights, UpdateStatistics* statistics )
+{
+	assert( statistics != NULL );
+	*statistics = UpdateStatistics();
+	if ( m_context == NULL )
+		return false;
+	if ( m_turnTable.loaded() ) {
+		qCritical() << "traffic overlay not supported by edge based graphs";
+		return false;
+	}
+
+	QMutexLocker locker( &m_updateMutex );
+	QTime time;
+	time.start();
+	if ( m_updateContext == NULL ) {
+		m_updateContext = createContext();
+		if ( m_updateContext == NULL )
+			return false;
+	}
+	if ( m_edgeMap.empty() && !loadEdgeMap() )
+		return false;
+	if ( m_lowerFirst.empty() ) {
+		buildLowerIndex( m_updateContext );
+		qDebug() << "Contraction Hierarchies: initialized traffic overlay:" << time.restart() << "ms";
+	}
+
+	Context* context = m_updateContext;
+	const QSharedPointer< const Overlay > previous = currentOverlay();
+	QSharedPointer< Overlay > overlay( new Overlay( *previous ) );
+	overlay->version = ++m_overlayVersion;
+	if ( overlay->nodes.empty() )
+		overlay->nodes.resize( m_graph.numberOfNodeIDs(), false );
+	std::priority_queue< NodeIterator > changed;
+	QSet< NodeIterator > queued;
+	for ( int i = 0; i < weights.size(); i++ ) {
+		if ( weights[i].edge >= m_edgeMap.size() || m_edgeMap[weights[i].edge].id == std::numeric_limits< unsigned >::max() ) {
+			statistics->ignored++;
+			continue;
+		}
+		const EdgeLocation& location = m_edgeMap[weights[i].edge];
+		const EdgeIterator edge = m_graph.findEdge( &context->cache, location.source, location.target, location.id );
+		const NodeIterator node = std::max( location.source, location.target );
+		const unsigned distance = std::max( weights[i].seconds * 10 + 0.5, 1.0 );
+		if ( !setOverlayWeight( overlay.data(), node, edge, distance, distance ) )
+			continue;
+		statistics->edges++;
+		if ( distance < edge.distance() )
+			overlay->decreasedEdges.insert( edge.id(), node );
+		else
+			overlay->decreasedEdges.remove( edge.id() );
+		if ( !queued.contains( node ) ) {
+			queued.insert( node );
+			changed.push( node );
+		}
+	}
+
+	while ( !changed.empty() ) {
+		const NodeIterator node = changed.top();
+		changed.pop();
+		reweightShortcuts( context, overlay.data(), node, &changed, &queued, statistics );
+	}
+
+	statistics->overlaidEdges = overlay->weights.size();
+	statistics->regionNodes = buildRegion( context, overlay.data() );
+	statistics->fallbacks = m_fallbackRoutes.fetchAndStoreOrdered( 0 );
+	statistics->routes = m_overlaidRoutes.fetchAndStoreOrdered( 0 );
+	publishOverlay( overlay );
+	statistics->milliseconds = time.elapsed();
+	return true;
+}
+
+void ContractionHierarchiesClient::ClearEdgeWeights()
+{
+	QMutexLocker locker( &m_updateMutex );
+	Overlay* overlay = new Overlay();
+	overlay->version = ++m_overlayVersion;
+	publishOverlay( QSharedPointer< const Overlay >( overlay ) );
+}
+
+QSharedPointer< const ContractionHierarchiesClient::Overlay > ContractionHierarchiesClient::currentOverlay()
+{
+	QMutexLocker locker( &m_overlayMutex );
+	return m_overlay;
+}
+
+// replaces the current overlay, the queries holding the previous one finish with it
+void ContractionHierarchiesClient::publishOverlay( QSharedPointer< const Overlay > overlay )
+{
+	QMutexLocker locker( &m_overlayMutex );
+	m_overlay = overlay;
+}
+
+void ContractionHierarchiesClient::SetCollectStatistics( bool enabled )
+{
+	m_collectStatistics = enabled;
+}
+
+bool ContractionHierarchiesClient::GetQueryStatistics( QueryContext* queryContext, QueryStatistics* statistics )
+{
+	assert( statistics != NULL );
+	const Context* context = queryContext != NULL ? static_cast< const Context* >( queryContext ) : m_context;
+	if ( context == NULL || !context->collectStatistics )
+		return false;
+	*statistics = context->statistics;
+	const CompressedGraph::Cache::Counters counters = context->cache.counters();
+	statistics->blocks = counters.blocks - context->cacheCounters.blocks;
+	statistics->blocksRead = counters.blocksRead - context->cacheCounters.blocksRead;
+	statistics->decodedBlocks = counters.decodedBlocks - context->cacheCounters.decodedBlocks;
+	statistics->pathBlocks = counters.pathBlocks - context->cacheCounters.pathBlocks;
+	statistics->pathBlocksRead = counters.pathBlocksRead - context->cacheCounters.pathBlocksRead;
+	return true;
+}
+
+// resets the statistics of the context if they are collected
+void ContractionHierarchiesClient::startStatistics( Context* context )
+{
+	context->collectStatistics = m_collectStatistics;
+	if ( !m_collectStatistics )
+		return;
+	context->statistics = QueryStatistics();
+	context->cacheCounters = context->cache.counters();
 }
 
 Q_EXPORT_PLUGIN2( contractionhierarchiesclient, ContractionHierarchiesClient )
@@ -22,15 +22,28 @@ along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QObject>
 #include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QAtomicInt>
 #include "interfaces/irouter.h"
+#include "interfaces/icachesettings.h"
+#include "interfaces/idistancetable.h"
+#include "interfaces/iisochrone.h"
+#include "interfaces/ialternativeroutes.h"
+#include "interfaces/itrafficoverlay.h"
+#include "interfaces/iquerystatistics.h"
 #include "binaryheap.h"
 #include "compressedgraph.h"
+#include "turntable.h"
 #include <queue>
+#include <vector>
 
-class ContractionHierarchiesClient : public QObject, public IRouter
+class ContractionHierarchiesClient : public QObject, public IRouter, public ICacheSettings, public IDistanceTable, public IIsochrone, public IAlternativeRoutes, public ITrafficOverlay, public IQueryStatistics
 {
 	Q_OBJECT
-	Q_INTERFACES( IRouter )
+	Q_INTERFACES( IRouter ICacheSettings IDistanceTable IIsochrone IAlternativeRoutes ITrafficOverlay IQueryStatistics )
 public:
 	ContractionHierarchiesClient();
 	virtual ~ContractionHierarchiesClient();
@@ -42,10 +55,26 @@ public:
 	virtual bool LoadData();
 	virtual bool UnloadData();
 	virtual bool GetRoute( double* distance, QVector< Node>* pathNodes, QVector< Edge >* pathEdges, const IGPSLookup::Result& source, const IGPSLookup::Result& target );
+	virtual QueryContext* CreateQueryContext();
+	virtual bool GetRoute( QueryContext* context, double* distance, QVector< Node>* pathNodes, QVector< Edge >* pathEdges, const IGPSLookup::Result& source, const IGPSLookup::Result& target );
 	virtual bool GetName( QString* result, unsigned name );
 	virtual bool GetNames( QVector< QString >* result, QVector< unsigned > names );
 	virtual bool GetType( QString* result, unsigned type );
 	virtual bool GetTypes( QVector< QString >* result, QVector< unsigned > types );
+	virtual void SetCacheMode( CacheMode mode );
+	virtual CacheMode GetCacheMode();
+	virtual void SetCacheSize( unsigned bytes );
+	virtual unsigned GetCacheSize();
+	virtual void SetWarmCache( bool enabled );
+	virtual bool SaveWarmCache();
+	virtual bool GetDistanceTable( QueryContext* context, QVector< double >* distances, const QVector< IGPSLookup::Result >& sources, const QVector< IGPSLookup::Result >& targets );
+	virtual bool GetReachableNodes( QueryContext* context, QVector< ReachedNode >* result, const IGPSLookup::Result& source, double maxSeconds );
+	virtual bool GetIsochrones( QueryContext* context, QVector< Isochrone >* result, const IGPSLookup::Result& source, const QVector< double >& limits, double resolution );
+	virtual bool GetAlternativeRoutes( QueryContext* context, QVector< Route >* result, const IGPSLookup::Result& source, const IGPSLookup::Result& target, int maxAlternatives, const Limits& limits );
+	virtual bool UpdateEdgeWeights( const QVector< EdgeWeight >& weights, UpdateStatistics* statistics );
+	virtual void ClearEdgeWeights();
+	virtual void SetCollectStatistics( bool enabled );
+	virtual bool GetQueryStatistics( QueryContext* context, QueryStatistics* statistics );
 
 protected:
 	struct HeapData {
@@ -62,6 +91,10 @@ protected:
 			bool operator()( bool forward, bool /*backward*/ ) const {
 				return forward;
 			}
+			// the search follows the direction of travel
+			bool travelsForward() const {
+				return true;
+			}
 	};
 
 	class AllowBackwardEdge {
@@ -69,25 +102,249 @@ protected:
 			bool operator()( bool /*forward*/, bool backward ) const {
 				return backward;
 			}
+			bool travelsForward() const {
+				return false;
+			}
 	};
 
 	typedef CompressedGraph::NodeIterator NodeIterator;
 	typedef CompressedGraph::EdgeIterator EdgeIterator;
-	typedef BinaryHeap< NodeIterator, int, int, HeapData, MapStorage< NodeIterator, unsigned > > Heap;
+	typedef BinaryHeap< NodeIterator, int, int, HeapData, GenerationStorage< NodeIterator, unsigned > > Heap;
+
+	// distance from a node to a target of a distance table query
+	struct BucketEntry {
+		NodeIterator node;
+		unsigned target;
+		int distance;
+		BucketEntry( NodeIterator n, unsigned t, int d ) : node( n ), target( t ), distance( d ) {}
+		bool operator<( const BucketEntry& right ) const {
+			return node < right.node;
+		}
+	};
+
+	// via node of an alternative route
+	struct ViaCandidate {
+		NodeIterator node;
+		int distance;
+		int score;
+		ViaCandidate( NodeIterator n, int d ) : node( n ), distance( d ), score( 0 ) {}
+		bool operator<( const ViaCandidate& right ) const {
+			return distance < right.distance;
+		}
+	};
+
+	// edge of a path in the direction of travel
+	struct PathEdge {
+		NodeIterator source;
+		NodeIterator target;
+		int distance;
+		PathEdge( NodeIterator s, NodeIterator t, int d ) : source( s ), target( t ), distance( d ) {}
+		quint64 key() const {
+			return ( ( quint64 ) source << 32 ) | target;
+		}
+	};
+
+	// travel times of an edge replaced by the traffic overlay
+	struct OverlayWeight {
+		unsigned forward;
+		unsigned backward;
+		OverlayWeight() : forward( 0 ), backward( 0 ) {}
+		OverlayWeight( unsigned f, unsigned b ) : forward( f ), backward( b ) {}
+	};
+
+	// position of an importer edge in the graph, see ContractionHierarchies::Preprocess
+	struct EdgeLocation {
+		NodeIterator source;
+		NodeIterator target;
+		unsigned id;
+	};
+
+	// original edges of a shortcut in the direction of travel, see unpackEdge
+	// edge: the shortcut's edge ID and direction, version: the overlay it was unpacked with
+	struct UnpackedShortcut {
+		quint64 edge;
+		unsigned version;
+		QVector< Node > nodes;
+		QVector< Edge > edges;
+		UnpackedShortcut() : edge( std::numeric_limits< quint64 >::max() ), version( 0 ) {}
+	};
+
+	// travel times of the traffic overlay, immutable once published
+	// a query keeps the overlay it started with, an update publishes a modified copy
+	struct Overlay {
+		// replaced travel times by edge ID and the nodes storing such edges
+		QHash< quint64, OverlayWeight > weights;
+		std::vector< bool > nodes;
+		// original edges faster than preprocessed and the nodes storing them
+		QHash< quint64, NodeIterator > decreasedEdges;
+		// the decreased edges' nodes and all nodes reachable upwards from them, empty without such edges
+		std::vector< bool > region;
+		// invalidates the unpacked shortcuts of all contexts
+		unsigned version;
+		Overlay() : version( 0 ) {}
+	};
+
+	// the memo is direct mapped, a shortcut replaces the last one unpacked into its slot
+	static const unsigned unpackedShortcutSlots = 1024;
+	// longer paths are cheap to unpack compared to their size
+	static const int unpackedShortcutEdges = 64;
+
+	// all mutable state of a query
+	class Context : public QueryContext {
+	public:
+		Context( unsigned nodeIDs ) : heapForward( nodeIDs ), heapBackward( nodeIDs ), localForward( NULL ), localBackward( NULL ), numberOfNodeIDs( nodeIDs ), lowerBound( false ), collectStatistics( false )
+		{
+		}
+
+		~Context()
+		{
+			delete localForward;
+			delete localBackward;
+		}
+
+		Heap heapForward;
+		Heap heapBackward;
+		// heaps of the local queries of the alternative route computation, allocated on demand
+		Heap* localForward;
+		Heap* localBackward;
+		unsigned numberOfNodeIDs;
+		// the overlay of the current query
+		QSharedPointer< const Overlay > overlay;
+		// the source and target edges use the smaller of the preprocessed and the overlay travel time
+		bool lowerBound;
+		std::queue< NodeIterator > stallQueue;
+		// scratch buffers for the path reconstruction
+		std::vector< NodeIterator > pathStack;
+		QVector< Node > tempNodes;
+		// node buckets of the distance table computation
+		std::vector< BucketEntry > buckets;
+		// scratch buffer for the turns into the target of an edge based query
+		std::vector< TurnTable::Turn > turns;
+		// distances of the one-to-all sweep, indexed by node ID
+		std::vector< int > sweepDistances;
+		// coordinates of the block scanned by the sweep
+		std::vector< UnsignedCoordinate > blockCoordinates;
+		// scratch buffers of the alternative route computation
+		std::vector< NodeIterator > settled;
+		std::vector< ViaCandidate > candidates;
+		std::vector< PathEdge > viaChain;
+		std::vector< PathEdge > viaPath;
+		std::vector< quint64 > optimalChain;
+		std::vector< quint64 > selectedEdges;
+		// recently unpacked shortcuts, allocated on demand
+		std::vector< UnpackedShortcut > unpackedShortcuts;
+		// counters of the last route, the block accesses are taken from the cache when they are requested
+		bool collectStatistics;
+		QueryStatistics statistics;
+		CompressedGraph::Cache::Counters cacheCounters;
+		CompressedGraph::Cache cache;
+	};
 
 	CompressedGraph m_graph;
+	// only loaded for edge based graphs
+	TurnTable m_turnTable;
 	const char* m_names;
 	QFile m_namesFile;
-	Heap* m_heapForward;
-	Heap* m_heapBackward;
-	std::queue< NodeIterator > m_stallQueue;
+	Context* m_context;
 	QString m_directory;
 	QStringList m_types;
+	CacheMode m_cacheMode;
+	unsigned m_cacheSize;
+	bool m_warmCache;
+	// the blocks to prefetch into every new context, stored next to the graph
+	QString m_warmCacheFile;
+	std::vector< unsigned > m_hotBlocks;
+	std::vector< unsigned > m_hotPathBlocks;
+	// traffic overlay: point to point routes are exact, the other queries use the re-weighted hierarchy
+	// queries take the current overlay under m_overlayMutex, updates are serialized by m_updateMutex and use their own context
+	QSharedPointer< const Overlay > m_overlay;
+	QMutex m_overlayMutex;
+	QMutex m_updateMutex;
+	Context* m_updateContext;
+	// the version of the last published overlay
+	unsigned m_overlayVersion;
+	bool m_collectStatistics;
+	// loaded with the first update
+	std::vector< EdgeLocation > m_edgeMap;
+	// nodes storing an original edge to a node, indexed by m_lowerFirst
+	// built by the first update before it publishes its overlay, read-only afterwards
+	std::vector< unsigned > m_lowerFirst;
+	std::vector< NodeIterator > m_lowerNodes;
+	// nodes storing only shortcuts to a node, indexed by m_shortcutFirst
+	std::vector< unsigned > m_shortcutFirst;
+	std::vector< NodeIterator > m_shortcutNodes;
+	// point to point routes since the last update and those among them that searched the original edges
+	QAtomicInt m_overlaidRoutes;
+	QAtomicInt m_fallbackRoutes;
 
+	// the overlay if the node stores replaced travel times, NULL otherwise
+	const Overlay* overlaid( const Context* context, NodeIterator node ) const
+	{
+		const Overlay* overlay = context->overlay.data();
+		if ( overlay->nodes.empty() || !overlay->nodes[node] )
+			return NULL;
+		return overlay;
+	}
+
+	// travel time of an edge in the direction of travel, overlaid: the overlay if the edge's node stores replaced travel times
+	unsigned weight( const EdgeIterator& edge, const Overlay* overlaid, bool forward ) const
+	{
+		if ( overlaid != NULL ) {
+			QHash< quint64, OverlayWeight >::const_iterator i = overlaid->weights.constFind( edge.id() );
+			if ( i != overlaid->weights.constEnd() )
+				return forward ? i->forward : i->backward;
+		}
+		return edge.distance();
+	}
+
+	// travel time of an edge in the lower bound search, only decreased edges are faster than preprocessed
+	unsigned lowerWeight( const EdgeIterator& edge, const Overlay* overlaid, bool forward ) const
+	{
+		return std::min( weight( edge, overlaid, forward ), edge.distance() );
+	}
+
+	template< class EdgeAllowed, class StallEdgeAllowed >
+	void computeStep( Context* context, Heap* heapForward, Heap* heapBackward, const EdgeAllowed& edgeAllowed, const StallEdgeAllowed& stallEdgeAllowed, NodeIterator* middle, int* targetDistance );
 	template< class EdgeAllowed, class StallEdgeAllowed >
-	void computeStep( Heap* heapForward, Heap* heapBackward, const EdgeAllowed& edgeAllowed, const StallEdgeAllowed& stallEdgeAllowed, NodeIterator* middle, int* targetDistance );
-	int computeRoute( const IGPSLookup::Result& source, const IGPSLookup::Result& target, QVector< Node>* pathNodes, QVector< Edge >* pathEdges );
-	bool unpackEdge( const NodeIterator source, const NodeIterator target, bool forward, QVector< Node>* pathNodes, QVector< Edge >* pathEdges );
+	bool computeSearchStep( Context* context, Heap* heap, const EdgeAllowed& edgeAllowed, const StallEdgeAllowed& stallEdgeAllowed, NodeIterator* node );
+	EdgeIterator insertSource( Context* context, Heap* heap, const IGPSLookup::Result& source );
+	EdgeIterator insertTarget( Context* context, Heap* heap, const IGPSLookup::Result& target );
+	unsigned positionWeight( Context* context, const EdgeIterator& edge, const IGPSLookup::Result& position );
+	int computeRoute( Context* context, const IGPSLookup::Result& source, const IGPSLookup::Result& target, QVector< Node>* pathNodes, QVector< Edge >* pathEdges );
+	int computeOverlaidRoute( Context* context, const IGPSLookup::Result& source, const IGPSLookup::Result& target, QVector< Node>* pathNodes, QVector< Edge >* pathEdges );
+	int computeLowerBound( Context* context, const IGPSLookup::Result& source, const IGPSLookup::Result& target, int upperBound );
+	void computeBoundStep( Context* context, Heap* heap, Heap* otherHeap, bool forward, int* targetDistance );
+	void computeOriginalStep( Context* context, Heap* heap, Heap* otherHeap, bool forward, NodeIterator* middle, int* targetDistance );
+	void relaxEdge( Heap* heap, Heap* otherHeap, NodeIterator node, NodeIterator to, int toDistance, NodeIterator* middle, int* targetDistance );
+	void buildRoute( Context* context, NodeIterator middle, const IGPSLookup::Result& source, const IGPSLookup::Result& target, const EdgeIterator& sourceEdge, const EdgeIterator& targetEdge, QVector< Node>* pathNodes, QVector< Edge >* pathEdges );
+	double onEdgeDistance( Context* context, const IGPSLookup::Result& source, const IGPSLookup::Result& target );
+	bool findRoadEdge( TurnTable::RoadEdge* result, const IGPSLookup::Result& position );
+	void insertEdgeBasedSource( Heap* heap, const TurnTable::RoadEdge& source, double percentage );
+	void insertEdgeBasedTarget( Context* context, Heap* heap, const TurnTable::RoadEdge& target, double percentage );
+	double computeEdgeBasedRoute( Context* context, const IGPSLookup::Result& source, const IGPSLookup::Result& target, QVector< Node>* pathNodes, QVector< Edge >* pathEdges );
+	void buildEdgeBasedRoute( Context* context, NodeIterator middle, const IGPSLookup::Result& source, const IGPSLookup::Result& target, const TurnTable::RoadEdge& sourceRoad, const TurnTable::RoadEdge& targetRoad, QVector< Node>* pathNodes, QVector< Edge >* pathEdges );
+	void appendRoadPath( QVector< Node >* pathNodes, const TurnTable::RoadEdge& road, int begin, int end );
+	Edge roadDescription( const TurnTable::RoadEdge& road );
+	bool computeOneToAll( Context* context, const IGPSLookup::Result& source );
+	unsigned viaChain( Context* context, NodeIterator via, std::vector< PathEdge >* chain );
+	unsigned unpackViaChain( Context* context, const std::vector< PathEdge >& chain, unsigned viaIndex, std::vector< PathEdge >* path );
+	int sharedDistance( const std::vector< PathEdge >& path, const std::vector< quint64 >& edges );
+	bool isLocallyOptimal( Context* context, const std::vector< PathEdge >& path, unsigned viaIndex, int radius );
+	int computeDistance( Context* context, NodeIterator source, NodeIterator target );
+	EdgeIterator shortestEdge( Context* context, const NodeIterator source, const NodeIterator target, bool forward );
+	unsigned shortestWeight( Context* context, const NodeIterator source, const NodeIterator target, bool forward, const Overlay* overlay );
+	void unpackTraversal( Context* context, const NodeIterator from, const NodeIterator to, QVector< Node>* pathNodes, QVector< Edge >* pathEdges );
+	bool unpackEdge( Context* context, const NodeIterator source, const NodeIterator target, bool forward, QVector< Node>* pathNodes, QVector< Edge >* pathEdges, unsigned depth = 0 );
+	void unpackEdge( Context* context, const NodeIterator source, const NodeIterator target, bool forward, std::vector< PathEdge >* path );
+	Context* createContext();
+	QSharedPointer< const Overlay > currentOverlay();
+	void publishOverlay( QSharedPointer< const Overlay > overlay );
+	void startStatistics( Context* context );
+	bool loadEdgeMap();
+	void buildLowerIndex( Context* context );
+	unsigned buildRegion( Context* context, Overlay* overlay );
+	bool setOverlayWeight( Overlay* overlay, NodeIterator node, const EdgeIterator& edge, unsigned forward, unsigned backward );
+	void reweightShortcuts( Context* context, Overlay* overlay, NodeIterator middle, std::priority_queue< NodeIterator >* changed, QSet< NodeIterator >* queued, UpdateStatistics* statistics );
 
 };
 
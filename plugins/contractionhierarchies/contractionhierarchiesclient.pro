@@ -20,12 +20,23 @@ HEADERS += \
 	 ../../utils/coordinates.h \
 	 ../../utils/config.h \
 	 blockcache.h \
+	 mappedblocks.h \
 	 binaryheap.h \
 	 ../../interfaces/irouter.h \
+	 ../../interfaces/icachesettings.h \
+	 ../../interfaces/idistancetable.h \
+	 ../../interfaces/iisochrone.h \
+	 ../../interfaces/ialternativeroutes.h \
+	 ../../interfaces/itrafficoverlay.h \
+	 ../../interfaces/iquerystatistics.h \
 	 contractionhierarchiesclient.h \
 	 compressedgraph.h \
+	 frequencycache.h \
+	 turntable.h \
 	 ../../interfaces/igpslookup.h \
 	 ../../utils/bithelpers.h \
+	 ../../utils/bitunpack.h \
+	 ../../utils/gridoutline.h \
 	 ../../utils/qthelpers.h
 
 SOURCES += \
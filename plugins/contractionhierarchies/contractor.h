@@ -59,13 +59,17 @@ class Contractor {
 
 		struct _HeapData {
 			bool target;
+			// edges on the path from the source
+			unsigned short hops;
 			_HeapData()
 			{
 				target = false;
+				hops = 0;
 			}
-			_HeapData( bool t )
+			_HeapData( bool t, unsigned short h )
 			{
 				target = t;
+				hops = h;
 			}
 		};
 
@@ -78,15 +82,22 @@ class Contractor {
 			std::vector< _ImportEdge > insertedEdges;
 			std::vector< Witness > witnessList;
 			std::vector< NodeID > neighbours;
+			// statistics
+			long long evaluations;
+			long long settledNodes;
 			_ThreadData( NodeID nodes ): heap( nodes ) {
+				evaluations = settledNodes = 0;
 			}
 		};
 
 		struct _PriorityData {
 			int depth;
 			NodeID bias;
+			// lazy updates: a neighbour was contracted since the priority was computed
+			bool dirty;
 			_PriorityData() {
 				depth = 0;
+				dirty = false;
 			}
 		};
 
@@ -114,9 +125,11 @@ class Contractor {
 			double inserting;
 			double removing;
 			double updating;
+			unsigned evaluations;
 
 			_LogItem() {
 				iteration = nodes = contraction = independent = inserting = removing = updating = 0;
+				evaluations = 0;
 			}
 
 			double GetTotalTime() const {
@@ -124,7 +137,7 @@ class Contractor {
 			}
 
 			void PrintStatistics() const {
-				qDebug( "%d\t%d\t%lf\t%lf\t%lf\t%lf\t%lf", iteration, nodes, independent, contraction, inserting, removing, updating );
+				qDebug( "%d\t%d\t%lf\t%lf\t%lf\t%lf\t%lf\t%u", iteration, nodes, independent, contraction, inserting, removing, updating, evaluations );
 			}
 		};
 
@@ -148,13 +161,14 @@ class Contractor {
 						sum.inserting += iterations[i].inserting;
 						sum.removing += iterations[i].removing;
 						sum.updating += iterations[i].updating;
+						sum.evaluations += iterations[i].evaluations;
 					}
 
 					return sum;
 				}
 
 				void PrintHeader() const {
-					qDebug( "Iteration\tNodes\tIndependent\tContraction\tInserting\tRemoving\tUpdating" );
+					qDebug( "Iteration\tNodes\tIndependent\tContraction\tInserting\tRemoving\tUpdating\tEvaluations" );
 				}
 
 				void PrintSummary() const {
@@ -215,13 +229,63 @@ class Contractor {
 				qDebug( "Skipped %d edges with too large edge weight", skippedLargeEdges );
 			std::sort( edges.begin(), edges.end() );
 
+			_inputChecksum = 2166136261u;
+			for ( std::vector< _ImportEdge >::const_iterator i = edges.begin(), e = edges.end(); i != e; ++i ) {
+				_AddChecksum( i->source );
+				_AddChecksum( i->target );
+				_AddChecksum( i->data.distance );
+				_AddChecksum( ( i->data.forward ? 1 : 0 ) | ( i->data.backward ? 2 : 0 ) );
+			}
+
 			_graph = new _DynamicGraph( nodes, edges );
+			_inputEdges = edges.size();
+			_compactThreshold = std::numeric_limits< quint64 >::max();
+			_checkpointInterval = 0;
+			_checkpointKey = 0;
+			_resume = false;
+			_hopLimit = 0;
+			_lazyUpdates = false;
+			_witnessPhase = 0;
+			_witnessHops = 0;
 
 			std::vector< _ImportEdge >().swap( edges );
 		}
 
 		~Contractor() {
 			delete _graph;
+			if ( _spillFile.isOpen() )
+				_spillFile.remove();
+		}
+
+		// spill mode: the edges of contracted nodes are written to the file, one run sorted by source per round,
+		// instead of staying in the graph. The graph is compacted whenever it allocates more than compactThreshold bytes
+		// keep preserves the runs of an interrupted contraction, Run truncates them to its checkpoint
+		bool SetSpillFile( QString filename, quint64 compactThreshold, bool keep = false ) {
+			_spillFile.setFileName( filename );
+			if ( !openQFile( &_spillFile, keep ? QIODevice::ReadWrite : QIODevice::WriteOnly ) )
+				return false;
+			_spillFile.seek( _spillFile.size() );
+			_compactThreshold = compactThreshold;
+			return true;
+		}
+
+		// writes the contraction state to the file whenever interval seconds passed since the last checkpoint, requires a spill file
+		// the contracted levels are already in the spill file => only the graph of the remaining nodes is rewritten
+		// with resume Run continues from the checkpoint if it belongs to the same input, identified by key and a checksum of the input edges
+		void SetCheckpoint( QString filename, double interval, unsigned key, bool resume ) {
+			assert( _spillFile.isOpen() );
+			_checkpointFilename = filename;
+			_checkpointInterval = interval;
+			_checkpointKey = key;
+			_resume = resume;
+		}
+
+		// hopLimit > 0 limits the witness searches to paths of that many edges while the remaining graph is sparse,
+		// the limit doubles once its average degree exceeds 3.3 and is dropped after 10
+		// lazy updates only mark the neighbours of contracted nodes, their priorities are recomputed once they are selected
+		void SetWitnessSearch( unsigned hopLimit, bool lazyUpdates ) {
+			_hopLimit = hopLimit;
+			_lazyUpdates = lazyUpdates;
 		}
 
 		void Run() {
@@ -238,42 +302,71 @@ class Contractor {
 
 			NodeID levelID = 0;
 			NodeID iteration = 0;
-			std::vector< std::pair< NodeID, bool > > remainingNodes( numberOfNodes );
-			std::vector< double > nodePriority( numberOfNodes );
-			std::vector< _PriorityData > nodeData( numberOfNodes );
-
-			//initialize the variables
-		#pragma omp parallel for schedule ( guided )
-			for ( int x = 0; x < ( int ) numberOfNodes; ++x )
-				remainingNodes[x].first = x;
-			std::random_shuffle( remainingNodes.begin(), remainingNodes.end() );
-			for ( int x = 0; x < ( int ) numberOfNodes; ++x )
-				nodeData[remainingNodes[x].first].bias = x;
-
-			qDebug( "Initialise Elimination PQ... " );
-			_LogItem statistics0;
-			statistics0.updating = _Timestamp();
-			statistics0.iteration = 0;
-		#pragma omp parallel
-			{
-				_ThreadData* data = threadData[omp_get_thread_num()];
-		#pragma omp for schedule ( guided )
-				for ( int x = 0; x < ( int ) numberOfNodes; ++x ) {
-					nodePriority[x] = _Evaluate( data, &nodeData[x], x );
+			std::vector< std::pair< NodeID, bool > > remainingNodes;
+			std::vector< double > nodePriority;
+			std::vector< _PriorityData > nodeData;
+
+			if ( _resume && _ReadCheckpoint( &levelID, &iteration, &remainingNodes, &nodePriority, &nodeData ) ) {
+				qDebug( "resumed the contraction: %d of %d nodes contracted", levelID, numberOfNodes );
+				log.PrintHeader();
+			} else {
+				// state of an unusable checkpoint
+				if ( _spillFile.isOpen() ) {
+					_spillFile.resize( 0 );
+					_spillFile.seek( 0 );
 				}
-			}
-			qDebug( "done" );
+				_order.clear();
+				_rounds.clear();
+				_witnessPhase = 0;
+				remainingNodes.assign( numberOfNodes, std::make_pair( 0, false ) );
+				nodePriority.assign( numberOfNodes, 0 );
+				nodeData.assign( numberOfNodes, _PriorityData() );
+
+				//initialize the variables
+			#pragma omp parallel for schedule ( guided )
+				for ( int x = 0; x < ( int ) numberOfNodes; ++x )
+					remainingNodes[x].first = x;
+				std::random_shuffle( remainingNodes.begin(), remainingNodes.end() );
+				for ( int x = 0; x < ( int ) numberOfNodes; ++x )
+					nodeData[remainingNodes[x].first].bias = x;
+
+				qDebug( "Initialise Elimination PQ... " );
+				_witnessHops = _WitnessHops( remainingNodes );
+				_LogItem statistics0;
+				statistics0.updating = _Timestamp();
+				statistics0.iteration = 0;
+			#pragma omp parallel
+				{
+					_ThreadData* data = threadData[omp_get_thread_num()];
+			#pragma omp for schedule ( guided )
+					for ( int x = 0; x < ( int ) numberOfNodes; ++x ) {
+						nodePriority[x] = _Evaluate( data, &nodeData[x], x );
+					}
+				}
+				qDebug( "done" );
 
-			statistics0.updating = _Timestamp() - statistics0.updating;
-			log.Insert( statistics0 );
+				statistics0.updating = _Timestamp() - statistics0.updating;
+				statistics0.evaluations = numberOfNodes;
+				log.Insert( statistics0 );
 
-			log.PrintHeader();
-			statistics0.PrintStatistics();
+				log.PrintHeader();
+				statistics0.PrintStatistics();
+			}
+			double lastCheckpoint = _Timestamp();
+			long long shortcutEdges = 0;
 
 			while ( levelID < numberOfNodes ) {
 				_LogItem statistics;
 				statistics.iteration = iteration++;
 				const int last = ( int ) remainingNodes.size();
+				for ( int threadNum = 0; threadNum < maxThreads; ++threadNum )
+					threadData[threadNum]->evaluations = 0;
+
+				const unsigned witnessHops = _WitnessHops( remainingNodes );
+				if ( witnessHops != _witnessHops ) {
+					qDebug( "witness search hop limit: %d", witnessHops );
+					_witnessHops = witnessHops;
+				}
 
 				//determine independent node set
 				double timeLast = _Timestamp();
@@ -286,10 +379,64 @@ class Contractor {
 						remainingNodes[i].second = _IsIndependent( nodePriority, nodeData, data, node );
 					}
 				}
+				//lazy updates: recompute outdated priorities of the selected nodes, defer the ones no longer minimal in their neighbourhood
+				//the selected nodes are at least 3 hops apart => the recomputed priorities do not affect the other checks,
+				//deferring only shrinks the independent set => the remaining nodes stay independent
+				if ( _lazyUpdates ) {
+					int recomputed = 0;
+					int deferred = 0;
+					int dirty = 0;
+		#pragma omp parallel
+					{
+						_ThreadData* const data = threadData[omp_get_thread_num()];
+		#pragma omp for schedule ( guided ) reduction( + : recomputed, deferred, dirty )
+						for ( int i = 0; i < last; ++i ) {
+							const NodeID node = remainingNodes[i].first;
+							if ( nodeData[node].dirty )
+								dirty++;
+							if ( !remainingNodes[i].second || !nodeData[node].dirty )
+								continue;
+							nodePriority[node] = _Evaluate( data, &nodeData[node], node );
+							nodeData[node].dirty = false;
+							remainingNodes[i].second = _IsIndependent( nodePriority, nodeData, data, node );
+							recomputed++;
+							if ( !remainingNodes[i].second )
+								deferred++;
+						}
+					}
+					//most selected priorities were outdated or most remaining priorities are => recompute all of them,
+					//outdated priorities that are too high would otherwise never be selected and fixed
+					if ( 2 * deferred > recomputed || 2 * ( dirty - recomputed ) > last ) {
+		#pragma omp parallel
+						{
+							_ThreadData* const data = threadData[omp_get_thread_num()];
+		#pragma omp for schedule ( guided )
+							for ( int i = 0; i < last; ++i ) {
+								const NodeID node = remainingNodes[i].first;
+								if ( !nodeData[node].dirty )
+									continue;
+								nodePriority[node] = _Evaluate( data, &nodeData[node], node );
+								nodeData[node].dirty = false;
+							}
+						}
+		#pragma omp parallel
+						{
+							_ThreadData* const data = threadData[omp_get_thread_num()];
+		#pragma omp for schedule ( guided )
+							for ( int i = 0; i < last; ++i ) {
+								const NodeID node = remainingNodes[i].first;
+								remainingNodes[i].second = _IsIndependent( nodePriority, nodeData, data, node );
+							}
+						}
+					}
+				}
 				_NodePartitionor functor;
 				const std::vector < std::pair < NodeID, bool > >::const_iterator first = stable_partition( remainingNodes.begin(), remainingNodes.end(), functor );
 				const int firstIndependent = first - remainingNodes.begin();
 				statistics.nodes = last - firstIndependent;
+				for ( int position = firstIndependent; position < last; ++position )
+					_order.push_back( remainingNodes[position].first );
+				_rounds.push_back( last - firstIndependent );
 				statistics.independent += _Timestamp() - timeLast;
 				timeLast = _Timestamp();
 
@@ -327,6 +474,7 @@ class Contractor {
 						const _ImportEdge& edge = data.insertedEdges[i];
 						_graph->InsertEdge( edge.source, edge.target, edge.data );
 					}
+					shortcutEdges += data.insertedEdges.size();
 					std::vector< _ImportEdge >().swap( data.insertedEdges );
 				}
 				statistics.inserting += _Timestamp() - timeLast;
@@ -344,6 +492,10 @@ class Contractor {
 				}
 				statistics.updating += _Timestamp() - timeLast;
 				timeLast = _Timestamp();
+				for ( int threadNum = 0; threadNum < maxThreads; ++threadNum )
+					statistics.evaluations += threadData[threadNum]->evaluations;
+
+				_SpillContracted( remainingNodes.begin() + firstIndependent, remainingNodes.begin() + last );
 
 				//output some statistics
 				statistics.PrintStatistics();
@@ -354,6 +506,145 @@ class Contractor {
 				remainingNodes.resize( firstIndependent );
 				std::vector< std::pair< NodeID, bool > >( remainingNodes ).swap( remainingNodes );
 				log.Insert( statistics );
+
+				if ( !_checkpointFilename.isEmpty() && levelID < numberOfNodes && _Timestamp() - lastCheckpoint >= _checkpointInterval ) {
+					if ( !_WriteCheckpoint( levelID, iteration, remainingNodes, nodePriority, nodeData ) )
+						qWarning( "failed to write the checkpoint" );
+					lastCheckpoint = _Timestamp();
+				}
+			}
+			if ( !_checkpointFilename.isEmpty() ) {
+				QFile::remove( _checkpointFilename );
+				QFile::remove( _checkpointFilename + ".tmp" );
+			}
+
+			long long settledNodes = 0;
+			for ( int threadNum = 0; threadNum < maxThreads; threadNum++ ) {
+				_witnessList.insert( _witnessList.end(), threadData[threadNum]->witnessList.begin(), threadData[threadNum]->witnessList.end() );
+				settledNodes += threadData[threadNum]->settledNodes;
+				delete threadData[threadNum];
+			}
+
+			log.PrintSummary();
+			qDebug( "Witness Search: hop limit %d, %s updates", _hopLimit, _lazyUpdates ? "lazy" : "eager" );
+			qDebug( "Priority Evaluations: %u", log.GetSum().evaluations );
+			qDebug( "Settled Nodes: %lld", settledNodes );
+			qDebug( "Shortcut Edges: %lld", shortcutEdges );
+			qDebug( "Total Time: %lf s", log.GetSum().GetTotalTime() );
+
+		}
+
+		// contracts the nodes in the order of a previous run, e.g., to apply a new metric to an existing hierarchy
+		// skips the priority computation, only the witness searches are repeated
+		// the nodes of a round are contracted in parallel,
+		// nodes at most two hops away from an earlier node of their round are deferred like in _IsIndependent
+		bool RunWithOrder( const std::vector< NodeID >& order, const std::vector< unsigned >& rounds ) {
+			const NodeID numberOfNodes = _graph->GetNumberOfNodes();
+			if ( order.size() != numberOfNodes ) {
+				qCritical( "node order does not match the graph: %d nodes, %d ordered", numberOfNodes, ( int ) order.size() );
+				return false;
+			}
+			std::vector< unsigned > position( numberOfNodes, numberOfNodes );
+			for ( NodeID i = 0; i < numberOfNodes; ++i ) {
+				if ( order[i] >= numberOfNodes || position[order[i]] != numberOfNodes ) {
+					qCritical( "node order is not a permutation" );
+					return false;
+				}
+				position[order[i]] = i;
+			}
+			unsigned roundNodes = 0;
+			for ( unsigned round = 0; round < rounds.size(); ++round )
+				roundNodes += rounds[round];
+			if ( roundNodes != numberOfNodes ) {
+				qCritical( "contraction rounds do not match the node order" );
+				return false;
+			}
+
+			_LogData log;
+			int maxThreads = omp_get_max_threads();
+			std::vector < _ThreadData* > threadData;
+			for ( int threadNum = 0; threadNum < maxThreads; ++threadNum ) {
+				threadData.push_back( new _ThreadData( numberOfNodes ) );
+			}
+			qDebug( "%d nodes, %d edges", numberOfNodes, _graph->GetNumberOfEdges() );
+			qDebug( "using %d threads, %d rounds", maxThreads, ( int ) rounds.size() );
+			log.PrintHeader();
+
+			_order.clear();
+			_rounds.clear();
+			_witnessHops = 0;
+			NodeID iteration = 0;
+			NodeID begin = 0;
+			std::vector< std::pair< NodeID, bool > > remainingNodes;
+			for ( unsigned round = 0; round < rounds.size(); ++round ) {
+				remainingNodes.resize( rounds[round] );
+				for ( unsigned i = 0; i < rounds[round]; ++i )
+					remainingNodes[i].first = order[begin + i];
+				begin += rounds[round];
+
+				while ( !remainingNodes.empty() ) {
+					_LogItem statistics;
+					statistics.iteration = iteration++;
+					const int last = ( int ) remainingNodes.size();
+
+					// earlier rounds are contracted and no longer adjacent
+					double timeLast = _Timestamp();
+		#pragma omp parallel
+					{
+						_ThreadData* const data = threadData[omp_get_thread_num()];
+		#pragma omp for schedule ( guided )
+						for ( int i = 0; i < last; ++i ) {
+							const NodeID node = remainingNodes[i].first;
+							remainingNodes[i].second = _IsFirstInNeighbourhood( position, data, node );
+						}
+					}
+					_NodePartitionor functor;
+					const std::vector < std::pair < NodeID, bool > >::const_iterator first = stable_partition( remainingNodes.begin(), remainingNodes.end(), functor );
+					const int firstIndependent = first - remainingNodes.begin();
+					statistics.nodes = last - firstIndependent;
+					for ( int i = firstIndependent; i < last; ++i )
+						_order.push_back( remainingNodes[i].first );
+					_rounds.push_back( last - firstIndependent );
+					statistics.independent += _Timestamp() - timeLast;
+					timeLast = _Timestamp();
+
+		#pragma omp parallel
+					{
+						_ThreadData* const data = threadData[omp_get_thread_num()];
+		#pragma omp for schedule ( guided ) nowait
+						for ( int i = firstIndependent; i < last; ++i )
+							_Contract< false > ( data, remainingNodes[i].first );
+						std::sort( data->insertedEdges.begin(), data->insertedEdges.end() );
+					}
+					statistics.contraction += _Timestamp() - timeLast;
+					timeLast = _Timestamp();
+
+		#pragma omp parallel
+					{
+						_ThreadData* const data = threadData[omp_get_thread_num()];
+		#pragma omp for schedule ( guided ) nowait
+						for ( int i = firstIndependent; i < last; ++i )
+							_DeleteIncommingEdges( data, remainingNodes[i].first );
+					}
+					statistics.removing += _Timestamp() - timeLast;
+					timeLast = _Timestamp();
+
+					for ( int threadNum = 0; threadNum < maxThreads; ++threadNum ) {
+						_ThreadData& data = *threadData[threadNum];
+						for ( int i = 0; i < ( int ) data.insertedEdges.size(); ++i ) {
+							const _ImportEdge& edge = data.insertedEdges[i];
+							_graph->InsertEdge( edge.source, edge.target, edge.data );
+						}
+						std::vector< _ImportEdge >().swap( data.insertedEdges );
+					}
+					statistics.inserting += _Timestamp() - timeLast;
+
+					_SpillContracted( remainingNodes.begin() + firstIndependent, remainingNodes.begin() + last );
+
+					statistics.PrintStatistics();
+					remainingNodes.resize( firstIndependent );
+					log.Insert( statistics );
+				}
 			}
 
 			for ( int threadNum = 0; threadNum < maxThreads; threadNum++ ) {
@@ -363,30 +654,54 @@ class Contractor {
 
 			log.PrintSummary();
 			qDebug( "Total Time: %lf s", log.GetSum().GetTotalTime() );
+			return true;
+		}
 
+		// the nodes in the order of their contraction, grouped into rounds of nodes contracted in parallel
+		void GetOrder( std::vector< NodeID >* order, std::vector< unsigned >* rounds ) {
+			*order = _order;
+			*rounds = _rounds;
 		}
 
+		// in spill mode the spilled runs are merged by counting their edges per node first
 		template< class Edge >
-		void GetEdges( std::vector< Edge >* edges ) {
+		bool GetEdges( std::vector< Edge >* edges ) {
 			NodeID numberOfNodes = _graph->GetNumberOfNodes();
-			for ( NodeID node = 0; node < numberOfNodes; ++node ) {
-				for ( _DynamicGraph::EdgeIterator edge = _graph->BeginEdges( node ), endEdges = _graph->EndEdges( node ); edge != endEdges; ++edge ) {
-					const NodeID target = _graph->GetTarget( edge );
-					const _EdgeData& data = _graph->GetEdgeData( edge );
-					Edge newEdge;
-					newEdge.source = node;
-					newEdge.target = target;
-					newEdge.data.distance = data.distance;
-					newEdge.data.shortcut = data.shortcut;
-					if ( data.shortcut )
-						newEdge.data.middle = data.middle;
-					else
-						newEdge.data.id = data.id;
-					newEdge.data.forward = data.forward;
-					newEdge.data.backward = data.backward;
-					edges->push_back( newEdge );
+			if ( !_spillFile.isOpen() ) {
+				for ( NodeID node = 0; node < numberOfNodes; ++node ) {
+					for ( _DynamicGraph::EdgeIterator edge = _graph->BeginEdges( node ), endEdges = _graph->EndEdges( node ); edge != endEdges; ++edge )
+						edges->push_back( _ConvertEdge< Edge >( node, _graph->GetTarget( edge ), _graph->GetEdgeData( edge ) ) );
 				}
+				return true;
 			}
+
+			std::vector< unsigned > firstEdge( numberOfNodes + 1, 0 );
+			std::vector< _ImportEdge > buffer;
+			_spillFile.close();
+			if ( !openQFile( &_spillFile, QIODevice::ReadOnly ) ) {
+				qCritical( "failed to read the spilled edges" );
+				return false;
+			}
+			while ( _ReadSpilled( &buffer ) ) {
+				for ( unsigned i = 0; i < buffer.size(); ++i )
+					firstEdge[buffer[i].source + 1]++;
+			}
+			for ( NodeID node = 0; node < numberOfNodes; ++node )
+				firstEdge[node + 1] += firstEdge[node] + _graph->GetOutDegree( node );
+
+			const unsigned base = edges->size();
+			edges->resize( base + firstEdge[numberOfNodes] );
+			_spillFile.seek( 0 );
+			while ( _ReadSpilled( &buffer ) ) {
+				for ( unsigned i = 0; i < buffer.size(); ++i )
+					( *edges )[base + firstEdge[buffer[i].source]++] = _ConvertEdge< Edge >( buffer[i].source, buffer[i].target, buffer[i].data );
+			}
+			for ( NodeID node = 0; node < numberOfNodes; ++node ) {
+				for ( _DynamicGraph::EdgeIterator edge = _graph->BeginEdges( node ), endEdges = _graph->EndEdges( node ); edge != endEdges; ++edge )
+					( *edges )[base + firstEdge[node]++] = _ConvertEdge< Edge >( node, _graph->GetTarget( edge ), _graph->GetEdgeData( edge ) );
+			}
+			_spillFile.remove();
+			return true;
 		}
 
 		template< class Edge >
@@ -417,7 +732,8 @@ class Contractor {
 
 		bool _ConstructCH( _DynamicGraph* _graph );
 
-		void _Dijkstra( const unsigned maxDistance, const unsigned numTargets, const int maxNodes, _ThreadData* const data ){
+		// maxHops = 0 does not limit the amount of edges of a witness
+		void _Dijkstra( const unsigned maxDistance, const unsigned numTargets, const int maxNodes, const unsigned maxHops, _ThreadData* const data ){
 
 			_Heap& heap = data->heap;
 
@@ -426,6 +742,7 @@ class Contractor {
 			while ( heap.Size() > 0 ) {
 				const NodeID node = heap.DeleteMin();
 				const unsigned distance = heap.GetKey( node );
+				data->settledNodes++;
 				if ( nodes++ > maxNodes )
 					return;
 				//Destination settled?
@@ -436,6 +753,9 @@ class Contractor {
 					if ( targetsFound >= numTargets )
 						return;
 				}
+				const unsigned short hops = heap.GetData( node ).hops;
+				if ( maxHops != 0 && hops >= maxHops )
+					continue;
 
 				//iterate over all edges of node
 				for ( _DynamicGraph::EdgeIterator edge = _graph->BeginEdges( node ), endEdges = _graph->EndEdges( node ); edge != endEdges; ++edge ) {
@@ -447,11 +767,16 @@ class Contractor {
 
 					//New Node discovered -> Add to Heap + Node Info Storage
 					if ( !heap.WasInserted( to ) )
-						heap.Insert( to, toDistance, _HeapData() );
+						heap.Insert( to, toDistance, _HeapData( false, hops + 1 ) );
 
 					//Found a shorter Path -> Update distance
 					else if ( toDistance < heap.GetKey( to ) ) {
 						heap.DecreaseKey( to, toDistance );
+						heap.GetData( to ).hops = hops + 1;
+					}
+					//Found a path with less edges -> the edge order does not decide on the hops
+					else if ( toDistance == heap.GetKey( to ) && hops + 1 < heap.GetData( to ).hops ) {
+						heap.GetData( to ).hops = hops + 1;
 					}
 				}
 			}
@@ -459,6 +784,7 @@ class Contractor {
 
 		double _Evaluate( _ThreadData* const data, _PriorityData* const nodeData, NodeID node ){
 			_ContractionInformation stats;
+			data->evaluations++;
 
 			//perform simulated contraction
 			_Contract< true > ( data, node, &stats );
@@ -492,9 +818,9 @@ class Contractor {
 					continue;
 
 				heap.Clear();
-				heap.Insert( source, 0, _HeapData() );
+				heap.Insert( source, 0, _HeapData( false, 0 ) );
 				if ( node != source )
-					heap.Insert( node, inData.distance, _HeapData() );
+					heap.Insert( node, inData.distance, _HeapData( false, 1 ) );
 				unsigned maxDistance = 0;
 				unsigned numTargets = 0;
 
@@ -506,7 +832,7 @@ class Contractor {
 					const unsigned pathDistance = inData.distance + outData.distance;
 					maxDistance = std::max( maxDistance, pathDistance );
 					if ( !heap.WasInserted( target ) ) {
-						heap.Insert( target, pathDistance, _HeapData( true ) );
+						heap.Insert( target, pathDistance, _HeapData( true, 2 ) );
 						numTargets++;
 					} else if ( pathDistance < heap.GetKey( target ) ) {
 						heap.DecreaseKey( target, pathDistance );
@@ -514,9 +840,9 @@ class Contractor {
 				}
 
 				if ( Simulate )
-					_Dijkstra( maxDistance, numTargets, 500, data );
+					_Dijkstra( maxDistance, numTargets, 500, _witnessHops, data );
 				else
-					_Dijkstra( maxDistance, numTargets, 1000, data );
+					_Dijkstra( maxDistance, numTargets, 1000, _witnessHops, data );
 
 				for ( _DynamicGraph::EdgeIterator outEdge = _graph->BeginEdges( node ), endOutEdges = _graph->EndEdges( node ); outEdge != endOutEdges; ++outEdge ) {
 					const _EdgeData& outData = _graph->GetEdgeData( outEdge );
@@ -625,12 +951,35 @@ class Contractor {
 
 			for ( int i = 0, e = ( int ) neighbours.size(); i < e; ++i ) {
 				const NodeID u = neighbours[i];
-				( *priorities )[u] = _Evaluate( data, &( *nodeData )[u], u );
+				if ( _lazyUpdates )
+					( *nodeData )[u].dirty = true;
+				else
+					( *priorities )[u] = _Evaluate( data, &( *nodeData )[u], u );
 			}
 
 			return true;
 		}
 
+		// advances the witness search phase with the average degree of the remaining graph, returns its hop limit, 0 = unlimited
+		// the remaining graph gets denser with every round and needs longer witnesses to avoid superfluous shortcuts
+		unsigned _WitnessHops( const std::vector< std::pair< NodeID, bool > >& remainingNodes ) {
+			if ( _hopLimit == 0 )
+				return 0;
+			long long degree = 0;
+			for ( unsigned i = 0; i < remainingNodes.size(); ++i )
+				degree += _graph->GetOutDegree( remainingNodes[i].first );
+			const double averageDegree = ( double ) degree / std::max( ( int ) remainingNodes.size(), 1 );
+			if ( averageDegree >= 3.3 )
+				_witnessPhase = std::max( _witnessPhase, 1u );
+			if ( averageDegree >= 10 )
+				_witnessPhase = 2;
+			if ( _witnessPhase == 0 )
+				return _hopLimit;
+			if ( _witnessPhase == 1 )
+				return 2 * _hopLimit;
+			return 0;
+		}
+
 		bool _IsIndependent( const std::vector< double >& priorities, const std::vector< _PriorityData >& nodeData, _ThreadData* const data, NodeID node ) {
 			const double priority = priorities[node];
 
@@ -675,9 +1024,233 @@ class Contractor {
 		}
 
 
+		// the contracted nodes are no longer adjacent => only compares against the remaining nodes
+		bool _IsFirstInNeighbourhood( const std::vector< unsigned >& position, _ThreadData* const data, NodeID node ) {
+			std::vector< NodeID >& neighbours = data->neighbours;
+			neighbours.clear();
+
+			for ( _DynamicGraph::EdgeIterator e = _graph->BeginEdges( node ) ; e < _graph->EndEdges( node ) ; ++e ) {
+				const NodeID target = _graph->GetTarget( e );
+				if ( position[target] < position[node] )
+					return false;
+				neighbours.push_back( target );
+			}
+
+			std::sort( neighbours.begin(), neighbours.end() );
+			neighbours.resize( std::unique( neighbours.begin(), neighbours.end() ) - neighbours.begin() );
+
+			for ( std::vector< NodeID >::const_iterator i = neighbours.begin(), lastNode = neighbours.end(); i != lastNode; ++i ) {
+				for ( _DynamicGraph::EdgeIterator e = _graph->BeginEdges( *i ) ; e < _graph->EndEdges( *i ) ; ++e ) {
+					if ( position[_graph->GetTarget( e )] < position[node] )
+						return false;
+				}
+			}
+
+			return true;
+		}
+
+		template< class Edge >
+		static Edge _ConvertEdge( NodeID source, NodeID target, const _EdgeData& data ) {
+			Edge newEdge;
+			newEdge.source = source;
+			newEdge.target = target;
+			newEdge.data.distance = data.distance;
+			newEdge.data.shortcut = data.shortcut;
+			if ( data.shortcut )
+				newEdge.data.middle = data.middle;
+			else
+				newEdge.data.id = data.id;
+			newEdge.data.forward = data.forward;
+			newEdge.data.backward = data.backward;
+			return newEdge;
+		}
+
+		// contracted nodes keep their edges unchanged, they are only needed for the output
+		template< class NodeIterator >
+		void _SpillContracted( NodeIterator begin, NodeIterator end ) {
+			if ( !_spillFile.isOpen() )
+				return;
+			std::vector< NodeID > nodes;
+			for ( NodeIterator i = begin; i != end; ++i )
+				nodes.push_back( i->first );
+			std::sort( nodes.begin(), nodes.end() );
+
+			std::vector< _ImportEdge > run;
+			for ( unsigned i = 0; i < nodes.size(); ++i ) {
+				for ( _DynamicGraph::EdgeIterator edge = _graph->BeginEdges( nodes[i] ), endEdges = _graph->EndEdges( nodes[i] ); edge != endEdges; ++edge ) {
+					_ImportEdge newEdge;
+					newEdge.source = nodes[i];
+					newEdge.target = _graph->GetTarget( edge );
+					newEdge.data = _graph->GetEdgeData( edge );
+					run.push_back( newEdge );
+				}
+				_graph->DeleteAllEdges( nodes[i] );
+			}
+			if ( !run.empty() )
+				_spillFile.write( ( const char* ) &run[0], run.size() * sizeof( _ImportEdge ) );
+
+			// only worth it if most slots are unused, otherwise the remaining graph alone exceeds the threshold
+			if ( _graph->GetMemoryUsage() > _compactThreshold && 2 * ( quint64 ) _graph->GetNumberOfEdges() < _graph->GetNumberOfEdgeSlots() )
+				_graph->Compact();
+		}
+
+		// version, key, input checksum, number of nodes, number of input edges, contracted nodes, iteration, remaining nodes, order size, rounds size, witness search phase, spilled bytes
+		// | remaining nodes, priorities, priority data, order, rounds, number of remaining edges, remaining edges sorted by source
+		bool _WriteCheckpoint( NodeID levelID, NodeID iteration, const std::vector< std::pair< NodeID, bool > >& remainingNodes, const std::vector< double >& nodePriority, const std::vector< _PriorityData >& nodeData ) {
+			double time = _Timestamp();
+			_spillFile.flush();
+			QFile checkpointFile( _checkpointFilename + ".tmp" );
+			if ( !openQFile( &checkpointFile, QIODevice::WriteOnly ) )
+				return false;
+
+			const NodeID numberOfNodes = _graph->GetNumberOfNodes();
+			unsigned header[11] = { checkpointFileVersion, _checkpointKey, _inputChecksum, numberOfNodes, _inputEdges, levelID, iteration, ( unsigned ) remainingNodes.size(), ( unsigned ) _order.size(), ( unsigned ) _rounds.size(), _witnessPhase };
+			const qint64 spilled = _spillFile.pos();
+			checkpointFile.write( ( const char* ) header, sizeof( header ) );
+			checkpointFile.write( ( const char* ) &spilled, sizeof( spilled ) );
+			std::vector< NodeID > nodes( remainingNodes.size() );
+			for ( unsigned i = 0; i < remainingNodes.size(); ++i )
+				nodes[i] = remainingNodes[i].first;
+			_WriteVector( &checkpointFile, nodes );
+			_WriteVector( &checkpointFile, nodePriority );
+			_WriteVector( &checkpointFile, nodeData );
+			_WriteVector( &checkpointFile, _order );
+			_WriteVector( &checkpointFile, _rounds );
+
+			std::vector< _ImportEdge > edges;
+			for ( NodeID node = 0; node < numberOfNodes; ++node ) {
+				for ( _DynamicGraph::EdgeIterator edge = _graph->BeginEdges( node ), endEdges = _graph->EndEdges( node ); edge != endEdges; ++edge ) {
+					_ImportEdge newEdge;
+					newEdge.source = node;
+					newEdge.target = _graph->GetTarget( edge );
+					newEdge.data = _graph->GetEdgeData( edge );
+					edges.push_back( newEdge );
+				}
+			}
+			unsigned numberOfEdges = edges.size();
+			checkpointFile.write( ( const char* ) &numberOfEdges, sizeof( numberOfEdges ) );
+			_WriteVector( &checkpointFile, edges );
+			if ( checkpointFile.error() != QFile::NoError )
+				return false;
+			checkpointFile.close();
+
+			// an interruption before the rename leaves only the complete new checkpoint, _ReadCheckpoint falls back to it
+			QFile::remove( _checkpointFilename );
+			if ( !checkpointFile.rename( _checkpointFilename ) )
+				return false;
+			qDebug( "wrote checkpoint: %d nodes contracted, %d edges remaining, %lf s", levelID, numberOfEdges, _Timestamp() - time );
+			return true;
+		}
+
+		bool _ReadCheckpoint( NodeID* levelID, NodeID* iteration, std::vector< std::pair< NodeID, bool > >* remainingNodes, std::vector< double >* nodePriority, std::vector< _PriorityData >* nodeData ) {
+			QFile checkpointFile( _checkpointFilename );
+			if ( !checkpointFile.exists() )
+				checkpointFile.setFileName( _checkpointFilename + ".tmp" );
+			if ( !checkpointFile.open( QIODevice::ReadOnly ) ) {
+				qWarning( "no checkpoint to resume from, contracting from scratch" );
+				return false;
+			}
+			const NodeID numberOfNodes = _graph->GetNumberOfNodes();
+			unsigned header[11];
+			qint64 spilled = 0;
+			if ( checkpointFile.read( ( char* ) header, sizeof( header ) ) != sizeof( header ) || checkpointFile.read( ( char* ) &spilled, sizeof( spilled ) ) != sizeof( spilled ) ) {
+				qWarning( "checkpoint is truncated, contracting from scratch" );
+				return false;
+			}
+			if ( header[0] != checkpointFileVersion || header[1] != _checkpointKey || header[2] != _inputChecksum || header[3] != numberOfNodes || header[4] != _inputEdges ) {
+				qWarning( "checkpoint belongs to a different input, contracting from scratch" );
+				return false;
+			}
+			if ( spilled > _spillFile.size() ) {
+				qWarning( "spilled edges of the checkpoint are missing, contracting from scratch" );
+				return false;
+			}
+
+			// read completely before any state is replaced, a truncated checkpoint leaves the contractor untouched
+			std::vector< NodeID > nodes;
+			std::vector< double > priorities;
+			std::vector< _PriorityData > data;
+			std::vector< NodeID > order;
+			std::vector< unsigned > rounds;
+			std::vector< _ImportEdge > edges;
+			unsigned numberOfEdges = 0;
+			bool complete = _ReadVector( &checkpointFile, header[7], &nodes ) && _ReadVector( &checkpointFile, numberOfNodes, &priorities ) && _ReadVector( &checkpointFile, numberOfNodes, &data );
+			complete = complete && _ReadVector( &checkpointFile, header[8], &order ) && _ReadVector( &checkpointFile, header[9], &rounds );
+			complete = complete && checkpointFile.read( ( char* ) &numberOfEdges, sizeof( numberOfEdges ) ) == sizeof( numberOfEdges ) && _ReadVector( &checkpointFile, numberOfEdges, &edges );
+			if ( !complete ) {
+				qWarning( "checkpoint is truncated, contracting from scratch" );
+				return false;
+			}
+
+			*levelID = header[5];
+			*iteration = header[6];
+			_witnessPhase = header[10];
+			nodePriority->swap( priorities );
+			nodeData->swap( data );
+			_order.swap( order );
+			_rounds.swap( rounds );
+			remainingNodes->resize( nodes.size() );
+			for ( unsigned i = 0; i < nodes.size(); ++i )
+				( *remainingNodes )[i] = std::make_pair( nodes[i], false );
+			delete _graph;
+			_graph = new _DynamicGraph( numberOfNodes, edges );
+			_spillFile.resize( spilled );
+			_spillFile.seek( spilled );
+			return true;
+		}
+
+		// FNV-1a
+		void _AddChecksum( unsigned data ) {
+			for ( int byte = 0; byte < 4; byte++ ) {
+				_inputChecksum = ( _inputChecksum ^ ( data & 255 ) ) * 16777619u;
+				data >>= 8;
+			}
+		}
+
+		template< class T >
+		static void _WriteVector( QFile* file, const std::vector< T >& data ) {
+			if ( !data.empty() )
+				file->write( ( const char* ) &data[0], data.size() * sizeof( T ) );
+		}
+
+		template< class T >
+		static bool _ReadVector( QFile* file, unsigned size, std::vector< T >* data ) {
+			data->resize( size );
+			if ( size == 0 )
+				return true;
+			const qint64 bytes = ( qint64 ) size * sizeof( T );
+			return file->read( ( char* ) &( *data )[0], bytes ) == bytes;
+		}
+
+		// reads the next chunk of spilled edges
+		bool _ReadSpilled( std::vector< _ImportEdge >* buffer ) {
+			buffer->resize( 1 << 16 );
+			const qint64 bytes = _spillFile.read( ( char* ) &( *buffer )[0], buffer->size() * sizeof( _ImportEdge ) );
+			buffer->resize( std::max( bytes, ( qint64 ) 0 ) / sizeof( _ImportEdge ) );
+			return !buffer->empty();
+		}
+
 		_DynamicGraph* _graph;
+		// spill mode only
+		QFile _spillFile;
+		quint64 _compactThreshold;
+		QString _checkpointFilename;
+		double _checkpointInterval;
+		unsigned _checkpointKey;
+		bool _resume;
+		unsigned _inputEdges;
+		// identifies the input edges of a checkpoint
+		unsigned _inputChecksum;
+		static const unsigned checkpointFileVersion = 3;
+		// witness search
+		unsigned _hopLimit;
+		bool _lazyUpdates;
+		unsigned _witnessPhase;
+		unsigned _witnessHops;
 		std::vector< Witness > _witnessList;
 		std::vector< _ImportEdge > _loops;
+		std::vector< NodeID > _order;
+		std::vector< unsigned > _rounds;
 };
 
 #endif // CONTRACTOR_H_INCLUDED
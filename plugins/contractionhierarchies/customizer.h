@@ -0,0 +1,476 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CUSTOMIZER_H
+#define CUSTOMIZER_H
+
+#include "compressedgraph.h"
+#include "utils/qthelpers.h"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <vector>
+#include <QtDebug>
+
+// customizable hierarchy: the shortcuts only depend on the node order, their weights on the travel times of the original edges
+// the topology connects all upper neighbours of a node, in the order of the node IDs, the most important node has the smallest ID
+// every shortcut knows the middle nodes it can be unpacked with, customizing recomputes the weights bottom up without any witness search
+class Customizer {
+
+public:
+
+	typedef CompressedGraph::Edge Edge;
+	typedef CompressedGraph::NodeIterator NodeIterator;
+
+	// the settings of the graph builder, customizing rebuilds the module with them
+	struct BuildSettings {
+		unsigned blockSize;
+		unsigned unpackedNodes;
+		unsigned coreNodes;
+		// the block layout of the module, the other modules know the node IDs it results in
+		std::vector< unsigned > firstNodes;
+		BuildSettings() : blockSize( 12 ), unpackedNodes( 0 ), coreNodes( 0 ) {}
+	};
+
+	Customizer() : m_numNodes( 0 )
+	{
+	}
+
+	// computes a node order that only depends on the road graph: eliminates a node of minimum degree and connects its neighbours, repeatedly
+	// the nodes are numbered by level, the last level gets the smallest IDs, no two nodes of a level are connected
+	template< class InputEdge >
+	static void ComputeOrder( unsigned numNodes, const std::vector< InputEdge >& inputEdges, std::vector< NodeID >* map )
+	{
+		Timer time;
+		std::vector< std::vector< NodeID > > neighbours( numNodes );
+		for ( typename std::vector< InputEdge >::const_iterator i = inputEdges.begin(), iend = inputEdges.end(); i != iend; i++ ) {
+			if ( i->source == i->target )
+				continue;
+			neighbours[i->source].push_back( i->target );
+			neighbours[i->target].push_back( i->source );
+		}
+		typedef std::pair< unsigned, NodeID > Degree;
+		std::priority_queue< Degree, std::vector< Degree >, std::greater< Degree > > queue;
+		for ( NodeID node = 0; node < numNodes; node++ ) {
+			std::sort( neighbours[node].begin(), neighbours[node].end() );
+			neighbours[node].resize( std::unique( neighbours[node].begin(), neighbours[node].end() ) - neighbours[node].begin() );
+			queue.push( Degree( neighbours[node].size(), node ) );
+		}
+
+		// the level of a node is one above the levels of its eliminated neighbours
+		std::vector< unsigned > level( numNodes, 0 );
+		std::vector< bool > eliminated( numNodes, false );
+		std::vector< NodeID > merged;
+		while ( !queue.empty() ) {
+			const Degree degree = queue.top();
+			queue.pop();
+			const NodeID node = degree.second;
+			if ( eliminated[node] || degree.first != neighbours[node].size() )
+				continue;
+			eliminated[node] = true;
+			const std::vector< NodeID >& clique = neighbours[node];
+			for ( unsigned i = 0; i < clique.size(); i++ ) {
+				const NodeID neighbour = clique[i];
+				merged.clear();
+				std::set_union( neighbours[neighbour].begin(), neighbours[neighbour].end(), clique.begin(), clique.end(), std::back_inserter( merged ) );
+				merged.erase( std::remove( merged.begin(), merged.end(), neighbour ), merged.end() );
+				merged.erase( std::remove( merged.begin(), merged.end(), node ), merged.end() );
+				neighbours[neighbour].swap( merged );
+				level[neighbour] = std::max( level[neighbour], level[node] + 1 );
+				queue.push( Degree( neighbours[neighbour].size(), neighbour ) );
+			}
+			std::vector< NodeID >().swap( neighbours[node] );
+		}
+
+		std::vector< std::pair< unsigned, NodeID > > order( numNodes );
+		for ( NodeID node = 0; node < numNodes; node++ )
+			order[node] = std::make_pair( level[node], node );
+		std::sort( order.begin(), order.end() );
+		map->resize( numNodes );
+		for ( NodeID position = 0; position < numNodes; position++ )
+			( *map )[order[position].second] = numNodes - 1 - position;
+		qDebug() << "computed customizable node order:" << time.elapsed() << "ms";
+	}
+
+	// edges: the original edges, their source is the less important node
+	void BuildTopology( unsigned numNodes, const std::vector< Edge >& edges )
+	{
+		Timer time;
+		m_numNodes = numNodes;
+
+		// connect the upper neighbours of every node in the order of contraction
+		// it suffices to pass them to the least important one among them, it connects them in turn
+		std::vector< std::vector< NodeIterator > > upper( numNodes );
+		for ( unsigned edge = 0; edge < edges.size(); edge++ ) {
+			if ( edges[edge].data.shortcut || edges[edge].source == edges[edge].target )
+				continue;
+			assert( edges[edge].source > edges[edge].target );
+			upper[edges[edge].source].push_back( edges[edge].target );
+		}
+		for ( NodeIterator node = numNodes; node-- != 0; ) {
+			std::vector< NodeIterator >& neighbours = upper[node];
+			std::sort( neighbours.begin(), neighbours.end() );
+			neighbours.resize( std::unique( neighbours.begin(), neighbours.end() ) - neighbours.begin() );
+			if ( neighbours.empty() )
+				continue;
+			std::vector< NodeIterator >& next = upper[neighbours.back()];
+			next.insert( next.end(), neighbours.begin(), neighbours.end() - 1 );
+		}
+
+		m_firstArc.resize( numNodes + 1 );
+		m_arcTarget.clear();
+		for ( NodeIterator node = 0; node < numNodes; node++ ) {
+			m_firstArc[node] = m_arcTarget.size();
+			m_arcTarget.insert( m_arcTarget.end(), upper[node].begin(), upper[node].end() );
+			std::vector< NodeIterator >().swap( upper[node] );
+		}
+		m_firstArc[numNodes] = m_arcTarget.size();
+
+		// every pair of arcs of a node spans a triangle with the arc between their targets
+		m_firstTriangle.assign( m_arcTarget.size() + 1, 0 );
+		for ( int pass = 0; pass < 2; pass++ ) {
+			if ( pass == 1 ) {
+				for ( unsigned arc = 0; arc < m_arcTarget.size(); arc++ )
+					m_firstTriangle[arc + 1] += m_firstTriangle[arc];
+				m_triangles.resize( m_firstTriangle.back() );
+			}
+			std::vector< unsigned > position( m_firstTriangle.begin(), m_firstTriangle.end() - 1 );
+			for ( NodeIterator middle = 0; middle < numNodes; middle++ ) {
+				for ( unsigned targetArc = m_firstArc[middle]; targetArc < m_firstArc[middle + 1]; targetArc++ ) {
+					for ( unsigned sourceArc = targetArc + 1; sourceArc < m_firstArc[middle + 1]; sourceArc++ ) {
+						const unsigned arc = findArc( m_arcTarget[sourceArc], m_arcTarget[targetArc] );
+						assert( arc != m_arcTarget.size() );
+						if ( pass == 0 ) {
+							m_firstTriangle[arc + 1]++;
+							continue;
+						}
+						Triangle& triangle = m_triangles[position[arc]++];
+						triangle.middle = middle;
+						triangle.sourceArc = sourceArc;
+						triangle.targetArc = targetArc;
+					}
+				}
+			}
+		}
+
+		computeLevels();
+		qDebug() << "built customizable topology:" << m_arcTarget.size() << "arcs," << m_triangles.size() << "triangles," << m_firstLevel.size() - 1 << "levels:" << time.elapsed() << "ms";
+	}
+
+	// version, number of nodes, number of arcs, number of triangles, block size, unpacked nodes, core nodes, number of blocks
+	// | first node per block | first arc per node | arc targets | first triangle per arc | triangles
+	bool Write( QString filename ) const
+	{
+		QFile topologyFile( filename );
+		if ( !openQFile( &topologyFile, QIODevice::WriteOnly ) )
+			return false;
+		unsigned header[8] = { topologyFileVersion, m_numNodes, ( unsigned ) m_arcTarget.size(), ( unsigned ) m_triangles.size(),
+									  m_settings.blockSize, m_settings.unpackedNodes, m_settings.coreNodes, ( unsigned ) m_settings.firstNodes.size() - 1 };
+		topologyFile.write( ( const char* ) header, sizeof( header ) );
+		writeVector( &topologyFile, m_settings.firstNodes );
+		writeVector( &topologyFile, m_firstArc );
+		writeVector( &topologyFile, m_arcTarget );
+		writeVector( &topologyFile, m_firstTriangle );
+		writeVector( &topologyFile, m_triangles );
+		qDebug() << "wrote customizable topology:" << topologyFile.size() / 1024 / 1024 << "MB";
+		return true;
+	}
+
+	bool Read( QString filename, unsigned numNodes )
+	{
+		QFile topologyFile( filename );
+		if ( !openQFile( &topologyFile, QIODevice::ReadOnly ) )
+			return false;
+		unsigned header[8];
+		if ( topologyFile.read( ( char* ) header, sizeof( header ) ) != sizeof( header ) || header[0] != topologyFileVersion ) {
+			qCritical() << "customizable topology format not compatible:" << filename;
+			return false;
+		}
+		if ( header[1] != numNodes ) {
+			qCritical() << "customizable topology belongs to a different graph:" << filename;
+			return false;
+		}
+		m_numNodes = header[1];
+		m_settings.blockSize = header[4];
+		m_settings.unpackedNodes = header[5];
+		m_settings.coreNodes = header[6];
+		bool ok = readVector( &topologyFile, header[7] + 1, &m_settings.firstNodes );
+		ok = ok && readVector( &topologyFile, m_numNodes + 1, &m_firstArc );
+		ok = ok && readVector( &topologyFile, header[2], &m_arcTarget );
+		ok = ok && readVector( &topologyFile, header[2] + 1, &m_firstTriangle );
+		ok = ok && readVector( &topologyFile, header[3], &m_triangles );
+		ok = ok && m_firstArc.back() == m_arcTarget.size() && m_firstTriangle.back() == m_triangles.size();
+		if ( !ok ) {
+			qCritical() << "customizable topology corrupted:" << filename;
+			return false;
+		}
+		computeLevels();
+		return true;
+	}
+
+	void SetBuildSettings( const BuildSettings& settings )
+	{
+		m_settings = settings;
+	}
+
+	const BuildSettings& GetBuildSettings() const
+	{
+		return m_settings;
+	}
+
+	// computes the shortcut weights from the original edges of edges, drops the shortcuts of a previous run
+	// keeps the original edges in their order, their IDs among the parallel edges do not change
+	// appends the shortcuts faster than the original edges between the same nodes, edges stay grouped by source
+	// leaves out the shortcuts with a shorter path over more important nodes unless allShortcuts is set
+	bool Run( std::vector< Edge >* edges, bool allShortcuts = false )
+	{
+		Timer time;
+		const unsigned infinity = std::numeric_limits< unsigned >::max();
+		const unsigned numArcs = m_arcTarget.size();
+		m_forward.assign( numArcs, infinity );
+		m_backward.assign( numArcs, infinity );
+		m_forwardMiddle.assign( numArcs, m_numNodes );
+		m_backwardMiddle.assign( numArcs, m_numNodes );
+
+		std::vector< Edge > originalEdges;
+		originalEdges.reserve( edges->size() );
+		for ( unsigned edge = 0; edge < edges->size(); edge++ ) {
+			const Edge& original = ( *edges )[edge];
+			if ( original.data.shortcut )
+				continue;
+			originalEdges.push_back( original );
+			if ( original.source == original.target )
+				continue;
+			const unsigned arc = original.source < m_numNodes && original.target < original.source ? findArc( original.source, original.target ) : numArcs;
+			if ( arc == numArcs ) {
+				qCritical() << "customizable topology does not match the graph, missing arc:" << original.source << original.target;
+				return false;
+			}
+			if ( original.data.forward )
+				m_forward[arc] = std::min( m_forward[arc], original.data.distance );
+			if ( original.data.backward )
+				m_backward[arc] = std::min( m_backward[arc], original.data.distance );
+		}
+		std::vector< Edge >().swap( *edges );
+		std::stable_sort( originalEdges.begin(), originalEdges.end(), compareSource );
+
+		// the arcs of a node only depend on the arcs of less important nodes, which belong to lower levels
+		for ( unsigned level = 0; level + 1 < m_firstLevel.size(); level++ ) {
+			const int begin = m_firstLevel[level];
+			const int end = m_firstLevel[level + 1];
+#pragma omp parallel for schedule( dynamic, 64 )
+			for ( int i = begin; i < end; i++ )
+				customizeNode( m_levelNodes[i] );
+		}
+		qDebug() << "customized" << numArcs << "arcs:" << time.restart() << "ms";
+
+		// the arcs of more important nodes belong to higher levels and already know their shortest paths
+		m_exactForward = m_forward;
+		m_exactBackward = m_backward;
+		for ( unsigned level = m_firstLevel.size() - 1; level-- != 0; ) {
+			const int begin = m_firstLevel[level];
+			const int end = m_firstLevel[level + 1];
+#pragma omp parallel for schedule( dynamic, 64 )
+			for ( int i = begin; i < end; i++ )
+				findShorterPaths( m_levelNodes[i] );
+		}
+		qDebug() << "searched shorter paths over more important nodes:" << time.restart() << "ms";
+
+		unsigned shortcuts = 0;
+		edges->reserve( originalEdges.size() + numArcs );
+		std::vector< Edge >::const_iterator original = originalEdges.begin();
+		for ( NodeIterator node = 0; node < m_numNodes; node++ ) {
+			for ( ; original != originalEdges.end() && original->source == node; original++ )
+				edges->push_back( *original );
+			for ( unsigned arc = m_firstArc[node]; arc < m_firstArc[node + 1]; arc++ ) {
+				// a shortcut with a shorter path between its nodes is never part of a shortest path
+				const bool forward = m_forwardMiddle[arc] != m_numNodes && ( allShortcuts || m_exactForward[arc] == m_forward[arc] );
+				const bool backward = m_backwardMiddle[arc] != m_numNodes && ( allShortcuts || m_exactBackward[arc] == m_backward[arc] );
+				if ( forward && backward && m_forward[arc] == m_backward[arc] && m_forwardMiddle[arc] == m_backwardMiddle[arc] ) {
+					edges->push_back( shortcut( node, arc, m_forward[arc], m_forwardMiddle[arc], true, true ) );
+					shortcuts++;
+					continue;
+				}
+				if ( forward ) {
+					edges->push_back( shortcut( node, arc, m_forward[arc], m_forwardMiddle[arc], true, false ) );
+					shortcuts++;
+				}
+				if ( backward ) {
+					edges->push_back( shortcut( node, arc, m_backward[arc], m_backwardMiddle[arc], false, true ) );
+					shortcuts++;
+				}
+			}
+		}
+		qDebug() << "customization:" << originalEdges.size() << "original edges," << shortcuts << "shortcuts";
+		std::vector< unsigned >().swap( m_exactForward );
+		std::vector< unsigned >().swap( m_exactBackward );
+		return true;
+	}
+
+private:
+
+	static const unsigned topologyFileVersion = 1;
+
+	// the arcs between the middle node and the source / target of an arc
+	// the middle node is less important than both
+	struct Triangle {
+		NodeIterator middle;
+		unsigned sourceArc;
+		unsigned targetArc;
+	};
+
+	static bool compareSource( const Edge& left, const Edge& right )
+	{
+		return left.source < right.source;
+	}
+
+	template< class T >
+	static void writeVector( QFile* file, const std::vector< T >& data )
+	{
+		if ( !data.empty() )
+			file->write( ( const char* ) &data[0], data.size() * sizeof( T ) );
+	}
+
+	template< class T >
+	static bool readVector( QFile* file, unsigned size, std::vector< T >* data )
+	{
+		data->resize( size );
+		if ( size == 0 )
+			return true;
+		const qint64 bytes = ( qint64 ) size * sizeof( T );
+		return file->read( ( char* ) &( *data )[0], bytes ) == bytes;
+	}
+
+	// the arc from source to the more important target, the number of arcs if there is none
+	unsigned findArc( NodeIterator source, NodeIterator target ) const
+	{
+		std::vector< NodeIterator >::const_iterator begin = m_arcTarget.begin() + m_firstArc[source];
+		std::vector< NodeIterator >::const_iterator end = m_arcTarget.begin() + m_firstArc[source + 1];
+		std::vector< NodeIterator >::const_iterator arc = std::lower_bound( begin, end, target );
+		if ( arc == end || *arc != target )
+			return m_arcTarget.size();
+		return arc - m_arcTarget.begin();
+	}
+
+	// a node's level is one above the highest level of the less important nodes connected to it
+	void computeLevels()
+	{
+		std::vector< unsigned > level( m_numNodes, 0 );
+		unsigned levels = m_numNodes == 0 ? 0 : 1;
+		for ( NodeIterator node = m_numNodes; node-- != 0; ) {
+			for ( unsigned arc = m_firstArc[node]; arc < m_firstArc[node + 1]; arc++ )
+				level[m_arcTarget[arc]] = std::max( level[m_arcTarget[arc]], level[node] + 1 );
+			levels = std::max( levels, level[node] + 1 );
+		}
+		m_firstLevel.assign( levels + 1, 0 );
+		for ( NodeIterator node = 0; node < m_numNodes; node++ )
+			m_firstLevel[level[node] + 1]++;
+		for ( unsigned i = 0; i < levels; i++ )
+			m_firstLevel[i + 1] += m_firstLevel[i];
+		m_levelNodes.resize( m_numNodes );
+		std::vector< unsigned > position( m_firstLevel.begin(), m_firstLevel.end() - 1 );
+		for ( NodeIterator node = 0; node < m_numNodes; node++ )
+			m_levelNodes[position[level[node]]++] = node;
+	}
+
+	// forward: source -> middle -> target, backward: target -> middle -> source
+	void customizeNode( NodeIterator node )
+	{
+		const unsigned infinity = std::numeric_limits< unsigned >::max();
+		for ( unsigned arc = m_firstArc[node]; arc < m_firstArc[node + 1]; arc++ ) {
+			for ( unsigned i = m_firstTriangle[arc]; i < m_firstTriangle[arc + 1]; i++ ) {
+				const Triangle& triangle = m_triangles[i];
+				const unsigned toSource = m_forward[triangle.sourceArc];
+				const unsigned fromSource = m_backward[triangle.sourceArc];
+				const unsigned toTarget = m_forward[triangle.targetArc];
+				const unsigned fromTarget = m_backward[triangle.targetArc];
+				if ( fromSource != infinity && toTarget != infinity && fromSource + toTarget < m_forward[arc] ) {
+					m_forward[arc] = fromSource + toTarget;
+					m_forwardMiddle[arc] = triangle.middle;
+				}
+				if ( fromTarget != infinity && toSource != infinity && fromTarget + toSource < m_backward[arc] ) {
+					m_backward[arc] = fromTarget + toSource;
+					m_backwardMiddle[arc] = triangle.middle;
+				}
+			}
+		}
+	}
+
+	// forward: node -> via -> target, backward: target -> via -> node
+	// the arc between the two more important nodes already has its shortest path, the arcs of node might still improve
+	void findShorterPaths( NodeIterator node )
+	{
+		const unsigned infinity = std::numeric_limits< unsigned >::max();
+		for ( unsigned arc = m_firstArc[node]; arc < m_firstArc[node + 1]; arc++ ) {
+			const NodeIterator target = m_arcTarget[arc];
+			for ( unsigned viaArc = m_firstArc[node]; viaArc < m_firstArc[node + 1]; viaArc++ ) {
+				const NodeIterator via = m_arcTarget[viaArc];
+				if ( via == target )
+					continue;
+				const unsigned between = via > target ? findArc( via, target ) : findArc( target, via );
+				const unsigned viaToTarget = via > target ? m_exactForward[between] : m_exactBackward[between];
+				const unsigned targetToVia = via > target ? m_exactBackward[between] : m_exactForward[between];
+				const unsigned toVia = m_exactForward[viaArc];
+				const unsigned fromVia = m_exactBackward[viaArc];
+				if ( toVia != infinity && viaToTarget != infinity && toVia + viaToTarget < m_exactForward[arc] )
+					m_exactForward[arc] = toVia + viaToTarget;
+				if ( targetToVia != infinity && fromVia != infinity && targetToVia + fromVia < m_exactBackward[arc] )
+					m_exactBackward[arc] = targetToVia + fromVia;
+			}
+		}
+	}
+
+	Edge shortcut( NodeIterator source, unsigned arc, unsigned distance, NodeIterator middle, bool forward, bool backward ) const
+	{
+		Edge edge;
+		edge.source = source;
+		edge.target = m_arcTarget[arc];
+		edge.data.distance = distance;
+		edge.data.shortcut = true;
+		edge.data.forward = forward;
+		edge.data.backward = backward;
+		edge.data.unpacked = false;
+		edge.data.reversed = false;
+		edge.data.middle = middle;
+		edge.data.path = 0;
+		return edge;
+	}
+
+	BuildSettings m_settings;
+	unsigned m_numNodes;
+	// arcs from a node to its more important neighbours, sorted by target
+	std::vector< unsigned > m_firstArc;
+	std::vector< NodeIterator > m_arcTarget;
+	std::vector< unsigned > m_firstTriangle;
+	std::vector< Triangle > m_triangles;
+	// nodes sorted by level
+	std::vector< unsigned > m_firstLevel;
+	std::vector< NodeIterator > m_levelNodes;
+	// customized weights, a middle node equal to the number of nodes marks the original edges
+	std::vector< unsigned > m_forward;
+	std::vector< unsigned > m_backward;
+	std::vector< NodeIterator > m_forwardMiddle;
+	std::vector< NodeIterator > m_backwardMiddle;
+	// shortest paths between the nodes of an arc, also over more important nodes
+	std::vector< unsigned > m_exactForward;
+	std::vector< unsigned > m_exactBackward;
+};
+
+#endif // CUSTOMIZER_H
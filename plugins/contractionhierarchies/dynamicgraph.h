@@ -187,6 +187,41 @@ class DynamicGraph {
 			return deleted;
 		}
 
+		//removes all edges of a node, their slots stay allocated until Compact
+		//InsertEdge does not reuse them => the order of the other adjacency lists does not change
+		void DeleteAllEdges( const NodeIterator source )
+		{
+			Node &node = m_nodes[source];
+			m_numEdges -= node.edges;
+			node.edges = 0;
+		}
+
+		//edge slots including the unused ones
+		unsigned GetNumberOfEdgeSlots() const
+		{
+			return m_edges.size();
+		}
+
+		//bytes allocated for nodes and edge slots
+		quint64 GetMemoryUsage() const
+		{
+			return ( quint64 ) m_nodes.capacity() * sizeof( Node ) + ( quint64 ) m_edges.capacity() * sizeof( Edge );
+		}
+
+		//moves the edges together, frees the slots of deleted edges. Invalidates all edge iterators
+		void Compact()
+		{
+			std::vector< Edge > edges;
+			edges.reserve( m_numEdges * 1.2 );
+			for ( NodeIterator node = 0; node < m_numNodes; ++node ) {
+				const EdgeIterator firstEdge = edges.size();
+				edges.insert( edges.end(), m_edges.begin() + m_nodes[node].firstEdge, m_edges.begin() + m_nodes[node].firstEdge + m_nodes[node].edges );
+				m_nodes[node].firstEdge = firstEdge;
+			}
+			m_edges.swap( edges );
+			qDebug() << "Contraction Hiearchies: compacted graph:" << m_numEdges << m_edges.size() << m_edges.capacity();
+		}
+
 		//searches for a specific edge
 		EdgeIterator FindEdge( const NodeIterator &from, const NodeIterator &to ) const
 		{
@@ -0,0 +1,217 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FREQUENCYCACHE_H_INCLUDED
+#define FREQUENCYCACHE_H_INCLUDED
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <vector>
+
+// keeps the most frequently accessed entries within a memory budget
+// keys are dense, e.g., block ids
+// Entry must have member function / variables:
+// function size_t bytes() const => memory used by the entry
+// copy constructor
+// not thread-safe: every access updates the access counts,
+// threads have to use their own cache
+template< class Entry >
+class FrequencyCache {
+
+public:
+
+	FrequencyCache()
+	{
+		m_budget = 0;
+		m_bytes = 0;
+		m_minimumAccesses = 0;
+		m_victimCount = 0;
+		m_lastKey = std::numeric_limits< unsigned >::max();
+	}
+
+	~FrequencyCache()
+	{
+		unload();
+	}
+
+	// a key has to be accessed minimumAccesses times before it is cached
+	// budget == 0 disables the cache
+	void load( unsigned numberOfKeys, size_t budget, unsigned minimumAccesses )
+	{
+		unload();
+		m_budget = budget;
+		m_minimumAccesses = minimumAccesses;
+		if ( m_budget == 0 )
+			return;
+		m_counts.assign( numberOfKeys, 0 );
+		m_slots.assign( numberOfKeys, -1 );
+	}
+
+	void unload()
+	{
+		for ( unsigned slot = 0; slot < m_entries.size(); slot++ )
+			delete m_entries[slot];
+		std::vector< Entry* >().swap( m_entries );
+		std::vector< unsigned >().swap( m_keys );
+		std::vector< int >().swap( m_free );
+		std::vector< unsigned short >().swap( m_counts );
+		std::vector< int >().swap( m_slots );
+		m_budget = 0;
+		m_bytes = 0;
+		m_victimCount = 0;
+		m_lastKey = std::numeric_limits< unsigned >::max();
+	}
+
+	bool enabled() const
+	{
+		return m_budget != 0;
+	}
+
+	size_t bytes() const
+	{
+		return m_bytes;
+	}
+
+	// the accessed keys, most frequently accessed first
+	void hottest( std::vector< unsigned >* keys ) const
+	{
+		std::vector< std::pair< unsigned, unsigned > > accessed;
+		for ( unsigned key = 0; key < m_counts.size(); key++ ) {
+			if ( m_counts[key] != 0 )
+				accessed.push_back( std::make_pair( std::numeric_limits< unsigned short >::max() - m_counts[key], key ) );
+		}
+		std::sort( accessed.begin(), accessed.end() );
+		keys->clear();
+		for ( unsigned i = 0; i < accessed.size(); i++ )
+			keys->push_back( accessed[i].second );
+	}
+
+	// counts an access, returns the key's entry or NULL if it is not cached
+	// the returned entry stays valid until the next entry is returned
+	const Entry* find( unsigned key )
+	{
+		assert( key < m_counts.size() );
+		if ( m_counts[key] == std::numeric_limits< unsigned short >::max() )
+			age();
+		m_counts[key]++;
+		const int slot = m_slots[key];
+		if ( slot == -1 )
+			return NULL;
+		m_lastKey = key;
+		return m_entries[slot];
+	}
+
+	// is an uncached key accessed more often than the least frequently accessed entry?
+	bool admit( unsigned key )
+	{
+		assert( m_slots[key] == -1 );
+		const unsigned count = m_counts[key];
+		if ( count < m_minimumAccesses )
+			return false;
+		if ( m_bytes < m_budget )
+			return true;
+		// the counts of cached entries only increase => the stored victim count is a lower bound
+		if ( count <= m_victimCount )
+			return false;
+		const int slot = victim();
+		if ( slot == -1 )
+			return false;
+		m_victimCount = m_counts[m_keys[slot]];
+		return count > m_victimCount;
+	}
+
+	// caches a copy of the entry, evicts the least frequently accessed entries until it fits into the budget
+	// returns NULL if it exceeds the budget on its own
+	const Entry* insert( unsigned key, const Entry& entry )
+	{
+		assert( m_slots[key] == -1 );
+		const size_t bytes = entry.bytes();
+		if ( bytes > m_budget )
+			return NULL;
+		while ( m_bytes + bytes > m_budget ) {
+			const int slot = victim();
+			if ( slot == -1 )
+				return NULL;
+			evict( slot );
+		}
+
+		int slot;
+		if ( !m_free.empty() ) {
+			slot = m_free.back();
+			m_free.pop_back();
+		} else {
+			slot = m_entries.size();
+			m_entries.push_back( NULL );
+			m_keys.push_back( 0 );
+		}
+		m_entries[slot] = new Entry( entry );
+		m_keys[slot] = key;
+		m_slots[key] = slot;
+		m_bytes += bytes;
+		m_victimCount = std::min( m_victimCount, ( unsigned ) m_counts[key] );
+		m_lastKey = key;
+		return m_entries[slot];
+	}
+
+private:
+
+	// least frequently accessed entry, except for the last one returned
+	int victim() const
+	{
+		int result = -1;
+		for ( unsigned slot = 0; slot < m_entries.size(); slot++ ) {
+			if ( m_entries[slot] == NULL || m_keys[slot] == m_lastKey )
+				continue;
+			if ( result == -1 || m_counts[m_keys[slot]] < m_counts[m_keys[result]] )
+				result = slot;
+		}
+		return result;
+	}
+
+	void evict( int slot )
+	{
+		m_bytes -= m_entries[slot]->bytes();
+		m_slots[m_keys[slot]] = -1;
+		delete m_entries[slot];
+		m_entries[slot] = NULL;
+		m_free.push_back( slot );
+	}
+
+	// halves all counts => recent accesses weigh more than old ones
+	void age()
+	{
+		for ( unsigned key = 0; key < m_counts.size(); key++ )
+			m_counts[key] >>= 1;
+		m_victimCount >>= 1;
+	}
+
+	std::vector< Entry* > m_entries;
+	std::vector< unsigned > m_keys;
+	std::vector< int > m_free;
+	std::vector< unsigned short > m_counts;
+	std::vector< int > m_slots;
+	size_t m_budget;
+	size_t m_bytes;
+	unsigned m_minimumAccesses;
+	unsigned m_victimCount;
+	unsigned m_lastKey;
+};
+
+#endif // FREQUENCYCACHE_H_INCLUDED
@@ -0,0 +1,138 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MAPPEDBLOCKS_H_INCLUDED
+#define MAPPEDBLOCKS_H_INCLUDED
+
+#include <QFile>
+#include <QtDebug>
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// alternative to BlockCache: maps the whole file into memory
+// and loads all blocks in advance
+// Block must have member function / variables:
+// variable id => block id
+// function void load( const unsigned char* buffer )
+// read-only after loading => can be shared by any number of threads
+template< class Block >
+class MappedBlocks {
+
+public:
+
+	MappedBlocks()
+	{
+		m_data = NULL;
+		m_size = 0;
+		m_blockSize = 0;
+	}
+
+	~MappedBlocks()
+	{
+		unload();
+	}
+
+	bool load( const QString& filename, unsigned blockSize )
+	{
+		unload();
+		m_inputFile.setFileName( filename );
+		if ( !m_inputFile.open( QIODevice::ReadOnly ) ) {
+			qCritical() << "failed to open file:" << m_inputFile.fileName();
+			return false;
+		}
+
+		qint64 size = m_inputFile.size();
+		m_size = size;
+		m_blockSize = blockSize;
+		if ( size == 0 )
+			return true;
+		m_data = m_inputFile.map( 0, size );
+		if ( m_data == NULL ) {
+			qCritical() << "failed to map file:" << m_inputFile.fileName();
+			m_inputFile.close();
+			return false;
+		}
+
+		unsigned blockCount = ( size + blockSize - 1 ) / blockSize;
+		m_blocks.resize( blockCount );
+		for ( unsigned block = 0; block < blockCount; block++ )
+			m_blocks[block].load( block, m_data + ( qint64 ) block * blockSize );
+
+		return true;
+	}
+
+	void unload()
+	{
+		if ( m_data != NULL )
+			m_inputFile.unmap( m_data );
+		m_data = NULL;
+		m_size = 0;
+		m_inputFile.close();
+		std::vector< Block >().swap( m_blocks );
+	}
+
+	// asks the operating system to read the blocks into the page cache in the background
+	// adjacent blocks are advised together, the order of the blocks does not matter
+	void prefetch( const std::vector< unsigned >& blocks ) const
+	{
+#ifdef Q_OS_UNIX
+		if ( m_data == NULL )
+			return;
+		std::vector< unsigned > sorted( blocks );
+		std::sort( sorted.begin(), sorted.end() );
+		sorted.erase( std::unique( sorted.begin(), sorted.end() ), sorted.end() );
+		const qint64 pageSize = sysconf( _SC_PAGESIZE );
+		for ( unsigned first = 0, end = 0; first < sorted.size(); first = end ) {
+			end = first + 1;
+			while ( end < sorted.size() && sorted[end] == sorted[end - 1] + 1 )
+				end++;
+			// the advised range has to start at a page boundary
+			const qint64 begin = ( qint64 ) sorted[first] * m_blockSize / pageSize * pageSize;
+			const qint64 last = std::min( ( qint64 ) sorted[end - 1] * m_blockSize + m_blockSize, m_size );
+			if ( begin < last )
+				posix_madvise( m_data + begin, last - begin, POSIX_MADV_WILLNEED );
+		}
+#else
+		Q_UNUSED( blocks );
+#endif
+	}
+
+	const Block* getBlock( unsigned block ) const
+	{
+		assert( block < m_blocks.size() );
+		return &m_blocks[block];
+	}
+
+private:
+
+	unsigned char* m_data;
+	qint64 m_size;
+	unsigned m_blockSize;
+	std::vector< Block > m_blocks;
+	QFile m_inputFile;
+
+};
+
+#endif // MAPPEDBLOCKS_H_INCLUDED
@@ -0,0 +1,304 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TURNTABLE_H_INCLUDED
+#define TURNTABLE_H_INCLUDED
+
+#include "utils/config.h"
+#include "utils/coordinates.h"
+#include "utils/bithelpers.h"
+#include <QFile>
+#include <QtDebug>
+#include <vector>
+
+// turning penalties and road edges of an edge based contraction hierarchy
+// the nodes of the edge based graph are directed road edges, its edges are the allowed turns
+// file layout:
+// Header | penalty dictionary | node record offsets | road coordinates | node records | road edge records
+// node record: in degree, out degree, uniform flag, in slots, penalty indices
+// penalty indices are stored row-major ( in slot * out degree + out slot ), or once if all are equal
+// read-only after loading => can be shared by any number of threads
+class TurnTable {
+
+public:
+
+	struct RoadEdge {
+		// original node IDs, as seen by the gps lookup
+		NodeID source;
+		NodeID target;
+		// distinguishes parallel edges
+		unsigned edgeID;
+		unsigned edgeIDAtSource;
+		unsigned edgeIDAtTarget;
+		bool bidirectional;
+		bool branchingPossible;
+		// node IDs of the directed copies in the compressed graph
+		NodeID forwardNode;
+		NodeID backwardNode;
+		// travel time in 1/10 seconds
+		unsigned distance;
+		unsigned name;
+		unsigned type;
+		// coordinates source, path..., target
+		unsigned path;
+		unsigned pathLength;
+	};
+
+	// directed road edge entering a node
+	struct Slot {
+		unsigned roadEdge;
+		bool forward;
+	};
+
+	// turn from a directed road edge into another one
+	struct Turn {
+		NodeID node;
+		int penalty;
+	};
+
+	struct Header {
+		unsigned numberOfNodes;
+		unsigned numberOfRoadEdges;
+		unsigned numberOfPenalties;
+		unsigned numberOfCoordinates;
+		unsigned nodeRecordsSize;
+		unsigned roadEdgeBits;
+		unsigned penaltyBits;
+		unsigned degreeBits;
+		unsigned nodeBits;
+		unsigned edgeIDBits;
+		unsigned slotBits;
+		unsigned graphNodeBits;
+		unsigned distanceBits;
+		unsigned nameBits;
+		unsigned typeBits;
+		unsigned pathBits;
+		unsigned pathLengthBits;
+
+		unsigned roadEdgeRecordBits() const
+		{
+			return 2 * nodeBits + edgeIDBits + 2 * slotBits + 2 + 2 * graphNodeBits + distanceBits + nameBits + typeBits + pathBits + pathLengthBits;
+		}
+	};
+
+	// the bit streams are padded to allow for unaligned 32 bit reads at their end
+	static const unsigned padding = 8;
+
+	TurnTable()
+	{
+		m_data = NULL;
+		memset( &m_header, 0, sizeof( Header ) );
+	}
+
+	~TurnTable()
+	{
+		unload();
+	}
+
+	bool load( const QString& filename )
+	{
+		unload();
+		m_inputFile.setFileName( filename );
+		if ( !m_inputFile.open( QIODevice::ReadOnly ) ) {
+			qCritical() << "failed to open file:" << m_inputFile.fileName();
+			return false;
+		}
+
+		qint64 size = m_inputFile.size();
+		if ( size < ( qint64 ) sizeof( Header ) ) {
+			qCritical() << "corrupt turn table:" << m_inputFile.fileName();
+			m_inputFile.close();
+			return false;
+		}
+		m_data = m_inputFile.map( 0, size );
+		if ( m_data == NULL ) {
+			qCritical() << "failed to map file:" << m_inputFile.fileName();
+			m_inputFile.close();
+			return false;
+		}
+
+		memcpy( &m_header, m_data, sizeof( Header ) );
+		m_roadEdgeRecordBits = m_header.roadEdgeRecordBits();
+		const unsigned char* position = m_data + sizeof( Header );
+		m_penalties = ( const int* ) position;
+		position += m_header.numberOfPenalties * sizeof( int );
+		m_nodeOffsets = ( const unsigned* ) position;
+		position += ( m_header.numberOfNodes + 1 ) * sizeof( unsigned );
+		m_coordinates = ( const UnsignedCoordinate* ) position;
+		position += m_header.numberOfCoordinates * sizeof( UnsignedCoordinate );
+		m_nodeRecords = position;
+		position += m_header.nodeRecordsSize + padding;
+		m_roadEdgeRecords = position;
+		position += ( ( quint64 ) m_header.numberOfRoadEdges * m_roadEdgeRecordBits + 7 ) / 8 + padding;
+
+		if ( position - m_data > size ) {
+			qCritical() << "corrupt turn table:" << m_inputFile.fileName();
+			unload();
+			return false;
+		}
+
+		qDebug() << "turn table:" << m_header.numberOfNodes << "nodes," << m_header.numberOfRoadEdges << "road edges," << m_header.numberOfPenalties << "distinct penalties";
+		return true;
+	}
+
+	void unload()
+	{
+		if ( m_data != NULL )
+			m_inputFile.unmap( m_data );
+		m_data = NULL;
+		m_inputFile.close();
+	}
+
+	bool loaded() const
+	{
+		return m_data != NULL;
+	}
+
+	unsigned numberOfRoadEdges() const
+	{
+		return m_header.numberOfRoadEdges;
+	}
+
+	// returns numberOfRoadEdges() if no such road edge exists
+	unsigned findRoadEdge( NodeID source, NodeID target, unsigned edgeID ) const
+	{
+		if ( target >= m_header.numberOfNodes )
+			return m_header.numberOfRoadEdges;
+		NodeRecord record = nodeRecord( target );
+		for ( unsigned slot = 0; slot < record.inDegree; slot++ ) {
+			Slot in = readSlot( record, slot );
+			if ( !in.forward || in.roadEdge >= m_header.numberOfRoadEdges )
+				continue;
+			RoadEdge edge;
+			roadEdge( &edge, in.roadEdge );
+			if ( edge.source == source && edge.edgeID == edgeID )
+				return in.roadEdge;
+		}
+		return m_header.numberOfRoadEdges;
+	}
+
+	void roadEdge( RoadEdge* result, unsigned id ) const
+	{
+		assert( id < m_header.numberOfRoadEdges );
+		quint64 position = ( quint64 ) id * m_roadEdgeRecordBits;
+		const unsigned char* buffer = m_roadEdgeRecords + ( position >> 3 );
+		int offset = position & 7;
+		result->source = read_unaligned_unsigned( &buffer, m_header.nodeBits, &offset );
+		result->target = read_unaligned_unsigned( &buffer, m_header.nodeBits, &offset );
+		result->edgeID = read_unaligned_unsigned( &buffer, m_header.edgeIDBits, &offset );
+		result->edgeIDAtSource = read_unaligned_unsigned( &buffer, m_header.slotBits, &offset );
+		result->edgeIDAtTarget = read_unaligned_unsigned( &buffer, m_header.slotBits, &offset );
+		result->bidirectional = read_unaligned_unsigned( &buffer, 1, &offset ) != 0;
+		result->branchingPossible = read_unaligned_unsigned( &buffer, 1, &offset ) != 0;
+		result->forwardNode = read_unaligned_unsigned( &buffer, m_header.graphNodeBits, &offset );
+		result->backwardNode = read_unaligned_unsigned( &buffer, m_header.graphNodeBits, &offset );
+		result->distance = read_unaligned_unsigned( &buffer, m_header.distanceBits, &offset );
+		result->name = read_unaligned_unsigned( &buffer, m_header.nameBits, &offset );
+		result->type = read_unaligned_unsigned( &buffer, m_header.typeBits, &offset );
+		result->path = read_unaligned_unsigned( &buffer, m_header.pathBits, &offset );
+		result->pathLength = read_unaligned_unsigned( &buffer, m_header.pathLengthBits, &offset );
+	}
+
+	// all allowed turns into the directed copy of a road edge
+	void predecessors( std::vector< Turn >* result, const RoadEdge& edge, bool forward ) const
+	{
+		result->clear();
+		NodeRecord record = nodeRecord( forward ? edge.source : edge.target );
+		const unsigned outSlot = forward ? edge.edgeIDAtSource : edge.edgeIDAtTarget;
+		if ( outSlot >= record.outDegree )
+			return;
+		for ( unsigned slot = 0; slot < record.inDegree; slot++ ) {
+			const int penalty = readPenalty( record, slot, outSlot );
+			if ( penalty < 0 )
+				continue;
+			Slot in = readSlot( record, slot );
+			if ( in.roadEdge >= m_header.numberOfRoadEdges )
+				continue;
+			RoadEdge predecessor;
+			roadEdge( &predecessor, in.roadEdge );
+			Turn turn;
+			turn.node = in.forward ? predecessor.forwardNode : predecessor.backwardNode;
+			turn.penalty = penalty;
+			result->push_back( turn );
+		}
+	}
+
+	UnsignedCoordinate coordinate( unsigned index ) const
+	{
+		assert( index < m_header.numberOfCoordinates );
+		return m_coordinates[index];
+	}
+
+protected:
+
+	struct NodeRecord {
+		unsigned inDegree;
+		unsigned outDegree;
+		bool uniform;
+		// bit position of the in slots / penalty indices
+		quint64 firstSlot;
+		quint64 firstPenalty;
+	};
+
+	NodeRecord nodeRecord( NodeID node ) const
+	{
+		assert( node < m_header.numberOfNodes );
+		NodeRecord record;
+		const unsigned char* buffer = m_nodeRecords + m_nodeOffsets[node];
+		int offset = 0;
+		record.inDegree = read_unaligned_unsigned( &buffer, m_header.degreeBits, &offset );
+		record.outDegree = read_unaligned_unsigned( &buffer, m_header.degreeBits, &offset );
+		record.uniform = read_unaligned_unsigned( &buffer, 1, &offset ) != 0;
+		record.firstSlot = ( quint64 ) m_nodeOffsets[node] * 8 + 2 * m_header.degreeBits + 1;
+		record.firstPenalty = record.firstSlot + record.inDegree * ( m_header.roadEdgeBits + 1 );
+		return record;
+	}
+
+	Slot readSlot( const NodeRecord& record, unsigned slot ) const
+	{
+		quint64 position = record.firstSlot + slot * ( m_header.roadEdgeBits + 1 );
+		const unsigned char* buffer = m_nodeRecords + ( position >> 3 );
+		int offset = position & 7;
+		Slot result;
+		result.roadEdge = read_unaligned_unsigned( &buffer, m_header.roadEdgeBits, &offset );
+		result.forward = read_unaligned_unsigned( &buffer, 1, &offset ) != 0;
+		return result;
+	}
+
+	int readPenalty( const NodeRecord& record, unsigned inSlot, unsigned outSlot ) const
+	{
+		quint64 position = record.firstPenalty;
+		if ( !record.uniform )
+			position += ( inSlot * record.outDegree + outSlot ) * m_header.penaltyBits;
+		return m_penalties[read_unaligned_unsigned( m_nodeRecords + ( position >> 3 ), m_header.penaltyBits, position & 7 )];
+	}
+
+	unsigned char* m_data;
+	Header m_header;
+	unsigned m_roadEdgeRecordBits;
+	const int* m_penalties;
+	const unsigned* m_nodeOffsets;
+	const UnsignedCoordinate* m_coordinates;
+	const unsigned char* m_nodeRecords;
+	const unsigned char* m_roadEdgeRecords;
+	QFile m_inputFile;
+
+};
+
+#endif // TURNTABLE_H_INCLUDED
@@ -0,0 +1,263 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TURNTABLEBUILDER_H_INCLUDED
+#define TURNTABLEBUILDER_H_INCLUDED
+
+#include "turntable.h"
+#include "utils/qthelpers.h"
+#include <QHash>
+#include <algorithm>
+
+// writes the turn table of an edge based contraction hierarchy
+// penalties are rounded to 1/10 seconds and replaced by indices into a dictionary
+// sorted by frequency, most turn tables consist of only a handful of distinct values
+class TurnTableBuilder {
+
+public:
+
+	typedef TurnTable::Slot Slot;
+	typedef TurnTable::RoadEdge RoadEdge;
+
+	// inSlots: in slots of all nodes, node after node, inDegree[node] slots each
+	// penalties: as provided by the importer
+	TurnTableBuilder( std::vector< char >& inDegree, std::vector< char >& outDegree, std::vector< double >& penalties, std::vector< Slot >& inSlots, std::vector< RoadEdge >& roadEdges, std::vector< UnsignedCoordinate >& coordinates )
+	{
+		m_inDegree.swap( inDegree );
+		m_outDegree.swap( outDegree );
+		m_penalties.swap( penalties );
+		m_inSlots.swap( inSlots );
+		m_roadEdges.swap( roadEdges );
+		m_coordinates.swap( coordinates );
+	}
+
+	bool run( QString filename )
+	{
+		QFile file( filename );
+		if ( !openQFile( &file, QIODevice::WriteOnly ) )
+			return false;
+
+		buildDictionary();
+
+		TurnTable::Header header;
+		header.numberOfNodes = m_inDegree.size();
+		header.numberOfRoadEdges = m_roadEdges.size();
+		header.numberOfPenalties = m_dictionary.size();
+		header.numberOfCoordinates = m_coordinates.size();
+		// an additional value marks unused slots
+		header.roadEdgeBits = bits_needed( m_roadEdges.size() );
+		header.penaltyBits = bits_needed( m_dictionary.size() - 1 );
+
+		unsigned maxDegree = 0;
+		for ( unsigned node = 0; node < m_inDegree.size(); node++ ) {
+			maxDegree = std::max( maxDegree, ( unsigned ) m_inDegree[node] );
+			maxDegree = std::max( maxDegree, ( unsigned ) m_outDegree[node] );
+		}
+		header.degreeBits = bits_needed( maxDegree );
+
+		unsigned maxNode = 0, maxEdgeID = 0, maxSlot = 0, maxGraphNode = 0, maxDistance = 0, maxName = 0, maxType = 0, maxPathLength = 0;
+		for ( unsigned edge = 0; edge < m_roadEdges.size(); edge++ ) {
+			const RoadEdge& road = m_roadEdges[edge];
+			maxNode = std::max( maxNode, std::max( road.source, road.target ) );
+			maxEdgeID = std::max( maxEdgeID, road.edgeID );
+			maxSlot = std::max( maxSlot, std::max( road.edgeIDAtSource, road.edgeIDAtTarget ) );
+			maxGraphNode = std::max( maxGraphNode, std::max( road.forwardNode, road.backwardNode ) );
+			maxDistance = std::max( maxDistance, road.distance );
+			maxName = std::max( maxName, road.name );
+			maxType = std::max( maxType, road.type );
+			maxPathLength = std::max( maxPathLength, road.pathLength );
+		}
+		header.nodeBits = bits_needed( maxNode );
+		header.edgeIDBits = bits_needed( maxEdgeID );
+		header.slotBits = bits_needed( maxSlot );
+		header.graphNodeBits = bits_needed( maxGraphNode );
+		header.distanceBits = bits_needed( maxDistance );
+		header.nameBits = bits_needed( maxName );
+		header.typeBits = bits_needed( maxType );
+		header.pathBits = bits_needed( m_coordinates.size() );
+		header.pathLengthBits = bits_needed( maxPathLength );
+
+		std::vector< unsigned > nodeOffsets;
+		std::vector< unsigned char > nodeRecords;
+		if ( !writeNodeRecords( header, &nodeOffsets, &nodeRecords ) )
+			return false;
+		header.nodeRecordsSize = nodeRecords.size() - TurnTable::padding;
+
+		std::vector< unsigned char > roadEdgeRecords;
+		writeRoadEdgeRecords( header, &roadEdgeRecords );
+
+		file.write( ( const char* ) &header, sizeof( header ) );
+		file.write( ( const char* ) &m_dictionary[0], m_dictionary.size() * sizeof( int ) );
+		file.write( ( const char* ) &nodeOffsets[0], nodeOffsets.size() * sizeof( unsigned ) );
+		if ( !m_coordinates.empty() )
+			file.write( ( const char* ) &m_coordinates[0], m_coordinates.size() * sizeof( UnsignedCoordinate ) );
+		file.write( ( const char* ) &nodeRecords[0], nodeRecords.size() );
+		file.write( ( const char* ) &roadEdgeRecords[0], roadEdgeRecords.size() );
+
+		qDebug() << "turn table distinct penalties:" << m_dictionary.size();
+		qDebug() << "turn table uniform nodes:" << m_uniformNodes << "/" << m_inDegree.size();
+		qDebug() << "turn table size:" << file.size() / 1024 << "KB";
+		return true;
+	}
+
+protected:
+
+	static int roundPenalty( double penalty )
+	{
+		if ( penalty < 0 )
+			return -1;
+		return penalty * 10 + 0.5;
+	}
+
+	struct PenaltyCount {
+		int penalty;
+		unsigned count;
+		bool operator<( const PenaltyCount& right ) const {
+			if ( count != right.count )
+				return count > right.count;
+			return penalty < right.penalty;
+		}
+	};
+
+	void buildDictionary()
+	{
+		QHash< int, unsigned > counts;
+		for ( unsigned i = 0; i < m_penalties.size(); i++ )
+			counts[roundPenalty( m_penalties[i] )]++;
+		// there has to be at least one entry
+		if ( counts.isEmpty() )
+			counts[-1] = 0;
+
+		std::vector< PenaltyCount > sorted;
+		for ( QHash< int, unsigned >::const_iterator i = counts.begin(), iend = counts.end(); i != iend; ++i ) {
+			PenaltyCount entry;
+			entry.penalty = i.key();
+			entry.count = i.value();
+			sorted.push_back( entry );
+		}
+		std::sort( sorted.begin(), sorted.end() );
+
+		m_dictionary.clear();
+		m_dictionaryIndex.clear();
+		for ( unsigned i = 0; i < sorted.size(); i++ ) {
+			m_dictionary.push_back( sorted[i].penalty );
+			m_dictionaryIndex[sorted[i].penalty] = i;
+		}
+	}
+
+	bool writeNodeRecords( const TurnTable::Header& header, std::vector< unsigned >* nodeOffsets, std::vector< unsigned char >* records )
+	{
+		const unsigned slotBits = header.roadEdgeBits + 1;
+		m_uniformNodes = 0;
+
+		std::vector< bool > uniform( m_inDegree.size(), false );
+		quint64 size = 0;
+		unsigned table = 0;
+		for ( unsigned node = 0; node < m_inDegree.size(); node++ ) {
+			const unsigned tableSize = m_inDegree[node] * m_outDegree[node];
+			if ( table + tableSize > m_penalties.size() ) {
+				qCritical() << "turn table exceeds the penalties provided:" << node;
+				return false;
+			}
+			bool isUniform = tableSize > 0;
+			for ( unsigned i = 1; i < tableSize && isUniform; i++ )
+				isUniform = roundPenalty( m_penalties[table + i] ) == roundPenalty( m_penalties[table] );
+			uniform[node] = isUniform;
+			if ( isUniform )
+				m_uniformNodes++;
+			table += tableSize;
+
+			unsigned bits = 2 * header.degreeBits + 1 + m_inDegree[node] * slotBits;
+			bits += ( isUniform ? 1 : tableSize ) * header.penaltyBits;
+			size += ( bits + 7 ) / 8;
+		}
+		if ( size > std::numeric_limits< unsigned >::max() ) {
+			qCritical() << "turn table too large";
+			return false;
+		}
+
+		nodeOffsets->resize( m_inDegree.size() + 1 );
+		records->assign( size + TurnTable::padding, 0 );
+		unsigned offset = 0;
+		unsigned firstSlot = 0;
+		table = 0;
+		for ( unsigned node = 0; node < m_inDegree.size(); node++ ) {
+			( *nodeOffsets )[node] = offset;
+			const unsigned inDegree = m_inDegree[node];
+			const unsigned outDegree = m_outDegree[node];
+			unsigned char* buffer = &( *records )[offset];
+			int bitOffset = 0;
+			write_unaligned_unsigned( &buffer, inDegree, header.degreeBits, &bitOffset );
+			write_unaligned_unsigned( &buffer, outDegree, header.degreeBits, &bitOffset );
+			write_unaligned_unsigned( &buffer, uniform[node] ? 1 : 0, 1, &bitOffset );
+			for ( unsigned slot = 0; slot < inDegree; slot++ ) {
+				const Slot& in = m_inSlots[firstSlot + slot];
+				write_unaligned_unsigned( &buffer, in.roadEdge, header.roadEdgeBits, &bitOffset );
+				write_unaligned_unsigned( &buffer, in.forward ? 1 : 0, 1, &bitOffset );
+			}
+			const unsigned tableSize = uniform[node] ? 1 : inDegree * outDegree;
+			for ( unsigned i = 0; i < tableSize; i++ )
+				write_unaligned_unsigned( &buffer, m_dictionaryIndex[roundPenalty( m_penalties[table + i]  )], header.penaltyBits, &bitOffset );
+
+			offset = buffer - &( *records )[0] + ( bitOffset != 0 ? 1 : 0 );
+			firstSlot += inDegree;
+			table += inDegree * outDegree;
+		}
+		( *nodeOffsets )[m_inDegree.size()] = offset;
+		assert( offset == size );
+		return true;
+	}
+
+	void writeRoadEdgeRecords( const TurnTable::Header& header, std::vector< unsigned char >* records )
+	{
+		const unsigned recordBits = header.roadEdgeRecordBits();
+		records->assign( ( ( quint64 ) m_roadEdges.size() * recordBits + 7 ) / 8 + TurnTable::padding, 0 );
+		unsigned char* buffer = &( *records )[0];
+		int offset = 0;
+		for ( unsigned edge = 0; edge < m_roadEdges.size(); edge++ ) {
+			const RoadEdge& road = m_roadEdges[edge];
+			write_unaligned_unsigned( &buffer, road.source, header.nodeBits, &offset );
+			write_unaligned_unsigned( &buffer, road.target, header.nodeBits, &offset );
+			write_unaligned_unsigned( &buffer, road.edgeID, header.edgeIDBits, &offset );
+			write_unaligned_unsigned( &buffer, road.edgeIDAtSource, header.slotBits, &offset );
+			write_unaligned_unsigned( &buffer, road.edgeIDAtTarget, header.slotBits, &offset );
+			write_unaligned_unsigned( &buffer, road.bidirectional ? 1 : 0, 1, &offset );
+			write_unaligned_unsigned( &buffer, road.branchingPossible ? 1 : 0, 1, &offset );
+			write_unaligned_unsigned( &buffer, road.forwardNode, header.graphNodeBits, &offset );
+			write_unaligned_unsigned( &buffer, road.backwardNode, header.graphNodeBits, &offset );
+			write_unaligned_unsigned( &buffer, road.distance, header.distanceBits, &offset );
+			write_unaligned_unsigned( &buffer, road.name, header.nameBits, &offset );
+			write_unaligned_unsigned( &buffer, road.type, header.typeBits, &offset );
+			write_unaligned_unsigned( &buffer, road.path, header.pathBits, &offset );
+			write_unaligned_unsigned( &buffer, road.pathLength, header.pathLengthBits, &offset );
+		}
+	}
+
+	std::vector< char > m_inDegree;
+	std::vector< char > m_outDegree;
+	std::vector< double > m_penalties;
+	std::vector< Slot > m_inSlots;
+	std::vector< RoadEdge > m_roadEdges;
+	std::vector< UnsignedCoordinate > m_coordinates;
+	std::vector< int > m_dictionary;
+	QHash< int, unsigned > m_dictionaryIndex;
+	unsigned m_uniformNodes;
+};
+
+#endif // TURNTABLEBUILDER_H_INCLUDED
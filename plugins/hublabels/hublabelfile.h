@@ -0,0 +1,206 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HUBLABELFILE_H
+#define HUBLABELFILE_H
+
+#include "utils/bithelpers.h"
+#include <QFile>
+#include <QtDebug>
+#include <vector>
+
+// hub labels of all nodes of a contraction hierarchy
+// the shortest path distance from s to t is the minimum of forward( s ).distance + backward( t ).distance over their common hubs
+// file layout:
+// version, number of node IDs, number of hubs, padding | forward offsets | backward offsets | label data
+// the offsets ( quint64, number of node IDs + 1 each ) index into the label data, the label of a node ends where the next one starts
+// a label lists its hubs by ascending rank, each entry is the varint encoded difference to the previous hub followed by the varint encoded distance
+// read-only after loading => can be shared by any number of threads
+class HubLabelFile {
+
+public:
+
+	static const unsigned version = 1;
+
+	struct Entry {
+		unsigned hub;
+		unsigned distance;
+		Entry() {}
+		Entry( unsigned h, unsigned d ) : hub( h ), distance( d ) {}
+		bool operator<( const Entry& right ) const {
+			if ( hub != right.hub )
+				return hub < right.hub;
+			return distance < right.distance;
+		}
+	};
+
+	// decodes a label entry by entry
+	class LabelIterator {
+
+		friend class HubLabelFile;
+
+	public:
+
+		LabelIterator( const unsigned char* begin, const unsigned char* end ) : m_position( begin ), m_end( end ), m_hub( 0 )
+		{
+		}
+
+		bool hasEntriesLeft() const
+		{
+			return m_position < m_end;
+		}
+
+		Entry next()
+		{
+			m_hub += read_varint( &m_position );
+			return Entry( m_hub, read_varint( &m_position ) );
+		}
+
+	private:
+
+		const unsigned char* m_position;
+		const unsigned char* m_end;
+		unsigned m_hub;
+	};
+
+	HubLabelFile()
+	{
+		m_data = NULL;
+		m_numberOfNodeIDs = 0;
+		m_numberOfHubs = 0;
+	}
+
+	~HubLabelFile()
+	{
+		unload();
+	}
+
+	// label has to be sorted by hub
+	static void encode( std::vector< unsigned char >* buffer, const std::vector< Entry >& label )
+	{
+		unsigned previous = 0;
+		for ( std::vector< Entry >::const_iterator i = label.begin(), iend = label.end(); i != iend; i++ ) {
+			assert( i == label.begin() || i->hub > previous );
+			write_varint( buffer, i->hub - previous );
+			write_varint( buffer, i->distance );
+			previous = i->hub;
+		}
+	}
+
+	bool load( const QString& filename )
+	{
+		unload();
+		m_file.setFileName( filename );
+		if ( !m_file.open( QIODevice::ReadOnly ) ) {
+			qCritical() << "failed to open file:" << m_file.fileName();
+			return false;
+		}
+
+		unsigned header[3];
+		if ( m_file.read( ( char* ) header, sizeof( header ) ) != sizeof( header ) || header[0] != version ) {
+			qCritical() << "hub label file format not compatible:" << m_file.fileName();
+			m_file.close();
+			return false;
+		}
+		m_numberOfNodeIDs = header[1];
+		m_numberOfHubs = header[2];
+
+		const qint64 indexSize = 2 * ( ( qint64 ) m_numberOfNodeIDs + 1 ) * sizeof( quint64 );
+		if ( m_file.size() < headerSize() + indexSize ) {
+			qCritical() << "hub label file corrupted:" << m_file.fileName();
+			unload();
+			return false;
+		}
+		m_data = m_file.map( 0, m_file.size() );
+		if ( m_data == NULL ) {
+			qCritical() << "failed to map file:" << m_file.fileName();
+			unload();
+			return false;
+		}
+		m_forwardIndex = ( const quint64* ) ( m_data + headerSize() );
+		m_backwardIndex = m_forwardIndex + m_numberOfNodeIDs + 1;
+		m_labels = m_data + headerSize() + indexSize;
+		if ( headerSize() + indexSize + ( qint64 ) m_backwardIndex[m_numberOfNodeIDs] != m_file.size() ) {
+			qCritical() << "hub label file corrupted:" << m_file.fileName();
+			unload();
+			return false;
+		}
+		return true;
+	}
+
+	void unload()
+	{
+		if ( m_data != NULL )
+			m_file.unmap( m_data );
+		m_data = NULL;
+		m_file.close();
+		m_numberOfNodeIDs = 0;
+		m_numberOfHubs = 0;
+	}
+
+	bool loaded() const
+	{
+		return m_data != NULL;
+	}
+
+	// the header is padded => the offsets are aligned to 8 bytes
+	static qint64 headerSize()
+	{
+		return 4 * sizeof( unsigned );
+	}
+
+	unsigned numberOfNodeIDs() const
+	{
+		return m_numberOfNodeIDs;
+	}
+
+	unsigned numberOfHubs() const
+	{
+		return m_numberOfHubs;
+	}
+
+	quint64 labelSize() const
+	{
+		return m_backwardIndex[m_numberOfNodeIDs];
+	}
+
+	LabelIterator forward( unsigned node ) const
+	{
+		assert( node < m_numberOfNodeIDs );
+		return LabelIterator( m_labels + m_forwardIndex[node], m_labels + m_forwardIndex[node + 1] );
+	}
+
+	LabelIterator backward( unsigned node ) const
+	{
+		assert( node < m_numberOfNodeIDs );
+		return LabelIterator( m_labels + m_backwardIndex[node], m_labels + m_backwardIndex[node + 1] );
+	}
+
+private:
+
+	QFile m_file;
+	unsigned char* m_data;
+	const quint64* m_forwardIndex;
+	const quint64* m_backwardIndex;
+	const unsigned char* m_labels;
+	unsigned m_numberOfNodeIDs;
+	unsigned m_numberOfHubs;
+};
+
+#endif // HUBLABELFILE_H
@@ -0,0 +1,107 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "hublabels.h"
+#include "hublabelsbuilder.h"
+#include "utils/qthelpers.h"
+
+#include <QSettings>
+
+HubLabels::HubLabels()
+{
+}
+
+HubLabels::~HubLabels()
+{
+}
+
+QString HubLabels::GetName()
+{
+	return "Hub Labels";
+}
+
+bool HubLabels::LoadSettings( QSettings* settings )
+{
+	return m_contractionHierarchies.LoadSettings( settings );
+}
+
+bool HubLabels::SaveSettings( QSettings* settings )
+{
+	return m_contractionHierarchies.SaveSettings( settings );
+}
+
+int HubLabels::GetFileFormatVersion()
+{
+	// 2: the contraction hierarchy may use compressed path blocks
+	return 2;
+}
+
+HubLabels::Type HubLabels::GetType()
+{
+	return Router;
+}
+
+bool HubLabels::Preprocess( IImporter* importer, QString dir )
+{
+	// the labels do not know about turns
+	if ( m_contractionHierarchies.IsEdgeBased() ) {
+		qCritical() << "hub labels require a node based contraction hierarchy";
+		return false;
+	}
+
+	if ( !m_contractionHierarchies.Preprocess( importer, dir ) )
+		return false;
+
+	CompressedGraph graph;
+	if ( !graph.loadGraph( fileInDirectory( dir, "Contraction Hierarchies" ), 0, true ) )
+		return false;
+	HubLabelsBuilder builder( &graph );
+	return builder.run( fileInDirectory( dir, "Hub Labels" ) );
+}
+
+// IConsoleSettings
+QString HubLabels::GetModuleName()
+{
+	return GetName();
+}
+
+bool HubLabels::GetSettingsList( QVector< Setting >* settings )
+{
+	settings->push_back( Setting( "", "hub-labels-block-size", "sets block size of the underlying compressed graph to 2^x", "integer > 7" ) );
+	settings->push_back( Setting( "", "hub-labels-customize", "contracts with the node order stored by hub-labels-keep-order, only recomputes the shortcuts and labels", "" ) );
+	settings->push_back( Setting( "", "hub-labels-keep-order", "stores the node order of the underlying contraction, lets later runs customize it", "" ) );
+	return true;
+}
+
+bool HubLabels::SetSetting( int id, QVariant data )
+{
+	// forwarded to the contraction hierarchies settings, the edge based graph is not supported
+	switch( id ) {
+	case 0:
+		return m_contractionHierarchies.SetSetting( 0, data );
+	case 1:
+		return m_contractionHierarchies.SetSetting( 2, data );
+	case 2:
+		return m_contractionHierarchies.SetSetting( 12, data );
+	default:
+		return false;
+	}
+}
+
+Q_EXPORT_PLUGIN2( hublabels, HubLabels )
@@ -0,0 +1,62 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HUBLABELS_H
+#define HUBLABELS_H
+
+#include <QObject>
+#include "interfaces/ipreprocessor.h"
+#include "interfaces/iconsolesettings.h"
+#include "plugins/contractionhierarchies/contractionhierarchies.h"
+
+// computes a contraction hierarchy and derives hub labels from its search spaces
+class HubLabels :
+		public QObject,
+		public IConsoleSettings,
+		public IPreprocessor
+{
+	Q_OBJECT
+	Q_INTERFACES( IPreprocessor )
+	Q_INTERFACES( IConsoleSettings )
+
+public:
+
+	HubLabels();
+
+	// IPreprocessor
+	virtual QString GetName();
+	virtual int GetFileFormatVersion();
+	virtual Type GetType();
+	virtual bool LoadSettings( QSettings* settings );
+	virtual bool SaveSettings( QSettings* settings );
+	virtual bool Preprocess( IImporter* importer, QString dir );
+	virtual ~HubLabels();
+
+	// IConsoleSettings
+	virtual QString GetModuleName();
+	virtual bool GetSettingsList( QVector< Setting >* settings );
+	virtual bool SetSetting( int id, QVariant data );
+
+protected:
+
+	// shares its settings with the contraction hierarchies plugin
+	ContractionHierarchies m_contractionHierarchies;
+};
+
+#endif // HUBLABELS_H
@@ -0,0 +1,37 @@
+TEMPLATE = lib
+CONFIG += plugin static
+
+INCLUDEPATH += ../..
+
+DESTDIR = ../../bin/plugins_preprocessor
+unix {
+	QMAKE_CXXFLAGS_RELEASE -= -O2
+	QMAKE_CXXFLAGS_RELEASE += -O3 \
+		 -Wno-unused-function \
+		 -fopenmp
+	QMAKE_CXXFLAGS_DEBUG += -Wno-unused-function \
+		 -fopenmp
+}
+LIBS += -fopenmp
+HEADERS += hublabels.h \
+	 hublabelsbuilder.h \
+	 hublabelfile.h \
+	 ../contractionhierarchies/contractionhierarchies.h \
+	 ../contractionhierarchies/compressedgraph.h \
+	 ../contractionhierarchies/frequencycache.h \
+	 ../contractionhierarchies/blockcache.h \
+	 ../contractionhierarchies/mappedblocks.h \
+	 ../../interfaces/ipreprocessor.h \
+	 ../../interfaces/iconsolesettings.h \
+	 ../../utils/coordinates.h \
+	 ../../utils/config.h \
+	 ../../utils/bithelpers.h \
+	 ../../utils/bitunpack.h \
+	 ../../utils/qthelpers.h \
+	 ../../interfaces/irouter.h
+SOURCES += hublabels.cpp
+
+nogui {
+	DEFINES += NOGUI
+	QT -= gui
+}
@@ -0,0 +1,291 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HUBLABELSBUILDER_H
+#define HUBLABELSBUILDER_H
+
+#include "plugins/contractionhierarchies/compressedgraph.h"
+#include "hublabelfile.h"
+#include "utils/qthelpers.h"
+#include <omp.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+// derives hub labels from the upward search spaces of a contraction hierarchy
+// the upward search space of a node is the node itself merged with the search spaces of its upward neighbours.
+// processing the nodes top-down computes it with a single merge per node,
+// afterwards every hub a higher node's label reaches faster is pruned, leaving only hubs on shortest paths
+class HubLabelsBuilder {
+
+public:
+
+	typedef CompressedGraph::NodeIterator NodeIterator;
+	typedef CompressedGraph::EdgeIterator EdgeIterator;
+	typedef HubLabelFile::Entry Entry;
+
+	struct Statistics {
+		quint64 entries;
+		quint64 prunedEntries;
+		unsigned maxLabelSize;
+		Statistics() : entries( 0 ), prunedEntries( 0 ), maxLabelSize( 0 ) {}
+	};
+
+	HubLabelsBuilder( CompressedGraph* graph ) : m_graph( graph )
+	{
+	}
+
+	bool run( QString filename )
+	{
+		qDebug() << "computing hub labels for" << m_graph->numberOfNodes() << "nodes";
+		Timer time;
+		if ( !computeLevels() )
+			return false;
+		qDebug() << "computed" << m_levelBegin.size() - 1 << "levels:" << time.restart() << "ms";
+		computeLabels();
+		qDebug() << "computed labels:" << time.restart() << "ms";
+		if ( !write( filename ) )
+			return false;
+		qDebug() << "wrote labels:" << time.restart() << "ms";
+
+		const quint64 labels = 2 * std::max( ( quint64 ) m_nodes.size(), ( quint64 ) 1 );
+		qDebug() << "label entries:" << m_statistics.entries << ", average label size:" << ( double ) m_statistics.entries / labels << ", max label size:" << m_statistics.maxLabelSize;
+		qDebug() << "pruned entries:" << m_statistics.prunedEntries << "(" << 100.0 * m_statistics.prunedEntries / std::max( m_statistics.entries + m_statistics.prunedEntries, ( quint64 ) 1 ) << "% )";
+		qDebug() << "label data:" << m_labelBytes / 1024 / 1024 << "MB," << ( double ) m_labelBytes / std::max( m_statistics.entries, ( quint64 ) 1 ) << "bytes / entry";
+		return true;
+	}
+
+	const Statistics& statistics() const
+	{
+		return m_statistics;
+	}
+
+protected:
+
+	struct SameHub {
+		bool operator()( const Entry& left, const Entry& right ) const {
+			return left.hub == right.hub;
+		}
+	};
+
+	// ranks the nodes by ID => higher nodes have smaller ranks
+	// the level of a node is one more than the highest level of its upward neighbours,
+	// nodes of the same level do not depend on each other
+	bool computeLevels()
+	{
+		CompressedGraph::Cache cache;
+		if ( !m_graph->loadCache( &cache ) )
+			return false;
+
+		m_nodes.clear();
+		m_rank.assign( m_graph->numberOfNodeIDs(), std::numeric_limits< unsigned >::max() );
+		for ( unsigned block = 0; block < m_graph->numberOfBlocks(); block++ ) {
+			unsigned count = m_graph->numberOfNodes( &cache, block );
+			for ( unsigned internal = 0; internal < count; internal++ ) {
+				NodeIterator node = m_graph->nodeID( block, internal );
+				m_rank[node] = m_nodes.size();
+				m_nodes.push_back( node );
+			}
+		}
+
+		std::vector< unsigned > level( m_nodes.size(), 0 );
+		unsigned numberOfLevels = 0;
+		for ( unsigned rank = 0; rank < m_nodes.size(); rank++ ) {
+			for ( EdgeIterator edge = m_graph->edges( &cache, m_nodes[rank] ); edge.hasEdgesLeft(); ) {
+				m_graph->unpackNextEdge( &edge );
+				const unsigned target = m_rank[edge.target()];
+				if ( target >= rank ) {
+					qCritical() << "contraction hierarchy is not ordered topologically";
+					return false;
+				}
+				level[rank] = std::max( level[rank], level[target] + 1 );
+			}
+			numberOfLevels = std::max( numberOfLevels, level[rank] + 1 );
+		}
+
+		m_levelBegin.assign( numberOfLevels + 1, 0 );
+		for ( unsigned rank = 0; rank < m_nodes.size(); rank++ )
+			m_levelBegin[level[rank] + 1]++;
+		for ( unsigned i = 1; i <= numberOfLevels; i++ )
+			m_levelBegin[i] += m_levelBegin[i - 1];
+		m_levelOrder.resize( m_nodes.size() );
+		std::vector< unsigned > position( m_levelBegin.begin(), m_levelBegin.end() - 1 );
+		for ( unsigned rank = 0; rank < m_nodes.size(); rank++ )
+			m_levelOrder[position[level[rank]]++] = rank;
+		return true;
+	}
+
+	void computeLabels()
+	{
+		m_forward.assign( m_nodes.size(), std::vector< unsigned char >() );
+		m_backward.assign( m_nodes.size(), std::vector< unsigned char >() );
+		m_statistics = Statistics();
+
+#pragma omp parallel
+		{
+			CompressedGraph::Cache cache;
+			m_graph->loadCache( &cache );
+			std::vector< unsigned > distances( m_nodes.size(), std::numeric_limits< unsigned >::max() );
+			std::vector< Entry > candidates;
+			std::vector< Entry > label;
+			Statistics statistics;
+
+			// the implicit barrier at the end of each loop finishes a level before the next one starts
+			for ( unsigned level = 0; level + 1 < m_levelBegin.size(); level++ ) {
+#pragma omp for schedule( dynamic, 64 )
+				for ( int i = m_levelBegin[level]; i < ( int ) m_levelBegin[level + 1]; i++ ) {
+					const unsigned rank = m_levelOrder[i];
+					for ( int direction = 0; direction < 2; direction++ ) {
+						const bool forward = direction == 0;
+						searchSpace( &cache, rank, forward, &candidates );
+						prune( rank, forward, candidates, &label, &distances );
+						HubLabelFile::encode( forward ? &m_forward[rank] : &m_backward[rank], label );
+						statistics.entries += label.size();
+						statistics.prunedEntries += candidates.size() - label.size();
+						statistics.maxLabelSize = std::max( statistics.maxLabelSize, ( unsigned ) label.size() );
+					}
+				}
+			}
+
+#pragma omp critical
+			{
+				m_statistics.entries += statistics.entries;
+				m_statistics.prunedEntries += statistics.prunedEntries;
+				m_statistics.maxLabelSize = std::max( m_statistics.maxLabelSize, statistics.maxLabelSize );
+			}
+		}
+	}
+
+	// merges the labels of the upward neighbours, keeps the shortest distance per hub
+	void searchSpace( CompressedGraph::Cache* cache, unsigned rank, bool forward, std::vector< Entry >* result )
+	{
+		result->clear();
+		result->push_back( Entry( rank, 0 ) );
+		for ( EdgeIterator edge = m_graph->edges( cache, m_nodes[rank] ); edge.hasEdgesLeft(); ) {
+			m_graph->unpackNextEdge( &edge );
+			if ( forward ? !edge.forward() : !edge.backward() )
+				continue;
+			const std::vector< unsigned char >& encoded = forward ? m_forward[m_rank[edge.target()]] : m_backward[m_rank[edge.target()]];
+			for ( HubLabelFile::LabelIterator entry = labelIterator( encoded ); entry.hasEntriesLeft(); ) {
+				Entry next = entry.next();
+				result->push_back( Entry( next.hub, next.distance + edge.distance() ) );
+			}
+		}
+		std::sort( result->begin(), result->end() );
+		result->erase( std::unique( result->begin(), result->end(), SameHub() ), result->end() );
+	}
+
+	// removes every hub that is reached faster through another hub:
+	// the search space distance to a hub h is not its shortest path distance if another hub x
+	// of the search space reaches h faster, i.e., distance( x ) + distance( x, h ) < distance( h ).
+	// distance( x, h ) is taken from the final label of h in the opposite direction
+	void prune( unsigned rank, bool forward, const std::vector< Entry >& candidates, std::vector< Entry >* result, std::vector< unsigned >* distances )
+	{
+		for ( std::vector< Entry >::const_iterator i = candidates.begin(), iend = candidates.end(); i != iend; i++ )
+			( *distances )[i->hub] = i->distance;
+
+		result->clear();
+		for ( std::vector< Entry >::const_iterator i = candidates.begin(), iend = candidates.end(); i != iend; i++ ) {
+			if ( i->hub == rank || !dominated( *i, forward ? m_backward[i->hub] : m_forward[i->hub], *distances ) )
+				result->push_back( *i );
+		}
+
+		for ( std::vector< Entry >::const_iterator i = candidates.begin(), iend = candidates.end(); i != iend; i++ )
+			( *distances )[i->hub] = std::numeric_limits< unsigned >::max();
+	}
+
+	static bool dominated( const Entry& hub, const std::vector< unsigned char >& oppositeLabel, const std::vector< unsigned >& distances )
+	{
+		for ( HubLabelFile::LabelIterator entry = labelIterator( oppositeLabel ); entry.hasEntriesLeft(); ) {
+			const Entry via = entry.next();
+			if ( via.hub == hub.hub || distances[via.hub] == std::numeric_limits< unsigned >::max() )
+				continue;
+			if ( distances[via.hub] + via.distance < hub.distance )
+				return true;
+		}
+		return false;
+	}
+
+	static HubLabelFile::LabelIterator labelIterator( const std::vector< unsigned char >& encoded )
+	{
+		if ( encoded.empty() )
+			return HubLabelFile::LabelIterator( NULL, NULL );
+		return HubLabelFile::LabelIterator( &encoded[0], &encoded[0] + encoded.size() );
+	}
+
+	bool write( QString filename )
+	{
+		QFile labelFile( filename );
+		if ( !openQFile( &labelFile, QIODevice::WriteOnly ) )
+			return false;
+
+		const unsigned numberOfNodeIDs = m_graph->numberOfNodeIDs();
+		unsigned header[4] = { HubLabelFile::version, numberOfNodeIDs, ( unsigned ) m_nodes.size(), 0 };
+		labelFile.write( ( const char* ) header, sizeof( header ) );
+
+		// nodes IDs without a node have empty labels
+		std::vector< quint64 > offsets( numberOfNodeIDs + 1 );
+		quint64 position = 0;
+		for ( int direction = 0; direction < 2; direction++ ) {
+			const std::vector< std::vector< unsigned char > >& labels = direction == 0 ? m_forward : m_backward;
+			for ( unsigned node = 0; node < numberOfNodeIDs; node++ ) {
+				offsets[node] = position;
+				if ( m_rank[node] != std::numeric_limits< unsigned >::max() )
+					position += labels[m_rank[node]].size();
+			}
+			offsets[numberOfNodeIDs] = position;
+			labelFile.write( ( const char* ) &offsets[0], offsets.size() * sizeof( quint64 ) );
+		}
+		m_labelBytes = position;
+
+		for ( int direction = 0; direction < 2; direction++ ) {
+			std::vector< std::vector< unsigned char > >& labels = direction == 0 ? m_forward : m_backward;
+			for ( unsigned node = 0; node < numberOfNodeIDs; node++ ) {
+				if ( m_rank[node] == std::numeric_limits< unsigned >::max() )
+					continue;
+				std::vector< unsigned char >& label = labels[m_rank[node]];
+				if ( !label.empty() )
+					labelFile.write( ( const char* ) &label[0], label.size() );
+				std::vector< unsigned char >().swap( label );
+			}
+		}
+
+		if ( labelFile.error() != QFile::NoError ) {
+			qCritical() << "failed to write hub labels:" << labelFile.fileName();
+			return false;
+		}
+		return true;
+	}
+
+	CompressedGraph* m_graph;
+	// node IDs by rank
+	std::vector< NodeIterator > m_nodes;
+	// rank of each node ID
+	std::vector< unsigned > m_rank;
+	// ranks grouped by level, level l occupies [ m_levelBegin[l], m_levelBegin[l + 1] )
+	std::vector< unsigned > m_levelOrder;
+	std::vector< unsigned > m_levelBegin;
+	// encoded labels by rank
+	std::vector< std::vector< unsigned char > > m_forward;
+	std::vector< std::vector< unsigned char > > m_backward;
+	Statistics m_statistics;
+	quint64 m_labelBytes;
+};
+
+#endif // HUBLABELSBUILDER_H
@@ -0,0 +1,325 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "hublabelsclient.h"
+#include "utils/qthelpers.h"
+#include <QtDebug>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <iterator>
+#ifndef NOGUI
+	#include <QMessageBox>
+#endif
+
+HubLabelsClient::HubLabelsClient()
+{
+	m_context = NULL;
+}
+
+HubLabelsClient::~HubLabelsClient()
+{
+	UnloadData();
+}
+
+QString HubLabelsClient::GetName()
+{
+	return "Hub Labels";
+}
+
+void HubLabelsClient::SetInputDirectory( const QString& dir )
+{
+	m_directory = dir;
+	m_contractionHierarchies.SetInputDirectory( dir );
+}
+
+void HubLabelsClient::ShowSettings()
+{
+#ifndef NOGUI
+	QMessageBox::information( NULL, "Settings", "No settings available" );
+#endif
+}
+
+bool HubLabelsClient::UnloadData()
+{
+	if ( m_context != NULL )
+		delete m_context;
+	m_context = NULL;
+	m_labels.unload();
+	m_graph.unloadGraph();
+	m_contractionHierarchies.UnloadData();
+
+	return true;
+}
+
+bool HubLabelsClient::IsCompatible( int fileFormatVersion )
+{
+	// 2: contraction hierarchy with compressed path blocks
+	if ( fileFormatVersion == 1 || fileFormatVersion == 2 )
+		return true;
+	return false;
+}
+
+bool HubLabelsClient::LoadData()
+{
+	UnloadData();
+
+	if ( !m_contractionHierarchies.LoadData() )
+		return false;
+	// the labels are only combined with single edges => no cache needed
+	if ( !m_graph.loadGraph( fileInDirectory( m_directory, "Contraction Hierarchies" ), 0, true ) )
+		return false;
+	if ( !m_labels.load( fileInDirectory( m_directory, "Hub Labels" ) ) )
+		return false;
+	if ( m_labels.numberOfNodeIDs() != m_graph.numberOfNodeIDs() ) {
+		qCritical() << "hub labels do not belong to the contraction hierarchy";
+		return false;
+	}
+
+	m_context = createContext();
+	if ( m_context == NULL )
+		return false;
+
+	return true;
+}
+
+HubLabelsClient::Context* HubLabelsClient::createContext()
+{
+	Context* context = new Context();
+	if ( !m_graph.loadCache( &context->cache ) ) {
+		delete context;
+		return NULL;
+	}
+	return context;
+}
+
+IRouter::QueryContext* HubLabelsClient::CreateQueryContext()
+{
+	if ( m_context == NULL )
+		return NULL;
+	Context* context = createContext();
+	if ( context == NULL )
+		return NULL;
+	context->contractionHierarchies = m_contractionHierarchies.CreateQueryContext();
+	if ( context->contractionHierarchies == NULL ) {
+		delete context;
+		return NULL;
+	}
+	return context;
+}
+
+bool HubLabelsClient::GetRoute( double* distance, QVector< Node>* pathNodes, QVector< Edge >* pathEdges, const IGPSLookup::Result& source, const IGPSLookup::Result& target )
+{
+	return GetRoute( m_context, distance, pathNodes, pathEdges, source, target );
+}
+
+bool HubLabelsClient::GetRoute( QueryContext* queryContext, double* distance, QVector< Node>* pathNodes, QVector< Edge >* pathEdges, const IGPSLookup::Result& source, const IGPSLookup::Result& target )
+{
+	assert( distance != NULL );
+	Context* context = queryContext != NULL ? static_cast< Context* >( queryContext ) : m_context;
+	assert( context != NULL );
+
+	// the labels know distances only
+	if ( pathNodes != NULL || pathEdges != NULL )
+		return m_contractionHierarchies.GetRoute( context->contractionHierarchies, distance, pathNodes, pathEdges, source, target );
+
+	sourceLabel( context, &context->forward, source );
+	targetLabel( context, &context->backward, target );
+	const int labelDistance = mergeLabels( context->forward, context->backward );
+	if ( labelDistance == std::numeric_limits< int >::max() )
+		return false;
+
+	// is it shorter to drive along the edge?
+	*distance = std::min( ( double ) labelDistance, onEdgeDistance( context, source, target ) ) / 10;
+	return true;
+}
+
+bool HubLabelsClient::GetName( QString* result, unsigned name )
+{
+	return m_contractionHierarchies.GetName( result, name );
+}
+
+bool HubLabelsClient::GetNames( QVector< QString >* result, QVector< unsigned > names )
+{
+	return m_contractionHierarchies.GetNames( result, names );
+}
+
+bool HubLabelsClient::GetType( QString* result, unsigned type )
+{
+	return m_contractionHierarchies.GetType( result, type );
+}
+
+bool HubLabelsClient::GetTypes( QVector< QString >* result, QVector< unsigned > types )
+{
+	return m_contractionHierarchies.GetTypes( result, types );
+}
+
+void HubLabelsClient::SetCacheMode( CacheMode mode )
+{
+	m_contractionHierarchies.SetCacheMode( mode );
+}
+
+ICacheSettings::CacheMode HubLabelsClient::GetCacheMode()
+{
+	return m_contractionHierarchies.GetCacheMode();
+}
+
+void HubLabelsClient::SetCacheSize( unsigned bytes )
+{
+	m_contractionHierarchies.SetCacheSize( bytes );
+}
+
+unsigned HubLabelsClient::GetCacheSize()
+{
+	return m_contractionHierarchies.GetCacheSize();
+}
+
+void HubLabelsClient::SetWarmCache( bool enabled )
+{
+	m_contractionHierarchies.SetWarmCache( enabled );
+}
+
+bool HubLabelsClient::SaveWarmCache()
+{
+	return m_contractionHierarchies.SaveWarmCache();
+}
+
+bool HubLabelsClient::GetDistanceTable( QueryContext* queryContext, QVector< double >* distances, const QVector< IGPSLookup::Result >& sources, const QVector< IGPSLookup::Result >& targets )
+{
+	assert( distances != NULL );
+	Context* context = queryContext != NULL ? static_cast< Context* >( queryContext ) : m_context;
+	assert( context != NULL );
+
+	distances->clear();
+	if ( sources.empty() || targets.empty() )
+		return true;
+
+	context->targets.resize( targets.size() );
+	for ( int target = 0; target < targets.size(); target++ )
+		targetLabel( context, &context->targets[target], targets[target] );
+
+	distances->resize( sources.size() * targets.size() );
+	for ( int source = 0; source < sources.size(); source++ ) {
+		sourceLabel( context, &context->forward, sources[source] );
+		for ( int target = 0; target < targets.size(); target++ ) {
+			double distance = mergeLabels( context->forward, context->targets[target] );
+			// is it shorter to drive along the edge?
+			// GetRoute only considers this if the endpoints are connected
+			if ( distance != std::numeric_limits< int >::max() )
+				distance = std::min( distance, onEdgeDistance( context, sources[source], targets[target] ) );
+			if ( distance == std::numeric_limits< int >::max() )
+				( *distances )[source * targets.size() + target] = std::numeric_limits< double >::max();
+			else
+				( *distances )[source * targets.size() + target] = distance / 10;
+		}
+	}
+
+	return true;
+}
+
+quint64 HubLabelsClient::GetLabelBytes()
+{
+	if ( !m_labels.loaded() )
+		return 0;
+	return m_labels.labelSize();
+}
+
+// same start and end points as the contraction hierarchy's search
+void HubLabelsClient::sourceLabel( Context* context, std::vector< Entry >* label, const IGPSLookup::Result& source )
+{
+	EdgeIterator sourceEdge = m_graph.findEdge( &context->cache, source.source, source.target, source.edgeID );
+	unsigned sourceWeight = sourceEdge.distance();
+
+	label->clear();
+	appendLabel( label, m_labels.forward( source.target ), sourceWeight - sourceWeight * source.percentage );
+	if ( sourceEdge.backward() && sourceEdge.forward() && source.target != source.source ) {
+		context->temp.swap( *label );
+		appendLabel( label, m_labels.forward( source.source ), sourceWeight * source.percentage );
+		combineLabel( context, label );
+	}
+}
+
+void HubLabelsClient::targetLabel( Context* context, std::vector< Entry >* label, const IGPSLookup::Result& target )
+{
+	EdgeIterator targetEdge = m_graph.findEdge( &context->cache, target.source, target.target, target.edgeID );
+	unsigned targetWeight = targetEdge.distance();
+
+	label->clear();
+	appendLabel( label, m_labels.backward( target.source ), targetWeight * target.percentage );
+	if ( targetEdge.backward() && targetEdge.forward() && target.target != target.source ) {
+		context->temp.swap( *label );
+		appendLabel( label, m_labels.backward( target.target ), targetWeight - targetWeight * target.percentage );
+		combineLabel( context, label );
+	}
+}
+
+void HubLabelsClient::appendLabel( std::vector< Entry >* label, HubLabelFile::LabelIterator entry, int offset )
+{
+	label->clear();
+	while ( entry.hasEntriesLeft() ) {
+		Entry next = entry.next();
+		label->push_back( Entry( next.hub, next.distance + offset ) );
+	}
+}
+
+// merges the label with the one stored in context->temp, both are sorted by hub
+// keeps the shorter distance of common hubs
+void HubLabelsClient::combineLabel( Context* context, std::vector< Entry >* label )
+{
+	std::vector< Entry >& merged = context->merged;
+	merged.clear();
+	std::merge( label->begin(), label->end(), context->temp.begin(), context->temp.end(), std::back_inserter( merged ) );
+	merged.erase( std::unique( merged.begin(), merged.end(), SameHub() ), merged.end() );
+	label->swap( merged );
+}
+
+// linear merge of two labels sorted by hub
+int HubLabelsClient::mergeLabels( const std::vector< Entry >& forward, const std::vector< Entry >& backward )
+{
+	unsigned result = std::numeric_limits< int >::max();
+	std::vector< Entry >::const_iterator i = forward.begin(), iend = forward.end();
+	std::vector< Entry >::const_iterator j = backward.begin(), jend = backward.end();
+	while ( i != iend && j != jend ) {
+		if ( i->hub < j->hub ) {
+			++i;
+		} else if ( j->hub < i->hub ) {
+			++j;
+		} else {
+			result = std::min( result, i->distance + j->distance );
+			++i;
+			++j;
+		}
+	}
+	return result;
+}
+
+// travel time when driving along the edge from the source to the target position
+// std::numeric_limits< double >::max() if they do not share an edge or the edge's direction forbids it
+double HubLabelsClient::onEdgeDistance( Context* context, const IGPSLookup::Result& source, const IGPSLookup::Result& target )
+{
+	if ( target.source != source.source || target.target != source.target || source.edgeID != target.edgeID )
+		return std::numeric_limits< double >::max();
+
+	EdgeIterator targetEdge = m_graph.findEdge( &context->cache, target.source, target.target, target.edgeID );
+	if ( !( targetEdge.forward() && targetEdge.backward() ) && source.percentage >= target.percentage )
+		return std::numeric_limits< double >::max();
+	return fabs( target.percentage - source.percentage ) * targetEdge.distance();
+}
+
+Q_EXPORT_PLUGIN2( hublabelsclient, HubLabelsClient )
@@ -0,0 +1,113 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HUBLABELSCLIENT_H
+#define HUBLABELSCLIENT_H
+
+#include <QObject>
+#include "interfaces/irouter.h"
+#include "interfaces/icachesettings.h"
+#include "interfaces/idistancetable.h"
+#include "plugins/contractionhierarchies/contractionhierarchiesclient.h"
+#include "plugins/contractionhierarchies/compressedgraph.h"
+#include "hublabelfile.h"
+#include <vector>
+
+// answers distance queries with a merge of two hub labels
+// routes with a path are computed by the contraction hierarchy the labels were derived from
+class HubLabelsClient : public QObject, public IRouter, public ICacheSettings, public IDistanceTable
+{
+	Q_OBJECT
+	Q_INTERFACES( IRouter ICacheSettings IDistanceTable )
+public:
+	HubLabelsClient();
+	virtual ~HubLabelsClient();
+
+	virtual QString GetName();
+	virtual void SetInputDirectory( const QString& dir );
+	virtual void ShowSettings();
+	virtual bool IsCompatible( int fileFormatVersion );
+	virtual bool LoadData();
+	virtual bool UnloadData();
+	virtual bool GetRoute( double* distance, QVector< Node>* pathNodes, QVector< Edge >* pathEdges, const IGPSLookup::Result& source, const IGPSLookup::Result& target );
+	virtual QueryContext* CreateQueryContext();
+	virtual bool GetRoute( QueryContext* context, double* distance, QVector< Node>* pathNodes, QVector< Edge >* pathEdges, const IGPSLookup::Result& source, const IGPSLookup::Result& target );
+	virtual bool GetName( QString* result, unsigned name );
+	virtual bool GetNames( QVector< QString >* result, QVector< unsigned > names );
+	virtual bool GetType( QString* result, unsigned type );
+	virtual bool GetTypes( QVector< QString >* result, QVector< unsigned > types );
+	virtual void SetCacheMode( CacheMode mode );
+	virtual CacheMode GetCacheMode();
+	virtual void SetCacheSize( unsigned bytes );
+	virtual unsigned GetCacheSize();
+	virtual void SetWarmCache( bool enabled );
+	virtual bool SaveWarmCache();
+	virtual bool GetDistanceTable( QueryContext* context, QVector< double >* distances, const QVector< IGPSLookup::Result >& sources, const QVector< IGPSLookup::Result >& targets );
+
+	// size of the label data in bytes
+	quint64 GetLabelBytes();
+
+protected:
+
+	typedef CompressedGraph::NodeIterator NodeIterator;
+	typedef CompressedGraph::EdgeIterator EdgeIterator;
+	typedef HubLabelFile::Entry Entry;
+
+	struct SameHub {
+		bool operator()( const Entry& left, const Entry& right ) const {
+			return left.hub == right.hub;
+		}
+	};
+
+	class Context : public QueryContext {
+	public:
+		Context() : contractionHierarchies( NULL )
+		{
+		}
+		~Context()
+		{
+			delete contractionHierarchies;
+		}
+		// NULL => the contraction hierarchy's internal context
+		QueryContext* contractionHierarchies;
+		CompressedGraph::Cache cache;
+		std::vector< Entry > forward;
+		std::vector< Entry > backward;
+		std::vector< Entry > temp;
+		std::vector< Entry > merged;
+		std::vector< std::vector< Entry > > targets;
+	};
+
+	Context* createContext();
+	// the label of a position combines the labels of the edge's endpoints, offset by the travel time along the edge
+	void sourceLabel( Context* context, std::vector< Entry >* label, const IGPSLookup::Result& source );
+	void targetLabel( Context* context, std::vector< Entry >* label, const IGPSLookup::Result& target );
+	void appendLabel( std::vector< Entry >* label, HubLabelFile::LabelIterator entry, int offset );
+	void combineLabel( Context* context, std::vector< Entry >* label );
+	static int mergeLabels( const std::vector< Entry >& forward, const std::vector< Entry >& backward );
+	double onEdgeDistance( Context* context, const IGPSLookup::Result& source, const IGPSLookup::Result& target );
+
+	ContractionHierarchiesClient m_contractionHierarchies;
+	CompressedGraph m_graph;
+	HubLabelFile m_labels;
+	QString m_directory;
+	Context* m_context;
+};
+
+#endif // HUBLABELSCLIENT_H
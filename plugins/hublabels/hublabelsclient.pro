@@ -0,0 +1,38 @@
+TEMPLATE = lib
+CONFIG += plugin static
+
+INCLUDEPATH += ../..
+
+DESTDIR = ../../bin/plugins_client
+unix {
+	QMAKE_CXXFLAGS_RELEASE -= -O2
+	QMAKE_CXXFLAGS_RELEASE += -O3 \
+		 -Wno-unused-function
+	QMAKE_CXXFLAGS_DEBUG += -Wno-unused-function
+}
+
+nogui {
+	DEFINES+=NOGUI
+	QT -= gui
+}
+
+HEADERS += \
+	 ../../utils/coordinates.h \
+	 ../../utils/config.h \
+	 ../../interfaces/irouter.h \
+	 ../../interfaces/icachesettings.h \
+	 ../../interfaces/idistancetable.h \
+	 ../../interfaces/igpslookup.h \
+	 ../contractionhierarchies/contractionhierarchiesclient.h \
+	 ../contractionhierarchies/compressedgraph.h \
+	 ../contractionhierarchies/frequencycache.h \
+	 ../contractionhierarchies/blockcache.h \
+	 ../contractionhierarchies/mappedblocks.h \
+	 hublabelsclient.h \
+	 hublabelfile.h \
+	 ../../utils/bithelpers.h \
+	 ../../utils/bitunpack.h \
+	 ../../utils/qthelpers.h
+
+SOURCES += \
+	 hublabelsclient.cpp
@@ -1,6 +1,7 @@
 TEMPLATE = subdirs
-SUBDIRS = ch gg osmr mr qr utt osmi ti
+SUBDIRS = ch hl gg osmr mr qr utt osmi ti
 ch.file = contractionhierarchies/contractionhierarchies.pro
+hl.file = hublabels/hublabels.pro
 gg.file = gpsgrid/gpsgrid.pro
 osmr.file = osmrenderer/osmrenderer.pro
 mr.file = osmrenderer/mapnikrenderer.pro
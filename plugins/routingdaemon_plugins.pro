@@ -1,4 +1,5 @@
 TEMPLATE = subdirs
-SUBDIRS = ch gg
+SUBDIRS = ch hl gg
 ch.file = contractionhierarchies/contractionhierarchiesclient.pro
+hl.file = hublabels/hublabelsclient.pro
 gg.file = gpsgrid/gpsgridclient.pro
@@ -30,6 +30,7 @@ along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
 
 Q_IMPORT_PLUGIN( mapnikrenderer );
 Q_IMPORT_PLUGIN( contractionhierarchies );
+Q_IMPORT_PLUGIN( hublabels );
 Q_IMPORT_PLUGIN( gpsgrid );
 Q_IMPORT_PLUGIN( unicodetournamenttrie );
 Q_IMPORT_PLUGIN( osmrenderer );
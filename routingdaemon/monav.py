@@ -25,6 +25,9 @@ import socket
 import struct
 
 from signals_pb2 import CommandType, VersionCommand, VersionResult, RoutingCommand, RoutingResult
+from signals_pb2 import DistanceTableCommand, DistanceTableResult
+from signals_pb2 import IsochroneCommand, IsochroneResult
+from signals_pb2 import TrafficUpdateCommand, TrafficUpdateResult
 from signals_pb2 import Node as Waypoint
 
 
@@ -101,7 +104,7 @@ def get_version(connection=None):
     return result.version
 
 
-def get_route(data_directory, waypoints, lookup_radius=10000, lookup_edge_names=True, connection=None):
+def get_route(data_directory, waypoints, lookup_radius=10000, lookup_edge_names=True, alternatives=0, connection=None):
     """Get the shortest route between a list of waypoints using MoNav.
 
     * connection should be a TcpConnection object.
@@ -115,6 +118,10 @@ def get_route(data_directory, waypoints, lookup_radius=10000, lookup_edge_names=
         edges
         edge_names
         edge_types
+        alternatives
+
+    * alternatives is the maximum number of alternative routes to compute
+      in addition to the shortest one, only for two waypoints.
 
     * First start the monav-server.
 
@@ -130,6 +137,7 @@ def get_route(data_directory, waypoints, lookup_radius=10000, lookup_edge_names=
     command.data_directory = data_directory
     command.lookup_radius = lookup_radius
     command.lookup_edge_names = lookup_edge_names
+    command.alternatives = alternatives
 
     if hasattr(waypoints[0], 'latitude'):
         command.waypoints.extend(waypoints)
@@ -163,3 +171,183 @@ def get_route(data_directory, waypoints, lookup_radius=10000, lookup_edge_names=
     else:
         raise Exception(str(result.type) + ": return value not recognized")
 
+
+def get_distance_table(data_directory, sources, targets, lookup_radius=10000, connection=None):
+    """Get the travel time from every source to every target using MoNav.
+
+    * sources and targets are lists of Waypoints or (latitude, longitude)
+      tuples.
+
+    * Return a list of rows, one per source, each containing the travel
+      time in seconds to every target. Unreachable targets are None.
+
+    * First start the monav-server.
+
+    """
+    if not connection:
+        connection = TcpConnection()
+
+    # Generate and write the command type.
+    connection.write(CommandType(value=CommandType.DISTANCE_TABLE_COMMAND))
+
+    # Generate the command.
+    command = DistanceTableCommand()
+    command.data_directory = data_directory
+    command.lookup_radius = lookup_radius
+
+    for waypoints, field in ((sources, command.sources), (targets, command.targets)):
+        for waypoint in waypoints:
+            if hasattr(waypoint, 'latitude'):
+                field.add().CopyFrom(waypoint)
+            else:
+                assert len(waypoint) == 2
+                field.add(latitude=waypoint[0], longitude=waypoint[1])
+
+    # Write the command.
+    connection.write(command)
+
+    # Read result.
+    result = DistanceTableResult()
+    connection.read(result)
+
+    # Close the connection (just in case)
+    connection.close()
+
+    if result.type == DistanceTableResult.SUCCESS:
+        n = len(targets)
+        return [[seconds if seconds >= 0 else None for seconds in result.seconds[i * n:(i + 1) * n]]
+                for i in range(len(sources))]
+    elif result.type == DistanceTableResult.LOAD_FAILED:
+        raise Exception(str(result.type) + ": failed to load data directory")
+    elif result.type == DistanceTableResult.LOOKUP_FAILED:
+        raise Exception(str(result.type) + ": failed to lookup nearest edge")
+    elif result.type == DistanceTableResult.NOT_SUPPORTED:
+        raise Exception(str(result.type) + ": router does not support distance tables")
+    elif result.type == DistanceTableResult.QUERY_FAILED:
+        raise Exception(str(result.type) + ": failed to compute distance table")
+    elif result.type == DistanceTableResult.TOO_LARGE:
+        raise Exception(str(result.type) + ": too many sources and targets")
+    else:
+        raise Exception(str(result.type) + ": return value not recognized")
+
+
+def get_isochrones(data_directory, source, limits, resolution=100, lookup_radius=10000, reachable_nodes=False, connection=None):
+    """Get the areas reachable from source within the given travel times using MoNav.
+
+    * source is a Waypoint or a (latitude, longitude) tuple, limits is a
+      list of travel times in seconds.
+
+    * Return a list with one entry per limit, each a list of rings of
+      (latitude, longitude) tuples. Outer boundaries and holes have opposite
+      orientation. With reachable_nodes the list of
+      ((latitude, longitude), seconds) tuples of all routing nodes within the
+      largest limit is returned as well.
+
+    * First start the monav-server.
+
+    """
+    if not connection:
+        connection = TcpConnection()
+
+    # Generate and write the command type.
+    connection.write(CommandType(value=CommandType.ISOCHRONE_COMMAND))
+
+    # Generate the command.
+    command = IsochroneCommand()
+    command.data_directory = data_directory
+    command.lookup_radius = lookup_radius
+    command.resolution = resolution
+    command.reachable_nodes = reachable_nodes
+    command.limits.extend(limits)
+
+    if hasattr(source, 'latitude'):
+        command.source.CopyFrom(source)
+    else:
+        assert len(source) == 2
+        command.source.latitude = source[0]
+        command.source.longitude = source[1]
+
+    # Write the command.
+    connection.write(command)
+
+    # Read result.
+    result = IsochroneResult()
+    connection.read(result)
+
+    # Close the connection (just in case)
+    connection.close()
+
+    if result.type == IsochroneResult.SUCCESS:
+        isochrones = [[[(node.latitude, node.longitude) for node in ring.nodes] for ring in isochrone.rings]
+                      for isochrone in result.isochrones]
+        if not reachable_nodes:
+            return isochrones
+        return isochrones, [((reached.node.latitude, reached.node.longitude), reached.seconds)
+                            for reached in result.reached_nodes]
+    elif result.type == IsochroneResult.LOAD_FAILED:
+        raise Exception(str(result.type) + ": failed to load data directory")
+    elif result.type == IsochroneResult.LOOKUP_FAILED:
+        raise Exception(str(result.type) + ": failed to lookup nearest edge")
+    elif result.type == IsochroneResult.NOT_SUPPORTED:
+        raise Exception(str(result.type) + ": router does not support isochrones")
+    elif result.type == IsochroneResult.QUERY_FAILED:
+        raise Exception(str(result.type) + ": failed to compute isochrones")
+    elif result.type == IsochroneResult.INVALID_REQUEST:
+        raise Exception(str(result.type) + ": invalid limits or resolution")
+    else:
+        raise Exception(str(result.type) + ": return value not recognized")
+
+
+def update_traffic(data_directory, weights, clear=False, connection=None):
+    """Replace the travel times of routing edges in the loaded MoNav data.
+
+    * weights is a list of (edge, seconds) tuples, edge being the index of
+      the routing edge as written by the importer.
+
+    * With clear the preprocessed travel times are restored first.
+
+    * Return a dict with the number of changed edges, ignored edges,
+      recomputed shortcuts, changed shortcuts, overlaid edges, nodes of the
+      region around decreased travel times, and the routes computed since
+      the previous update together with those of them that had to search
+      the whole graph.
+
+    * First start the monav-server.
+
+    """
+    if not connection:
+        connection = TcpConnection()
+
+    # Generate and write the command type.
+    connection.write(CommandType(value=CommandType.TRAFFIC_UPDATE_COMMAND))
+
+    # Generate the command.
+    command = TrafficUpdateCommand()
+    command.data_directory = data_directory
+    command.clear = clear
+    for edge, seconds in weights:
+        command.edges.append(edge)
+        command.seconds.append(seconds)
+
+    # Write the command.
+    connection.write(command)
+
+    # Read result.
+    result = TrafficUpdateResult()
+    connection.read(result)
+
+    # Close the connection (just in case)
+    connection.close()
+
+    if result.type == TrafficUpdateResult.SUCCESS:
+        return {'edges': result.edges, 'ignored': result.ignored, 'shortcuts': result.shortcuts,
+                'changed_shortcuts': result.changed_shortcuts, 'overlaid_edges': result.overlaid_edges,
+                'region_nodes': result.region_nodes, 'routes': result.routes, 'fallbacks': result.fallbacks}
+    elif result.type == TrafficUpdateResult.LOAD_FAILED:
+        raise Exception(str(result.type) + ": failed to load data directory")
+    elif result.type == TrafficUpdateResult.NOT_SUPPORTED:
+        raise Exception(str(result.type) + ": router does not support traffic updates")
+    elif result.type == TrafficUpdateResult.UPDATE_FAILED:
+        raise Exception(str(result.type) + ": failed to update travel times")
+    else:
+        raise Exception(str(result.type) + ": return value not recognized")
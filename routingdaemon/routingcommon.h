@@ -24,9 +24,16 @@ along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
 #include <QSettings>
 #include <QFile>
 #include <QtDebug>
+#include <vector>
 
 #include "interfaces/irouter.h"
 #include "interfaces/igpslookup.h"
+#include "interfaces/icachesettings.h"
+#include "interfaces/idistancetable.h"
+#include "interfaces/iisochrone.h"
+#include "interfaces/ialternativeroutes.h"
+#include "interfaces/itrafficoverlay.h"
+#include "interfaces/iquerystatistics.h"
 #include "utils/directoryunpacker.h"
 
 #include "signals.h"
@@ -41,6 +48,14 @@ public:
 		m_loaded = false;
 		m_gpsLookup = NULL,
 		m_router = NULL;
+		m_distanceTable = NULL;
+		m_isochrone = NULL;
+		m_alternativeRoutes = NULL;
+		m_trafficOverlay = NULL;
+		m_queryStatistics = NULL;
+		m_statisticsQueries = 0;
+		m_cacheSettings = NULL;
+		m_warmCacheQueries = 0;
 	}
 
 	~RoutingCommon()
@@ -50,6 +65,11 @@ public:
 
 protected:
 
+	// limits the memory of a single distance table request
+	static const int maxDistanceTableEntries = 1000000;
+	// smallest grid cell in meters an isochrone is rasterized into
+	static const int minIsochroneResolution = 5;
+
 	// Handle the connection before the command type is known.
 	void handleConnection( Socket* connection )
 	{
@@ -68,6 +88,12 @@ protected:
 			handleConnection<MoNav::UnpackCommand, MoNav::UnpackResult>( connection );
 		} else if ( type.value() == MoNav::CommandType::ROUTING_COMMAND ) {
 			handleConnection<MoNav::RoutingCommand, MoNav::RoutingResult>( connection );
+		} else if ( type.value() == MoNav::CommandType::DISTANCE_TABLE_COMMAND ) {
+			handleConnection<MoNav::DistanceTableCommand, MoNav::DistanceTableResult>( connection );
+		} else if ( type.value() == MoNav::CommandType::ISOCHRONE_COMMAND ) {
+			handleConnection<MoNav::IsochroneCommand, MoNav::IsochroneResult>( connection );
+		} else if ( type.value() == MoNav::CommandType::TRAFFIC_UPDATE_COMMAND ) {
+			handleConnection<MoNav::TrafficUpdateCommand, MoNav::TrafficUpdateResult>( connection );
 		}
 	}
 
@@ -127,47 +153,44 @@ protected:
 
 		result.set_type( MoNav::RoutingResult::SUCCESS );
 
-		QString dataDirectory = command.data_directory().c_str();
-		if ( !m_loaded || dataDirectory != m_dataDirectory ) {
-			unloadPlugins();
-			m_loaded = loadPlugins( dataDirectory );
-			m_dataDirectory = dataDirectory;
-		}
-
-		if ( m_loaded ) {
+		if ( loadDataDirectory( command.data_directory().c_str() ) ) {
 			QVector< IRouter::Node > pathNodes;
 			QVector< IRouter::Edge > pathEdges;
 			double distance = 0;
 			bool success = true;
-			for ( int i = 1; i < command.waypoints_size(); i++ ) {
-				if ( i != 1 ) {
-					// Remove last node.
-					result.mutable_nodes( result.nodes_size() - 1 )->Clear();
-				}
-				double segmentDistance;
-				pathNodes.clear();
-				pathEdges.clear();
-				result.set_type( computeRoute( &segmentDistance, &pathNodes, &pathEdges, command.waypoints( i - 1 ), command.waypoints( i ), command.lookup_radius() ) );
-				if ( result.type() != MoNav::RoutingResult::SUCCESS ) {
-					success = false;
-					break;
-				}
-				distance += segmentDistance;
-
-				for ( int j = 0; j < pathNodes.size(); j++ ) {
-					GPSCoordinate gps = pathNodes[j].coordinate.ToGPSCoordinate();
-					MoNav::Node* node = result.add_nodes();
-					node->set_latitude( gps.latitude );
-					node->set_longitude( gps.longitude );
+			if ( command.alternatives() > 0 && command.waypoints_size() == 2 && m_alternativeRoutes != NULL ) {
+				// the shortest route is the first one of the alternative route query
+				QVector< IAlternativeRoutes::Route > routes;
+				result.set_type( computeAlternativeRoutes( &routes, command.waypoints( 0 ), command.waypoints( 1 ), command.lookup_radius(), command.alternatives() ) );
+				success = result.type() == MoNav::RoutingResult::SUCCESS;
+				if ( success ) {
+					distance = routes.first().seconds;
+					addPath( &result, routes.first().pathNodes, routes.first().pathEdges );
+					for ( int i = 1; i < routes.size(); i++ ) {
+						MoNav::AlternativeRoute* alternative = result.add_alternatives();
+						alternative->set_seconds( routes[i].seconds );
+						addPath( alternative, routes[i].pathNodes, routes[i].pathEdges );
+					}
 				}
+			} else {
+				if ( command.alternatives() > 0 )
+					qDebug() << "alternative routes are only supported for two waypoints by routers implementing them";
+				for ( int i = 1; i < command.waypoints_size(); i++ ) {
+					if ( i != 1 ) {
+						// Remove last node.
+						result.mutable_nodes( result.nodes_size() - 1 )->Clear();
+					}
+					double segmentDistance;
+					pathNodes.clear();
+					pathEdges.clear();
+					result.set_type( computeRoute( &segmentDistance, &pathNodes, &pathEdges, command.waypoints( i - 1 ), command.waypoints( i ), command.lookup_radius() ) );
+					if ( result.type() != MoNav::RoutingResult::SUCCESS ) {
+						success = false;
+						break;
+					}
+					distance += segmentDistance;
 
-				for ( int j = 0; j < pathEdges.size(); j++ ) {
-					MoNav::Edge* edge = result.add_edges();
-					edge->set_n_segments( pathEdges[j].length );
-					edge->set_name_id( pathEdges[j].name );
-					edge->set_type_id( pathEdges[j].type );
-					edge->set_seconds( pathEdges[j].seconds );
-					edge->set_branching_possible( pathEdges[j].branchingPossible );
+					addPath( &result, pathNodes, pathEdges );
 				}
 			}
 			result.set_seconds( distance );
@@ -178,8 +201,15 @@ protected:
 					QString lastName;
 					unsigned lastTypeID = std::numeric_limits< unsigned >::max();
 					QString lastType;
-					for ( int j = 0; j < result.edges_size(); j++ ) {
-						MoNav::Edge* edge = result.mutable_edges( j );
+					std::vector< MoNav::Edge* > edges;
+					for ( int j = 0; j < result.edges_size(); j++ )
+						edges.push_back( result.mutable_edges( j ) );
+					for ( int i = 0; i < result.alternatives_size(); i++ ) {
+						for ( int j = 0; j < result.alternatives( i ).edges_size(); j++ )
+							edges.push_back( result.mutable_alternatives( i )->mutable_edges( j ) );
+					}
+					for ( unsigned j = 0; j < edges.size(); j++ ) {
+						MoNav::Edge* edge = edges[j];
 
 						if ( lastNameID != edge->name_id() ) {
 							lastNameID = edge->name_id();
@@ -207,6 +237,212 @@ protected:
 		return result;
 	}
 
+	// Execute distance table command.
+	MoNav::DistanceTableResult execute( const MoNav::DistanceTableCommand command )
+	{
+		MoNav::DistanceTableResult result;
+
+		result.set_type( MoNav::DistanceTableResult::SUCCESS );
+
+		if ( !loadDataDirectory( command.data_directory().c_str() ) ) {
+			result.set_type( MoNav::DistanceTableResult::LOAD_FAILED );
+			return result;
+		}
+		if ( m_distanceTable == NULL ) {
+			qCritical() << "router does not support distance tables";
+			result.set_type( MoNav::DistanceTableResult::NOT_SUPPORTED );
+			return result;
+		}
+		if ( ( qint64 ) command.sources_size() * command.targets_size() > maxDistanceTableEntries ) {
+			qCritical() << "distance table too large:" << command.sources_size() << "x" << command.targets_size();
+			result.set_type( MoNav::DistanceTableResult::TOO_LARGE );
+			return result;
+		}
+
+		QTime time;
+		time.start();
+		QVector< IGPSLookup::Result > sources( command.sources_size() );
+		for ( int i = 0; i < command.sources_size(); i++ ) {
+			if ( !lookupPosition( &sources[i], command.sources( i ), command.lookup_radius() ) ) {
+				result.set_type( MoNav::DistanceTableResult::LOOKUP_FAILED );
+				return result;
+			}
+		}
+		QVector< IGPSLookup::Result > targets( command.targets_size() );
+		for ( int i = 0; i < command.targets_size(); i++ ) {
+			if ( !lookupPosition( &targets[i], command.targets( i ), command.lookup_radius() ) ) {
+				result.set_type( MoNav::DistanceTableResult::LOOKUP_FAILED );
+				return result;
+			}
+		}
+		qDebug() << "GPS Lookup:" << time.restart() << "ms";
+
+		QVector< double > distances;
+		if ( !m_distanceTable->GetDistanceTable( NULL, &distances, sources, targets ) ) {
+			result.set_type( MoNav::DistanceTableResult::QUERY_FAILED );
+			return result;
+		}
+		qDebug() << "Distance Table:" << sources.size() << "x" << targets.size() << time.restart() << "ms";
+
+		for ( int i = 0; i < distances.size(); i++ ) {
+			if ( distances[i] == std::numeric_limits< double >::max() )
+				result.add_seconds( -1 );
+			else
+				result.add_seconds( distances[i] );
+		}
+
+		return result;
+	}
+
+	// Execute isochrone command.
+	MoNav::IsochroneResult execute( const MoNav::IsochroneCommand command )
+	{
+		MoNav::IsochroneResult result;
+
+		result.set_type( MoNav::IsochroneResult::SUCCESS );
+
+		if ( !loadDataDirectory( command.data_directory().c_str() ) ) {
+			result.set_type( MoNav::IsochroneResult::LOAD_FAILED );
+			return result;
+		}
+		if ( m_isochrone == NULL ) {
+			qCritical() << "router does not support isochrones";
+			result.set_type( MoNav::IsochroneResult::NOT_SUPPORTED );
+			return result;
+		}
+
+		// also rejects NaN
+		if ( !( command.resolution() >= minIsochroneResolution ) ) {
+			qCritical() << "isochrone resolution too small:" << command.resolution();
+			result.set_type( MoNav::IsochroneResult::INVALID_REQUEST );
+			return result;
+		}
+		if ( command.limits_size() == 0 ) {
+			qCritical() << "no isochrone limits given";
+			result.set_type( MoNav::IsochroneResult::INVALID_REQUEST );
+			return result;
+		}
+		for ( int i = 0; i < command.limits_size(); i++ ) {
+			if ( !( command.limits( i ) >= 0 ) ) {
+				qCritical() << "invalid isochrone limit:" << command.limits( i );
+				result.set_type( MoNav::IsochroneResult::INVALID_REQUEST );
+				return result;
+			}
+		}
+
+		QTime time;
+		time.start();
+		IGPSLookup::Result source;
+		if ( !lookupPosition( &source, command.source(), command.lookup_radius() ) ) {
+			result.set_type( MoNav::IsochroneResult::LOOKUP_FAILED );
+			return result;
+		}
+		qDebug() << "GPS Lookup:" << time.restart() << "ms";
+
+		QVector< double > limits;
+		for ( int i = 0; i < command.limits_size(); i++ )
+			limits.push_back( command.limits( i ) );
+
+		QVector< IIsochrone::Isochrone > isochrones;
+		if ( !m_isochrone->GetIsochrones( NULL, &isochrones, source, limits, command.resolution() ) ) {
+			result.set_type( MoNav::IsochroneResult::QUERY_FAILED );
+			return result;
+		}
+		qDebug() << "Isochrones:" << limits.size() << time.restart() << "ms";
+
+		for ( int i = 0; i < isochrones.size(); i++ ) {
+			MoNav::Isochrone* isochrone = result.add_isochrones();
+			isochrone->set_seconds( isochrones[i].seconds );
+			for ( int ring = 0; ring < isochrones[i].rings.size(); ring++ ) {
+				MoNav::Ring* resultRing = isochrone->add_rings();
+				const QVector< UnsignedCoordinate >& nodes = isochrones[i].rings[ring];
+				for ( int node = 0; node < nodes.size(); node++ ) {
+					GPSCoordinate gps = nodes[node].ToGPSCoordinate();
+					MoNav::Node* resultNode = resultRing->add_nodes();
+					resultNode->set_latitude( gps.latitude );
+					resultNode->set_longitude( gps.longitude );
+				}
+			}
+		}
+
+		if ( command.reachable_nodes() && !limits.empty() ) {
+			QVector< IIsochrone::ReachedNode > reached;
+			if ( !m_isochrone->GetReachableNodes( NULL, &reached, source, *std::max_element( limits.begin(), limits.end() ) ) ) {
+				result.set_type( MoNav::IsochroneResult::QUERY_FAILED );
+				return result;
+			}
+			for ( int i = 0; i < reached.size(); i++ ) {
+				GPSCoordinate gps = reached[i].coordinate.ToGPSCoordinate();
+				MoNav::ReachedNode* resultNode = result.add_reached_nodes();
+				resultNode->mutable_node()->set_latitude( gps.latitude );
+				resultNode->mutable_node()->set_longitude( gps.longitude );
+				resultNode->set_seconds( reached[i].seconds );
+			}
+			qDebug() << "Reachable Nodes:" << reached.size() << time.restart() << "ms";
+		}
+
+		return result;
+	}
+
+	// Execute traffic update command.
+	MoNav::TrafficUpdateResult execute( const MoNav::TrafficUpdateCommand command )
+	{
+		MoNav::TrafficUpdateResult result;
+
+		result.set_type( MoNav::TrafficUpdateResult::SUCCESS );
+
+		if ( !loadDataDirectory( command.data_directory().c_str() ) ) {
+			result.set_type( MoNav::TrafficUpdateResult::LOAD_FAILED );
+			return result;
+		}
+		if ( m_trafficOverlay == NULL ) {
+			qCritical() << "router does not support traffic updates";
+			result.set_type( MoNav::TrafficUpdateResult::NOT_SUPPORTED );
+			return result;
+		}
+		if ( command.edges_size() != command.seconds_size() ) {
+			qCritical() << "traffic update needs one travel time per edge";
+			result.set_type( MoNav::TrafficUpdateResult::UPDATE_FAILED );
+			return result;
+		}
+
+		if ( command.clear() )
+			m_trafficOverlay->ClearEdgeWeights();
+
+		QVector< ITrafficOverlay::EdgeWeight > weights;
+		for ( int i = 0; i < command.edges_size(); i++ )
+			weights.push_back( ITrafficOverlay::EdgeWeight( command.edges( i ), command.seconds( i ) ) );
+
+		ITrafficOverlay::UpdateStatistics statistics;
+		if ( !m_trafficOverlay->UpdateEdgeWeights( weights, &statistics ) ) {
+			result.set_type( MoNav::TrafficUpdateResult::UPDATE_FAILED );
+			return result;
+		}
+		qDebug() << "Traffic Update:" << statistics.edges << "edges," << statistics.shortcuts << "shortcuts," << statistics.milliseconds << "ms";
+		qDebug() << "Traffic Update:" << statistics.regionNodes << "region nodes," << statistics.fallbacks << "of" << statistics.routes << "routes searched the whole graph";
+
+		result.set_edges( statistics.edges );
+		result.set_ignored( statistics.ignored );
+		result.set_shortcuts( statistics.shortcuts );
+		result.set_changed_shortcuts( statistics.changedShortcuts );
+		result.set_overlaid_edges( statistics.overlaidEdges );
+		result.set_region_nodes( statistics.regionNodes );
+		result.set_routes( statistics.routes );
+		result.set_fallbacks( statistics.fallbacks );
+
+		return result;
+	}
+
+	bool lookupPosition( IGPSLookup::Result* result, const MoNav::Node& position, double lookupRadius )
+	{
+		UnsignedCoordinate coordinate( GPSCoordinate( position.latitude(), position.longitude() ) );
+		if ( !m_gpsLookup->GetNearestEdge( result, coordinate, lookupRadius, position.heading_penalty(), position.heading() ) ) {
+			qDebug() << "no edge near waypoint found";
+			return false;
+		}
+		return true;
+	}
+
 	MoNav::RoutingResult::Type computeRoute( double* resultDistance, QVector< IRouter::Node >* resultNodes, QVector< IRouter::Edge >* resultEdge, MoNav::Node source, MoNav::Node target, double lookupRadius )
 	{
 		if ( m_gpsLookup == NULL || m_router == NULL ) {
@@ -233,6 +469,8 @@ protected:
 		}
 		found = m_router->GetRoute( resultDistance, resultNodes, resultEdge, sourcePosition, targetPosition );
 		qDebug() << "Routing:" << time.restart() << "ms";
+		logQueryStatistics();
+		saveWarmCache();
 
 		if ( !found ) {
 			return MoNav::RoutingResult::ROUTE_FAILED;
@@ -241,6 +479,99 @@ protected:
 		return MoNav::RoutingResult::SUCCESS;
 	}
 
+	MoNav::RoutingResult::Type computeAlternativeRoutes( QVector< IAlternativeRoutes::Route >* routes, MoNav::Node source, MoNav::Node target, double lookupRadius, int alternatives )
+	{
+		if ( m_gpsLookup == NULL || m_alternativeRoutes == NULL ) {
+			qCritical() << "tried to query route before setting valid data directory";
+			return MoNav::RoutingResult::LOAD_FAILED;
+		}
+		QTime time;
+		time.start();
+		IGPSLookup::Result sourcePosition;
+		IGPSLookup::Result targetPosition;
+		if ( !lookupPosition( &sourcePosition, source, lookupRadius ) || !lookupPosition( &targetPosition, target, lookupRadius ) )
+			return MoNav::RoutingResult::LOOKUP_FAILED;
+		qDebug() << "GPS Lookup:" << time.restart() << "ms";
+		bool found = m_alternativeRoutes->GetAlternativeRoutes( NULL, routes, sourcePosition, targetPosition, alternatives, IAlternativeRoutes::Limits() );
+		qDebug() << "Alternative Routes:" << routes->size() << time.restart() << "ms";
+		logQueryStatistics();
+		saveWarmCache();
+
+		if ( !found || routes->empty() )
+			return MoNav::RoutingResult::ROUTE_FAILED;
+
+		return MoNav::RoutingResult::SUCCESS;
+	}
+
+	// logs the counters of the last query and adds them to the totals of the loaded data
+	void logQueryStatistics()
+	{
+		IQueryStatistics::QueryStatistics statistics;
+		if ( m_queryStatistics == NULL || !m_queryStatistics->GetQueryStatistics( NULL, &statistics ) )
+			return;
+		qDebug() << "Query Statistics: settled" << statistics.settledForward << "/" << statistics.settledBackward
+				<< "stalled" << statistics.stalled << "relaxed" << statistics.relaxedEdges
+				<< "blocks" << statistics.blocks << "read" << statistics.blocksRead << "decoded" << statistics.decodedBlocks
+				<< "path blocks" << statistics.pathBlocks << "read" << statistics.pathBlocksRead
+				<< "unpack depth" << statistics.unpackDepth;
+
+		m_statisticsTotal.add( statistics );
+		m_statisticsQueries++;
+		if ( m_statisticsQueries % 100 != 0 )
+			return;
+		const double queries = m_statisticsQueries;
+		qDebug() << "Query Statistics: average of" << m_statisticsQueries << "queries: settled"
+				<< ( m_statisticsTotal.settledForward + m_statisticsTotal.settledBackward ) / queries
+				<< "stalled" << m_statisticsTotal.stalled / queries << "relaxed" << m_statisticsTotal.relaxedEdges / queries
+				<< "blocks" << m_statisticsTotal.blocks / queries << "read" << m_statisticsTotal.blocksRead / queries
+				<< "path blocks" << m_statisticsTotal.pathBlocks / queries << "read" << m_statisticsTotal.pathBlocksRead / queries
+				<< "max unpack depth" << m_statisticsTotal.unpackDepth;
+	}
+
+	// remembers the most used blocks every now and then, a restarted daemon prefetches them
+	void saveWarmCache()
+	{
+		if ( m_cacheSettings == NULL )
+			return;
+		m_warmCacheQueries++;
+		if ( m_warmCacheQueries % 1000 != 0 )
+			return;
+		if ( !m_cacheSettings->SaveWarmCache() )
+			qDebug() << "failed to save the warm cache";
+	}
+
+	// appends the path to a message with nodes and edges
+	template< class Message >
+	void addPath( Message* message, const QVector< IRouter::Node >& pathNodes, const QVector< IRouter::Edge >& pathEdges )
+	{
+		for ( int j = 0; j < pathNodes.size(); j++ ) {
+			GPSCoordinate gps = pathNodes[j].coordinate.ToGPSCoordinate();
+			MoNav::Node* node = message->add_nodes();
+			node->set_latitude( gps.latitude );
+			node->set_longitude( gps.longitude );
+		}
+
+		for ( int j = 0; j < pathEdges.size(); j++ ) {
+			MoNav::Edge* edge = message->add_edges();
+			edge->set_n_segments( pathEdges[j].length );
+			edge->set_name_id( pathEdges[j].name );
+			edge->set_type_id( pathEdges[j].type );
+			edge->set_seconds( pathEdges[j].seconds );
+			edge->set_branching_possible( pathEdges[j].branchingPossible );
+		}
+	}
+
+	// loads the plugins if the data directory changed
+	bool loadDataDirectory( QString dataDirectory )
+	{
+		if ( !m_loaded || dataDirectory != m_dataDirectory ) {
+			unloadPlugins();
+			m_loaded = loadPlugins( dataDirectory );
+			m_dataDirectory = dataDirectory;
+		}
+		return m_loaded;
+	}
+
 	bool loadPlugins( QString dataDirectory )
 	{
 		QDir dir( dataDirectory );
@@ -283,7 +614,7 @@ protected:
 				return false;
 			}
 			int routerFileFormatVersion = pluginSettings.value( "routerFileFormatVersion" ).toInt();
-			if ( !m_gpsLookup->IsCompatible( routerFileFormatVersion ) ) {
+			if ( !m_router->IsCompatible( routerFileFormatVersion ) ) {
 				qCritical() << "Router file format not compatible";
 				return false;
 			}
@@ -313,21 +644,55 @@ protected:
 		}
 		if ( IRouter *interface = qobject_cast< IRouter* >( plugin ) ) {
 			qDebug() << "found plugin:" << interface->GetName();
-			if ( interface->GetName() == routerName )
+			if ( interface->GetName() == routerName ) {
 				m_router = interface;
+				// servers have plenty of memory => avoid private copies of the data
+				m_cacheSettings = qobject_cast< ICacheSettings* >( plugin );
+				if ( m_cacheSettings != NULL ) {
+					m_cacheSettings->SetCacheMode( ICacheSettings::MemoryMapped );
+					m_cacheSettings->SetWarmCache( true );
+				}
+				m_distanceTable = qobject_cast< IDistanceTable* >( plugin );
+				m_isochrone = qobject_cast< IIsochrone* >( plugin );
+				m_alternativeRoutes = qobject_cast< IAlternativeRoutes* >( plugin );
+				m_trafficOverlay = qobject_cast< ITrafficOverlay* >( plugin );
+				// the daemon logs the cost of every query anyway
+				m_queryStatistics = qobject_cast< IQueryStatistics* >( plugin );
+				if ( m_queryStatistics != NULL )
+					m_queryStatistics->SetCollectStatistics( true );
+			}
 		}
 	}
 
 	void unloadPlugins()
 	{
 		m_router = NULL;
+		m_distanceTable = NULL;
+		m_isochrone = NULL;
+		m_alternativeRoutes = NULL;
+		m_trafficOverlay = NULL;
+		m_queryStatistics = NULL;
 		m_gpsLookup = NULL;
+		m_statisticsTotal = IQueryStatistics::QueryStatistics();
+		m_statisticsQueries = 0;
+		m_cacheSettings = NULL;
+		m_warmCacheQueries = 0;
 	}
 
 	bool m_loaded;
 	QString m_dataDirectory;
 	IGPSLookup* m_gpsLookup;
 	IRouter* m_router;
+	IDistanceTable* m_distanceTable;
+	IIsochrone* m_isochrone;
+	IAlternativeRoutes* m_alternativeRoutes;
+	ITrafficOverlay* m_trafficOverlay;
+	IQueryStatistics* m_queryStatistics;
+	// sums of the query statistics since the data was loaded
+	IQueryStatistics::QueryStatistics m_statisticsTotal;
+	unsigned m_statisticsQueries;
+	ICacheSettings* m_cacheSettings;
+	unsigned m_warmCacheQueries;
 };
 
 #endif // ROUTINGCOMMON_H
@@ -22,6 +22,7 @@ along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
 #include "routingdaemon.h"
 
 Q_IMPORT_PLUGIN( contractionhierarchiesclient );
+Q_IMPORT_PLUGIN( hublabelsclient );
 Q_IMPORT_PLUGIN( gpsgridclient );
 
 QtMsgHandler oldHandler = NULL;
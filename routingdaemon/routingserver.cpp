@@ -21,6 +21,7 @@ along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
 #include "routingserver.h"
 
 Q_IMPORT_PLUGIN( contractionhierarchiesclient );
+Q_IMPORT_PLUGIN( hublabelsclient );
 Q_IMPORT_PLUGIN( gpsgridclient );
 
 int main( int argc, char** argv )
@@ -0,0 +1,24 @@
+QT       += core
+
+QT       -= gui
+
+INCLUDEPATH += ../..
+
+TARGET = bit-unpack-benchmark
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+unix {
+	QMAKE_CXXFLAGS_RELEASE -= -O2
+	QMAKE_CXXFLAGS_RELEASE += -O3 \
+		 -Wno-unused-function
+	QMAKE_CXXFLAGS_DEBUG += -Wno-unused-function
+}
+
+SOURCES += main.cpp
+
+HEADERS += \
+	 ../../utils/bitunpack.h \
+	 ../../utils/bithelpers.h
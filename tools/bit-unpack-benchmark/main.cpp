@@ -0,0 +1,182 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// measures the decode throughput of the fixed width bit field kernels against the per field helpers
+
+#include "utils/bitunpack.h"
+#include "utils/bithelpers.h"
+#include "stdio.h"
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <cstdlib>
+#include <vector>
+
+#ifdef BITUNPACK_X86
+#include <x86intrin.h>
+#endif
+
+struct Run {
+	const char* name;
+	int bits;
+	unsigned stride;
+};
+
+// the layouts found in the compressed graph blocks
+static const Run runs[] = {
+	{ "first edges", 4, 4 },
+	{ "first edges", 8, 8 },
+	{ "first edges", 12, 12 },
+	{ "first edges", 16, 16 },
+	{ "first edges", 20, 20 },
+	{ "first edges", 24, 24 },
+	{ "first edges", 28, 28 },
+	{ "coordinates", 10, 20 },
+	{ "coordinates", 14, 28 },
+	{ "coordinates", 18, 36 },
+};
+
+struct Kernel {
+	const char* name;
+	UnpackBitsKernel kernel;
+	bool supported;
+};
+
+void printHelp()
+{
+	printf( "Usage:\n" );
+	printf( "\tbit-unpack-benchmark [fields repetitions seed]\n" );
+}
+
+// the way the compressed graph read the fields before, one read_unaligned_unsigned per field
+static void unpack_bits_legacy( const unsigned char* buffer, unsigned position, int bits, unsigned stride, unsigned count, unsigned* out )
+{
+	for ( unsigned i = 0; i < count; i++, position += stride )
+		out[i] = read_unaligned_unsigned( buffer + ( position >> 3 ), bits, position & 7 );
+}
+
+// TSC cycles where available, nanoseconds otherwise
+static quint64 timestamp( QElapsedTimer* timer )
+{
+#ifdef BITUNPACK_X86
+	Q_UNUSED( timer );
+	return __rdtsc();
+#else
+	return timer->nsecsElapsed();
+#endif
+}
+
+static double benchmark( UnpackBitsKernel kernel, const std::vector< unsigned char >& buffer, const Run& run, unsigned count, unsigned repetitions, std::vector< unsigned >* out )
+{
+	QElapsedTimer timer;
+	timer.start();
+	quint64 best = 0;
+	for ( unsigned repetition = 0; repetition < repetitions; repetition++ ) {
+		const quint64 start = timestamp( &timer );
+		kernel( &buffer[0], repetition & 7, run.bits, run.stride, count, &( *out )[0] );
+		const quint64 time = timestamp( &timer ) - start;
+		if ( repetition == 0 || time < best )
+			best = time;
+	}
+	return ( double ) count * run.bits / std::max( best, ( quint64 ) 1 );
+}
+
+int main( int argc, char *argv[] )
+{
+	QCoreApplication a( argc, argv );
+
+	QStringList args = a.arguments();
+	if ( args.size() != 1 && args.size() != 4 ) {
+		printHelp();
+		return -1;
+	}
+	unsigned count = 4096;
+	unsigned repetitions = 1000;
+	unsigned seed = 1;
+	if ( args.size() == 4 ) {
+		bool ok1, ok2, ok3;
+		count = args[1].toUInt( &ok1 );
+		repetitions = args[2].toUInt( &ok2 );
+		seed = args[3].toUInt( &ok3 );
+		if ( !ok1 || !ok2 || !ok3 || count == 0 || repetitions == 0 ) {
+			printHelp();
+			return -1;
+		}
+	}
+
+	std::vector< Kernel > kernels;
+	Kernel legacy = { "legacy", unpack_bits_legacy, true };
+	Kernel scalar = { "scalar", unpack_bits_scalar, true };
+	kernels.push_back( legacy );
+	kernels.push_back( scalar );
+#ifdef BITUNPACK_X86
+	__builtin_cpu_init();
+	Kernel bmi2 = { "bmi2", unpack_bits_bmi2, __builtin_cpu_supports( "bmi2" ) && __builtin_cpu_supports( "sse4.1" ) };
+	Kernel avx2 = { "avx2", unpack_bits_avx2, __builtin_cpu_supports( "avx2" ) != 0 };
+	kernels.push_back( bmi2 );
+	kernels.push_back( avx2 );
+#endif
+	Kernel dispatched = { "dispatched", unpack_bits_kernel(), true };
+	kernels.push_back( dispatched );
+
+	srand( seed );
+	// large enough for any run + the word reads of the legacy helper past the end
+	std::vector< unsigned char > buffer( ( ( size_t ) count * 36 + 7 ) / 8 + 16 );
+	for ( size_t i = 0; i < buffer.size(); i++ )
+		buffer[i] = rand();
+
+#ifdef BITUNPACK_X86
+	printf( "fields: %u, repetitions: %u, throughput in bits / TSC cycle\n", count, repetitions );
+#else
+	printf( "fields: %u, repetitions: %u, throughput in bits / ns\n", count, repetitions );
+#endif
+	printf( "%-12s %4s %6s", "run", "bits", "stride" );
+	for ( unsigned kernel = 0; kernel < kernels.size(); kernel++ )
+		printf( " %10s", kernels[kernel].name );
+	printf( "\n" );
+
+	std::vector< unsigned > expected( count );
+	std::vector< unsigned > out( count );
+	unsigned mismatches = 0;
+	for ( unsigned r = 0; r < sizeof( runs ) / sizeof( runs[0] ); r++ ) {
+		const Run& run = runs[r];
+		printf( "%-12s %4d %6u", run.name, run.bits, run.stride );
+		for ( unsigned kernel = 0; kernel < kernels.size(); kernel++ ) {
+			if ( !kernels[kernel].supported ) {
+				printf( " %10s", "-" );
+				continue;
+			}
+			double throughput = benchmark( kernels[kernel].kernel, buffer, run, count, repetitions, &out );
+			printf( " %10.2lf", throughput );
+
+			for ( unsigned offset = 0; offset < 8; offset++ ) {
+				unpack_bits_legacy( &buffer[0], offset, run.bits, run.stride, count, &expected[0] );
+				kernels[kernel].kernel( &buffer[0], offset, run.bits, run.stride, count, &out[0] );
+				if ( expected != out )
+					mismatches++;
+			}
+		}
+		printf( "\n" );
+	}
+	printf( "mismatches: %u\n", mismatches );
+
+	a.quit();
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+QT       += core
+
+QT       -= gui
+
+INCLUDEPATH += ../..
+
+TARGET = ch-block-report
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+unix {
+	QMAKE_CXXFLAGS_RELEASE -= -O2
+	QMAKE_CXXFLAGS_RELEASE += -O3 \
+		 -Wno-unused-function
+	QMAKE_CXXFLAGS_DEBUG += -Wno-unused-function
+}
+
+SOURCES += main.cpp
+
+HEADERS += \
+	 ../../plugins/contractionhierarchies/compressedgraph.h \
+	 ../../plugins/contractionhierarchies/binaryheap.h \
+	 ../../plugins/contractionhierarchies/frequencycache.h \
+	 ../../plugins/contractionhierarchies/blockcache.h \
+	 ../../plugins/contractionhierarchies/mappedblocks.h \
+	 ../../utils/bithelpers.h \
+	 ../../utils/bitunpack.h \
+	 ../../utils/qthelpers.h
@@ -0,0 +1,213 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// reports how many blocks of the compressed graph random queries fetch
+// compares modules preprocessed with different node orders, fewer blocks => less I/O on flash storage
+
+#include "plugins/contractionhierarchies/compressedgraph.h"
+#include "plugins/contractionhierarchies/binaryheap.h"
+#include "utils/qthelpers.h"
+#include "stdio.h"
+
+#include <QtCore/QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <limits>
+#include <vector>
+
+typedef CompressedGraph::NodeIterator NodeIterator;
+typedef CompressedGraph::EdgeIterator EdgeIterator;
+
+struct HeapData {
+	NodeIterator parent;
+	HeapData( NodeIterator p ) : parent( p ) {}
+};
+
+typedef BinaryHeap< NodeIterator, int, int, HeapData > Heap;
+
+struct Statistics {
+	unsigned long long blocks;
+	unsigned long long settled;
+	unsigned long long stalled;
+	unsigned long long checksum;
+};
+
+void printHelp()
+{
+	printf( "Usage:\n" );
+	printf( "\tch-block-report queries seed routing-module-dir [routing-module-dir ...]\n" );
+}
+
+// marks the blocks fetched by the current query
+struct BlockSet {
+	std::vector< unsigned > generation;
+	unsigned current;
+	unsigned size;
+
+	void next()
+	{
+		current++;
+		size = 0;
+	}
+
+	void insert( unsigned block )
+	{
+		if ( generation[block] == current )
+			return;
+		generation[block] = current;
+		size++;
+	}
+};
+
+// settles one node like the client, stalls without propagating the stall to other nodes
+void computeStep( CompressedGraph* graph, CompressedGraph::Cache* cache, Heap* heapForward, Heap* heapBackward, bool forward, int* targetDistance, BlockSet* blocks, Statistics* statistics )
+{
+	const NodeIterator node = heapForward->DeleteMin();
+	const int distance = heapForward->GetKey( node );
+	statistics->settled++;
+
+	if ( heapBackward->WasInserted( node ) ) {
+		const int newDistance = heapBackward->GetKey( node ) + distance;
+		if ( newDistance < *targetDistance )
+			*targetDistance = newDistance;
+	}
+
+	if ( distance > *targetDistance ) {
+		heapForward->DeleteAll();
+		return;
+	}
+
+	blocks->insert( graph->nodeBlock( node ) );
+	for ( EdgeIterator edge = graph->edges( cache, node ); edge.hasEdgesLeft(); ) {
+		graph->unpackNextEdge( &edge );
+		if ( forward ? !edge.backward() : !edge.forward() )
+			continue;
+		const NodeIterator to = edge.target();
+		if ( heapForward->WasInserted( to ) && heapForward->GetKey( to ) + ( int ) edge.distance() < distance ) {
+			statistics->stalled++;
+			return;
+		}
+	}
+
+	for ( EdgeIterator edge = graph->edges( cache, node ); edge.hasEdgesLeft(); ) {
+		graph->unpackNextEdge( &edge );
+		if ( forward ? !edge.forward() : !edge.backward() )
+			continue;
+		const NodeIterator to = edge.target();
+		const int toDistance = distance + edge.distance();
+
+		if ( !heapForward->WasInserted( to ) )
+			heapForward->Insert( to, toDistance, node );
+		else if ( toDistance < heapForward->GetKey( to ) )
+			heapForward->DecreaseKey( to, toDistance );
+	}
+}
+
+bool report( QString directory, unsigned numberOfQueries, unsigned seed )
+{
+	// memory mapped => the block cache does not hide any fetches
+	CompressedGraph graph;
+	if ( !graph.loadGraph( fileInDirectory( directory, "Contraction Hierarchies" ), 0, true ) ) {
+		qCritical() << "failed to load the contraction hierarchies data:" << directory;
+		return false;
+	}
+	if ( graph.numberOfBlocks() == 0 ) {
+		qCritical() << "graph is empty:" << directory;
+		return false;
+	}
+
+	CompressedGraph::Cache cache;
+	graph.loadCache( &cache );
+	// the node IDs differ between node orders => draw the same number of random nodes from each module
+	srand( seed );
+	std::vector< NodeIterator > queries;
+	while ( queries.size() < numberOfQueries * 2 ) {
+		unsigned block = rand() % graph.numberOfBlocks();
+		unsigned count = graph.numberOfNodes( &cache, block );
+		if ( count == 0 )
+			continue;
+		queries.push_back( graph.nodeID( block, rand() % count ) );
+	}
+
+	Heap heapForward( graph.numberOfNodeIDs() );
+	Heap heapBackward( graph.numberOfNodeIDs() );
+	BlockSet blocks;
+	blocks.generation.assign( graph.numberOfBlocks(), 0 );
+	blocks.current = 0;
+
+	Statistics statistics;
+	statistics.blocks = 0;
+	statistics.settled = 0;
+	statistics.stalled = 0;
+	statistics.checksum = 0;
+	for ( unsigned i = 0; i + 1 < queries.size(); i += 2 ) {
+		heapForward.Clear();
+		heapBackward.Clear();
+		blocks.next();
+		heapForward.Insert( queries[i], 0, queries[i] );
+		heapBackward.Insert( queries[i + 1], 0, queries[i + 1] );
+		int targetDistance = std::numeric_limits< int >::max();
+		while ( heapForward.Size() + heapBackward.Size() > 0 ) {
+			if ( heapForward.Size() > 0 )
+				computeStep( &graph, &cache, &heapForward, &heapBackward, true, &targetDistance, &blocks, &statistics );
+			if ( heapBackward.Size() > 0 )
+				computeStep( &graph, &cache, &heapBackward, &heapForward, false, &targetDistance, &blocks, &statistics );
+		}
+		statistics.blocks += blocks.size;
+		if ( targetDistance != std::numeric_limits< int >::max() )
+			statistics.checksum += targetDistance;
+	}
+
+	printf( "%s: %u blocks, %.2lf nodes / block, %.2lf blocks / query, %.1lf settled nodes / query, %.1lf stalled / query, %.2lf settled nodes / block fetched, checksum %llu\n",
+			  directory.toUtf8().constData(),
+			  graph.numberOfBlocks(),
+			  ( double ) graph.numberOfNodes() / graph.numberOfBlocks(),
+			  ( double ) statistics.blocks / numberOfQueries,
+			  ( double ) statistics.settled / numberOfQueries,
+			  ( double ) statistics.stalled / numberOfQueries,
+			  ( double ) statistics.settled / std::max( statistics.blocks, 1ull ),
+			  statistics.checksum );
+	return true;
+}
+
+int main( int argc, char *argv[] )
+{
+	QCoreApplication a( argc, argv );
+
+	QStringList args = a.arguments();
+	if ( args.size() < 4 ) {
+		printHelp();
+		return -1;
+	}
+	bool ok1, ok2;
+	unsigned numberOfQueries = args[1].toUInt( &ok1 );
+	unsigned seed = args[2].toUInt( &ok2 );
+	if ( !ok1 || !ok2 || numberOfQueries == 0 ) {
+		printHelp();
+		return -1;
+	}
+
+	for ( int module = 3; module < args.size(); module++ ) {
+		if ( !report( args[module], numberOfQueries, seed ) )
+			return -1;
+	}
+
+	a.quit();
+	return 0;
+}
@@ -0,0 +1,35 @@
+QT       += core
+
+QT       -= gui
+
+INCLUDEPATH += ../..
+
+TARGET = ch-customize
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+DEFINES += NOGUI
+
+unix {
+	QMAKE_CXXFLAGS_RELEASE -= -O2
+	QMAKE_CXXFLAGS_RELEASE += -O3 \
+		 -Wno-unused-function \
+		 -fopenmp
+	QMAKE_CXXFLAGS_DEBUG += -Wno-unused-function \
+		 -fopenmp
+}
+LIBS += -fopenmp
+
+SOURCES += main.cpp
+
+HEADERS += \
+	 ../../plugins/contractionhierarchies/customizer.h \
+	 ../../plugins/contractionhierarchies/compressedgraph.h \
+	 ../../plugins/contractionhierarchies/compressedgraphbuilder.h \
+	 ../../interfaces/iimporter.h \
+	 ../../interfaces/irouter.h \
+	 ../../utils/bithelpers.h \
+	 ../../utils/bitunpack.h \
+	 ../../utils/qthelpers.h
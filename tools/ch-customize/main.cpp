@@ -0,0 +1,162 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// rewrites a routing module with new travel times without contracting it again
+// recomputes the shortcut weights of the stored topology bottom up and rebuilds the compressed graph in place
+// the module has to be preprocessed with the customizable setting of Contraction Hierarchies
+// the node order and the IDs of the parallel edges stay the same, the address lookup and the edge map remain valid
+
+#include "plugins/contractionhierarchies/compressedgraphbuilder.h"
+#include "plugins/contractionhierarchies/customizer.h"
+#include "utils/qthelpers.h"
+#include "stdio.h"
+
+#include <QtCore/QCoreApplication>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <vector>
+
+void printHelp()
+{
+	printf( "Usage:\n" );
+	printf( "\tch-customize routing-module-dir travel-times\n" );
+	printf( "\ttravel-times: one line per changed edge, index of the importer's routing edge and its new travel time in seconds\n" );
+	printf( "\tthe other edges keep their travel time, the module keeps the new travel times for later customizations\n" );
+}
+
+// replaces the travel times of the original edges, counts the edges that are not part of the graph
+static bool readTravelTimes( QString filename, std::vector< IImporter::RoutingEdge >* originalEdges, unsigned* changed, unsigned* ignored )
+{
+	QFile file( filename );
+	if ( !openQFile( &file, QIODevice::ReadOnly ) )
+		return false;
+	QTextStream stream( &file );
+	*changed = 0;
+	*ignored = 0;
+	for ( unsigned line = 1; !stream.atEnd(); line++ ) {
+		QStringList items = stream.readLine().split( ' ', QString::SkipEmptyParts );
+		if ( items.empty() )
+			continue;
+		bool edgeOK = false;
+		bool secondsOK = false;
+		const unsigned edge = items.size() == 2 ? items[0].toUInt( &edgeOK ) : 0;
+		const double seconds = items.size() == 2 ? items[1].toDouble( &secondsOK ) : 0;
+		if ( !edgeOK || !secondsOK || seconds < 0 ) {
+			qCritical() << "malformed travel time in line" << line << "of" << filename;
+			return false;
+		}
+		if ( edge >= originalEdges->size() ) {
+			( *ignored )++;
+			continue;
+		}
+		( *originalEdges )[edge].distance = seconds;
+		( *changed )++;
+	}
+	return true;
+}
+
+int main( int argc, char *argv[] )
+{
+	QCoreApplication a( argc, argv );
+
+	QStringList args = a.arguments();
+	if ( args.size() != 3 ) {
+		printHelp();
+		return -1;
+	}
+
+	Timer time;
+	QString filename = fileInDirectory( args[1], "Contraction Hierarchies" );
+	std::vector< IRouter::Node > nodes;
+	std::vector< CompressedGraph::Edge > edges;
+	std::vector< IImporter::RoutingEdge > originalEdges;
+	std::vector< IRouter::Node > edgePaths;
+	if ( !CompressedGraphBuilder::readInput( filename + "_contraction", &nodes, &edges, &originalEdges, &edgePaths ) ) {
+		qCritical() << "failed to read the contraction result, preprocess the module with customizable";
+		return -1;
+	}
+	Customizer customizer;
+	if ( !customizer.Read( filename + "_topology", nodes.size() ) ) {
+		qCritical() << "failed to read the customizable topology, preprocess the module with customizable";
+		return -1;
+	}
+
+	unsigned changed;
+	unsigned ignored;
+	if ( !readTravelTimes( args[2], &originalEdges, &changed, &ignored ) )
+		return -1;
+
+	// edges left out by the preprocessing stay out, their IDs would not be valid
+	// travel time in 1/10 seconds, as used by the contractor
+	unsigned longEdges = 0;
+	for ( unsigned edge = 0; edge < edges.size(); edge++ ) {
+		if ( edges[edge].data.shortcut )
+			continue;
+		const double seconds = originalEdges[edges[edge].data.id].distance;
+		edges[edge].data.distance = std::max( seconds * 10.0 + 0.5, 1.0 );
+		if ( edges[edge].data.distance > 24 * 60 * 60 * 10 )
+			longEdges++;
+	}
+	if ( longEdges != 0 ) {
+		qCritical() << longEdges << "edges take longer than a day, preprocess the module again";
+		return -1;
+	}
+	qDebug() << "read" << changed << "travel times," << ignored << "edges not part of the graph:" << time.restart() << "ms";
+
+	if ( !customizer.Run( &edges ) )
+		return -1;
+	const Customizer::BuildSettings settings = customizer.GetBuildSettings();
+
+	// later customizations start from the new travel times, kept aside until the module is rewritten
+	if ( !CompressedGraphBuilder::writeInput( filename + "_contraction_customized", nodes, edges, originalEdges, edgePaths ) )
+		return -1;
+
+	std::vector< unsigned > map( nodes.size() );
+	for ( unsigned node = 0; node < nodes.size(); node++ )
+		map[node] = node;
+	// the other modules know the node IDs of the block layout
+	CompressedGraphBuilder* builder = new CompressedGraphBuilder( 1u << settings.blockSize, nodes, edges, originalEdges, edgePaths, settings.unpackedNodes );
+	builder->setBlockLayout( settings.firstNodes );
+	bool ok = builder->run( filename, &map );
+	delete builder;
+	if ( !ok ) {
+		QFile::remove( filename + "_contraction_customized" );
+		qCritical() << "the customized graph does not fit the module, preprocess it again";
+		return -1;
+	}
+	QFile::remove( filename + "_contraction" );
+	if ( !QFile::rename( filename + "_contraction_customized", filename + "_contraction" ) ) {
+		qCritical() << "failed to replace the contraction result:" << filename + "_contraction";
+		return -1;
+	}
+
+	// the core holds the decoded blocks of the old graph
+	QFile::remove( filename + "_core" );
+	if ( settings.coreNodes > 0 ) {
+		CompressedGraph graph;
+		if ( !graph.loadGraph( filename, 0, true ) || !graph.writeCore( filename + "_core", settings.coreNodes ) )
+			return -1;
+	}
+	qDebug() << "rewrote the module:" << time.elapsed() << "ms";
+
+	a.quit();
+	return 0;
+}
@@ -0,0 +1,183 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// compares the heap index storages of the contraction hierarchies client on random queries
+
+#include "plugins/contractionhierarchies/compressedgraph.h"
+#include "plugins/contractionhierarchies/binaryheap.h"
+#include "utils/qthelpers.h"
+#include "stdio.h"
+
+#include <QtCore/QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <limits>
+#include <vector>
+
+typedef CompressedGraph::NodeIterator NodeIterator;
+typedef CompressedGraph::EdgeIterator EdgeIterator;
+
+struct HeapData {
+	NodeIterator parent;
+	HeapData( NodeIterator p ) : parent( p ) {}
+};
+
+struct Statistics {
+	double milliseconds;
+	unsigned long long settled;
+	unsigned long long checksum;
+};
+
+void printHelp()
+{
+	printf( "Usage:\n" );
+	printf( "\tch-heap-benchmark routing-module-dir [queries seed]\n" );
+}
+
+template< class Heap >
+void computeStep( CompressedGraph* graph, CompressedGraph::Cache* cache, Heap* heapForward, Heap* heapBackward, bool forward, int* targetDistance )
+{
+	const NodeIterator node = heapForward->DeleteMin();
+	const int distance = heapForward->GetKey( node );
+
+	if ( heapBackward->WasInserted( node ) ) {
+		const int newDistance = heapBackward->GetKey( node ) + distance;
+		if ( newDistance < *targetDistance )
+			*targetDistance = newDistance;
+	}
+
+	if ( distance > *targetDistance ) {
+		heapForward->DeleteAll();
+		return;
+	}
+
+	for ( EdgeIterator edge = graph->edges( cache, node ); edge.hasEdgesLeft(); ) {
+		graph->unpackNextEdge( &edge );
+		if ( forward ? !edge.forward() : !edge.backward() )
+			continue;
+		const NodeIterator to = edge.target();
+		const int toDistance = distance + edge.distance();
+
+		if ( !heapForward->WasInserted( to ) )
+			heapForward->Insert( to, toDistance, node );
+		else if ( toDistance < heapForward->GetKey( to ) )
+			heapForward->DecreaseKey( to, toDistance );
+	}
+}
+
+template< class Storage >
+Statistics benchmark( CompressedGraph* graph, const std::vector< NodeIterator >& queries )
+{
+	typedef BinaryHeap< NodeIterator, int, int, HeapData, Storage > Heap;
+	Heap heapForward( graph->numberOfNodeIDs() );
+	Heap heapBackward( graph->numberOfNodeIDs() );
+	CompressedGraph::Cache cache;
+	graph->loadCache( &cache );
+
+	Statistics result;
+	result.settled = 0;
+	result.checksum = 0;
+	Timer time;
+	for ( unsigned i = 0; i + 1 < queries.size(); i += 2 ) {
+		heapForward.Clear();
+		heapBackward.Clear();
+		heapForward.Insert( queries[i], 0, queries[i] );
+		heapBackward.Insert( queries[i + 1], 0, queries[i + 1] );
+		int targetDistance = std::numeric_limits< int >::max();
+		while ( heapForward.Size() + heapBackward.Size() > 0 ) {
+			if ( heapForward.Size() > 0 ) {
+				computeStep( graph, &cache, &heapForward, &heapBackward, true, &targetDistance );
+				result.settled++;
+			}
+			if ( heapBackward.Size() > 0 ) {
+				computeStep( graph, &cache, &heapBackward, &heapForward, false, &targetDistance );
+				result.settled++;
+			}
+		}
+		if ( targetDistance != std::numeric_limits< int >::max() )
+			result.checksum += targetDistance;
+	}
+	result.milliseconds = time.elapsed();
+	return result;
+}
+
+void print( const char* name, const Statistics& statistics, unsigned queries )
+{
+	printf( "%s: %.3lf ms / query, %.1lf ns / settled node, %.1lf settled nodes / query, checksum %llu\n",
+			  name,
+			  statistics.milliseconds / queries,
+			  statistics.milliseconds * 1000000 / std::max( statistics.settled, 1ull ),
+			  ( double ) statistics.settled / queries,
+			  statistics.checksum );
+}
+
+int main( int argc, char *argv[] )
+{
+	QCoreApplication a( argc, argv );
+
+	QStringList args = a.arguments();
+	if ( args.size() != 2 && args.size() != 4 ) {
+		printHelp();
+		return -1;
+	}
+	unsigned numberOfQueries = 10000;
+	unsigned seed = 1;
+	if ( args.size() == 4 ) {
+		bool ok1, ok2;
+		numberOfQueries = args[2].toUInt( &ok1 );
+		seed = args[3].toUInt( &ok2 );
+		if ( !ok1 || !ok2 || numberOfQueries == 0 ) {
+			printHelp();
+			return -1;
+		}
+	}
+
+	// memory mapped => no block cache effects in the measurements
+	CompressedGraph graph;
+	if ( !graph.loadGraph( fileInDirectory( args[1], "Contraction Hierarchies" ), 0, true ) ) {
+		qCritical() << "failed to load the contraction hierarchies data";
+		return -1;
+	}
+	if ( graph.numberOfBlocks() == 0 ) {
+		qCritical() << "graph is empty";
+		return -1;
+	}
+
+	CompressedGraph::Cache cache;
+	graph.loadCache( &cache );
+	srand( seed );
+	std::vector< NodeIterator > queries;
+	while ( queries.size() < numberOfQueries * 2 ) {
+		unsigned block = rand() % graph.numberOfBlocks();
+		unsigned count = graph.numberOfNodes( &cache, block );
+		if ( count == 0 )
+			continue;
+		queries.push_back( graph.nodeID( block, rand() % count ) );
+	}
+
+	printf( "nodes: %u, node IDs: %u, queries: %u\n", graph.numberOfNodes(), graph.numberOfNodeIDs(), numberOfQueries );
+	// run each one twice to warm up the page cache
+	for ( int run = 0; run < 2; run++ ) {
+		print( "MapStorage", benchmark< MapStorage< NodeIterator, unsigned > >( &graph, queries ), numberOfQueries );
+		print( "GenerationStorage", benchmark< GenerationStorage< NodeIterator, unsigned > >( &graph, queries ), numberOfQueries );
+	}
+
+	a.quit();
+	return 0;
+}
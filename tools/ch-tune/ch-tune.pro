@@ -0,0 +1,35 @@
+QT       += core
+
+QT       -= gui
+
+INCLUDEPATH += ../..
+
+TARGET = ch-tune
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+DEFINES += NOGUI
+
+unix {
+	QMAKE_CXXFLAGS_RELEASE -= -O2
+	QMAKE_CXXFLAGS_RELEASE += -O3 \
+		 -Wno-unused-function
+	QMAKE_CXXFLAGS_DEBUG += -Wno-unused-function
+}
+
+# build the client plugins first, e.g., with monavroutingdaemon.pro
+LIBS += -L../../bin/plugins_client -lcontractionhierarchiesclient
+
+SOURCES += main.cpp
+
+HEADERS += \
+	 ../../plugins/contractionhierarchies/contractionhierarchiesclient.h \
+	 ../../plugins/contractionhierarchies/compressedgraph.h \
+	 ../../plugins/contractionhierarchies/frequencycache.h \
+	 ../../plugins/contractionhierarchies/compressedgraphbuilder.h \
+	 ../../interfaces/iquerystatistics.h \
+	 ../../utils/bithelpers.h \
+	 ../../utils/bitunpack.h \
+	 ../../utils/qthelpers.h
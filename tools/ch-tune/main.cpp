@@ -0,0 +1,380 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// rebuilds the compressed graph of a routing module at several block sizes from its stored contraction result
+// replays a query workload under several cache budgets and recommends the setting with the best latency per MB
+// the module has to be preprocessed with the keep-contraction setting of Contraction Hierarchies
+
+#include "plugins/contractionhierarchies/contractionhierarchiesclient.h"
+#include "plugins/contractionhierarchies/compressedgraphbuilder.h"
+#include "interfaces/iquerystatistics.h"
+#include "utils/qthelpers.h"
+#include "stdio.h"
+
+#include <QtCore/QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+// a position on an original edge, by node IDs of the contraction result
+struct Position {
+	NodeID source;
+	NodeID target;
+	double percentage;
+};
+
+struct Query {
+	Position source;
+	Position target;
+};
+
+struct Settings {
+	std::vector< int > blockSizes;
+	// kilobytes
+	std::vector< unsigned > budgets;
+	unsigned queries;
+	unsigned warmup;
+	unsigned seed;
+	unsigned unpackedNodes;
+	// simulated storage: every block read costs seek + block size / throughput
+	double seekMicroseconds;
+	double megabytesPerSecond;
+	// settings this much slower than the fastest one are not recommended
+	double tolerance;
+};
+
+struct Result {
+	int blockSize;
+	unsigned budget;
+	qint64 graphBytes;
+	unsigned found;
+	double measured;
+	double simulated;
+	double p95;
+	double blocksRead;
+};
+
+void printHelp()
+{
+	printf( "Usage:\n" );
+	printf( "\tch-tune routing-module-dir scratch-dir [options]\n" );
+	printf( "\t--block-sizes x,y,...: block sizes 2^x to build, 8 <= x <= 20, default 10,11,12,13,14\n" );
+	printf( "\t--budgets a,b,...: cache budgets in KB, default 512,1024,2048,4096,6144,8192,16384\n" );
+	printf( "\t--queries N: measured queries, default 2000\n" );
+	printf( "\t--warmup N: queries run before measuring, default 500\n" );
+	printf( "\t--seed S: seed of the workload, default 1\n" );
+	printf( "\t--unpack-nodes N: unpack-nodes setting of the rebuilt graphs, default 0\n" );
+	printf( "\t--seek-us T: simulated access time of a block read, default 100\n" );
+	printf( "\t--throughput M: simulated read throughput in MB/s, default 20\n" );
+	printf( "\t--tolerance F: recommends only settings within a factor 1 + F of the fastest one, default 0.1\n" );
+}
+
+template< class T >
+static bool parseList( const QString& value, std::vector< T >* list )
+{
+	list->clear();
+	QStringList items = value.split( ',' );
+	for ( int i = 0; i < items.size(); i++ ) {
+		bool ok;
+		int item = items[i].toInt( &ok );
+		if ( !ok || item <= 0 )
+			return false;
+		list->push_back( item );
+	}
+	return !list->empty();
+}
+
+// random positions on original edges, oriented in a direction the edge can be traversed
+static void generateWorkload( const std::vector< CompressedGraph::Edge >& edges, unsigned count, std::vector< Query >* workload )
+{
+	std::vector< unsigned > original;
+	for ( unsigned edge = 0; edge < edges.size(); edge++ ) {
+		if ( !edges[edge].data.shortcut )
+			original.push_back( edge );
+	}
+	if ( original.empty() )
+		return;
+
+	std::vector< Position > positions;
+	while ( positions.size() < count * 2 ) {
+		const CompressedGraph::Edge& edge = edges[original[rand() % original.size()]];
+		bool forward = edge.data.forward;
+		if ( edge.data.forward && edge.data.backward )
+			forward = rand() % 2 == 0;
+		Position position;
+		position.source = forward ? edge.source : edge.target;
+		position.target = forward ? edge.target : edge.source;
+		position.percentage = ( rand() % 1001 ) / 1000.0;
+		positions.push_back( position );
+	}
+	for ( unsigned i = 0; i < count; i++ ) {
+		Query query;
+		query.source = positions[2 * i];
+		query.target = positions[2 * i + 1];
+		workload->push_back( query );
+	}
+}
+
+// the parallel edges appear in the same order at every block size, the first one is always taken
+static IGPSLookup::Result toResult( const Position& position, const std::vector< unsigned >& map )
+{
+	IGPSLookup::Result result;
+	result.source = map[position.source];
+	result.target = map[position.target];
+	result.edgeID = 0;
+	result.percentage = position.percentage;
+	result.previousWayCoordinates = 1;
+	result.gridDistance2 = 0;
+	return result;
+}
+
+static bool copyFile( const QString& from, const QString& to )
+{
+	QFile::remove( to );
+	if ( !QFile::copy( from, to ) ) {
+		qCritical() << "failed to copy" << from << "to" << to;
+		return false;
+	}
+	return true;
+}
+
+// builds the graph with copies of the contraction result, the builder consumes its input
+static bool buildGraph( const QString& moduleDir, const QString& dir, int blockSize, const Settings& settings,
+		const std::vector< IRouter::Node >& nodes, const std::vector< CompressedGraph::Edge >& edges, const std::vector< IImporter::RoutingEdge >& originalEdges, const std::vector< IRouter::Node >& edgePaths,
+		std::vector< unsigned >* map, qint64* graphBytes )
+{
+	if ( !QDir().mkpath( dir ) ) {
+		qCritical() << "failed to create directory:" << dir;
+		return false;
+	}
+	QString filename = fileInDirectory( dir, "Contraction Hierarchies" );
+	QString moduleFilename = fileInDirectory( moduleDir, "Contraction Hierarchies" );
+	if ( !copyFile( moduleFilename + "_names", filename + "_names" ) || !copyFile( moduleFilename + "_types", filename + "_types" ) )
+		return false;
+
+	std::vector< IRouter::Node > inputNodes( nodes );
+	std::vector< CompressedGraph::Edge > inputEdges( edges );
+	std::vector< IImporter::RoutingEdge > inputOriginalEdges( originalEdges );
+	std::vector< IRouter::Node > inputEdgePaths( edgePaths );
+	map->resize( nodes.size() );
+	for ( unsigned node = 0; node < nodes.size(); node++ )
+		( *map )[node] = node;
+	CompressedGraphBuilder* builder = new CompressedGraphBuilder( 1u << blockSize, inputNodes, inputEdges, inputOriginalEdges, inputEdgePaths, settings.unpackedNodes );
+	bool ok = builder->run( filename, map );
+	delete builder;
+	if ( !ok )
+		return false;
+
+	*graphBytes = QFile( filename + "_edges" ).size() + QFile( filename + "_paths" ).size();
+	return true;
+}
+
+static bool replay( const QString& dir, unsigned budget, const std::vector< Query >& workload, const std::vector< unsigned >& map, const Settings& settings, Result* result )
+{
+	ContractionHierarchiesClient client;
+	client.SetInputDirectory( dir );
+	client.SetCacheMode( ICacheSettings::BoundedCache );
+	client.SetCacheSize( budget * 1024 );
+	if ( !client.LoadData() )
+		return false;
+	client.SetCollectStatistics( true );
+
+	const double blockMicroseconds = settings.seekMicroseconds + ( double ) ( 1u << result->blockSize ) / ( settings.megabytesPerSecond * 1024 * 1024 ) * 1000000;
+	std::vector< double > simulated;
+	result->found = 0;
+	result->measured = 0;
+	result->blocksRead = 0;
+	IRouter::QueryContext* context = client.CreateQueryContext();
+	QVector< IRouter::Node > pathNodes;
+	QVector< IRouter::Edge > pathEdges;
+	QElapsedTimer timer;
+	for ( unsigned i = 0; i < workload.size(); i++ ) {
+		double distance;
+		timer.start();
+		bool found = client.GetRoute( context, &distance, &pathNodes, &pathEdges, toResult( workload[i].source, map ), toResult( workload[i].target, map ) );
+		const double microseconds = timer.nsecsElapsed() / 1000.0;
+		if ( i < settings.warmup )
+			continue;
+		IQueryStatistics::QueryStatistics statistics;
+		client.GetQueryStatistics( context, &statistics );
+		const unsigned blocksRead = statistics.blocksRead + statistics.pathBlocksRead;
+		if ( found )
+			result->found++;
+		result->measured += microseconds;
+		result->blocksRead += blocksRead;
+		simulated.push_back( microseconds + blocksRead * blockMicroseconds );
+	}
+	delete context;
+
+	const double count = std::max( ( unsigned ) simulated.size(), 1u );
+	result->measured /= count;
+	result->blocksRead /= count;
+	result->simulated = 0;
+	for ( unsigned i = 0; i < simulated.size(); i++ )
+		result->simulated += simulated[i];
+	result->simulated /= count;
+	std::sort( simulated.begin(), simulated.end() );
+	result->p95 = simulated.empty() ? 0 : simulated[std::min( ( unsigned ) ( 0.95 * simulated.size() ), ( unsigned ) simulated.size() - 1 )];
+	return true;
+}
+
+// the cheapest setting in latency * MB among the ones close to the fastest
+static unsigned recommend( const std::vector< Result >& results, double tolerance )
+{
+	double fastest = results[0].simulated;
+	for ( unsigned i = 1; i < results.size(); i++ )
+		fastest = std::min( fastest, results[i].simulated );
+	unsigned best = results.size();
+	for ( unsigned i = 0; i < results.size(); i++ ) {
+		if ( results[i].simulated > fastest * ( 1 + tolerance ) )
+			continue;
+		if ( best == results.size() || results[i].simulated * results[i].budget < results[best].simulated * results[best].budget )
+			best = i;
+	}
+	return best;
+}
+
+int main( int argc, char *argv[] )
+{
+	QCoreApplication a( argc, argv );
+
+	QStringList args = a.arguments();
+	if ( args.size() < 3 ) {
+		printHelp();
+		return -1;
+	}
+	Settings settings;
+	for ( int blockSize = 10; blockSize <= 14; blockSize++ )
+		settings.blockSizes.push_back( blockSize );
+	const unsigned budgets[] = { 512, 1024, 2048, 4096, 6144, 8192, 16384 };
+	settings.budgets.assign( budgets, budgets + sizeof( budgets ) / sizeof( budgets[0] ) );
+	settings.queries = 2000;
+	settings.warmup = 500;
+	settings.seed = 1;
+	settings.unpackedNodes = 0;
+	settings.seekMicroseconds = 100;
+	settings.megabytesPerSecond = 20;
+	settings.tolerance = 0.1;
+	for ( int i = 3; i < args.size(); i += 2 ) {
+		if ( i + 1 >= args.size() ) {
+			printHelp();
+			return -1;
+		}
+		bool ok = true;
+		const QString& value = args[i + 1];
+		if ( args[i] == "--block-sizes" )
+			ok = parseList( value, &settings.blockSizes );
+		else if ( args[i] == "--budgets" )
+			ok = parseList( value, &settings.budgets );
+		else if ( args[i] == "--queries" )
+			settings.queries = value.toUInt( &ok );
+		else if ( args[i] == "--warmup" )
+			settings.warmup = value.toUInt( &ok );
+		else if ( args[i] == "--seed" )
+			settings.seed = value.toUInt( &ok );
+		else if ( args[i] == "--unpack-nodes" )
+			settings.unpackedNodes = value.toUInt( &ok );
+		else if ( args[i] == "--seek-us" )
+			settings.seekMicroseconds = value.toDouble( &ok );
+		else if ( args[i] == "--throughput" )
+			settings.megabytesPerSecond = value.toDouble( &ok );
+		else if ( args[i] == "--tolerance" )
+			settings.tolerance = value.toDouble( &ok );
+		else
+			ok = false;
+		if ( !ok || settings.queries == 0 || settings.megabytesPerSecond <= 0 ) {
+			printHelp();
+			return -1;
+		}
+	}
+	for ( unsigned i = 0; i < settings.blockSizes.size(); i++ ) {
+		if ( settings.blockSizes[i] < 8 || settings.blockSizes[i] > 20 ) {
+			qCritical() << "block size out of range: 2^" << settings.blockSizes[i];
+			return -1;
+		}
+	}
+
+	std::vector< IRouter::Node > nodes;
+	std::vector< CompressedGraph::Edge > edges;
+	std::vector< IImporter::RoutingEdge > originalEdges;
+	std::vector< IRouter::Node > edgePaths;
+	if ( !CompressedGraphBuilder::readInput( fileInDirectory( args[1], "Contraction Hierarchies" ) + "_contraction", &nodes, &edges, &originalEdges, &edgePaths ) ) {
+		qCritical() << "failed to read the contraction result, preprocess the module with keep-contraction";
+		return -1;
+	}
+
+	srand( settings.seed );
+	std::vector< Query > workload;
+	generateWorkload( edges, settings.warmup + settings.queries, &workload );
+	if ( workload.empty() ) {
+		qCritical() << "graph has no edges";
+		return -1;
+	}
+
+	std::vector< Result > results;
+	for ( unsigned i = 0; i < settings.blockSizes.size(); i++ ) {
+		Result result;
+		result.blockSize = settings.blockSizes[i];
+		QString dir = QDir( args[2] ).filePath( QString( "block-size-%1" ).arg( result.blockSize ) );
+		std::vector< unsigned > map;
+		if ( !buildGraph( args[1], dir, result.blockSize, settings, nodes, edges, originalEdges, edgePaths, &map, &result.graphBytes ) )
+			return -1;
+		for ( unsigned budget = 0; budget < settings.budgets.size(); budget++ ) {
+			result.budget = settings.budgets[budget];
+			if ( !replay( dir, result.budget, workload, map, settings, &result ) ) {
+				qCritical() << "failed to load the rebuilt graph:" << dir;
+				return -1;
+			}
+			qDebug() << "block size" << ( 1u << result.blockSize ) << "budget" << result.budget << "KB:" << result.simulated << "us / query";
+			results.push_back( result );
+		}
+	}
+
+	const unsigned best = recommend( results, settings.tolerance );
+	printf( "{\n" );
+	printf( "\t\"queries\": %u,\n", settings.queries );
+	printf( "\t\"seed\": %u,\n", settings.seed );
+	printf( "\t\"seekMicroseconds\": %.1lf,\n", settings.seekMicroseconds );
+	printf( "\t\"megabytesPerSecond\": %.1lf,\n", settings.megabytesPerSecond );
+	printf( "\t\"results\": [\n" );
+	for ( unsigned i = 0; i < results.size(); i++ ) {
+		const Result& result = results[i];
+		printf( "\t\t{ \"blockSize\": %u, \"budgetKB\": %u, \"graphBytes\": %lld, \"found\": %u, \"measuredMicroseconds\": %.2lf, \"simulatedMicroseconds\": %.2lf, \"simulatedP95\": %.2lf, \"blocksRead\": %.3lf, \"microsecondsTimesMB\": %.2lf }%s\n",
+				  1u << result.blockSize,
+				  result.budget,
+				  result.graphBytes,
+				  result.found,
+				  result.measured,
+				  result.simulated,
+				  result.p95,
+				  result.blocksRead,
+				  result.simulated * result.budget / 1024,
+				  i + 1 == results.size() ? "" : "," );
+	}
+	printf( "\t],\n" );
+	printf( "\t\"recommended\": { \"blockSize\": %d, \"blockSizeSetting\": %d, \"budgetKB\": %u }\n", 1 << results[best].blockSize, results[best].blockSize, results[best].budget );
+	printf( "}\n" );
+
+	a.quit();
+	return 0;
+}
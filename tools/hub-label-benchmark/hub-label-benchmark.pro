@@ -0,0 +1,35 @@
+QT       += core
+
+QT       -= gui
+
+INCLUDEPATH += ../..
+
+TARGET = hub-label-benchmark
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+DEFINES += NOGUI
+
+unix {
+	QMAKE_CXXFLAGS_RELEASE -= -O2
+	QMAKE_CXXFLAGS_RELEASE += -O3 \
+		 -Wno-unused-function
+	QMAKE_CXXFLAGS_DEBUG += -Wno-unused-function
+}
+
+# build the client plugins first, e.g., with monavroutingdaemon.pro
+LIBS += -L../../bin/plugins_client -lhublabelsclient -lcontractionhierarchiesclient
+
+SOURCES += main.cpp
+
+HEADERS += \
+	 ../../plugins/hublabels/hublabelsclient.h \
+	 ../../plugins/hublabels/hublabelfile.h \
+	 ../../plugins/contractionhierarchies/contractionhierarchiesclient.h \
+	 ../../plugins/contractionhierarchies/compressedgraph.h \
+	 ../../plugins/contractionhierarchies/frequencycache.h \
+	 ../../utils/bithelpers.h \
+	 ../../utils/bitunpack.h \
+	 ../../utils/qthelpers.h
@@ -0,0 +1,223 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// compares distance queries of the hub labels and the contraction hierarchies clients on random positions
+
+#include "plugins/hublabels/hublabelsclient.h"
+#include "plugins/contractionhierarchies/contractionhierarchiesclient.h"
+#include "plugins/contractionhierarchies/compressedgraph.h"
+#include "utils/qthelpers.h"
+#include "stdio.h"
+
+#include <QtCore/QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <limits>
+#include <vector>
+
+typedef CompressedGraph::NodeIterator NodeIterator;
+typedef CompressedGraph::EdgeIterator EdgeIterator;
+
+struct Statistics {
+	double milliseconds;
+	unsigned found;
+	double checksum;
+};
+
+void printHelp()
+{
+	printf( "Usage:\n" );
+	printf( "\thub-label-benchmark routing-module-dir [queries seed]\n" );
+}
+
+// a random position on an original edge, oriented in a direction the edge can be traversed
+bool randomPosition( CompressedGraph* graph, CompressedGraph::Cache* cache, IGPSLookup::Result* result )
+{
+	unsigned block = rand() % graph->numberOfBlocks();
+	unsigned count = graph->numberOfNodes( cache, block );
+	if ( count == 0 )
+		return false;
+	NodeIterator node = graph->nodeID( block, rand() % count );
+
+	std::vector< EdgeIterator > original;
+	for ( EdgeIterator edge = graph->edges( cache, node ); edge.hasEdgesLeft(); ) {
+		graph->unpackNextEdge( &edge );
+		if ( !edge.shortcut() )
+			original.push_back( edge );
+	}
+	if ( original.empty() )
+		return false;
+	unsigned chosen = rand() % original.size();
+	const EdgeIterator& edge = original[chosen];
+
+	// findEdge counts the parallel edges
+	result->edgeID = 0;
+	for ( unsigned i = 0; i < chosen; i++ ) {
+		if ( original[i].target() == edge.target() )
+			result->edgeID++;
+	}
+	result->source = edge.forward() ? node : edge.target();
+	result->target = edge.forward() ? edge.target() : node;
+	result->percentage = ( rand() % 1001 ) / 1000.0;
+	result->previousWayCoordinates = 1;
+	result->gridDistance2 = 0;
+	return true;
+}
+
+Statistics benchmarkQueries( IRouter* router, const std::vector< IGPSLookup::Result >& queries )
+{
+	IRouter::QueryContext* context = router->CreateQueryContext();
+	Statistics result;
+	result.found = 0;
+	result.checksum = 0;
+	Timer time;
+	for ( unsigned i = 0; i + 1 < queries.size(); i += 2 ) {
+		double distance;
+		if ( !router->GetRoute( context, &distance, NULL, NULL, queries[i], queries[i + 1] ) )
+			continue;
+		result.found++;
+		result.checksum += distance;
+	}
+	result.milliseconds = time.elapsed();
+	delete context;
+	return result;
+}
+
+Statistics benchmarkTable( IRouter* router, IDistanceTable* table, const QVector< IGPSLookup::Result >& positions, QVector< double >* distances )
+{
+	IRouter::QueryContext* context = router->CreateQueryContext();
+	Statistics result;
+	result.found = 0;
+	result.checksum = 0;
+	Timer time;
+	table->GetDistanceTable( context, distances, positions, positions );
+	result.milliseconds = time.elapsed();
+	for ( int i = 0; i < distances->size(); i++ ) {
+		if ( ( *distances )[i] == std::numeric_limits< double >::max() )
+			continue;
+		result.found++;
+		result.checksum += ( *distances )[i];
+	}
+	delete context;
+	return result;
+}
+
+void print( const char* name, const Statistics& statistics, unsigned queries )
+{
+	printf( "%s: %.2lf us / query, found %u, checksum %.1lf\n",
+			  name,
+			  statistics.milliseconds * 1000 / queries,
+			  statistics.found,
+			  statistics.checksum );
+}
+
+int main( int argc, char *argv[] )
+{
+	QCoreApplication a( argc, argv );
+
+	QStringList args = a.arguments();
+	if ( args.size() != 2 && args.size() != 4 ) {
+		printHelp();
+		return -1;
+	}
+	unsigned numberOfQueries = 10000;
+	unsigned seed = 1;
+	if ( args.size() == 4 ) {
+		bool ok1, ok2;
+		numberOfQueries = args[2].toUInt( &ok1 );
+		seed = args[3].toUInt( &ok2 );
+		if ( !ok1 || !ok2 || numberOfQueries == 0 ) {
+			printHelp();
+			return -1;
+		}
+	}
+
+	// memory mapped => no block cache effects in the measurements
+	ContractionHierarchiesClient contractionHierarchies;
+	contractionHierarchies.SetInputDirectory( args[1] );
+	contractionHierarchies.SetCacheMode( ICacheSettings::MemoryMapped );
+	HubLabelsClient hubLabels;
+	hubLabels.SetInputDirectory( args[1] );
+	hubLabels.SetCacheMode( ICacheSettings::MemoryMapped );
+	if ( !contractionHierarchies.LoadData() || !hubLabels.LoadData() ) {
+		qCritical() << "failed to load the hub labels module";
+		return -1;
+	}
+
+	CompressedGraph graph;
+	if ( !graph.loadGraph( fileInDirectory( args[1], "Contraction Hierarchies" ), 0, true ) ) {
+		qCritical() << "failed to load the contraction hierarchies data";
+		return -1;
+	}
+	if ( graph.numberOfBlocks() == 0 ) {
+		qCritical() << "graph is empty";
+		return -1;
+	}
+
+	CompressedGraph::Cache cache;
+	graph.loadCache( &cache );
+	srand( seed );
+	std::vector< IGPSLookup::Result > queries;
+	while ( queries.size() < numberOfQueries * 2 ) {
+		IGPSLookup::Result position;
+		if ( randomPosition( &graph, &cache, &position ) )
+			queries.push_back( position );
+	}
+	QVector< IGPSLookup::Result > tablePositions;
+	for ( unsigned i = 0; i < queries.size() && tablePositions.size() < 100; i++ )
+		tablePositions.push_back( queries[i] );
+
+	printf( "nodes: %u, queries: %u, label data: %.1lf MB, %.1lf bytes / node\n",
+			  graph.numberOfNodes(),
+			  numberOfQueries,
+			  hubLabels.GetLabelBytes() / 1024.0 / 1024.0,
+			  ( double ) hubLabels.GetLabelBytes() / std::max( graph.numberOfNodes(), 1u ) );
+
+	// run each one twice to warm up the page cache
+	for ( int run = 0; run < 2; run++ ) {
+		print( "Contraction Hierarchies", benchmarkQueries( &contractionHierarchies, queries ), numberOfQueries );
+		print( "Hub Labels", benchmarkQueries( &hubLabels, queries ), numberOfQueries );
+	}
+
+	// both have to agree on every distance
+	unsigned mismatches = 0;
+	for ( unsigned i = 0; i + 1 < queries.size(); i += 2 ) {
+		double chDistance = 0;
+		double hlDistance = 0;
+		bool chFound = contractionHierarchies.GetRoute( &chDistance, NULL, NULL, queries[i], queries[i + 1] );
+		bool hlFound = hubLabels.GetRoute( &hlDistance, NULL, NULL, queries[i], queries[i + 1] );
+		if ( chFound != hlFound || ( chFound && chDistance != hlDistance ) )
+			mismatches++;
+	}
+
+	QVector< double > chTable;
+	QVector< double > hlTable;
+	const unsigned cells = tablePositions.size() * tablePositions.size();
+	print( "Contraction Hierarchies table", benchmarkTable( &contractionHierarchies, &contractionHierarchies, tablePositions, &chTable ), cells );
+	print( "Hub Labels table", benchmarkTable( &hubLabels, &hubLabels, tablePositions, &hlTable ), cells );
+	for ( int i = 0; i < chTable.size() && i < hlTable.size(); i++ ) {
+		if ( chTable[i] != hlTable[i] )
+			mismatches++;
+	}
+
+	printf( "mismatches: %u\n", mismatches );
+
+	a.quit();
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,465 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// benchmarks route queries of a routing module ( Contraction Hierarchies + GPS Grid )
+// the query sets are reproducible for a given seed: uniform random pairs, local pairs and pairs by Dijkstra rank 2^k
+// every set runs single threaded and multi threaded, the results are printed as JSON to track regressions
+
+#include "plugins/contractionhierarchies/contractionhierarchiesclient.h"
+#include "plugins/contractionhierarchies/compressedgraph.h"
+#include "plugins/contractionhierarchies/binaryheap.h"
+#include "plugins/gpsgrid/gpsgridclient.h"
+#include "interfaces/iquerystatistics.h"
+#include "utils/qthelpers.h"
+#include "stdio.h"
+
+#include <QtCore/QCoreApplication>
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#ifndef _OPENMP
+#define omp_get_thread_num() (0)
+#define omp_get_max_threads() (1)
+#else
+#include <omp.h>
+#endif
+
+typedef CompressedGraph::NodeIterator NodeIterator;
+typedef CompressedGraph::EdgeIterator EdgeIterator;
+
+struct Query {
+	IGPSLookup::Result source;
+	IGPSLookup::Result target;
+};
+
+struct QuerySet {
+	QString name;
+	// Dijkstra rank of the targets, 0 for the other sets
+	unsigned rank;
+	std::vector< Query > queries;
+};
+
+struct Settings {
+	unsigned queries;
+	unsigned rankSources;
+	unsigned seed;
+	int threads;
+	// maximal distance between source and target of the local queries
+	double localRadius;
+	bool memoryMapped;
+};
+
+// the original edges in both directions, indexed by node ID
+struct OriginalGraph {
+	struct Arc {
+		NodeIterator target;
+		int distance;
+	};
+	std::vector< unsigned > firstArc;
+	std::vector< Arc > arcs;
+};
+
+struct DijkstraData {
+};
+
+typedef BinaryHeap< NodeIterator, unsigned, int, DijkstraData > Heap;
+
+struct Run {
+	int threads;
+	unsigned found;
+	double seconds;
+	// microseconds, sorted
+	std::vector< double > latencies;
+	IQueryStatistics::QueryStatistics statistics;
+};
+
+// radius in meters used to snap a coordinate to the nearest routing edge
+static const double snapRadius = 200;
+
+void printHelp()
+{
+	printf( "Usage:\n" );
+	printf( "\tmonav-bench routing-module-dir [options]\n" );
+	printf( "\t--queries N: queries of the uniform and local sets, default 1000\n" );
+	printf( "\t--rank-sources N: sources of the Dijkstra rank sets, each yields one query per rank, default 100\n" );
+	printf( "\t--seed S: seed of the query generation, default 1\n" );
+	printf( "\t--threads T: threads of the multi threaded runs, default all cores\n" );
+	printf( "\t--local-radius M: maximal distance in meters of the local queries, default 2000\n" );
+	printf( "\t--mapped: memory maps the graph instead of using the bounded block cache\n" );
+}
+
+static NodeIterator randomNode( CompressedGraph* graph, CompressedGraph::Cache* cache )
+{
+	while ( true ) {
+		unsigned block = rand() % graph->numberOfBlocks();
+		unsigned count = graph->numberOfNodes( cache, block );
+		if ( count != 0 )
+			return graph->nodeID( block, rand() % count );
+	}
+}
+
+static bool snap( IGPSLookup* gpsLookup, const UnsignedCoordinate& coordinate, IGPSLookup::Result* result )
+{
+	return gpsLookup->GetNearestEdge( result, coordinate, snapRadius );
+}
+
+static bool snapNode( CompressedGraph* graph, CompressedGraph::Cache* cache, IGPSLookup* gpsLookup, NodeIterator node, IGPSLookup::Result* result )
+{
+	return snap( gpsLookup, graph->node( cache, node ).coordinate, result );
+}
+
+static void generateUniform( CompressedGraph* graph, CompressedGraph::Cache* cache, IGPSLookup* gpsLookup, const Settings& settings, QuerySet* set )
+{
+	set->name = "uniform";
+	set->rank = 0;
+	for ( unsigned attempt = 0; set->queries.size() < settings.queries && attempt < settings.queries * 100; attempt++ ) {
+		Query query;
+		NodeIterator source = randomNode( graph, cache );
+		NodeIterator target = randomNode( graph, cache );
+		if ( !snapNode( graph, cache, gpsLookup, source, &query.source ) )
+			continue;
+		if ( !snapNode( graph, cache, gpsLookup, target, &query.target ) )
+			continue;
+		set->queries.push_back( query );
+	}
+}
+
+// targets are random coordinates within the local radius around the source
+static void generateLocal( CompressedGraph* graph, CompressedGraph::Cache* cache, IGPSLookup* gpsLookup, const Settings& settings, QuerySet* set )
+{
+	set->name = "local";
+	set->rank = 0;
+	for ( unsigned attempt = 0; set->queries.size() < settings.queries && attempt < settings.queries * 100; attempt++ ) {
+		Query query;
+		NodeIterator source = randomNode( graph, cache );
+		const UnsignedCoordinate coordinate = graph->node( cache, source ).coordinate;
+		if ( !snap( gpsLookup, coordinate, &query.source ) )
+			continue;
+
+		// the mercator projection is conformal, the scale is the same in both directions
+		const GPSCoordinate gps = coordinate.ToGPSCoordinate();
+		const GPSCoordinate gpsMoved( gps.latitude, gps.longitude + 1 );
+		const double unsignedPerMeter = ( ( double ) UnsignedCoordinate( gpsMoved ).x - coordinate.x ) / gps.ApproximateDistance( gpsMoved );
+		const double angle = 2 * M_PI * ( rand() % 3600 ) / 3600.0;
+		const double distance = settings.localRadius * ( rand() % 1001 ) / 1000.0 * unsignedPerMeter;
+		const double x = coordinate.x + distance * cos( angle );
+		const double y = coordinate.y + distance * sin( angle );
+		if ( x < 0 || y < 0 || x > std::numeric_limits< unsigned >::max() || y > std::numeric_limits< unsigned >::max() )
+			continue;
+		if ( !snap( gpsLookup, UnsignedCoordinate( x, y ), &query.target ) )
+			continue;
+		set->queries.push_back( query );
+	}
+}
+
+static void buildOriginalGraph( CompressedGraph* graph, CompressedGraph::Cache* cache, OriginalGraph* original )
+{
+	std::vector< std::pair< NodeIterator, OriginalGraph::Arc > > arcs;
+	for ( unsigned block = 0; block < graph->numberOfBlocks(); block++ ) {
+		unsigned count = graph->numberOfNodes( cache, block );
+		for ( unsigned internal = 0; internal < count; internal++ ) {
+			NodeIterator node = graph->nodeID( block, internal );
+			for ( EdgeIterator edge = graph->edges( cache, node ); edge.hasEdgesLeft(); ) {
+				graph->unpackNextEdge( &edge );
+				if ( edge.shortcut() )
+					continue;
+				OriginalGraph::Arc arc;
+				arc.distance = edge.distance();
+				if ( edge.forward() ) {
+					arc.target = edge.target();
+					arcs.push_back( std::make_pair( node, arc ) );
+				}
+				if ( edge.backward() ) {
+					arc.target = node;
+					arcs.push_back( std::make_pair( edge.target(), arc ) );
+				}
+			}
+		}
+	}
+
+	original->firstArc.assign( graph->numberOfNodeIDs() + 1, 0 );
+	for ( unsigned i = 0; i < arcs.size(); i++ )
+		original->firstArc[arcs[i].first + 1]++;
+	for ( unsigned node = 0; node < graph->numberOfNodeIDs(); node++ )
+		original->firstArc[node + 1] += original->firstArc[node];
+	original->arcs.resize( arcs.size() );
+	std::vector< unsigned > position( original->firstArc.begin(), original->firstArc.end() - 1 );
+	for ( unsigned i = 0; i < arcs.size(); i++ )
+		original->arcs[position[arcs[i].first]++] = arcs[i].second;
+}
+
+// one Dijkstra search per source, the node settled as 2^k-th becomes the target of the rank 2^k query
+static void generateRanks( CompressedGraph* graph, CompressedGraph::Cache* cache, IGPSLookup* gpsLookup, const Settings& settings, std::vector< QuerySet >* sets )
+{
+	OriginalGraph original;
+	buildOriginalGraph( graph, cache, &original );
+
+	const unsigned minimumRank = 4;
+	unsigned maximumRank = minimumRank;
+	while ( ( 2u << maximumRank ) <= graph->numberOfNodes() && maximumRank < 31 )
+		maximumRank++;
+	const unsigned first = sets->size();
+	for ( unsigned rank = minimumRank; rank <= maximumRank; rank++ ) {
+		QuerySet set;
+		set.name = QString( "rank" );
+		set.rank = 1u << rank;
+		sets->push_back( set );
+	}
+
+	Heap heap( graph->numberOfNodeIDs() );
+	for ( unsigned attempt = 0, sources = 0; sources < settings.rankSources && attempt < settings.rankSources * 100; attempt++ ) {
+		Query query;
+		NodeIterator source = randomNode( graph, cache );
+		if ( !snapNode( graph, cache, gpsLookup, source, &query.source ) )
+			continue;
+		sources++;
+
+		heap.Clear();
+		heap.Insert( source, 0, DijkstraData() );
+		unsigned settled = 0;
+		unsigned rank = minimumRank;
+		while ( heap.Size() != 0 && rank <= maximumRank ) {
+			NodeIterator node = heap.DeleteMin();
+			const int distance = heap.GetKey( node );
+			settled++;
+			if ( settled == 1u << rank ) {
+				if ( snapNode( graph, cache, gpsLookup, node, &query.target ) )
+					( *sets )[first + rank - minimumRank].queries.push_back( query );
+				rank++;
+			}
+			for ( unsigned arc = original.firstArc[node]; arc < original.firstArc[node + 1]; arc++ ) {
+				const OriginalGraph::Arc& edge = original.arcs[arc];
+				const int newDistance = distance + edge.distance;
+				if ( !heap.WasInserted( edge.target ) )
+					heap.Insert( edge.target, newDistance, DijkstraData() );
+				else if ( !heap.WasRemoved( edge.target ) && newDistance < heap.GetKey( edge.target ) )
+					heap.DecreaseKey( edge.target, newDistance );
+			}
+		}
+	}
+}
+
+// every run starts with fresh query contexts, i.e., with cold block caches, to keep the runs comparable
+static void runQueries( IRouter* router, IQueryStatistics* queryStatistics, const std::vector< Query >& queries, int threads, Run* run )
+{
+	std::vector< IRouter::QueryContext* > contexts;
+	for ( int thread = 0; thread < threads; thread++ )
+		contexts.push_back( router->CreateQueryContext() );
+	std::vector< IQueryStatistics::QueryStatistics > statistics( queries.size() );
+	std::vector< char > found( queries.size(), 0 );
+	run->threads = threads;
+	run->latencies.assign( queries.size(), 0 );
+
+	QElapsedTimer total;
+	total.start();
+#pragma omp parallel num_threads( threads )
+	{
+		IRouter::QueryContext* context = contexts[omp_get_thread_num()];
+		QVector< IRouter::Node > pathNodes;
+		QVector< IRouter::Edge > pathEdges;
+		QElapsedTimer timer;
+#pragma omp for schedule( dynamic, 16 )
+		for ( int i = 0; i < ( int ) queries.size(); i++ ) {
+			double distance;
+			timer.start();
+			found[i] = router->GetRoute( context, &distance, &pathNodes, &pathEdges, queries[i].source, queries[i].target );
+			run->latencies[i] = timer.nsecsElapsed() / 1000.0;
+			queryStatistics->GetQueryStatistics( context, &statistics[i] );
+		}
+	}
+	run->seconds = total.nsecsElapsed() / 1000000000.0;
+
+	run->found = 0;
+	run->statistics = IQueryStatistics::QueryStatistics();
+	for ( unsigned i = 0; i < queries.size(); i++ ) {
+		if ( found[i] )
+			run->found++;
+		run->statistics.add( statistics[i] );
+	}
+	std::sort( run->latencies.begin(), run->latencies.end() );
+	for ( int thread = 0; thread < threads; thread++ )
+		delete contexts[thread];
+}
+
+// nearest rank percentile of sorted values
+static double percentile( const std::vector< double >& values, double fraction )
+{
+	if ( values.empty() )
+		return 0;
+	unsigned index = ( unsigned ) ceil( fraction * values.size() );
+	return values[std::min( std::max( index, 1u ), ( unsigned ) values.size() ) - 1];
+}
+
+static void printRun( const Run& run, unsigned queries, bool last )
+{
+	const double count = std::max( queries, 1u );
+	const IQueryStatistics::QueryStatistics& statistics = run.statistics;
+	double mean = 0;
+	for ( unsigned i = 0; i < run.latencies.size(); i++ )
+		mean += run.latencies[i];
+	const unsigned blockAccesses = statistics.blocks + statistics.pathBlocks;
+	const unsigned blockReads = statistics.blocksRead + statistics.pathBlocksRead;
+	printf( "\t\t\t\t{\n" );
+	printf( "\t\t\t\t\t\"threads\": %d,\n", run.threads );
+	printf( "\t\t\t\t\t\"found\": %u,\n", run.found );
+	printf( "\t\t\t\t\t\"seconds\": %.6lf,\n", run.seconds );
+	printf( "\t\t\t\t\t\"queriesPerSecond\": %.1lf,\n", queries / std::max( run.seconds, 1e-9 ) );
+	printf( "\t\t\t\t\t\"latencyMicroseconds\": { \"mean\": %.2lf, \"p50\": %.2lf, \"p95\": %.2lf, \"p99\": %.2lf, \"max\": %.2lf },\n",
+			  mean / count,
+			  percentile( run.latencies, 0.50 ),
+			  percentile( run.latencies, 0.95 ),
+			  percentile( run.latencies, 0.99 ),
+			  run.latencies.empty() ? 0.0 : run.latencies.back() );
+	printf( "\t\t\t\t\t\"settledNodes\": %.2lf,\n", ( statistics.settledForward + statistics.settledBackward ) / count );
+	printf( "\t\t\t\t\t\"stalledNodes\": %.2lf,\n", statistics.stalled / count );
+	printf( "\t\t\t\t\t\"relaxedEdges\": %.2lf,\n", statistics.relaxedEdges / count );
+	printf( "\t\t\t\t\t\"maxUnpackDepth\": %u,\n", statistics.unpackDepth );
+	printf( "\t\t\t\t\t\"blockCache\": { \"blocks\": %.2lf, \"blocksRead\": %.2lf, \"decodedBlocks\": %.2lf, \"pathBlocks\": %.2lf, \"pathBlocksRead\": %.2lf, \"hitRate\": %.4lf }\n",
+			  statistics.blocks / count,
+			  statistics.blocksRead / count,
+			  statistics.decodedBlocks / count,
+			  statistics.pathBlocks / count,
+			  statistics.pathBlocksRead / count,
+			  blockAccesses == 0 ? 1.0 : 1.0 - ( double ) blockReads / blockAccesses );
+	printf( "\t\t\t\t}%s\n", last ? "" : "," );
+}
+
+static QString escape( QString text )
+{
+	return text.replace( "\\", "\\\\" ).replace( "\"", "\\\"" );
+}
+
+int main( int argc, char *argv[] )
+{
+	QCoreApplication a( argc, argv );
+
+	QStringList args = a.arguments();
+	if ( args.size() < 2 ) {
+		printHelp();
+		return -1;
+	}
+	Settings settings;
+	settings.queries = 1000;
+	settings.rankSources = 100;
+	settings.seed = 1;
+	settings.threads = omp_get_max_threads();
+	settings.localRadius = 2000;
+	settings.memoryMapped = false;
+	for ( int i = 2; i < args.size(); i++ ) {
+		bool ok = true;
+		if ( args[i] == "--mapped" ) {
+			settings.memoryMapped = true;
+			continue;
+		}
+		if ( i + 1 >= args.size() ) {
+			printHelp();
+			return -1;
+		}
+		QString value = args[++i];
+		if ( args[i - 1] == "--queries" )
+			settings.queries = value.toUInt( &ok );
+		else if ( args[i - 1] == "--rank-sources" )
+			settings.rankSources = value.toUInt( &ok );
+		else if ( args[i - 1] == "--seed" )
+			settings.seed = value.toUInt( &ok );
+		else if ( args[i - 1] == "--threads" )
+			settings.threads = value.toInt( &ok );
+		else if ( args[i - 1] == "--local-radius" )
+			settings.localRadius = value.toDouble( &ok );
+		else
+			ok = false;
+		if ( !ok || settings.threads < 1 || settings.localRadius <= 0 ) {
+			printHelp();
+			return -1;
+		}
+	}
+
+	ContractionHierarchiesClient contractionHierarchies;
+	contractionHierarchies.SetInputDirectory( args[1] );
+	contractionHierarchies.SetCacheMode( settings.memoryMapped ? ICacheSettings::MemoryMapped : ICacheSettings::BoundedCache );
+	GPSGridClient gpsGrid;
+	gpsGrid.SetInputDirectory( args[1] );
+	if ( !contractionHierarchies.LoadData() || !gpsGrid.LoadData() ) {
+		qCritical() << "failed to load the routing module";
+		return -1;
+	}
+	contractionHierarchies.SetCollectStatistics( true );
+
+	// the query generation reads the graph on its own, it does not touch the caches of the client
+	CompressedGraph graph;
+	if ( !graph.loadGraph( fileInDirectory( args[1], "Contraction Hierarchies" ), 0, true ) ) {
+		qCritical() << "failed to load the contraction hierarchies data";
+		return -1;
+	}
+	if ( graph.numberOfBlocks() == 0 ) {
+		qCritical() << "graph is empty";
+		return -1;
+	}
+	CompressedGraph::Cache cache;
+	graph.loadCache( &cache );
+
+	Timer time;
+	srand( settings.seed );
+	std::vector< QuerySet > sets( 2 );
+	generateUniform( &graph, &cache, &gpsGrid, settings, &sets[0] );
+	generateLocal( &graph, &cache, &gpsGrid, settings, &sets[1] );
+	generateRanks( &graph, &cache, &gpsGrid, settings, &sets );
+	qDebug() << "generated the query sets:" << time.restart() << "ms";
+
+	std::vector< int > threads;
+	threads.push_back( 1 );
+	if ( settings.threads > 1 )
+		threads.push_back( settings.threads );
+
+	printf( "{\n" );
+	printf( "\t\"module\": \"%s\",\n", escape( args[1] ).toUtf8().constData() );
+	printf( "\t\"cacheMode\": \"%s\",\n", settings.memoryMapped ? "mapped" : "bounded" );
+	printf( "\t\"nodes\": %u,\n", graph.numberOfNodes() );
+	printf( "\t\"blocks\": %u,\n", graph.numberOfBlocks() );
+	printf( "\t\"seed\": %u,\n", settings.seed );
+	printf( "\t\"sets\": [\n" );
+	for ( unsigned set = 0; set < sets.size(); set++ ) {
+		const QuerySet& querySet = sets[set];
+		printf( "\t\t{\n" );
+		printf( "\t\t\t\"name\": \"%s\",\n", querySet.name.toUtf8().constData() );
+		if ( querySet.rank != 0 )
+			printf( "\t\t\t\"rank\": %u,\n", querySet.rank );
+		printf( "\t\t\t\"queries\": %u,\n", ( unsigned ) querySet.queries.size() );
+		printf( "\t\t\t\"runs\": [\n" );
+		for ( unsigned i = 0; i < threads.size(); i++ ) {
+			Run run;
+			runQueries( &contractionHierarchies, &contractionHierarchies, querySet.queries, threads[i], &run );
+			printRun( run, querySet.queries.size(), i + 1 == threads.size() );
+		}
+		printf( "\t\t\t]\n" );
+		printf( "\t\t}%s\n", set + 1 == sets.size() ? "" : "," );
+	}
+	printf( "\t]\n" );
+	printf( "}\n" );
+	qDebug() << "ran the benchmark:" << time.elapsed() << "ms";
+
+	a.quit();
+	return 0;
+}
@@ -0,0 +1,38 @@
+QT       += core
+
+QT       -= gui
+
+INCLUDEPATH += ../..
+
+TARGET = monav-bench
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+DEFINES += NOGUI
+
+unix {
+	QMAKE_CXXFLAGS_RELEASE -= -O2
+	QMAKE_CXXFLAGS_RELEASE += -O3 \
+		 -Wno-unused-function \
+		 -fopenmp
+	QMAKE_CXXFLAGS_DEBUG += -Wno-unused-function \
+		 -fopenmp
+}
+
+# build the client plugins first, e.g., with monavroutingdaemon.pro
+LIBS += -fopenmp -L../../bin/plugins_client -lcontractionhierarchiesclient -lgpsgridclient
+
+SOURCES += main.cpp
+
+HEADERS += \
+	 ../../plugins/contractionhierarchies/contractionhierarchiesclient.h \
+	 ../../plugins/contractionhierarchies/compressedgraph.h \
+	 ../../plugins/contractionhierarchies/frequencycache.h \
+	 ../../plugins/contractionhierarchies/binaryheap.h \
+	 ../../plugins/gpsgrid/gpsgridclient.h \
+	 ../../interfaces/iquerystatistics.h \
+	 ../../utils/bithelpers.h \
+	 ../../utils/bitunpack.h \
+	 ../../utils/qthelpers.h
@@ -111,6 +111,37 @@ static inline void write_unaligned_unsigned( unsigned char** buffer, unsigned da
 	*offset &= 7;
 }
 
+// appends data in 7 bit groups, least significant first, the highest bit of a byte marks that more bytes follow
+static inline void write_varint( std::vector< unsigned char >* buffer, unsigned data ) {
+	while ( data >= 128 ) {
+		buffer->push_back( ( data & 127 ) | 128 );
+		data >>= 7;
+	}
+	buffer->push_back( data );
+}
+
+// reads a value written by write_varint and advances the buffer behind it
+static inline unsigned read_varint( const unsigned char** buffer ) {
+	const unsigned char* position = *buffer;
+	unsigned result = *position & 127;
+	int shift = 7;
+	while ( *position++ & 128 ) {
+		result |= ( unsigned ) ( *position & 127 ) << shift;
+		shift += 7;
+	}
+	*buffer = position;
+	return result;
+}
+
+// maps signed values to unsigned ones with small absolute values staying small: 0, -1, 1, -2, ...
+static inline unsigned encode_zigzag( int data ) {
+	return ( ( unsigned ) data << 1 ) ^ ( unsigned ) ( data >> 31 );
+}
+
+static inline int decode_zigzag( unsigned data ) {
+	return ( int ) ( data >> 1 ) ^ -( int ) ( data & 1 );
+}
+
 static inline unsigned read_bits ( unsigned data, char bits ) {
 	if ( bits == 32 )
 		return data;
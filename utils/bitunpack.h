@@ -0,0 +1,196 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BITUNPACK_H
+#define BITUNPACK_H
+
+#include <QtGlobal>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+
+// decoders for runs of fixed width bit fields, e.g., the first edge tables and coordinates of the compressed graph
+// picks the fastest kernel supported by the CPU at runtime, falls back to portable code everywhere else
+// all kernels read only the bytes covered by the fields, data is little endian
+
+#if defined( __x86_64__ ) && ( defined( __clang__ ) || ( __GNUC__ > 4 ) || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) )
+#define BITUNPACK_X86
+#include <immintrin.h>
+#define BITUNPACK_TARGET( isa ) __attribute__( ( target( isa ) ) )
+#endif
+
+typedef void ( *UnpackBitsKernel )( const unsigned char* buffer, unsigned position, int bits, unsigned stride, unsigned count, unsigned* out );
+
+static inline quint64 unpack_bits_load( const unsigned char* buffer )
+{
+	quint64 temp;
+	memcpy( &temp, buffer, sizeof( temp ) );
+	return temp;
+}
+
+// first byte behind the last field
+static inline size_t unpack_bits_end( unsigned position, int bits, unsigned stride, unsigned count )
+{
+	return ( ( size_t ) position + ( size_t ) stride * ( count - 1 ) + bits + 7 ) >> 3;
+}
+
+// reads a single field byte by byte, never touches bytes outside of the field
+static inline unsigned unpack_bits_field( const unsigned char* buffer, unsigned position, int bits )
+{
+	const unsigned char* data = buffer + ( position >> 3 );
+	const int offset = position & 7;
+	const int bytes = ( offset + bits + 7 ) >> 3;
+	quint64 value = 0;
+	for ( int i = 0; i < bytes; i++ )
+		value |= ( quint64 ) data[i] << ( 8 * i );
+	return ( value >> offset ) & ( ( ( quint64 ) 1 << bits ) - 1 );
+}
+
+// one unaligned 64 bit load per field, the fields near the end of the run are read byte by byte
+static void unpack_bits_scalar( const unsigned char* buffer, unsigned position, int bits, unsigned stride, unsigned count, unsigned* out )
+{
+	assert( bits <= 32 );
+	if ( count == 0 )
+		return;
+	const size_t end = unpack_bits_end( position, bits, stride, count );
+	const quint64 mask = ( ( quint64 ) 1 << bits ) - 1;
+	unsigned i = 0;
+	for ( ; i < count && ( position >> 3 ) + 8 <= end; i++, position += stride )
+		out[i] = ( unpack_bits_load( buffer + ( position >> 3 ) ) >> ( position & 7 ) ) & mask;
+	for ( ; i < count; i++, position += stride )
+		out[i] = unpack_bits_field( buffer, position, bits );
+}
+
+#ifdef BITUNPACK_X86
+
+// BMI2: pext gathers up to four fields of a 64 bit word, pdep spreads them into 16 bit lanes
+// which are widened with a single SSE4.1 instruction
+// fields wider than 16 bits are handled by the scalar kernel
+BITUNPACK_TARGET( "bmi2,sse4.1" )
+static void unpack_bits_bmi2( const unsigned char* buffer, unsigned position, int bits, unsigned stride, unsigned count, unsigned* out )
+{
+	assert( bits <= 32 );
+	if ( count == 0 )
+		return;
+	if ( bits > 16 || stride == 0 || stride > 25 ) {
+		unpack_bits_scalar( buffer, position, bits, stride, count, out );
+		return;
+	}
+	// 7 bits offset + the fields have to fit into the word
+	const unsigned perWord = std::min( 4u, ( 57 - bits ) / stride + 1 );
+	const size_t end = unpack_bits_end( position, bits, stride, count );
+	const quint64 mask = ( ( quint64 ) 1 << bits ) - 1;
+	quint64 fieldMask = 0;
+	quint64 laneMask = 0;
+	for ( unsigned j = 0; j < perWord; j++ ) {
+		fieldMask |= mask << ( j * stride );
+		laneMask |= mask << ( j * 16 );
+	}
+
+	unsigned i = 0;
+	for ( ; i + 4 <= count && ( position >> 3 ) + 8 <= end; ) {
+		quint64 word = unpack_bits_load( buffer + ( position >> 3 ) ) >> ( position & 7 );
+		if ( stride != ( unsigned ) bits )
+			word = _pext_u64( word, fieldMask );
+		word = _pdep_u64( word, laneMask );
+		_mm_storeu_si128( ( __m128i* ) ( out + i ), _mm_cvtepu16_epi32( _mm_loadl_epi64( ( const __m128i* ) &word ) ) );
+		i += perWord;
+		position += perWord * stride;
+	}
+	unpack_bits_scalar( buffer, position, bits, stride, count - i, out + i );
+}
+
+// AVX2: two 16 byte loads per 8 fields, pshufb moves the 4 bytes containing a field into its lane,
+// a variable shift per lane aligns the fields
+// requires every field to fit into 4 bytes and 4 consecutive fields into 16 bytes
+BITUNPACK_TARGET( "avx2" )
+static void unpack_bits_avx2( const unsigned char* buffer, unsigned position, int bits, unsigned stride, unsigned count, unsigned* out )
+{
+	assert( bits <= 32 );
+	if ( count == 0 )
+		return;
+	if ( bits > 25 || stride > 32 ) {
+		unpack_bits_scalar( buffer, position, bits, stride, count, out );
+		return;
+	}
+
+	// shuffle / shift controls of 4 lanes for each possible bit offset of the first field
+	__m128i shuffles[8];
+	__m128i shifts[8];
+	for ( unsigned offset = 0; offset < 8; offset++ ) {
+		char shuffle[16];
+		int shift[4];
+		for ( unsigned lane = 0; lane < 4; lane++ ) {
+			const unsigned fieldPosition = offset + lane * stride;
+			for ( unsigned byte = 0; byte < 4; byte++ )
+				shuffle[lane * 4 + byte] = ( fieldPosition >> 3 ) + byte;
+			shift[lane] = fieldPosition & 7;
+		}
+		shuffles[offset] = _mm_loadu_si128( ( const __m128i* ) shuffle );
+		shifts[offset] = _mm_setr_epi32( shift[0], shift[1], shift[2], shift[3] );
+	}
+	const __m256i mask = _mm256_set1_epi32( ( ( quint64 ) 1 << bits ) - 1 );
+	const size_t end = unpack_bits_end( position, bits, stride, count );
+
+	unsigned i = 0;
+	for ( ; i + 8 <= count; i += 8 ) {
+		const unsigned second = position + 4 * stride;
+		if ( ( second >> 3 ) + 16 > end )
+			break;
+		const __m128i low = _mm_loadu_si128( ( const __m128i* ) ( buffer + ( position >> 3 ) ) );
+		const __m128i high = _mm_loadu_si128( ( const __m128i* ) ( buffer + ( second >> 3 ) ) );
+		__m256i data = _mm256_inserti128_si256( _mm256_castsi128_si256( low ), high, 1 );
+		const __m256i shuffle = _mm256_inserti128_si256( _mm256_castsi128_si256( shuffles[position & 7] ), shuffles[second & 7], 1 );
+		const __m256i shift = _mm256_inserti128_si256( _mm256_castsi128_si256( shifts[position & 7] ), shifts[second & 7], 1 );
+		data = _mm256_shuffle_epi8( data, shuffle );
+		data = _mm256_and_si256( _mm256_srlv_epi32( data, shift ), mask );
+		_mm256_storeu_si256( ( __m256i* ) ( out + i ), data );
+		position += 8 * stride;
+	}
+	unpack_bits_scalar( buffer, position, bits, stride, count - i, out + i );
+}
+
+#endif // BITUNPACK_X86
+
+// kernel used by unpack_bits
+static inline UnpackBitsKernel unpack_bits_kernel()
+{
+	// racing initializations agree on the result
+	static UnpackBitsKernel kernel = NULL;
+	if ( kernel != NULL )
+		return kernel;
+	UnpackBitsKernel selected = unpack_bits_scalar;
+#ifdef BITUNPACK_X86
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx2" ) )
+		selected = unpack_bits_avx2;
+	else if ( __builtin_cpu_supports( "bmi2" ) && __builtin_cpu_supports( "sse4.1" ) )
+		selected = unpack_bits_bmi2;
+#endif
+	kernel = selected;
+	return kernel;
+}
+
+// unpacks count fields of bits <= 32 bits, the i-th field starts at bit position + i * stride
+static inline void unpack_bits( const unsigned char* buffer, unsigned position, int bits, unsigned stride, unsigned count, unsigned* out )
+{
+	unpack_bits_kernel()( buffer, position, bits, stride, count, out );
+}
+
+#endif // BITUNPACK_H
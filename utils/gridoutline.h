@@ -0,0 +1,174 @@
+/*
+Copyright 2010  Christian Vetter veaac.fdirct@gmail.com
+
+This file is part of MoNav.
+
+MoNav is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+MoNav is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with MoNav.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GRIDOUTLINE_H
+#define GRIDOUTLINE_H
+
+#include "utils/coordinates.h"
+#include <QVector>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// rasterizes points and line segments into square cells
+// and traces the outlines of the area covered
+class GridOutline
+{
+
+public:
+
+	GridOutline( unsigned cellSize )
+	{
+		assert( cellSize > 0 );
+		m_cellSize = cellSize;
+	}
+
+	void addPoint( const UnsignedCoordinate& point )
+	{
+		m_cells.push_back( key( point.x / m_cellSize, point.y / m_cellSize ) );
+	}
+
+	void addSegment( const UnsignedCoordinate& from, const UnsignedCoordinate& to )
+	{
+		double dx = ( double ) to.x - from.x;
+		double dy = ( double ) to.y - from.y;
+		// at most half a cell per step => no cell is skipped
+		unsigned steps = std::max( fabs( dx ), fabs( dy ) ) * 2 / m_cellSize + 1;
+		for ( unsigned step = 0; step <= steps; step++ ) {
+			double fraction = ( double ) step / steps;
+			addPoint( UnsignedCoordinate( from.x + dx * fraction, from.y + dy * fraction ) );
+		}
+	}
+
+	// outer boundaries run counter-clockwise around the covered cells
+	// ( with the y axis pointing upwards ), holes clockwise
+	// cells touching only at a corner are separated
+	void outlines( QVector< QVector< UnsignedCoordinate > >* rings )
+	{
+		std::sort( m_cells.begin(), m_cells.end() );
+		m_cells.erase( std::unique( m_cells.begin(), m_cells.end() ), m_cells.end() );
+
+		// boundary segments with the covered cell on their left
+		std::vector< Segment > segments;
+		for ( unsigned i = 0; i < m_cells.size(); i++ ) {
+			unsigned x = m_cells[i] >> 32;
+			unsigned y = m_cells[i] & 0xFFFFFFFFu;
+			if ( y == 0 || !covered( x, y - 1 ) )
+				segments.push_back( Segment( x, y, 1, 0 ) );
+			if ( !covered( x + 1, y ) )
+				segments.push_back( Segment( x + 1, y, 0, 1 ) );
+			if ( !covered( x, y + 1 ) )
+				segments.push_back( Segment( x + 1, y + 1, -1, 0 ) );
+			if ( x == 0 || !covered( x - 1, y ) )
+				segments.push_back( Segment( x, y + 1, 0, -1 ) );
+		}
+		std::sort( segments.begin(), segments.end() );
+
+		std::vector< bool > used( segments.size(), false );
+		for ( unsigned first = 0; first < segments.size(); first++ ) {
+			if ( used[first] )
+				continue;
+
+			QVector< UnsignedCoordinate > ring;
+			unsigned segment = first;
+			while ( true ) {
+				used[segment] = true;
+				const Segment& current = segments[segment];
+				ring.push_back( UnsignedCoordinate( current.x * m_cellSize, current.y * m_cellSize ) );
+				if ( current.x + current.dx == segments[first].x && current.y + current.dy == segments[first].y )
+					break;
+				unsigned next = nextSegment( segments, used, current );
+				if ( next == segments.size() )
+					break;
+				segment = next;
+			}
+			// only keep the corners
+			removeCollinear( &ring );
+			rings->push_back( ring );
+		}
+	}
+
+protected:
+
+	struct Segment {
+		unsigned x;
+		unsigned y;
+		int dx;
+		int dy;
+
+		Segment( unsigned x_, unsigned y_, int dx_, int dy_ ) : x( x_ ), y( y_ ), dx( dx_ ), dy( dy_ )
+		{
+		}
+
+		bool operator<( const Segment& right ) const
+		{
+			if ( x != right.x )
+				return x < right.x;
+			return y < right.y;
+		}
+	};
+
+	static quint64 key( unsigned x, unsigned y )
+	{
+		return ( ( quint64 ) x << 32 ) | y;
+	}
+
+	bool covered( unsigned x, unsigned y ) const
+	{
+		return std::binary_search( m_cells.begin(), m_cells.end(), key( x, y ) );
+	}
+
+	// continues at the end of the segment, at a vertex shared by two boundaries turn left
+	static unsigned nextSegment( const std::vector< Segment >& segments, const std::vector< bool >& used, const Segment& current )
+	{
+		Segment end( current.x + current.dx, current.y + current.dy, 0, 0 );
+		std::vector< Segment >::const_iterator i = std::lower_bound( segments.begin(), segments.end(), end );
+		unsigned result = segments.size();
+		for ( ; i != segments.end() && i->x == end.x && i->y == end.y; ++i ) {
+			unsigned index = i - segments.begin();
+			if ( used[index] )
+				continue;
+			if ( i->dx == -current.dy && i->dy == current.dx )
+				return index;
+			result = index;
+		}
+		return result;
+	}
+
+	static void removeCollinear( QVector< UnsignedCoordinate >* ring )
+	{
+		QVector< UnsignedCoordinate > result;
+		const int size = ring->size();
+		for ( int i = 0; i < size; i++ ) {
+			const UnsignedCoordinate& previous = ( *ring )[( i + size - 1 ) % size];
+			const UnsignedCoordinate& current = ( *ring )[i];
+			const UnsignedCoordinate& next = ( *ring )[( i + 1 ) % size];
+			bool horizontal = previous.y == current.y && current.y == next.y;
+			bool vertical = previous.x == current.x && current.x == next.x;
+			if ( !horizontal && !vertical )
+				result.push_back( current );
+		}
+		*ring = result;
+	}
+
+	unsigned m_cellSize;
+	std::vector< quint64 > m_cells;
+};
+
+#endif // GRIDOUTLINE_H